@@ -1,16 +1,29 @@
 #include "log-util.hpp"
+#include <sys/stat.h>
 #include <fstream>
+#include "selindex.hpp"
+#include "seltombstone.hpp"
 
 void LogUtil::print(
         const fru_set& frus,
         const std::string& start_time,
         const std::string& end_time,
-        bool opt_json,
+        OutputFormat fmt,
         std::ostream& os) {
-  std::unique_ptr<SELStream> stream =
-      make_stream(opt_json ? FORMAT_JSON : FORMAT_PRINT);
+  std::unique_ptr<SELStream> stream = make_stream(fmt);
+  SELTombstones tombstones(tombstone_path());
   for (auto& logfile : logfile_list()) {
     try {
+      stream->set_tombstones(tombstones.find(logfile));
+      struct stat st;
+      if (stat(logfile.c_str(), &st) == 0 &&
+          st.st_size >= SELIndex::min_log_size) {
+        SELIndex index(logfile, index_path(logfile));
+        RangeBuf buf(index.ranges(frus, start_time, end_time), index.data());
+        std::istream is(&buf);
+        stream->start(is, os, frus, start_time, end_time);
+        continue;
+      }
       auto fd = std::ifstream(logfile);
       if (!fd.is_open()) {
         throw std::runtime_error(logfile + " open failed");
@@ -26,7 +39,24 @@ void LogUtil::print(
 void LogUtil::clear(const fru_set& frus, const std::string& start_time, const std::string& end_time) {
   std::unique_ptr<SELStream> stream = make_stream(FORMAT_RAW);
   const std::vector<std::string>& llist = logfile_list();
+  SELTombstones tombstones(tombstone_path());
+  bool rewritten = false;
   for (auto& logfile : llist) {
+    struct stat st;
+    if (stat(logfile.c_str(), &st) != 0) {
+      continue;
+    }
+    if (st.st_size >= SELIndex::min_log_size) {
+      // Rewriting a large log wears the flash, hide the logs instead
+      // until the logfile is rotated out.
+      tombstones.add(logfile, frus, start_time, end_time, llist);
+      if (logfile == llist.back()) {
+        std::ofstream ofs(logfile, std::ios::app);
+        stream->log_cleared(ofs, frus, start_time, end_time);
+        stream->flush(ofs);
+      }
+      continue;
+    }
     auto fd = std::ifstream(logfile);
     if (!fd.is_open()) {
       continue;
@@ -36,6 +66,7 @@ void LogUtil::clear(const fru_set& frus, const std::string& start_time, const st
     if (!ofs.is_open()) {
       throw std::runtime_error(nfile + " creation failed");
     }
+    stream->set_tombstones(tombstones.find(logfile));
     stream->start(fd, ofs, frus, start_time, end_time);
     // If the last logfile, also add the "CLEARED"
     // log line as a breadcrumb
@@ -47,7 +78,11 @@ void LogUtil::clear(const fru_set& frus, const std::string& start_time, const st
     if (rename(nfile.c_str(), logfile.c_str())) {
       throw std::runtime_error(nfile + " renamed as " + logfile + " failed");
     }
+    rewritten = true;
+  }
+  // rsyslogd keeps writing to the replaced logfile otherwise.
+  if (rewritten) {
+    std::unique_ptr<rsyslogd> rd = make_rsyslogd();
+    rd->reload();
   }
-  std::unique_ptr<rsyslogd> rd = make_rsyslogd();
-  rd->reload();
 }
@@ -18,6 +18,19 @@ class LogUtil {
   virtual const std::vector<std::string>& logfile_list() {
     return logfile_list_;
   }
-  void print(const fru_set& frus, const std::string& start_time, const std::string& end_time, bool opt_json, std::ostream& os = std::cout);
+  // Where the SELIndex of a logfile is kept. It is rebuilt when lost,
+  // so keep it off the flash.
+  virtual std::string index_path(const std::string& logfile) {
+    return "/tmp/log-util/" + logfile.substr(logfile.rfind('/') + 1) + ".idx";
+  }
+  // Where the clears of large logs are kept. They have to survive a
+  // reboot like the logs.
+  virtual std::string tombstone_path() {
+    return "/mnt/data/logfile.cleared";
+  }
+  void print(const fru_set& frus, const std::string& start_time, const std::string& end_time, bool opt_json, std::ostream& os = std::cout) {
+    print(frus, start_time, end_time, opt_json ? FORMAT_JSON : FORMAT_PRINT, os);
+  }
+  void print(const fru_set& frus, const std::string& start_time, const std::string& end_time, OutputFormat fmt, std::ostream& os = std::cout);
   void clear(const fru_set& frus, const std::string& start_time, const std::string& end_time);
 };
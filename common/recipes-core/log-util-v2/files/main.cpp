@@ -33,7 +33,7 @@ std::string get_fru_list()
 }
 
 int main(int argc, char* argv[]) {
-  bool print = false, clear = false, opt_json = false;
+  bool print = false, clear = false, opt_json = false, opt_ndjson = false;
   std::set<std::string> fru_list;
   std::string fru_list_str = get_fru_list();
   std::regex pattern(R"(\s*,\s*)");
@@ -55,8 +55,12 @@ int main(int argc, char* argv[]) {
       actions->add_flag("--print", print, "Print the SEL for the given FRU");
   actions->add_flag("--clear", clear, "Clear SEL(s) of the given FRU");
   actions->require_option(1);
-  app.add_flag("--json", opt_json, "Print SEL(s) in JSON format")
+  auto json_opt = app.add_flag("--json", opt_json, "Print SEL(s) in JSON format")
       ->needs(print_opt);
+  app.add_flag("--ndjson", opt_ndjson,
+               "Print SEL(s) as one JSON object per line")
+      ->needs(print_opt)
+      ->excludes(json_opt);
   app.add_set("fru", fru, allowed_fru)->required();
 
   std::string start_time = "", end_time = "";
@@ -107,7 +111,13 @@ int main(int argc, char* argv[]) {
           strftime(curtime.data(), curtime.size(), "%Y-%m-%d %H:%M:%S", ts);
           end_time = curtime.data();
       }
-      util.print(action_fru_set, start_time, end_time, opt_json);
+      OutputFormat fmt = FORMAT_PRINT;
+      if (opt_json) {
+        fmt = FORMAT_JSON;
+      } else if (opt_ndjson) {
+        fmt = FORMAT_NDJSON;
+      }
+      util.print(action_fru_set, start_time, end_time, fmt);
 
     } else if (clear) {
       Exclusion guard;
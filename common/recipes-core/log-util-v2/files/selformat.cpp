@@ -1,11 +1,13 @@
 #include "selformat.hpp"
 #include "selexception.hpp"
 #include <openbmc/pal.h>
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <ctime>
 #include <time.h>
 #include <cstdio>
-#include <regex>
+#include <strings.h>
 #include <fstream>
 
 using namespace std::literals;
@@ -73,6 +75,183 @@ void SELFormat::set_clear_timestamp(uint8_t fru, const std::string& start_time,
     set_raw(std::move(log));
 }
 
+namespace {
+
+// \s of the C locale.
+bool is_space(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// The whitespace separated token at or after pos, empty at the end of
+// the line.
+std::string_view next_token(std::string_view line, size_t& pos) {
+  while (pos < line.size() && is_space(line[pos])) {
+    pos++;
+  }
+  size_t start = pos;
+  while (pos < line.size() && !is_space(line[pos])) {
+    pos++;
+  }
+  return line.substr(start, pos - start);
+}
+
+// 1 to max_digits digits within [lo, hi], as read by strptime().
+bool parse_int(std::string_view s, size_t max_digits, int lo, int hi, int& v) {
+  if (s.empty() || s.size() > max_digits) {
+    return false;
+  }
+  v = 0;
+  for (char c : s) {
+    if (!is_digit(c)) {
+      return false;
+    }
+    v = v * 10 + (c - '0');
+  }
+  return v >= lo && v <= hi;
+}
+
+// %b: the full or abbreviated name of a month, in any case.
+int parse_month(std::string_view s) {
+  static constexpr std::string_view names[] = {
+      "january", "february", "march", "april", "may", "june", "july",
+      "august", "september", "october", "november", "december"};
+  for (int i = 0; i < 12; i++) {
+    auto name = names[i];
+    if ((s.size() == 3 || s.size() == name.size()) &&
+        strncasecmp(s.data(), name.data(), s.size()) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// %H:%M:%S
+bool parse_hms(std::string_view s, int& hour, int& min, int& sec) {
+  auto c1 = s.find(':');
+  if (c1 == std::string_view::npos) {
+    return false;
+  }
+  auto c2 = s.find(':', c1 + 1);
+  if (c2 == std::string_view::npos) {
+    return false;
+  }
+  return parse_int(s.substr(0, c1), 2, 0, 23, hour) &&
+      parse_int(s.substr(c1 + 1, c2 - c1 - 1), 2, 0, 59, min) &&
+      parse_int(s.substr(c2 + 1), 2, 0, 61, sec);
+}
+
+// mktime() of a time read by strptime() into a zeroed struct tm.
+time_t local_time(int year, int mon, int mday, int hour, int min, int sec) {
+  // Not being DST, the seconds of a day just add up and mktime() is
+  // only needed once per day. Logs are mostly in order, but the few
+  // last days are kept for time ranges and logs written out of order.
+  struct day {
+    int year = -1, mon = -1, mday = -1;
+    time_t midnight = 0;
+  };
+  static std::array<day, 8> days;
+  static size_t next = 0;
+  auto it = std::find_if(days.begin(), days.end(), [&](const day& d) {
+    return d.mday == mday && d.mon == mon && d.year == year;
+  });
+  if (it == days.end()) {
+    std::tm ts{};
+    ts.tm_year = year - 1900;
+    ts.tm_mon = mon;
+    ts.tm_mday = mday;
+    it = days.begin() + next;
+    *it = {year, mon, mday, std::mktime(&ts)};
+    next = (next + 1) % days.size();
+  }
+  return it->midnight + hour * 3600 + min * 60 + sec;
+}
+
+// "HOSTNAME SEVERITY VERSION: APP: MESSAGE" from pos.
+bool tokenize_tail(std::string_view line, size_t pos, SELFormat::fields& f) {
+  f.hostname = next_token(line, pos);
+  auto severity = next_token(line, pos);
+  auto version = next_token(line, pos);
+  auto app = next_token(line, pos);
+  if (severity.empty() || version.size() < 2 || version.back() != ':' ||
+      app.size() < 2 || app.back() != ':' || line.size() - pos < 2) {
+    return false;
+  }
+  f.version = version.substr(0, version.size() - 1);
+  f.app = app.substr(0, app.size() - 1);
+  // At least one character, even if a space.
+  while (pos < line.size() - 1 && is_space(line[pos])) {
+    pos++;
+  }
+  f.msg = line.substr(pos);
+  return true;
+}
+
+} // namespace
+
+bool SELFormat::tokenize(std::string_view line, fields& f) {
+  // The three tokens before the current one, the closest first.
+  std::string_view prev[3];
+  fields legacy{};
+  bool has_legacy = false;
+
+  for (size_t pos = 0;;) {
+    auto tok = next_token(line, pos);
+    if (tok.empty()) {
+      break;
+    }
+    fields c{};
+    if (parse_hms(tok, c.hour, c.min, c.sec) &&
+        parse_int(prev[0], 2, 1, 31, c.mday) &&
+        (c.mon = parse_month(prev[1])) >= 0 && tokenize_tail(line, pos, c)) {
+      // The year need not start its token.
+      auto& year = prev[2];
+      if (year.size() >= 4 &&
+          parse_int(year.substr(year.size() - 4), 4, 0, 9999, c.year)) {
+        f = c;
+        f.legacy = false;
+        f.time = local_time(f.year, f.mon, f.mday, f.hour, f.min, f.sec);
+        return true;
+      }
+      if (!has_legacy) {
+        legacy = c;
+        has_legacy = true;
+      }
+    }
+    prev[2] = prev[1];
+    prev[1] = prev[0];
+    prev[0] = tok;
+  }
+  if (!has_legacy) {
+    return false;
+  }
+  f = legacy;
+  f.legacy = true;
+  f.year = 1900;
+  f.time = local_time(f.year, f.mon, f.mday, f.hour, f.min, f.sec);
+  return true;
+}
+
+int SELFormat::find_fru(std::string_view line) {
+  static constexpr std::string_view tag = "FRU: ";
+  for (size_t pos = line.find(tag); pos != std::string_view::npos;
+       pos = line.find(tag, pos + 1)) {
+    size_t end = pos + tag.size();
+    while (end < line.size() && is_digit(line[end])) {
+      end++;
+    }
+    int fru;
+    if (parse_int(line.substr(pos + tag.size(), end - pos - tag.size()), 9,
+                  0, 999999999, fru)) {
+      return fru;
+    }
+  }
+  return -1;
+}
+
 void SELFormat::set_raw(std::string&& line) {
   self_log_ = false;
   bare_ = true;
@@ -81,18 +260,20 @@ void SELFormat::set_raw(std::string&& line) {
     self_log_ = true;
     if (raw_.find("all logs") != std::string::npos) {
       fru_num_ = FRU_ALL;
+      fru_default_ = false;
     } else if (raw_.find("sys logs") != std::string::npos) {
       fru_num_ = FRU_SYS;
+      fru_default_ = false;
     }
   } else if (raw_.find(".crit") == std::string::npos) {
     throw SELParserError("Invalid log: " + raw_);
   } else {
     fru_num_ = default_fru_num_;
+    fru_default_ = true;
   }
-  static const std::regex find_fru_re(R"(FRU: (\d+))");
-  std::smatch find_fru_match;
-  if (regex_search(line, find_fru_match, find_fru_re)) {
-    fru_num_ = std::stoi(find_fru_match[1]);
+  if (int fru = find_fru(raw_); fru >= 0) {
+    fru_num_ = fru;
+    fru_default_ = false;
   }
   if (fru_num_ == FRU_ALL) {
     fru_ = "all";
@@ -103,86 +284,84 @@ void SELFormat::set_raw(std::string&& line) {
   } else {
     fru_ = get_fru_name(fru_num_);
   }
-  static const std::regex log_match(log_fmt.data());
-  static const std::regex log_match_legacy(log_fmt_legacy.data());
 
-  std::smatch sm;
-  if (bool year_fmt = false;
-      (year_fmt = std::regex_search(line, sm, log_match)) ||
-      std::regex_search(line, sm, log_match_legacy)) {
-    std::array<char, 256> curtime;
-    struct tm ts;
+  fields f;
+  if (!tokenize(raw_, f)) {
+    // Bare logs keep the time of the previous one.
+    hostname_ = version_ = app_ = msg_ = {};
+    return;
+  }
+  std::array<char, 32> curtime;
+  if (f.legacy) {
+    snprintf(curtime.data(), curtime.size(), "%02d-%02d %02d:%02d:%02d",
+             f.mon + 1, f.mday, f.hour, f.min, f.sec);
+  } else {
+    snprintf(curtime.data(), curtime.size(), "%04d-%02d-%02d %02d:%02d:%02d",
+             f.year, f.mon + 1, f.mday, f.hour, f.min, f.sec);
+  }
+  time_.assign(curtime.data());
+  has_time_ = true;
+  time_c_ = f.time;
+  hostname_ = f.hostname;
+  version_ = f.version;
+  app_ = f.app;
+  msg_ = f.msg;
+  bare_ = false;
+}
 
-    if (!year_fmt) {
-      strptime(sm[1].str().c_str(), "%b %d %H:%M:%S", &ts);
-      strftime(curtime.data(), curtime.size(), "%m-%d %H:%M:%S", &ts);
-    } else {
-      strptime(sm[1].str().c_str(), "%Y %b %d %H:%M:%S", &ts);
-      strftime(curtime.data(), curtime.size(), "%Y-%m-%d %H:%M:%S", &ts);
+bool SELFormat::parse_time(std::string_view str, time_t& t) {
+  // YYYY-MM-DD HH:MM:SS or MM-DD HH:MM:SS anywhere in str, with any
+  // whitespace in between.
+  auto match = [&](size_t pos, std::string_view pattern, int* out) {
+    for (char p : pattern) {
+      if (p == 'd') {
+        if (pos == str.size() || !is_digit(str[pos])) {
+          return false;
+        }
+        *out = *out * 10 + (str[pos++] - '0');
+        continue;
+      }
+      if (p == ' ') {
+        if (pos == str.size() || !is_space(str[pos])) {
+          return false;
+        }
+        while (pos < str.size() && is_space(str[pos])) {
+          pos++;
+        }
+      } else if (pos == str.size() || str[pos++] != p) {
+        return false;
+      }
+      // Next field.
+      out++;
+    }
+    return true;
+  };
+  // Year, month, day, hours, minutes, seconds.
+  int v[6];
+  for (auto [pattern, first] :
+       {std::pair{"dddd-dd-dd dd:dd:dd", 0}, std::pair{"dd-dd dd:dd:dd", 1}}) {
+    for (size_t pos = 0; pos < str.size(); pos++) {
+      std::fill(std::begin(v), std::end(v), 0);
+      // Legacy times have no year.
+      v[0] = first ? 1900 : 0;
+      if (!match(pos, pattern, v + first)) {
+        continue;
+      }
+      t = local_time(v[0], v[1] - 1, v[2], v[3], v[4], v[5]);
+      return true;
     }
-    time_.assign(curtime.data());
-    hostname_ = sm[2];
-    version_ = sm[3];
-    app_ = sm[4];
-    msg_ = sm[5];
-    bare_ = false;
   }
+  return false;
 }
 
 bool SELFormat::fits_time_range(const std::string& start_time, const std::string& end_time) {
-  time_t time_s, time_e, time_c;
-  std::smatch sm;
-
-  // construct the regexes
-  static const std::regex time_match(time_fmt.data());
-  static const std::regex time_match_legacy(time_fmt_legacy.data());
+  time_t time_s, time_e;
 
   // not expecting both of these strings to be in the same format just in case
-  if (std::regex_search(start_time, sm, time_match)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%Y-%m-%d %H:%M:%S", &ts);
-    time_s = std::mktime(&ts);
-  } else if (std::regex_search(start_time, sm, time_match_legacy)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%m-%d %H:%M:%S", &ts);
-    time_s = std::mktime(&ts);
-  } else {
-    return false;
-  }
-
-  if (std::regex_search(end_time, sm, time_match)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%Y-%m-%d %H:%M:%S", &ts);
-    time_e = std::mktime(&ts);
-  } else if (std::regex_search(end_time, sm, time_match_legacy)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%m-%d %H:%M:%S", &ts);
-    time_e = std::mktime(&ts);
-  } else {
+  if (!parse_time(start_time, time_s) || !parse_time(end_time, time_e)) {
     return false;
   }
-
-  // time_ is stored in a different format than displayed from what I can tell
-  if (std::regex_search(time_, sm, time_match)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%Y-%m-%d %H:%M:%S", &ts);
-    time_c = std::mktime(&ts);
-  } else if (std::regex_search(time_, sm, time_match_legacy)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%m-%d %H:%M:%S", &ts);
-    time_c = std::mktime(&ts);
-  } else {
-    return false;
-  }
-
-  // check if it is too old
-  if (difftime(time_s, time_c) > 0) {
-    return false;
-  }
-  if (difftime(time_c, time_e) > 0) {
-    return false;
-  }
-  return true;
+  return fits_time_range(time_s, time_e);
 }
 
 std::string SELFormat::str() const {
@@ -191,15 +370,15 @@ std::string SELFormat::str() const {
   return left_align(std::to_string(fru_num_), fru_num_left_align) + " " +
       left_align(fru_, fru_name_left_align) + " " +
       left_align(time_, time_left_align) + " " +
-      left_align(app_, app_left_align) + " " + msg_;
+      left_align(std::string(app_), app_left_align) + " " + std::string(msg_);
 }
 
 void SELFormat::json(nlohmann::json& j) const {
   j["FRU_NAME"] = fru_;
   j["FRU#"] = std::to_string(fru_num_);
   j["TIME_STAMP"] = time_;
-  j["APP_NAME"] = app_;
-  j["MESSAGE"] = msg_;
+  j["APP_NAME"] = std::string(app_);
+  j["MESSAGE"] = std::string(msg_);
 }
 
 void to_json(nlohmann::json& j, const SELFormat& sel) {
@@ -1,5 +1,6 @@
 #pragma once
 #include <nlohmann/json.hpp>
+#include <ctime>
 #include <set>
 #include <string>
 #include <string_view>
@@ -11,9 +12,24 @@ class SELFormat {
   static constexpr uint8_t FRU_SYS = 0xFE;
   static constexpr uint8_t FRU_ALL = 0x00;
 
+  // The fields of a log line, pointing into it.
+  struct fields {
+    std::string_view hostname;
+    std::string_view version;
+    std::string_view app;
+    std::string_view msg;
+    // Legacy time stamps have no year.
+    bool legacy;
+    int year, mon, mday, hour, min, sec;
+    time_t time;
+  };
+
   SELFormat(uint8_t default_fru_id)
       : default_fru_num_(default_fru_id), fru_num_(default_fru_id) {}
   virtual ~SELFormat() {}
+  // The fields point into raw_.
+  SELFormat(const SELFormat&) = delete;
+  SELFormat& operator=(const SELFormat&) = delete;
 
   static std::string left_align(const std::string& instr, size_t num);
   static std::string get_header();
@@ -37,16 +53,16 @@ class SELFormat {
   const std::string& time_stamp() const {
     return time_;
   }
-  const std::string& hostname() const {
+  std::string_view hostname() const {
     return hostname_;
   }
-  const std::string& version() const {
+  std::string_view version() const {
     return version_;
   }
-  const std::string& app() const {
+  std::string_view app() const {
     return app_;
   }
-  const std::string& msg() const {
+  std::string_view msg() const {
     return msg_;
   }
   std::string raw() const {
@@ -64,25 +80,49 @@ class SELFormat {
   void force_bare() {
     bare_ = true;
   }
-  bool fru_matches(const fru_set& frus) {
+  bool fru_matches(const fru_set& frus) const {
     if (frus.count(FRU_SYS) && fru_ == "sys")
       return true;
     return (frus.count(FRU_ALL) || frus.count(fru_num_));
   }
+  // fru_matches() as if parsed with the default FRU of a stream
+  // filtering on frus.
+  bool fru_matches_as(const fru_set& frus) const {
+    if (fru_default_)
+      return frus.count(FRU_SYS) || frus.count(FRU_ALL);
+    return fru_matches(frus);
+  }
 
   bool fits_time_range(const std::string& start_time, const std::string& end_time);
+  bool fits_time_range(time_t start_time, time_t end_time) const {
+    return has_time_ && start_time <= time_c_ && time_c_ <= end_time;
+  }
+  // Parse a YYYY-MM-DD HH:MM:SS or MM-DD HH:MM:SS time as used by
+  // fits_time_range().
+  static bool parse_time(std::string_view str, time_t& t);
+
+  // Split a line in the fields of the log format below. Returns false
+  // for a bare line.
+  static bool tokenize(std::string_view line, fields& f);
+  // The number of the first "FRU: <n>" of a line, -1 if none.
+  static int find_fru(std::string_view line);
 
  private:
   bool bare_ = true;
   bool self_log_ = false;
   std::string fru_ = "";
   std::string time_ = "";
-  std::string app_ = "";
-  std::string msg_ = "";
-  std::string hostname_ = "";
-  std::string version_ = "";
+  // time_ as used for time ranges.
+  bool has_time_ = false;
+  time_t time_c_ = 0;
+  std::string_view app_;
+  std::string_view msg_;
+  std::string_view hostname_;
+  std::string_view version_;
   int default_fru_num_;
   int fru_num_ = -1;
+  // fru_num_ is the default FRU.
+  bool fru_default_ = true;
   std::string raw_ = "";
 
   static constexpr size_t fru_num_left_align = 4;
@@ -104,20 +144,9 @@ class SELFormat {
   // rsyslogd's configuration and we ended up with the logfile
   // stored in persistent store without a year in the time stamp.
   // This is a hack-workaround to prevent parsing inconsistencies.
-  static constexpr std::string_view log_fmt =
-      R"(([0-9]{4}\s+\S+\s+\d+\s+\d+:\d+:\d+)\s+(\S+)\s+\S+\s+(\S+):\s+(\S+):\s+(.+)$)";
-
-  static constexpr std::string_view log_fmt_legacy =
-      R"((\S+\s+\d+\s+\d+:\d+:\d+)\s+(\S+)\s+\S+\s+(\S+):\s+(\S+):\s+(.+)$)";
-
-  static constexpr std::string_view time_fmt =
-    R"([0-9]{4}-[0-9]{2}-[0-9]{2}\s+[0-9]{2}:[0-9]{2}:[0-9]{2})";
-
-  static constexpr std::string_view time_fmt_legacy =
-    R"([0-9]{2}-[0-9]{2}\s+[0-9]{2}:[0-9]{2}:[0-9]{2})";
-
-  static constexpr std::string_view release_fmt =
-    R"(OpenBMC Release (\S+))";
+  // A line is in the current format if a HH:MM:SS anywhere in it is
+  // preceded by a year, month and day and followed by the rest of the
+  // format, else in the legacy format if preceded by a month and day.
 };
 
 void to_json(nlohmann::json& j, const SELFormat& sel);
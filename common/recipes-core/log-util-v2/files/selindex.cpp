@@ -0,0 +1,312 @@
+#include "selindex.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr char index_magic[4] = {'S', 'E', 'L', '2'};
+constexpr int64_t no_time_min = std::numeric_limits<int64_t>::max();
+constexpr int64_t no_time_max = std::numeric_limits<int64_t>::min();
+// Bytes before the end of the indexed part used to tell if the log
+// was rewritten.
+constexpr size_t fingerprint_size = 256;
+
+// State flags.
+constexpr uint32_t STATE_HAS_TIME = 1;
+
+struct index_header {
+  char magic[4];
+  uint32_t block_lines;
+  uint32_t count;
+  uint32_t reserved;
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t fingerprint;
+};
+
+} // namespace
+
+SELIndex::SELIndex(const std::string& logfile, const std::string& index_file) {
+  int fd = open(logfile.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(logfile + " open failed");
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error(logfile + " stat failed");
+  }
+  size_ = st.st_size;
+  dev_ = st.st_dev;
+  ino_ = st.st_ino;
+  if (size_ > 0) {
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error(logfile + " mmap failed");
+    }
+    data_ = static_cast<const char*>(addr);
+    madvise(addr, size_, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  if (!load(index_file)) {
+    blocks_.clear();
+    state_ = state{};
+  }
+  scan();
+  if (scanned_ > 0) {
+    store(index_file);
+  }
+
+  reach_.reserve(blocks_.size());
+  int64_t reach = no_time_max;
+  for (auto& b : blocks_) {
+    reach = std::max(reach, b.max_time);
+    reach_.push_back(reach);
+  }
+}
+
+SELIndex::~SELIndex() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+uint64_t SELIndex::fingerprint(uint64_t size) const {
+  uint64_t hash = 0xcbf29ce484222325ULL ^ size;
+  for (uint64_t i = size - std::min<uint64_t>(size, fingerprint_size);
+       i < size;
+       i++) {
+    hash ^= static_cast<uint8_t>(data_[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+bool SELIndex::load(const std::string& index_file) {
+  std::ifstream ifs(index_file, std::ios::binary);
+  if (!ifs.is_open()) {
+    return false;
+  }
+  index_header hdr;
+  if (!ifs.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) ||
+      !ifs.read(reinterpret_cast<char*>(&state_), sizeof(state_))) {
+    return false;
+  }
+  // The log is only ever appended to, or replaced.
+  if (memcmp(hdr.magic, index_magic, sizeof(index_magic)) != 0 ||
+      hdr.block_lines != block_lines || hdr.dev != dev_ || hdr.ino != ino_ ||
+      state_.size > size_ || hdr.count > state_.size ||
+      state_.lines > block_lines ||
+      hdr.fingerprint != fingerprint(state_.size)) {
+    return false;
+  }
+  blocks_.resize(hdr.count);
+  return bool(ifs.read(
+      reinterpret_cast<char*>(blocks_.data()), blocks_.size() * sizeof(block)));
+}
+
+void SELIndex::store(const std::string& index_file) const {
+  auto slash = index_file.rfind('/');
+  if (slash != std::string::npos && slash > 0) {
+    mkdir(index_file.substr(0, slash).c_str(), 0755);
+  }
+  std::string tmp = index_file + ".tmp" + std::to_string(getpid());
+  std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+  if (!ofs.is_open()) {
+    return;
+  }
+  index_header hdr{};
+  memcpy(hdr.magic, index_magic, sizeof(index_magic));
+  hdr.block_lines = block_lines;
+  hdr.count = blocks_.size();
+  hdr.dev = dev_;
+  hdr.ino = ino_;
+  hdr.fingerprint = fingerprint(state_.size);
+  ofs.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+  ofs.write(reinterpret_cast<const char*>(&state_), sizeof(state_));
+  ofs.write(
+      reinterpret_cast<const char*>(blocks_.data()),
+      blocks_.size() * sizeof(block));
+  ofs.close();
+  if (!ofs || rename(tmp.c_str(), index_file.c_str()) != 0) {
+    remove(tmp.c_str());
+  }
+}
+
+void SELIndex::scan() {
+  if (state_.size >= size_) {
+    return;
+  }
+  // Only complete lines are indexed, the rest is always read.
+  const char* last = static_cast<const char*>(
+      memrchr(data_ + state_.size, '\n', size_ - state_.size));
+  if (last == nullptr) {
+    return;
+  }
+  uint64_t end = last - data_ + 1;
+  for (uint64_t offset = state_.size; offset < end;) {
+    auto nl = static_cast<const char*>(
+        memchr(data_ + offset, '\n', end - offset));
+    if (blocks_.empty() || state_.lines == block_lines) {
+      block b{};
+      b.offset = offset;
+      b.resume = state_.resume;
+      b.min_time = no_time_min;
+      b.max_time = no_time_max;
+      if (state_.flags & STATE_HAS_TIME) {
+        b.min_time = b.max_time = state_.time;
+      }
+      blocks_.push_back(b);
+      state_.lines = 0;
+    }
+    state_.lines++;
+    scan_line(std::string_view(data_ + offset, nl - data_ - offset), offset);
+    offset = nl - data_ + 1;
+  }
+  scanned_ = end - state_.size;
+  state_.size = end;
+}
+
+void SELIndex::scan_line(std::string_view line, uint64_t offset) {
+  std::string stripped;
+  if (line.find('\0') != std::string_view::npos) {
+    stripped.assign(line);
+    stripped.erase(
+        std::remove(stripped.begin(), stripped.end(), '\0'), stripped.end());
+    line = stripped;
+  }
+  bool self = line.find("log-util") != std::string_view::npos;
+  if (!self && line.find(".crit") == std::string_view::npos) {
+    // Not a log, SELStream skips it.
+    return;
+  }
+  auto& b = blocks_.back();
+
+  // FRU_SYS is only the default when filtering on it, in which case the
+  // FRUs are not used. Otherwise logs without a FRU are FRU_ALL.
+  if (!self) {
+    state_.fru = SELFormat::FRU_ALL;
+  } else if (
+      line.find("all logs") != std::string_view::npos ||
+      line.find("sys logs") != std::string_view::npos) {
+    state_.fru = SELFormat::FRU_ALL;
+  }
+  if (int fru = SELFormat::find_fru(line); fru >= 0) {
+    // fru_matches() looks it up as an uint8_t.
+    state_.fru = fru == SELFormat::FRU_SYS ? SELFormat::FRU_ALL : fru & 0xff;
+  }
+  b.frus[state_.fru / 8] |= 1 << (state_.fru % 8);
+
+  if (SELFormat::fields f; SELFormat::tokenize(line, f)) {
+    state_.time = f.time;
+    state_.flags = STATE_HAS_TIME;
+    // Nothing of a parsed log depends on the lines before it.
+    if (!self) {
+      state_.resume = offset;
+    }
+  }
+  if (state_.flags & STATE_HAS_TIME) {
+    b.min_time = std::min(b.min_time, state_.time);
+    b.max_time = std::max(b.max_time, state_.time);
+  }
+}
+
+std::vector<std::string_view> SELIndex::ranges(
+    const fru_set& frus,
+    const std::string& start_time,
+    const std::string& end_time) const {
+  bool timed = !(start_time.empty() || end_time.empty());
+  time_t time_s = 0, time_e = 0;
+  if (timed &&
+      !(SELFormat::parse_time(start_time, time_s) &&
+        SELFormat::parse_time(end_time, time_e))) {
+    // Nothing fits an invalid range.
+    return {};
+  }
+  bool by_fru = !frus.count(SELFormat::FRU_ALL) && !frus.count(SELFormat::FRU_SYS);
+  uint8_t mask[32] = {};
+  for (auto fru : frus) {
+    mask[fru / 8] |= 1 << (fru % 8);
+  }
+
+  std::vector<std::string_view> out;
+  uint64_t out_end = 0;
+  auto add = [&](uint64_t resume, uint64_t end) {
+    if (!out.empty() && resume <= out_end) {
+      out.back() = std::string_view(
+          out.back().data(), data_ + end - out.back().data());
+    } else {
+      out.emplace_back(data_ + resume, end - resume);
+    }
+    out_end = end;
+  };
+
+  size_t first = 0;
+  if (timed) {
+    // Blocks before have no log as recent as start_time.
+    first = std::lower_bound(reach_.begin(), reach_.end(), int64_t(time_s)) -
+        reach_.begin();
+  }
+  for (size_t i = first; i < blocks_.size(); i++) {
+    const auto& b = blocks_[i];
+    if (timed && (b.max_time < time_s || b.min_time > time_e)) {
+      continue;
+    }
+    if (by_fru) {
+      bool any = false;
+      for (size_t j = 0; j < sizeof(mask) && !any; j++) {
+        any = mask[j] & b.frus[j];
+      }
+      if (!any) {
+        continue;
+      }
+    }
+    add(b.resume, i + 1 < blocks_.size() ? blocks_[i + 1].offset : state_.size);
+  }
+  if (state_.size < size_) {
+    add(state_.resume, size_);
+  }
+  return out;
+}
+
+RangeBuf::int_type RangeBuf::underflow() {
+  while (next_ < ranges_.size()) {
+    auto r = ranges_[next_++];
+    if (!r.empty()) {
+      // The get area is never written to.
+      char* begin = const_cast<char*>(r.data());
+      setg(begin, begin, begin + r.size());
+      return traits_type::to_int_type(*begin);
+    }
+  }
+  return traits_type::eof();
+}
+
+RangeBuf::pos_type RangeBuf::seekoff(
+    off_type off,
+    std::ios_base::seekdir dir,
+    std::ios_base::openmode which) {
+  if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::in)) {
+    return pos_type(off_type(-1));
+  }
+  if (gptr() != egptr()) {
+    return gptr() - base_;
+  }
+  // At the end of a range, where the next one starts.
+  while (next_ < ranges_.size() && ranges_[next_].empty()) {
+    next_++;
+  }
+  if (next_ < ranges_.size()) {
+    return ranges_[next_].data() - base_;
+  }
+  return ranges_.empty() ? 0 : ranges_.back().data() + ranges_.back().size() - base_;
+}
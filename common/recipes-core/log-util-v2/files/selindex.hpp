@@ -0,0 +1,112 @@
+#pragma once
+#include <sys/types.h>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "selformat.hpp"
+
+// Sparse index of a log file, to only parse the parts of it which may
+// hold the requested logs.
+//
+// The log is memory mapped and cut in blocks of block_lines lines. For
+// each block the index keeps its offset, the range of times and the
+// FRUs of its logs. It is kept in a file and extended as the log grows,
+// so only new lines are scanned.
+//
+// SELFormat carries the time of the last parsed log over to the bare
+// logs after it. To hand SELStream the same state it would have had
+// reading the whole file, a run of blocks starts at the last log before
+// it which does not depend on earlier lines.
+class SELIndex {
+ public:
+  static constexpr size_t block_lines = 256;
+  // Smaller logs are read directly.
+  static constexpr off_t min_log_size = 64 * 1024;
+
+  // Maps logfile and loads or builds its index. Throws
+  // std::runtime_error if the log cannot be read. Failing to store the
+  // index is not an error.
+  SELIndex(const std::string& logfile, const std::string& index_file);
+  ~SELIndex();
+
+  // The runs of the log which may hold logs matching the filters, in
+  // order. Empty start or end time do not filter on time, as with
+  // SELStream.
+  std::vector<std::string_view> ranges(
+      const fru_set& frus,
+      const std::string& start_time,
+      const std::string& end_time) const;
+
+  // The mapped log.
+  const char* data() const {
+    return data_;
+  }
+  size_t blocks() const {
+    return blocks_.size();
+  }
+  // Bytes of the log scanned to build or extend the index.
+  size_t scanned() const {
+    return scanned_;
+  }
+
+  SELIndex(const SELIndex&) = delete;
+  SELIndex& operator=(const SELIndex&) = delete;
+
+ private:
+  struct block {
+    uint64_t offset;
+    // Where to start parsing to get the state at offset.
+    uint64_t resume;
+    int64_t min_time;
+    int64_t max_time;
+    uint8_t frus[32];
+  };
+  // Scanner state at the end of the indexed part.
+  struct state {
+    uint64_t size = 0;
+    uint64_t resume = 0;
+    int64_t time = 0;
+    uint32_t flags = 0;
+    uint32_t fru = 0;
+    uint32_t lines = 0;
+  };
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  dev_t dev_ = 0;
+  ino_t ino_ = 0;
+  std::vector<block> blocks_;
+  // Latest time of the blocks up to each one, to find the first block
+  // which can hold a time.
+  std::vector<int64_t> reach_;
+  state state_;
+  size_t scanned_ = 0;
+
+  bool load(const std::string& index_file);
+  void store(const std::string& index_file) const;
+  void scan();
+  void scan_line(std::string_view line, uint64_t offset);
+  uint64_t fingerprint(uint64_t size) const;
+};
+
+// Reads a list of string_views as one stream. Its position is the
+// offset from base, e.g. in the logfile.
+class RangeBuf : public std::streambuf {
+  std::vector<std::string_view> ranges_;
+  size_t next_ = 0;
+  const char* base_;
+
+ public:
+  RangeBuf(std::vector<std::string_view>&& ranges, const char* base)
+      : ranges_(std::move(ranges)), base_(base) {}
+
+ protected:
+  int_type underflow() override;
+  // Only tells the position.
+  pos_type seekoff(
+      off_type off,
+      std::ios_base::seekdir dir,
+      std::ios_base::openmode which) override;
+};
@@ -4,13 +4,46 @@
 
 void SELStream::flush(std::ostream& os) {
   if (fmt_ == FORMAT_JSON) {
-    nlohmann::json j;
-    j["Logs"] = sel_list_;
-    os << j.dump(4) << '\n';
+    // The end of what nlohmann::json::dump(4) makes of {"Logs": [...]}.
+    if (json_count_ == 0) {
+      os << "{\n    \"Logs\": []\n}\n";
+    } else {
+      os << "\n    ]\n}\n";
+    }
+    json_count_ = 0;
   }
   os.flush();
 }
 
+void SELStream::write_json(std::ostream& os, const SELFormat& sel) {
+  nlohmann::json j(sel);
+  // Do not fail on logs which are not valid UTF-8.
+  auto error = nlohmann::json::error_handler_t::replace;
+  if (fmt_ == FORMAT_NDJSON) {
+    os << j.dump(-1, ' ', false, error) << '\n';
+    return;
+  }
+  // Logs are written as they are parsed instead of building the whole
+  // array, with the same output as dump(4) of it.
+  os << (json_count_++ == 0 ? "{\n    \"Logs\": [\n" : ",\n") << "        ";
+  for (char c : j.dump(4, ' ', false, error)) {
+    os << c;
+    if (c == '\n') {
+      os << "        ";
+    }
+  }
+}
+
+bool SELStream::hidden(const SELFormat& sel, uint64_t offset) const {
+  for (auto& t : tombstones_) {
+    if (offset < t.offset && sel.fru_matches_as(t.frus) &&
+        (!t.timed || sel.fits_time_range(t.start_time, t.end_time))) {
+      return true;
+    }
+  }
+  return false;
+}
+
 std::unique_ptr<SELFormat> SELStream::make_sel(uint8_t default_fru) {
   return std::make_unique<SELFormat>(default_fru);
 }
@@ -26,20 +59,30 @@ void SELStream::start(
       ? SELFormat::FRU_SYS
       : SELFormat::FRU_ALL;
   std::unique_ptr<SELFormat> sel = make_sel(default_fru_id);
+  bool timestamp = !(start_time.empty() || end_time.empty());
+  time_t time_s = 0, time_e = 0;
+  // Nothing fits a range which cannot be parsed.
+  bool valid_range = timestamp &&
+      SELFormat::parse_time(start_time, time_s) &&
+      SELFormat::parse_time(end_time, time_e);
   do {
     try {
+      std::streamoff offset = tombstones_.empty() ? 0 : std::streamoff(is.tellg());
       if (!(is >> *sel))
         break;
-      if (fmt_ == FORMAT_JSON && sel->is_bare()) {
+      if (offset >= 0 && hidden(*sel, offset)) {
+        continue;
+      }
+      if (is_json() && sel->is_bare()) {
         // RAW is used by clear and we filter out all previous
         // logs injected by this utility.
         // We do not send this as JSON format as well.
         continue;
       }
       bool blacklist = fmt_ == FORMAT_RAW;
-      bool timestamp = !(start_time.empty() || end_time.empty());
       if (timestamp) {
-          if (!((sel->fru_matches(filter_fru) && sel->fits_time_range(start_time, end_time)) ^ blacklist)) {
+          bool fits = valid_range && sel->fits_time_range(time_s, time_e);
+          if (!((sel->fru_matches(filter_fru) && fits) ^ blacklist)) {
             continue;
           }
       } else {
@@ -49,9 +92,8 @@ void SELStream::start(
       }
       if (fmt_ == FORMAT_RAW)
         sel->force_bare();
-      if (fmt_ == FORMAT_JSON) {
-        nlohmann::json j(*sel);
-        sel_list_.push_back(j);
+      if (is_json()) {
+        write_json(os, *sel);
       } else {
         os << *sel;
       }
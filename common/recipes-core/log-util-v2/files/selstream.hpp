@@ -1,22 +1,40 @@
 #pragma once
 #include <iostream>
 #include <memory>
+#include <vector>
 #include "selformat.hpp"
+#include "seltombstone.hpp"
 
-enum OutputFormat { FORMAT_PRINT, FORMAT_RAW, FORMAT_JSON };
+// FORMAT_NDJSON prints one JSON object per line, without the "Logs"
+// array around them.
+enum OutputFormat { FORMAT_PRINT, FORMAT_RAW, FORMAT_JSON, FORMAT_NDJSON };
 enum ParserFlag {
   PARSE_ALL         = 0,
   PARSE_STOP_ON_ERR = 1,
 };
 class SELStream {
-  nlohmann::json sel_list_ = nlohmann::json::array();
   OutputFormat fmt_;
+  // Logs written to the JSON array so far.
+  size_t json_count_ = 0;
+  std::vector<SELTombstone> tombstones_;
+
+  bool hidden(const SELFormat& sel, uint64_t offset) const;
+
+  bool is_json() const {
+    return fmt_ == FORMAT_JSON || fmt_ == FORMAT_NDJSON;
+  }
+  void write_json(std::ostream& os, const SELFormat& sel);
 
  public:
   SELStream(OutputFormat fmt) : fmt_(fmt) {}
   virtual ~SELStream() {}
   void flush(std::ostream& os);
   virtual std::unique_ptr<SELFormat> make_sel(uint8_t default_fru);
+  // Hide the logs cleared by tombstones from the next start(). The
+  // offsets are those of the input stream, which has to be seekable.
+  void set_tombstones(std::vector<SELTombstone>&& tombstones) {
+    tombstones_ = std::move(tombstones);
+  }
   void start(std::istream& is, std::ostream& os, const fru_set& filter_fru,
           const std::string& start_time, const std::string& end_time, const ParserFlag flag = PARSE_ALL);
   void log_cleared(std::ostream& os, const fru_set& affected_frus, const std::string& start_time, const std::string& end_time);
@@ -0,0 +1,161 @@
+#include "seltombstone.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <array>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Bytes at the start of a logfile used to tell it apart. They begin
+// with the time stamp of its first log.
+constexpr size_t fingerprint_size = 256;
+
+// ino fingerprint offset fru[,fru...] start|- end|-
+std::ostream& operator<<(std::ostream& os, const SELTombstone& t) {
+  os << t.ino << ' ' << t.fingerprint << ' ' << t.offset << ' ';
+  const char* sep = "";
+  for (auto fru : t.frus) {
+    os << sep << int(fru);
+    sep = ",";
+  }
+  if (t.timed) {
+    os << ' ' << t.start_time << ' ' << t.end_time;
+  } else {
+    os << " - -";
+  }
+  return os << '\n';
+}
+
+bool parse(const std::string& line, SELTombstone& t) {
+  std::istringstream is(line);
+  std::string frus, start, end;
+  if (!(is >> t.ino >> t.fingerprint >> t.offset >> frus >> start >> end)) {
+    return false;
+  }
+  std::istringstream fs(frus);
+  for (std::string fru; std::getline(fs, fru, ',');) {
+    t.frus.insert(std::stoi(fru));
+  }
+  t.timed = start != "-";
+  if (t.timed) {
+    t.start_time = std::stoll(start);
+    t.end_time = std::stoll(end);
+  }
+  return true;
+}
+
+} // namespace
+
+SELTombstones::SELTombstones(const std::string& path) : path_(path) {
+  std::ifstream ifs(path_);
+  for (std::string line; std::getline(ifs, line);) {
+    SELTombstone t;
+    try {
+      if (parse(line, t)) {
+        tombstones_.push_back(std::move(t));
+      }
+    } catch (std::exception&) {
+      // A line torn by a power loss.
+    }
+  }
+}
+
+uint64_t SELTombstones::fingerprint(const std::string& logfile) {
+  std::array<char, fingerprint_size> buf;
+  std::ifstream ifs(logfile, std::ios::binary);
+  ifs.read(buf.data(), buf.size());
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (std::streamsize i = 0; i < ifs.gcount(); i++) {
+    hash ^= static_cast<uint8_t>(buf[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+std::vector<SELTombstone> SELTombstones::find(const std::string& logfile) const {
+  std::vector<SELTombstone> found;
+  struct stat st;
+  if (tombstones_.empty() || stat(logfile.c_str(), &st) != 0) {
+    return found;
+  }
+  uint64_t hash = 0;
+  for (auto& t : tombstones_) {
+    if (t.ino != st.st_ino) {
+      continue;
+    }
+    if (hash == 0) {
+      hash = fingerprint(logfile);
+    }
+    if (t.fingerprint == hash) {
+      found.push_back(t);
+    }
+  }
+  return found;
+}
+
+void SELTombstones::add(
+    const std::string& logfile,
+    const fru_set& frus,
+    const std::string& start_time,
+    const std::string& end_time,
+    const std::vector<std::string>& logfiles) {
+  SELTombstone t;
+  struct stat st;
+  if (stat(logfile.c_str(), &st) != 0) {
+    throw std::runtime_error(logfile + " stat failed");
+  }
+  t.ino = st.st_ino;
+  t.fingerprint = fingerprint(logfile);
+  t.offset = st.st_size;
+  t.frus = frus;
+  t.timed = !(start_time.empty() || end_time.empty());
+  if (t.timed &&
+      !(SELFormat::parse_time(start_time, t.start_time) &&
+        SELFormat::parse_time(end_time, t.end_time))) {
+    // Nothing fits an invalid range.
+    return;
+  }
+
+  // Drop the tombstones of logs rotated out, even if a new logfile
+  // got their inode.
+  std::set<std::pair<uint64_t, uint64_t>> live;
+  for (auto& file : logfiles) {
+    if (stat(file.c_str(), &st) == 0) {
+      live.emplace(st.st_ino, fingerprint(file));
+    }
+  }
+  std::vector<SELTombstone> kept;
+  for (auto& old : tombstones_) {
+    if (live.count({old.ino, old.fingerprint})) {
+      kept.push_back(old);
+    }
+  }
+  kept.push_back(std::move(t));
+
+  std::string tmp = path_ + ".tmp";
+  {
+    std::ofstream ofs(tmp, std::ios::trunc);
+    for (auto& k : kept) {
+      ofs << k;
+    }
+    ofs.close();
+    if (!ofs) {
+      remove(tmp.c_str());
+      throw std::runtime_error(tmp + " creation failed");
+    }
+  }
+  // The clear has to survive a power loss once log-util returns.
+  int fd = open(tmp.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+  if (rename(tmp.c_str(), path_.c_str())) {
+    throw std::runtime_error(tmp + " renamed as " + path_ + " failed");
+  }
+  tombstones_ = std::move(kept);
+}
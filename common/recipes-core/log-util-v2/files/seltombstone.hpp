@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "selformat.hpp"
+
+// A clear of the logs of a logfile written before offset.
+struct SELTombstone {
+  // The logfile, which keeps its inode when rotated.
+  uint64_t ino = 0;
+  uint64_t fingerprint = 0;
+  uint64_t offset = 0;
+  fru_set frus;
+  bool timed = false;
+  time_t start_time = 0;
+  time_t end_time = 0;
+};
+
+// Clears recorded next to the logs instead of rewriting them.
+//
+// The tombstones are kept in a small text file, one per line. Readers
+// hide the logs they cover, and the logs themselves go away when the
+// logfile is rotated out, along with its tombstones.
+class SELTombstones {
+  std::string path_;
+  std::vector<SELTombstone> tombstones_;
+
+ public:
+  // Loads the tombstones of path, if any.
+  explicit SELTombstones(const std::string& path);
+
+  // Tells the logfile apart from a later one reusing its inode.
+  static uint64_t fingerprint(const std::string& logfile);
+
+  // The tombstones of a logfile.
+  std::vector<SELTombstone> find(const std::string& logfile) const;
+
+  // Clear the logs of logfile written so far. Tombstones of files which
+  // are not in logfiles anymore are dropped. Throws std::runtime_error
+  // if the tombstones cannot be stored.
+  void add(
+      const std::string& logfile,
+      const fru_set& frus,
+      const std::string& start_time,
+      const std::string& end_time,
+      const std::vector<std::string>& logfiles);
+
+  size_t size() const {
+    return tombstones_.size();
+  }
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include "selformat.hpp"
+#include "selstream.hpp"
+
+class NamedSELFormat : public SELFormat {
+ public:
+  NamedSELFormat(uint8_t fru_id) : SELFormat(fru_id) {}
+  std::string get_fru_name(uint8_t fru_id) override {
+    return "fru" + std::to_string(fru_id);
+  }
+};
+
+class NamedSELStream : public SELStream {
+ public:
+  NamedSELStream(OutputFormat fmt) : SELStream(fmt) {}
+  std::unique_ptr<SELFormat> make_sel(uint8_t default_fru) override {
+    return std::make_unique<NamedSELFormat>(default_fru);
+  }
+};
+
+// A log line every minute from now. Every tenth line is from healthd and
+// the others are sensord ones of FRU fru(i). With noise, a few lines are
+// breadcrumbs of clears, have no time stamp or are not logs at all.
+inline void append_sel(
+    const std::string& file,
+    time_t& now,
+    size_t lines,
+    const std::function<int(size_t)>& fru,
+    bool noise = false) {
+  std::ofstream ofs(file, std::ios::app);
+  for (size_t i = 0; i < lines; i++, now += 60) {
+    std::tm ts{};
+    localtime_r(&now, &ts);
+    char stamp[64];
+    strftime(stamp, sizeof(stamp), "%Y %b %e %H:%M:%S", &ts);
+    if (noise && i % 10 == 3) {
+      ofs << stamp << " log-util: User cleared FRU: " << fru(i) << " logs\n";
+    } else if (i % 10 == 5) {
+      ofs << " " << stamp
+          << " bmc-oob. user.crit fbtp-v2021.09.1: healthd: BMC CPU utilization ("
+          << i << "%) exceeds threshold\n";
+    } else if (noise && i % 10 == 7) {
+      ofs << "not a log line " << i << '\n';
+    } else if (noise && i % 10 == 8) {
+      ofs << " user.crit no timestamp " << i << '\n';
+    } else {
+      ofs << " " << stamp
+          << " bmc-oob. user.crit fbtp-v2021.09.1: sensord: ASSERT: Upper Critical threshold - raised - FRU: "
+          << fru(i) << ", num: 0xC0 curr_val: " << i << " RPM, snr: FAN"
+          << i % 8 << "_TACH\n";
+    }
+  }
+}
@@ -1,5 +1,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
 #include "selformat.hpp"
 
 // NOTE:
@@ -190,3 +192,76 @@ TEST(SELFormat, TimestampCompare) {
 }
 
 
+
+TEST(SELFormat, ParseTime) {
+  time_t t1, t2;
+  EXPECT_TRUE(SELFormat::parse_time("2020-05-18 10:18:40", t1));
+  EXPECT_TRUE(SELFormat::parse_time("at 2020-05-18  10:18:41 or so", t2));
+  EXPECT_EQ(t2 - t1, 1);
+  EXPECT_TRUE(SELFormat::parse_time("05-18 10:18:40", t2));
+  EXPECT_LT(t2, t1);
+  EXPECT_FALSE(SELFormat::parse_time("2020-05-18", t1));
+  EXPECT_FALSE(SELFormat::parse_time("", t1));
+}
+
+TEST(SELFormat, Tokenize) {
+  SELFormat::fields f;
+  EXPECT_TRUE(SELFormat::tokenize(
+      " 2020 Apr  6 15:00:40 bmc-oob. user.crit fbtp-v2020.09.1: sensord: ASSERT: FRU: 1",
+      f));
+  EXPECT_FALSE(f.legacy);
+  EXPECT_EQ(f.year, 2020);
+  EXPECT_EQ(f.mon, 3);
+  EXPECT_EQ(f.mday, 6);
+  EXPECT_EQ(f.hostname, "bmc-oob.");
+  EXPECT_EQ(f.version, "fbtp-v2020.09.1");
+  EXPECT_EQ(f.app, "sensord");
+  EXPECT_EQ(f.msg, "ASSERT: FRU: 1");
+
+  EXPECT_TRUE(SELFormat::tokenize(
+      "Mar  5 11:21:09 bmc-oob. user.crit fbtp-79c9c5e5b7: ipmid: ASSERT: GPIOAA0",
+      f));
+  EXPECT_TRUE(f.legacy);
+  EXPECT_EQ(f.app, "ipmid");
+  EXPECT_EQ(f.msg, "ASSERT: GPIOAA0");
+
+  EXPECT_FALSE(SELFormat::tokenize(
+      "2020 May 21 17:29:55 log-util: User cleared FRU: 2 logs", f));
+  EXPECT_FALSE(SELFormat::tokenize(
+      " 2020 May 18 10:18:40 bmc-oob. user.crit version app: message", f));
+
+  EXPECT_EQ(SELFormat::find_fru("FRU: 12, FRU: 3"), 12);
+  EXPECT_EQ(SELFormat::find_fru("FRU: x FRU: 3"), 3);
+  EXPECT_EQ(SELFormat::find_fru("no FRU"), -1);
+}
+
+// Run with --gtest_also_run_disabled_tests.
+TEST(SELFormat, DISABLED_Throughput) {
+  class NamedSELFormat : public SELFormat {
+   public:
+    NamedSELFormat() : SELFormat(SELFormat::FRU_ALL) {}
+    string get_fru_name(uint8_t) override {
+      return "mb";
+    }
+  } sel;
+  const string lines[] = {
+      " 2020 Apr  6 15:00:40 bmc-oob. user.crit fbtp-v2020.09.1: sensord: ASSERT: Upper Non Critical threshold - raised - FRU: 1, num: 0xC0 curr_val: 8988.00 RPM, thresh_val: 8500.00 RPM, snr: MB_FAN0_TACH",
+      " 2020 May 18 10:18:40 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: healthd: BMC Reboot detected - caused by reboot command",
+      "2020 May 21 17:29:55 log-util: User cleared FRU: 2 logs",
+      " Mar  5 11:21:09 bmc-oob. user.crit fbtp-79c9c5e5b7: ipmid: ASSERT: GPIOAA0 - FM_CPU1_SKTOCC_LVT3_N",
+  };
+  constexpr size_t count = 200000;
+  size_t matched = 0;
+  time_t start_time, end_time;
+  ASSERT_TRUE(SELFormat::parse_time("2020-05-18 00:00:00", start_time));
+  ASSERT_TRUE(SELFormat::parse_time("2020-05-19 00:00:00", end_time));
+  auto start = chrono::steady_clock::now();
+  for (size_t i = 0; i < count; i++) {
+    sel.set_raw(string(lines[i % size(lines)]));
+    matched += sel.fits_time_range(start_time, end_time);
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  EXPECT_GT(matched, 0);
+  cout << "set_raw + fits_time_range: " << size_t(count / elapsed.count())
+       << " lines/sec" << endl;
+}
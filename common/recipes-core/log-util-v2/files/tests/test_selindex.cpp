@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include "log-util.hpp"
+#include "selindex.hpp"
+#include "sel_test_helpers.hpp"
+
+using namespace std;
+
+namespace {
+
+class IndexedLogUtil : public LogUtil {
+  const std::vector<std::string> logfiles_{"./selindex.log"};
+
+ public:
+  std::unique_ptr<SELStream> make_stream(OutputFormat fmt) override {
+    return std::make_unique<NamedSELStream>(fmt);
+  }
+  const std::vector<std::string>& logfile_list() override {
+    return logfiles_;
+  }
+  std::string index_path(const std::string&) override {
+    return "./selindex.idx";
+  }
+};
+
+} // namespace
+
+class SELIndexTest : public ::testing::Test {
+ protected:
+  const string logfile = "./selindex.log";
+  const string index_file = "./selindex.idx";
+  time_t now = 0;
+
+  // FRU 1 to 4 in runs of 1000 lines, starting at 2021-03-01.
+  void append(size_t lines) {
+    append_sel(logfile, now, lines, [](size_t i) { return (i / 1000) % 4 + 1; },
+               true);
+  }
+
+  // Print through the index.
+  string print(const fru_set& frus, const string& start, const string& end,
+               bool json = false) {
+    IndexedLogUtil util;
+    stringstream outp;
+    util.print(frus, start, end, json, outp);
+    return outp.str();
+  }
+
+  // Print the whole log.
+  string print_all(const fru_set& frus, const string& start, const string& end,
+                   bool json = false) {
+    NamedSELStream stream(json ? FORMAT_JSON : FORMAT_PRINT);
+    ifstream ifs(logfile);
+    stringstream outp;
+    stream.start(ifs, outp, frus, start, end);
+    stream.flush(outp);
+    return outp.str();
+  }
+
+  void SetUp() {
+    std::tm ts{};
+    strptime("2021-03-01 00:00:00", "%Y-%m-%d %H:%M:%S", &ts);
+    now = mktime(&ts);
+    remove(logfile.c_str());
+    remove(index_file.c_str());
+    {
+      // Logs from before the time stamps had a year.
+      ofstream ofs(logfile);
+      for (int i = 0; i < 300; i++) {
+        ofs << " Feb 27 10:" << i / 60 << ":" << i % 60
+            << " bmc-oob. user.crit fbtp-v2020.09.1: healthd: FRU: 4 legacy\n";
+      }
+    }
+    append(5000);
+    // The clock was set back.
+    now -= 3 * 24 * 3600;
+    append(5000);
+  }
+  void TearDown() {
+    remove(logfile.c_str());
+    remove(index_file.c_str());
+  }
+};
+
+TEST_F(SELIndexTest, SameOutput) {
+  vector<pair<string, string>> times = {
+      {"", ""},
+      {"2021-03-02 10:00:00", "2021-03-02 12:00:00"},
+      {"2021-03-01 00:00:00", "2021-03-01 00:05:00"},
+      {"02-27 10:00:00", "02-27 10:02:00"},
+      {"2021-03-03 20:00:00", "2021-04-01 00:00:00"},
+      {"2021-04-01 00:00:00", "2021-05-01 00:00:00"},
+      {"bad", "2021-05-01 00:00:00"},
+  };
+  vector<fru_set> frus = {
+      {SELFormat::FRU_ALL}, {SELFormat::FRU_SYS}, {2}, {3, 4}, {9}};
+  for (auto& [start, end] : times) {
+    for (auto& f : frus) {
+      EXPECT_EQ(print(f, start, end), print_all(f, start, end))
+          << start << " - " << end;
+    }
+  }
+  EXPECT_EQ(
+      print({2}, times[1].first, times[1].second, true),
+      print_all({2}, times[1].first, times[1].second, true));
+}
+
+TEST_F(SELIndexTest, SkipsBlocks) {
+  SELIndex index(logfile, index_file);
+  EXPECT_EQ(
+      index.blocks(),
+      (10300 + SELIndex::block_lines - 1) / SELIndex::block_lines);
+
+  auto bytes = [](const vector<string_view>& ranges) {
+    size_t total = 0;
+    for (auto& r : ranges) {
+      total += r.size();
+    }
+    return total;
+  };
+  size_t size = bytes(index.ranges({SELFormat::FRU_ALL}, "", ""));
+  // Two hours are 120 lines, logged twice.
+  size_t hours = bytes(index.ranges(
+      {SELFormat::FRU_ALL}, "2021-03-02 10:00:00", "2021-03-02 12:00:00"));
+  EXPECT_GT(hours, 0);
+  EXPECT_LE(hours, size * 6 / (10000 / SELIndex::block_lines));
+  // FRU 1 is logged in a run of 1000 lines every 4000, FRU 9 never.
+  EXPECT_LT(bytes(index.ranges({1}, "", "")), size / 2);
+  EXPECT_EQ(bytes(index.ranges({9}, "", "")), 0);
+  EXPECT_EQ(
+      bytes(index.ranges({SELFormat::FRU_ALL}, "2022-01-01 00:00:00", "2022-02-01 00:00:00")),
+      0);
+}
+
+TEST_F(SELIndexTest, Extend) {
+  {
+    SELIndex index(logfile, index_file);
+    EXPECT_GT(index.scanned(), 0);
+  }
+  {
+    SELIndex index(logfile, index_file);
+    EXPECT_EQ(index.scanned(), 0);
+  }
+  size_t before = ifstream(logfile, ios::ate).tellg();
+  append(1000);
+  // An incomplete line is read but not indexed.
+  ofstream(logfile, ios::app) << " 2021 Mar 20 00:00:00 bmc-oob. user.crit";
+  size_t after = ifstream(logfile, ios::ate).tellg();
+  {
+    SELIndex index(logfile, index_file);
+    EXPECT_GT(index.scanned(), 0);
+    EXPECT_LT(index.scanned(), after - before);
+  }
+  string start = "2021-03-03 20:00:00", end = "2021-04-01 00:00:00";
+  EXPECT_EQ(print({2}, start, end), print_all({2}, start, end));
+  EXPECT_EQ(print({SELFormat::FRU_ALL}, "", ""), print_all({SELFormat::FRU_ALL}, "", ""));
+
+  // A replaced log is indexed again.
+  remove(logfile.c_str());
+  append(5000);
+  SELIndex index(logfile, index_file);
+  EXPECT_EQ(index.scanned(), ifstream(logfile, ios::ate).tellg());
+  EXPECT_EQ(print({3}, start, end), print_all({3}, start, end));
+}
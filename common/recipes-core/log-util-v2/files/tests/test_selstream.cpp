@@ -187,3 +187,58 @@ TEST(SELStream, ClearFru) {
   exp << "2020 Jun 21 17:29:55 log-util: User cleared FRU: 2 logs\n";
   ASSERT_EQ(outp.str(), exp.str());
 }
+
+TEST(SELStream, JSONSameAsDump) {
+  const string logs =
+      " 2020 May 18 10:18:40 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: healthd: BMC Reboot detected - \"caused\" by reboot command\n"
+      " 2020 Apr  6 15:00:40 bmc-oob. user.crit fbtp-v2020.09.1: sensord: ASSERT: Upper Non Critical threshold - raised - FRU: 1, num: 0xC0 curr_val: 8988.00 RPM, thresh_val: 8500.00 RPM, snr: MB_FAN0_TACH\n"
+      "2020 May 21 17:29:55 log-util: User cleared FRU: 2 logs\n";
+  for (auto frus : {fru_set{SELFormat::FRU_ALL}, fru_set{3}}) {
+    MockSELStream stream(FORMAT_JSON);
+    auto sel = std::make_unique<MockSELFormat>(SELFormat::FRU_ALL);
+    EXPECT_CALL(*sel, get_fru_name(AnyOf(1, 2)))
+        .WillRepeatedly(Return(string("mb")));
+    EXPECT_CALL(stream, make_sel(SELFormat::FRU_ALL))
+        .Times(1)
+        .WillOnce(Return(ByMove(std::move(sel))));
+    stringstream inp(logs), outp;
+    stream.start(inp, outp, frus, "", "");
+    stream.flush(outp);
+
+    // What the whole array used to be dumped as.
+    nlohmann::json j;
+    j["Logs"] = nlohmann::json::parse(outp.str())["Logs"];
+    EXPECT_EQ(outp.str(), j.dump(4) + "\n");
+    EXPECT_EQ(j["Logs"].size(), frus.count(SELFormat::FRU_ALL) ? 2 : 0);
+  }
+}
+
+TEST(SELStream, BasicNDJSON) {
+  stringstream inp;
+
+  inp << " 2020 May 18 10:18:40 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: healthd: BMC Reboot detected - caused by reboot command\n";
+  inp << " 2020 Apr  6 15:00:40 bmc-oob. user.crit fbtp-v2020.09.1: sensord: ASSERT: Upper Non Critical threshold - raised - FRU: 1, num: 0xC0 curr_val: 8988.00 RPM, thresh_val: 8500.00 RPM, snr: MB_FAN0_TACH\n";
+  inp << "2020 May 21 17:29:55 log-util: User cleared FRU: 2 logs\n";
+  MockSELStream stream(FORMAT_NDJSON);
+
+  auto sel = std::make_unique<MockSELFormat>(SELFormat::FRU_ALL);
+  EXPECT_CALL(*sel, get_fru_name(AnyOf(1, 2)))
+      .Times(2)
+      .WillOnce(Return(string("mb")))
+      .WillOnce(Return(string("nic")));
+  EXPECT_CALL(stream, make_sel(SELFormat::FRU_ALL))
+      .Times(1)
+      .WillOnce(Return(ByMove(std::move(sel))));
+  stringstream outp;
+  stream.start(inp, outp, {SELFormat::FRU_ALL}, "", "");
+  stream.flush(outp);
+
+  vector<nlohmann::json> got;
+  for (string line; getline(outp, line);) {
+    got.push_back(nlohmann::json::parse(line));
+  }
+  ASSERT_EQ(got.size(), 2);
+  EXPECT_EQ(got[0]["APP_NAME"], "healthd");
+  EXPECT_EQ(got[1]["FRU#"], "1");
+  EXPECT_EQ(got[1]["FRU_NAME"], "mb");
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include "log-util.hpp"
+#include "selindex.hpp"
+#include "seltombstone.hpp"
+#include "sel_test_helpers.hpp"
+
+using namespace std;
+
+namespace {
+
+class NoReload : public rsyslogd {
+ public:
+  void reload() override {}
+};
+
+class TombstoneLogUtil : public LogUtil {
+  std::vector<std::string> logfiles_;
+
+ public:
+  int reloads = 0;
+
+  explicit TombstoneLogUtil(const std::vector<std::string>& logfiles)
+      : logfiles_(logfiles) {}
+  std::unique_ptr<SELStream> make_stream(OutputFormat fmt) override {
+    return std::make_unique<NamedSELStream>(fmt);
+  }
+  std::unique_ptr<rsyslogd> make_rsyslogd() override {
+    reloads++;
+    return std::make_unique<NoReload>();
+  }
+  const std::vector<std::string>& logfile_list() override {
+    return logfiles_;
+  }
+  std::string index_path(const std::string& logfile) override {
+    return logfile + ".idx";
+  }
+  std::string tombstone_path() override {
+    return "./seltombstone.cleared";
+  }
+};
+
+string read_file(const string& path) {
+  ifstream ifs(path);
+  stringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+// Drop the breadcrumbs, which the copies do not have.
+string strip_cleared(const string& s) {
+  istringstream is(s);
+  string out;
+  for (string line; getline(is, line);) {
+    if (line.find("User cleared") == string::npos) {
+      out += line + '\n';
+    }
+  }
+  return out;
+}
+
+size_t count(const string& s, const string& needle) {
+  size_t n = 0;
+  for (size_t pos = s.find(needle); pos != string::npos;
+       pos = s.find(needle, pos + 1)) {
+    n++;
+  }
+  return n;
+}
+
+} // namespace
+
+class SELTombstoneTest : public ::testing::Test {
+ protected:
+  const string logfile = "./seltombstone.log";
+  const string rotated = "./seltombstone.log.0";
+  const string copy = "./seltombstone.copy";
+  const string cleared = "./seltombstone.cleared";
+  time_t now = 0;
+
+  // FRU 1 to 4 in turn, starting at 2021-03-01.
+  void append(const string& file, size_t lines) {
+    append_sel(file, now, lines, [](size_t i) { return i % 4 + 1; });
+  }
+
+  string print(const vector<string>& files, const fru_set& frus,
+               const string& start = "", const string& end = "") {
+    TombstoneLogUtil util(files);
+    stringstream outp;
+    util.print(frus, start, end, false, outp);
+    return outp.str();
+  }
+
+  // What clear() wrote before tombstones, done on a copy.
+  void clear_copy(const string& from, const fru_set& frus,
+                  const string& start = "", const string& end = "") {
+    ofstream(copy) << read_file(from);
+    NamedSELStream stream(FORMAT_RAW);
+    ifstream ifs(copy);
+    ofstream ofs(copy + ".tmp");
+    stream.start(ifs, ofs, frus, start, end);
+    stream.flush(ofs);
+    ofs.close();
+    rename((copy + ".tmp").c_str(), copy.c_str());
+  }
+
+  void remove_all() {
+    for (auto& f : {logfile, rotated, copy, cleared}) {
+      remove(f.c_str());
+      remove((f + ".idx").c_str());
+    }
+  }
+
+  void SetUp() {
+    std::tm ts{};
+    strptime("2021-03-01 00:00:00", "%Y-%m-%d %H:%M:%S", &ts);
+    now = mktime(&ts);
+    remove_all();
+    append(logfile, 2000);
+  }
+  void TearDown() {
+    remove_all();
+  }
+};
+
+TEST_F(SELTombstoneTest, ClearFru) {
+  string before = read_file(logfile);
+  ASSERT_GE(before.size(), size_t(SELIndex::min_log_size));
+  clear_copy(logfile, {2});
+
+  TombstoneLogUtil util({logfile});
+  util.clear({2}, "", "");
+  EXPECT_EQ(util.reloads, 0);
+  EXPECT_EQ(SELTombstones(cleared).size(), 1);
+  // Only the breadcrumb is written.
+  string after = read_file(logfile);
+  EXPECT_EQ(after.compare(0, before.size(), before), 0);
+  EXPECT_NE(after.find("User cleared FRU: 2 logs", before.size()), string::npos);
+
+  EXPECT_EQ(
+      print({logfile}, {SELFormat::FRU_ALL}).find("FRU: 2,"), string::npos);
+  EXPECT_EQ(strip_cleared(print({logfile}, {1, 2, 3})), print({copy}, {1, 2, 3}));
+  EXPECT_EQ(
+      print({logfile}, {3}, "2021-03-01 10:00:00", "2021-03-01 12:00:00"),
+      print({copy}, {3}, "2021-03-01 10:00:00", "2021-03-01 12:00:00"));
+
+  // Logs after the clear are shown.
+  append(logfile, 10);
+  EXPECT_NE(print({logfile}, {2}).find("FRU: 2,"), string::npos);
+}
+
+TEST_F(SELTombstoneTest, ClearTimestamp) {
+  string start = "2021-03-01 05:00:00", end = "2021-03-01 08:00:00";
+  clear_copy(logfile, {SELFormat::FRU_ALL}, start, end);
+  TombstoneLogUtil({logfile}).clear({SELFormat::FRU_ALL}, start, end);
+  EXPECT_EQ(print({logfile}, {4}), print({copy}, {4}));
+  EXPECT_EQ(print({logfile}, {SELFormat::FRU_ALL}, start, end), "");
+}
+
+TEST_F(SELTombstoneTest, ClearSys) {
+  clear_copy(logfile, {SELFormat::FRU_SYS});
+  TombstoneLogUtil({logfile}).clear({SELFormat::FRU_SYS}, "", "");
+  EXPECT_EQ(
+      print({logfile}, {SELFormat::FRU_SYS}).find("BMC CPU"), string::npos);
+  EXPECT_EQ(
+      strip_cleared(print({logfile}, {SELFormat::FRU_ALL})),
+      print({copy}, {SELFormat::FRU_ALL}));
+}
+
+TEST_F(SELTombstoneTest, Rotate) {
+  vector<string> files = {rotated, logfile};
+  TombstoneLogUtil(files).clear({1}, "", "");
+  EXPECT_EQ(SELTombstones(cleared).size(), 1);
+
+  // rotate_logfile
+  rename(logfile.c_str(), rotated.c_str());
+  append(logfile, 2000);
+  // Only the logs of the new logfile are left.
+  EXPECT_EQ(
+      count(print(files, {1}), "FRU: 1,"),
+      count(print({logfile}, {1}), "FRU: 1,"));
+  EXPECT_GT(count(print({logfile}, {1}), "FRU: 1,"), 0);
+
+  TombstoneLogUtil(files).clear({3}, "", "");
+  EXPECT_EQ(SELTombstones(cleared).size(), 3);
+  rename(logfile.c_str(), rotated.c_str());
+  append(logfile, 2000);
+  // The tombstones of the logfile rotated out are dropped.
+  TombstoneLogUtil(files).clear({4}, "", "");
+  SELTombstones tombstones(cleared);
+  EXPECT_EQ(tombstones.size(), 3);
+  EXPECT_EQ(tombstones.find(rotated).size(), 2);
+  EXPECT_EQ(tombstones.find(logfile).size(), 1);
+  EXPECT_EQ(
+      count(print(files, {3}), "FRU: 3,"),
+      count(print({logfile}, {3}), "FRU: 3,"));
+}
+
+TEST_F(SELTombstoneTest, SmallLogRewritten) {
+  remove(logfile.c_str());
+  append(logfile, 10);
+  TombstoneLogUtil util({logfile});
+  util.clear({2}, "", "");
+  EXPECT_EQ(util.reloads, 1);
+  EXPECT_EQ(SELTombstones(cleared).size(), 0);
+  EXPECT_EQ(read_file(logfile).find("FRU: 2,"), string::npos);
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Minimal streaming CBOR (RFC 8949) encoder. Used to serialize
+// monitored data straight into the response buffer without first
+// building a nlohmann::json tree. The output is decodable with
+// nlohmann::json::from_cbor() and results in the same document
+// as the to_json() counterparts.
+// Only definite length maps/arrays are supported. So the caller
+// must know the number of items up front.
+class CborEncoder {
+  std::vector<uint8_t>& out_;
+
+  enum MajorType : uint8_t {
+    UNSIGNED = 0,
+    NEGATIVE = 1,
+    TEXT = 3,
+    ARRAY = 4,
+    MAP = 5,
+    SIMPLE = 7,
+  };
+
+  void head(MajorType type, uint64_t arg) {
+    uint8_t major = type << 5;
+    if (arg < 24) {
+      out_.push_back(major | uint8_t(arg));
+    } else if (arg <= 0xff) {
+      out_.push_back(major | 24);
+      out_.push_back(uint8_t(arg));
+    } else if (arg <= 0xffff) {
+      out_.push_back(major | 25);
+      putBE(arg, 2);
+    } else if (arg <= 0xffffffff) {
+      out_.push_back(major | 26);
+      putBE(arg, 4);
+    } else {
+      out_.push_back(major | 27);
+      putBE(arg, 8);
+    }
+  }
+
+  void putBE(uint64_t val, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+      out_.push_back(uint8_t(val >> (i * 8)));
+    }
+  }
+
+ public:
+  explicit CborEncoder(std::vector<uint8_t>& out) : out_(out) {}
+
+  // Starts a map of size key-value pairs. The caller is expected
+  // to follow this up with size * 2 items.
+  CborEncoder& map(size_t size) {
+    head(MAP, size);
+    return *this;
+  }
+
+  // Starts an array of size items.
+  CborEncoder& array(size_t size) {
+    head(ARRAY, size);
+    return *this;
+  }
+
+  template <typename T, std::enable_if_t<std::is_integral_v<T>, bool> = true>
+  CborEncoder& operator<<(T val) {
+    if constexpr (std::is_same_v<T, bool>) {
+      out_.push_back((SIMPLE << 5) | (val ? 21 : 20));
+    } else if constexpr (std::is_signed_v<T>) {
+      if (val < 0) {
+        // -1 - n is encoded as n.
+        head(NEGATIVE, uint64_t(-1 - int64_t(val)));
+      } else {
+        head(UNSIGNED, uint64_t(val));
+      }
+    } else {
+      head(UNSIGNED, uint64_t(val));
+    }
+    return *this;
+  }
+
+  CborEncoder& operator<<(float val) {
+    uint32_t bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    out_.push_back((SIMPLE << 5) | 26);
+    putBE(bits, 4);
+    return *this;
+  }
+
+  CborEncoder& operator<<(std::string_view str) {
+    head(TEXT, str.size());
+    out_.insert(out_.end(), str.begin(), str.end());
+    return *this;
+  }
+
+  // Without this, string literals would decay to bool.
+  CborEncoder& operator<<(const char* str) {
+    return *this << std::string_view(str);
+  }
+
+  // Append a text string of size bytes which the caller will fill
+  // in. Returns a pointer to the start of the string.
+  char* text(size_t size) {
+    head(TEXT, size);
+    size_t off = out_.size();
+    out_.resize(off + size);
+    return reinterpret_cast<char*>(out_.data() + off);
+  }
+};
@@ -0,0 +1,197 @@
+#include "history.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <system_error>
+#include "log.hpp"
+
+static std::system_error sysError(const std::string& what) {
+  return std::system_error(
+      std::error_code(errno, std::generic_category()), what);
+}
+
+HistoryStore::HistoryStore(const std::string& path, size_t capacity) {
+  if (capacity == 0)
+    throw std::invalid_argument("History capacity cannot be zero");
+  mapSize_ = sizeof(Header) + capacity * sizeof(HistoryRecord);
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0)
+    throw sysError("Open " + path);
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    close(fd_);
+    throw sysError("Stat " + path);
+  }
+  bool fresh = size_t(st.st_size) != mapSize_;
+  if (fresh && (ftruncate(fd_, 0) != 0 || ftruncate(fd_, mapSize_) != 0)) {
+    close(fd_);
+    throw sysError("Resize " + path);
+  }
+  void* addr =
+      mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED) {
+    close(fd_);
+    throw sysError("Map " + path);
+  }
+  header_ = static_cast<Header*>(addr);
+  records_ = reinterpret_cast<HistoryRecord*>(header_ + 1);
+  if (fresh || header_->magic != kMagic || header_->version != kVersion ||
+      header_->capacity != capacity) {
+    if (!fresh)
+      logInfo << "Discarding incompatible history at " << path << std::endl;
+    std::fill(records_, records_ + capacity, HistoryRecord{});
+    header_->version = kVersion;
+    header_->capacity = capacity;
+    header_->appended = 0;
+    header_->ordered = 0;
+    header_->latest = 0;
+    header_->reserved = 0;
+    header_->magic = kMagic;
+  }
+}
+
+HistoryStore::~HistoryStore() {
+  munmap(header_, mapSize_);
+  close(fd_);
+}
+
+bool HistoryStore::append(
+    uint8_t deviceAddress,
+    uint16_t regAddr,
+    uint32_t timestamp,
+    const uint16_t* value,
+    size_t length) {
+  if (length > HistoryRecord::kMaxWords)
+    return false;
+  std::unique_lock lock(mutex_);
+  HistoryRecord& rec = records_[header_->appended % header_->capacity];
+  rec.timestamp = timestamp;
+  rec.regAddr = regAddr;
+  rec.deviceAddress = deviceAddress;
+  rec.length = length;
+  std::copy(value, value + length, rec.value);
+  // The clock was set back, the records so far cannot be
+  // searched by time anymore.
+  if (timestamp + kMaxReorder < header_->latest) {
+    header_->ordered = header_->appended;
+    header_->latest = timestamp;
+  } else {
+    header_->latest = std::max(header_->latest, timestamp);
+  }
+  // Only account for the record once it is fully written.
+  header_->appended++;
+  return true;
+}
+
+std::vector<HistoryRecord> HistoryStore::query(
+    uint8_t deviceAddress,
+    uint16_t regAddr,
+    uint32_t start,
+    uint32_t end) {
+  std::vector<HistoryRecord> ret;
+  auto match = [&](const HistoryRecord& rec) {
+    return rec.deviceAddress == deviceAddress && rec.regAddr == regAddr &&
+        rec.timestamp >= start && rec.timestamp <= end;
+  };
+  std::unique_lock lock(mutex_);
+  // Records older than the last step back of the clock are not in
+  // time order, go through all of them.
+  uint64_t ordered = std::max(oldest(), header_->ordered);
+  for (uint64_t seq = oldest(); seq < ordered; seq++) {
+    if (match(at(seq)))
+      ret.push_back(at(seq));
+  }
+  // The rest are in time order give or take kMaxReorder seconds, so
+  // a binary search gets us close to the first record of interest.
+  uint32_t searchStart = start > kMaxReorder ? start - kMaxReorder : 0;
+  uint64_t lo = ordered, hi = header_->appended;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    if (at(mid).timestamp < searchStart)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  for (uint64_t seq = lo; seq < header_->appended; seq++) {
+    const HistoryRecord& rec = at(seq);
+    if (rec.timestamp > end && rec.timestamp - end > kMaxReorder)
+      break;
+    if (match(rec))
+      ret.push_back(rec);
+  }
+  return ret;
+}
+
+// Same interpretation as integer registers of up to 2 words.
+static int32_t toInteger(const HistoryRecord& rec, bool sign) {
+  if (rec.length == 1)
+    return sign ? int16_t(rec.value[0]) : rec.value[0];
+  return int32_t((uint32_t(rec.value[0]) << 16) | rec.value[1]);
+}
+
+static void fromInteger(int32_t val, HistoryRecord& rec) {
+  uint32_t uval = uint32_t(val);
+  for (size_t i = rec.length; i > 0; i--, uval >>= 16)
+    rec.value[i - 1] = uval & 0xffff;
+}
+
+RegisterStoreValue HistoryStore::query(
+    uint8_t deviceAddress,
+    const RegisterDescriptor& desc,
+    uint32_t start,
+    uint32_t end,
+    uint32_t interval) {
+  std::vector<HistoryRecord> records =
+      query(deviceAddress, desc.begin, start, end);
+  // Ignore records made with a different register map.
+  records.erase(
+      std::remove_if(
+          records.begin(),
+          records.end(),
+          [&desc](const HistoryRecord& rec) {
+            return rec.length != desc.length;
+          }),
+      records.end());
+  RegisterStoreValue ret(desc);
+  if (interval == 0) {
+    ret.history.reserve(records.size());
+    for (const auto& rec : records)
+      ret.history.push_back(Register(desc, rec.timestamp, rec.value));
+    return ret;
+  }
+  bool average = (desc.format == RegisterValueType::INTEGER ||
+                  desc.format == RegisterValueType::FLOAT) &&
+      desc.length <= 2;
+  // Readings from before the clock was set back are out of order.
+  std::stable_sort(
+      records.begin(),
+      records.end(),
+      [](const HistoryRecord& a, const HistoryRecord& b) {
+        return a.timestamp < b.timestamp;
+      });
+  for (size_t i = 0; i < records.size();) {
+    uint32_t bucket =
+        records[i].timestamp - (records[i].timestamp - start) % interval;
+    int64_t sum = 0;
+    size_t num = 0;
+    HistoryRecord sample = records[i];
+    for (; i < records.size() &&
+         int64_t(records[i].timestamp) - bucket < int64_t(interval);
+         i++) {
+      sum += toInteger(records[i], desc.sign);
+      num++;
+      sample = records[i];
+    }
+    if (average)
+      fromInteger(int32_t(sum / int64_t(num)), sample);
+    ret.history.push_back(Register(desc, bucket, sample.value));
+  }
+  return ret;
+}
+
+size_t HistoryStore::size() {
+  std::unique_lock lock(mutex_);
+  return header_->appended - oldest();
+}
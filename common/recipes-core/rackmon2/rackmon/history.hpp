@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "regmap.hpp"
+
+// A single register reading as it is stored on disk. Records are
+// fixed size, so registers longer than kMaxWords are not recorded.
+struct HistoryRecord {
+  static constexpr size_t kMaxWords = 4;
+  uint32_t timestamp = 0;
+  uint16_t regAddr = 0;
+  uint8_t deviceAddress = 0;
+  uint8_t length = 0;
+  uint16_t value[kMaxWords] = {};
+};
+static_assert(sizeof(HistoryRecord) == 16, "HistoryRecord must be packed");
+
+// Persistent time-series of monitored registers. Readings are
+// appended to a memory mapped file used as a ring buffer of
+// fixed size records, so once it is full, the oldest readings
+// are overwritten. The file survives restarts of rackmond.
+class HistoryStore {
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    // Number of records ever appended. The next record goes to
+    // slot (appended % capacity).
+    uint64_t appended;
+    // Sequence number of the first record appended after the clock
+    // last went back in time. Records from there on are in time order.
+    uint64_t ordered;
+    // Latest timestamp appended.
+    uint32_t latest;
+    uint32_t reserved;
+  };
+  static constexpr uint32_t kMagic = 0x524d4853; // "RMHS"
+  static constexpr uint32_t kVersion = 2;
+  // Readings of different interfaces are appended in roughly time
+  // order. Allow for this much (In seconds) when searching by time.
+  static constexpr uint32_t kMaxReorder = 5;
+
+  std::mutex mutex_{};
+  int fd_ = -1;
+  size_t mapSize_ = 0;
+  Header* header_ = nullptr;
+  HistoryRecord* records_ = nullptr;
+
+  // Returns the record appended as the seq'th record.
+  const HistoryRecord& at(uint64_t seq) const {
+    return records_[seq % header_->capacity];
+  }
+  // Sequence number of the oldest record still around.
+  uint64_t oldest() const {
+    return header_->appended > header_->capacity
+        ? header_->appended - header_->capacity
+        : 0;
+  }
+
+ public:
+  // Opens (or creates) the store at path to hold capacity records.
+  // An existing store of a different capacity or format is
+  // discarded. Throws std::system_error on failure.
+  HistoryStore(const std::string& path, size_t capacity);
+  ~HistoryStore();
+  HistoryStore(const HistoryStore&) = delete;
+  HistoryStore& operator=(const HistoryStore&) = delete;
+
+  // Append a reading. Returns false if it does not fit in a record.
+  bool append(
+      uint8_t deviceAddress,
+      uint16_t regAddr,
+      uint32_t timestamp,
+      const uint16_t* value,
+      size_t length);
+
+  // Returns the readings of a register with start <= timestamp <= end
+  // in the order they were appended. Readings are stamped with the
+  // wall clock, so after it is set back, readings from before are
+  // searched one by one rather than by time.
+  std::vector<HistoryRecord>
+  query(uint8_t deviceAddress, uint16_t regAddr, uint32_t start, uint32_t end);
+
+  // Same as above, but returns the readings of the register described
+  // by desc in the same form as the monitored value data. With a
+  // non-zero interval (In seconds), readings are downsampled to one
+  // per interval starting at start: Integer and float registers of up
+  // to 32bits are averaged, others take the last reading of the
+  // interval.
+  RegisterStoreValue query(
+      uint8_t deviceAddress,
+      const RegisterDescriptor& desc,
+      uint32_t start,
+      uint32_t end,
+      uint32_t interval = 0);
+
+  // Number of records currently stored.
+  size_t size();
+  size_t capacity() const {
+    return header_->capacity;
+  }
+};
@@ -21,7 +21,20 @@ void Modbus::command(
   std::lock_guard<std::mutex> lck(deviceMutex_);
   device_->setBaudrate(baudrate);
   device_->write(req.raw.data(), req.len);
-  device_->read(resp.raw.data(), resp.len, timeout.count());
+  try {
+    device_->read(resp.raw.data(), resp.len, timeout.count());
+  } catch (TimeoutException&) {
+    // A device which cannot serve the request answers with an
+    // exception response instead, shorter than the one expected.
+    if (resp.len > kExceptionResponseLength && resp.raw[0] == req.raw[0] &&
+        resp.raw[1] == (req.raw[1] | 0x80)) {
+      uint8_t code = resp.raw[2];
+      resp.len = kExceptionResponseLength;
+      resp.validate();
+      throw ModbusError(code);
+    }
+    throw;
+  }
   resp.decode();
   if (settleTime != ModbusTime::zero()) {
     std::this_thread::sleep_for(settleTime);
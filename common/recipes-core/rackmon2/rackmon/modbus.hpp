@@ -9,7 +9,24 @@
 #include "uart.hpp"
 
 using ModbusTime = std::chrono::milliseconds;
+
+// Exception response of a device which could not serve a request.
+struct ModbusError : public std::runtime_error {
+  // Exception codes of the Modbus application protocol.
+  static constexpr uint8_t kIllegalFunction = 0x1;
+  static constexpr uint8_t kIllegalDataAddress = 0x2;
+  static constexpr uint8_t kIllegalDataValue = 0x3;
+  static constexpr uint8_t kDeviceFailure = 0x4;
+  uint8_t code;
+  explicit ModbusError(uint8_t c)
+      : std::runtime_error("Modbus exception: " + std::to_string(c)),
+        code(c) {}
+};
+
 class Modbus {
+  // addr(1), func(1), code(1), crc(2)
+  static constexpr size_t kExceptionResponseLength = 5;
+
   std::string devicePath_{};
   std::unique_ptr<UARTDevice> device_ = nullptr;
   std::mutex deviceMutex_{};
@@ -1,5 +1,6 @@
 #include "modbus_device.hpp"
 #include <iomanip>
+#include <numeric>
 #include <sstream>
 #include "log.hpp"
 
@@ -24,6 +25,8 @@ ModbusDevice::ModbusDevice(
   for (auto& it : registerMap.registerDescriptors) {
     info_.registerList.emplace_back(it.second);
   }
+  schedule_.resize(info_.registerList.size());
+  changeSeq_.resize(info_.registerList.size());
 
   for (const auto& sp : registerMap.specialHandlers) {
     ModbusSpecialHandler hdl{};
@@ -99,7 +102,205 @@ void ModbusDevice::readFileRecord(
   command(req, resp, timeout);
 }
 
-void ModbusDevice::monitor() {
+bool ModbusDevice::isDue(size_t idx, time_t now, time_t defaultPeriod) const {
+  const RegisterSchedule& sched = schedule_[idx];
+  int32_t period = info_.registerList[idx].period();
+  if (period == -1) {
+    // Static register, read it till we succeed once. Do not retry
+    // more often than the default period.
+    return !sched.valid && now >= sched.lastAttempt + defaultPeriod;
+  }
+  if (period == 0)
+    period = defaultPeriod;
+  return now >= sched.lastAttempt + period;
+}
+
+std::vector<RegisterSpan> ModbusDevice::planReads(
+    const std::vector<size_t>& regs) const {
+  std::vector<RegisterSpan> spans{};
+  const RegisterReadHints& hints = *registerMap_.readHints;
+  for (size_t i : regs) {
+    const auto& registerStore = info_.registerList[i];
+    uint16_t begin = registerStore.regAddr();
+    uint32_t end = uint32_t(begin) + registerStore.length();
+    if (!spans.empty() && !hints.splitBefore(begin)) {
+      RegisterSpan& span = spans.back();
+      uint32_t spanEnd = uint32_t(span.begin) + span.length;
+      // Registers are sorted by address, so begin is never
+      // before the start of the current span.
+      if (begin <= spanEnd + registerMap_.maxReadGap &&
+          std::max(end, spanEnd) - span.begin <= RegisterSpan::kMaxRegisters) {
+        span.length = std::max(end, spanEnd) - span.begin;
+        span.priority = std::max(span.priority, registerStore.priority());
+        span.stores.push_back(i);
+        continue;
+      }
+    }
+    spans.push_back(
+        {begin, registerStore.length(), registerStore.priority(), {i}});
+  }
+  std::stable_sort(
+      spans.begin(), spans.end(), [](const auto& a, const auto& b) {
+        return a.priority > b.priority;
+      });
+  return spans;
+}
+
+std::vector<RegisterSpan> ModbusDevice::planReads() const {
+  std::vector<size_t> regs(info_.registerList.size());
+  std::iota(regs.begin(), regs.end(), 0);
+  return planReads(regs);
+}
+
+void ModbusDevice::commitRegister(
+    size_t idx,
+    const uint16_t* value,
+    uint32_t timestamp) {
+  auto& registerStore = info_.registerList[idx];
+  // Compare with the previous value before it is overwritten (With
+  // keep == 1, front and back are the same register).
+  Register lastRegister = registerStore.back();
+  bool changed = !lastRegister ||
+      !std::equal(value, value + registerStore.length(), lastRegister.value);
+  registerStore.setFront(value, timestamp);
+  // If we dont care about changes or if we do
+  // and we notice that the value is different
+  // from the previous, increment store to
+  // point to the next.
+  if (!registerStore.storeChangesOnly() || changed) {
+    ++registerStore;
+    if (history_) {
+      history_->append(
+          info_.deviceAddress,
+          registerStore.regAddr(),
+          timestamp,
+          value,
+          registerStore.length());
+    }
+  }
+  if (changed) {
+    changeSeq_[idx] = monitorSeq_;
+  }
+}
+
+bool ModbusDevice::monitorRegister(size_t idx, uint32_t timestamp) {
+  auto& registerStore = info_.registerList[idx];
+  uint16_t registerOffset = registerStore.regAddr();
+  std::vector<uint16_t> value(registerStore.length());
+  try {
+    readHoldingRegisters(registerOffset, value);
+    commitRegister(idx, value.data(), timestamp);
+  } catch (std::exception& e) {
+    logInfo << "DEV:0x" << std::hex << int(info_.deviceAddress)
+            << " ReadReg 0x" << std::hex << registerOffset << ' '
+            << registerStore.name() << " caught: " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void ModbusDevice::monitorSpan(const RegisterSpan& span, uint32_t timestamp) {
+  std::vector<uint16_t> regs(span.length);
+  readHoldingRegisters(span.begin, regs);
+  for (size_t i : span.stores) {
+    auto& registerStore = info_.registerList[i];
+    commitRegister(
+        i, regs.data() + (registerStore.regAddr() - span.begin), timestamp);
+  }
+}
+
+void ModbusDevice::logSpanFailure(
+    const RegisterSpan& span,
+    const std::exception& e) {
+  logInfo << "DEV:0x" << std::hex << int(info_.deviceAddress) << " ReadRegs 0x"
+          << std::hex << span.begin << " len " << std::dec << span.length
+          << " caught: " << e.what() << std::endl;
+}
+
+RegisterSpan ModbusDevice::makeSpan(
+    std::vector<size_t>::const_iterator first,
+    std::vector<size_t>::const_iterator last) const {
+  RegisterSpan span{};
+  span.begin = info_.registerList[*first].regAddr();
+  uint32_t end = span.begin;
+  for (auto it = first; it != last; ++it) {
+    const auto& registerStore = info_.registerList[*it];
+    end = std::max(
+        end, uint32_t(registerStore.regAddr()) + registerStore.length());
+    span.priority = std::max(span.priority, registerStore.priority());
+    span.stores.push_back(*it);
+  }
+  span.length = end - span.begin;
+  return span;
+}
+
+ModbusDevice::SpanRead ModbusDevice::readSpan(
+    const RegisterSpan& span,
+    uint32_t timestamp) {
+  try {
+    monitorSpan(span, timestamp);
+  } catch (CRCError& e) {
+    // Line noise, nothing to learn about the device from this.
+    return SpanRead::kFailed;
+  } catch (ModbusError& e) {
+    logSpanFailure(span, e);
+    // Most likely a hole in the address space of the device.
+    return e.code == ModbusError::kIllegalDataAddress ? SpanRead::kRefused
+                                                      : SpanRead::kFailed;
+  } catch (std::exception& e) {
+    // A timeout cannot be told from a busy device or a noisy line.
+    logSpanFailure(span, e);
+    return SpanRead::kFailed;
+  }
+  for (size_t i : span.stores) {
+    schedule_[i].valid = true;
+  }
+  return SpanRead::kDone;
+}
+
+void ModbusDevice::readEach(const RegisterSpan& span, uint32_t timestamp) {
+  for (size_t i : span.stores) {
+    if (monitorRegister(i, timestamp))
+      schedule_[i].valid = true;
+  }
+}
+
+void ModbusDevice::bisectSpan(const RegisterSpan& span, uint32_t timestamp) {
+  auto mid = span.stores.begin() + span.stores.size() / 2;
+  RegisterSpan halves[] = {
+      makeSpan(span.stores.begin(), mid), makeSpan(mid, span.stores.end())};
+  SpanRead read[] = {
+      readSpan(halves[0], timestamp), readSpan(halves[1], timestamp)};
+  RegisterReadHints& hints = *registerMap_.readHints;
+  if (read[0] == SpanRead::kDone && read[1] == SpanRead::kDone) {
+    // Each half is fine on its own, the device does not like a
+    // read across them. Remember this for all devices of this type.
+    hints.split(halves[1].begin);
+    return;
+  }
+  for (size_t h = 0; h < 2; h++) {
+    if (read[h] == SpanRead::kDone)
+      continue;
+    if (read[h] == SpanRead::kFailed) {
+      // No answer about this half, so nothing is learned from it.
+      if (halves[h].stores.size() > 1)
+        readEach(halves[h], timestamp);
+      continue;
+    }
+    if (halves[h].stores.size() > 1) {
+      bisectSpan(halves[h], timestamp);
+      continue;
+    }
+    // A register which is refused even on its own. Read it by itself
+    // from now on, so it does not take its neighbors down with it.
+    size_t next = halves[h].stores.front() + 1;
+    hints.split(halves[h].begin);
+    if (next < info_.registerList.size())
+      hints.split(info_.registerList[next].regAddr());
+  }
+}
+
+void ModbusDevice::monitor(time_t defaultPeriod) {
   // If the number of consecutive failures has exceeded
   // a threshold, mark the device as dormant.
   uint32_t timestamp = std::time(0);
@@ -107,25 +308,28 @@ void ModbusDevice::monitor() {
     specialHandler.handle(*this);
   }
   std::unique_lock lk(registerListMutex_);
-  for (auto& registerStore : info_.registerList) {
-    uint16_t registerOffset = registerStore.regAddr();
-    auto& nextRegister = registerStore.front();
-    try {
-      readHoldingRegisters(registerOffset, nextRegister.value);
-      nextRegister.timestamp = timestamp;
-      // If we dont care about changes or if we do
-      // and we notice that the value is different
-      // from the previous, increment store to
-      // point to the next.
-      if (!nextRegister.desc.storeChangesOnly ||
-          nextRegister != registerStore.back()) {
-        ++registerStore;
-      }
-    } catch (std::exception& e) {
-      logInfo << "DEV:0x" << std::hex << int(info_.deviceAddress)
-              << " ReadReg 0x" << std::hex << registerOffset << ' '
-              << registerStore.name() << " caught: " << e.what() << std::endl;
+  monitorSeq_++;
+  std::vector<size_t> due{};
+  for (size_t i = 0; i < info_.registerList.size(); i++) {
+    if (isDue(i, timestamp, defaultPeriod))
+      due.push_back(i);
+  }
+  for (const auto& span : planReads(due)) {
+    for (size_t i : span.stores) {
+      schedule_[i].lastAttempt = timestamp;
+    }
+    if (span.stores.size() == 1) {
+      readEach(span, timestamp);
+      continue;
+    }
+    SpanRead read = readSpan(span, timestamp);
+    if (read == SpanRead::kDone)
       continue;
+    if (read == SpanRead::kRefused) {
+      bisectSpan(span, timestamp);
+    } else {
+      // Fall back to reading each register on its own.
+      readEach(span, timestamp);
     }
   }
 }
@@ -162,6 +366,55 @@ ModbusDeviceValueData ModbusDevice::getValueData() {
   return data;
 }
 
+// Keep in sync with the JSON serialization of ModbusDeviceMode.
+static const char* modeName(ModbusDeviceMode mode) {
+  return mode == ModbusDeviceMode::ACTIVE ? "active" : "dormant";
+}
+
+void ModbusDevice::encodeRawData(CborEncoder& e) {
+  std::unique_lock lk(registerListMutex_);
+  e.map(9);
+  e << "addr" << info_.deviceAddress << "crc_fails" << info_.crcErrors;
+  e << "timeouts" << info_.timeouts << "misc_fails" << info_.miscErrors;
+  e << "mode" << modeName(info_.mode) << "baudrate" << info_.baudrate;
+  e << "deviceType" << info_.deviceType << "now" << std::time(0);
+  e << "ranges";
+  e.array(info_.registerList.size());
+  for (const auto& reg : info_.registerList)
+    to_cbor(e, reg);
+}
+
+void ModbusDevice::encodeValueData(CborEncoder& e) {
+  std::unique_lock lk(registerListMutex_);
+  e.map(9);
+  e << "deviceAddress" << info_.deviceAddress << "deviceType"
+    << info_.deviceType;
+  e << "crcErrors" << info_.crcErrors << "timeouts" << info_.timeouts;
+  e << "miscErrors" << info_.miscErrors << "baudrate" << info_.baudrate;
+  e << "mode" << modeName(info_.mode) << "now" << std::time(0);
+  e << "registers";
+  e.array(info_.registerList.size());
+  for (const auto& reg : info_.registerList)
+    reg.encodeValue(e);
+}
+
+ModbusDeviceValueData ModbusDevice::getChangedValueData(uint64_t& since) {
+  std::unique_lock lk(registerListMutex_);
+  ModbusDeviceValueData data;
+  data.ModbusDeviceInfo::operator=(info_);
+  for (size_t i = 0; i < info_.registerList.size(); i++) {
+    if (changeSeq_[i] <= since)
+      continue;
+    const auto& reg = info_.registerList[i];
+    Register latest = reg.back();
+    RegisterStoreValue value(latest.desc);
+    value.history.push_back(latest);
+    data.registerList.push_back(std::move(value));
+  }
+  since = monitorSeq_;
+  return data;
+}
+
 static std::string commandOutput(const std::string& shell) {
   std::array<char, 128> buffer;
   std::string result;
@@ -1,6 +1,8 @@
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <ctime>
 #include <iostream>
+#include "history.hpp"
 #include "modbus.hpp"
 #include "modbus_cmds.hpp"
 #include "regmap.hpp"
@@ -66,12 +68,68 @@ struct ModbusDeviceValueData : public ModbusDeviceInfo {
 };
 void to_json(nlohmann::json& j, const ModbusDeviceValueData& m);
 
+// Describes a single Read Holding Registers transaction covering
+// one or more consecutive entries of the monitored register list.
+struct RegisterSpan {
+  // Maximum number of registers which fit in a single response
+  // addr(1), func(1), bytecount(1), <2 * count regs>, crc(2)
+  static constexpr uint16_t kMaxRegisters = (Msg::kMaxModbusLength - 5) / 2;
+  uint16_t begin = 0;
+  uint16_t length = 0;
+  // Highest priority of the register stores covered by this span.
+  uint8_t priority = 0;
+  // Indices of the register stores covered by this span.
+  std::vector<size_t> stores{};
+};
+
+// Tracks when a register was last read.
+struct RegisterSchedule {
+  // Time of the last attempt to read the register.
+  time_t lastAttempt = 0;
+  // Set once the register has been read successfully.
+  bool valid = false;
+};
+
 class ModbusDevice {
   Modbus& interface_;
   ModbusDeviceRawData info_;
   const RegisterMap& registerMap_;
   std::mutex registerListMutex_{};
   std::vector<ModbusSpecialHandler> specialHandlers_{};
+  // Read schedule of each entry in info_.registerList.
+  std::vector<RegisterSchedule> schedule_{};
+  // Number of monitor passes done on this device.
+  uint64_t monitorSeq_ = 0;
+  // Monitor pass in which each register last changed its value.
+  std::vector<uint64_t> changeSeq_{};
+  // Optional persistent store every kept reading is appended to.
+  HistoryStore* history_ = nullptr;
+
+  // Returns true if the register is due to be read.
+  bool isDue(size_t idx, time_t now, time_t defaultPeriod) const;
+
+  // Stores the value just read into the front of a register store.
+  void commitRegister(size_t idx, const uint16_t* value, uint32_t timestamp);
+  // Reads a single register store. Returns true on success.
+  bool monitorRegister(size_t idx, uint32_t timestamp);
+  // Reads an entire span in one transaction and scatters the
+  // contents into the covered register stores.
+  void monitorSpan(const RegisterSpan& span, uint32_t timestamp);
+  void logSpanFailure(const RegisterSpan& span, const std::exception& e);
+  // Span covering the register stores [first, last).
+  RegisterSpan makeSpan(
+      std::vector<size_t>::const_iterator first,
+      std::vector<size_t>::const_iterator last) const;
+  // Outcome of a read. Only an illegal data address exception is taken
+  // as the device refusing it.
+  enum class SpanRead { kDone, kRefused, kFailed };
+  // Reads a span and marks its stores valid.
+  SpanRead readSpan(const RegisterSpan& span, uint32_t timestamp);
+  // Reads each register store of a span by itself.
+  void readEach(const RegisterSpan& span, uint32_t timestamp);
+  // Reads a span the device refused in halves, and records in the
+  // read hints where it has to be split.
+  void bisectSpan(const RegisterSpan& span, uint32_t timestamp);
 
  public:
   ModbusDevice(
@@ -105,17 +163,41 @@ class ModbusDevice {
       std::vector<FileRecord>& records,
       ModbusTime timeout = ModbusTime::zero());
 
-  void monitor();
+  // Groups the given registers (Indices into the monitored register
+  // list) into as few read transactions as the register map (and
+  // learned read hints) allow. Spans are returned highest priority
+  // first.
+  std::vector<RegisterSpan> planReads(const std::vector<size_t>& regs) const;
+  // Plan reads of all monitored registers.
+  std::vector<RegisterSpan> planReads() const;
+
+  // Read all registers which are due. defaultPeriod is used as the
+  // period of registers which do not specify their own. With the
+  // default of 0, they are read on every call.
+  void monitor(time_t defaultPeriod = 0);
 
   bool isActive() const {
     return info_.mode == ModbusDeviceMode::ACTIVE;
   }
   void setActive() {
+    std::unique_lock lk(registerListMutex_);
     info_.numConsecutiveFailures = 0;
+    info_.mode = ModbusDeviceMode::ACTIVE;
+    // It may be another unit at the same address by now, read every
+    // register again, static ones included.
+    std::fill(schedule_.begin(), schedule_.end(), RegisterSchedule{});
   }
   time_t lastActive() const {
     return info_.lastActive;
   }
+  // Record kept readings into a persistent store as well.
+  void setHistoryStore(HistoryStore* history) {
+    history_ = history;
+  }
+  // Interface the device was discovered on.
+  const Modbus& getInterface() const {
+    return interface_;
+  }
 
   // Return structured information of the device.
   ModbusDeviceInfo getInfo();
@@ -129,6 +211,16 @@ class ModbusDevice {
   // Returns value formatted register data monitored for this device.
   ModbusDeviceValueData getValueData();
 
+  // Encodes the same as getRawData() and getValueData() respectively
+  // straight from the register stores.
+  void encodeRawData(CborEncoder& e);
+  void encodeValueData(CborEncoder& e);
+
+  // Returns the latest value of registers which changed after the
+  // monitor pass since. since is updated to the latest monitor pass
+  // so it can be passed back in to only receive newer changes.
+  ModbusDeviceValueData getChangedValueData(uint64_t& since);
+
   // Allow special handler access into the device.
   friend ModbusSpecialHandler;
 };
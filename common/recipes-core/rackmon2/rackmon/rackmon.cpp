@@ -19,6 +19,12 @@ void Rackmon::load(const std::string& confPath, const std::string& regmapDir) {
     interfaces_.back()->initialize(ifaceConf);
   }
   registerMapDB_.load(regmapDir);
+  if (j.contains("history")) {
+    const json& historyConf = j["history"];
+    history_ = std::make_unique<HistoryStore>(
+        historyConf.at("path"),
+        historyConf.value("records", kDefaultHistoryRecords));
+  }
 
   // Precomputing this makes our scan soooo much easier.
   // its 256 bytes wasted. but worth it.
@@ -30,7 +36,6 @@ void Rackmon::load(const std::string& confPath, const std::string& regmapDir) {
       continue;
     }
   }
-  nextDeviceToProbe_ = allPossibleDevAddrs_.begin();
 }
 
 bool Rackmon::probe(Modbus& interface, uint8_t addr) {
@@ -41,7 +46,12 @@ bool Rackmon::probe(Modbus& interface, uint8_t addr) {
     ReadHoldingRegistersResp resp(addr, v);
     interface.command(req, resp, rmap.defaultBaudrate, kProbeTimeout);
     std::unique_lock lock(devicesMutex_);
+    // Interfaces are scanned in parallel and we do not support the
+    // same address on multiple interfaces. First one wins.
+    if (devices_.find(addr) != devices_.end())
+      return false;
     devices_[addr] = std::make_unique<ModbusDevice>(interface, addr, rmap);
+    devices_[addr]->setHistoryStore(history_.get());
     logInfo << std::hex << std::setw(2) << std::setfill('0') << "Found "
             << int(addr) << " on " << interface.name() << std::endl;
     return true;
@@ -50,15 +60,6 @@ bool Rackmon::probe(Modbus& interface, uint8_t addr) {
   }
 }
 
-bool Rackmon::probe(uint8_t addr) {
-  // We do not support the same address
-  // on multiple interfaces.
-  return std::any_of(
-      interfaces_.begin(), interfaces_.end(), [this, addr](auto& iface) {
-        return probe(*iface, addr);
-      });
-}
-
 std::vector<uint8_t> Rackmon::inspectDormant() {
   time_t curr = std::time(0);
   std::vector<uint8_t> ret{};
@@ -92,14 +93,35 @@ void Rackmon::recoverDormant() {
   }
 }
 
-void Rackmon::monitor(void) {
-  std::shared_lock lock(devicesMutex_);
-  for (const auto& dev_it : devices_) {
-    if (!dev_it.second->isActive())
-      continue;
-    dev_it.second->monitor();
+void Rackmon::monitor(Modbus& interface) {
+  RACKMON_PROFILE_SCOPE(
+      monitorCycle, "monitor::" + interface.name(), profileStore_);
+  {
+    std::unique_lock lock(monitorStatsMutex_);
+    monitorStats_[&interface].inProgress = true;
   }
+  auto begin = std::chrono::steady_clock::now();
+  {
+    std::shared_lock lock(devicesMutex_);
+    for (const auto& dev_it : devices_) {
+      if (&dev_it.second->getInterface() != &interface ||
+          !dev_it.second->isActive())
+        continue;
+      dev_it.second->monitor(monitorInterval_.count());
+    }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - begin);
+  std::unique_lock lock(monitorStatsMutex_);
+  MonitorCycleStats& stats = monitorStats_[&interface];
+  stats.cycles++;
+  stats.last = elapsed;
+  stats.max = std::max(stats.max, elapsed);
+  stats.inProgress = false;
   lastMonitorTime_ = std::time(0);
+  lock.unlock();
+  if (monitorCallback_)
+    monitorCallback_();
 }
 
 bool Rackmon::isDeviceKnown(uint8_t addr) {
@@ -107,45 +129,135 @@ bool Rackmon::isDeviceKnown(uint8_t addr) {
   return devices_.find(addr) != devices_.end();
 }
 
-void Rackmon::fullScan() {
-  logInfo << "Starting scan of all devices" << std::endl;
+size_t Rackmon::dormantDevices(const Modbus& interface) {
+  std::shared_lock lk(devicesMutex_);
+  return std::count_if(devices_.begin(), devices_.end(), [&](const auto& it) {
+    return &it.second->getInterface() == &interface && !it.second->isActive();
+  });
+}
+
+void Rackmon::fullScan(Modbus& interface) {
+  logInfo << "Starting scan of all devices on " << interface.name()
+          << std::endl;
+  auto begin = std::chrono::steady_clock::now();
   for (auto& addr : allPossibleDevAddrs_) {
     if (isDeviceKnown(addr))
       continue;
-    probe(addr);
+    probe(interface, addr);
   }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - begin);
+  logInfo << "Scan of " << interface.name() << " took " << std::dec
+          << elapsed.count() << " ms" << std::endl;
+  std::unique_lock lock(scanStatsMutex_);
+  scanStats_[&interface].fullScan = elapsed;
 }
 
-void Rackmon::scan() {
-  // Circular iterator.
-  if (reqForceScan_.load()) {
-    fullScan();
-    reqForceScan_ = false;
-    return;
-  }
+size_t Rackmon::sweepBudget(const Modbus& interface) {
+  std::unique_lock lock(monitorStatsMutex_);
+  const MonitorCycleStats& stats = monitorStats_[&interface];
+  // Stay off the bus while its devices are being monitored.
+  if (stats.inProgress)
+    return 0;
+  // Fraction of the time the bus is idle going by the last monitor
+  // cycle. Absent devices cost a full kProbeTimeout each, so only
+  // use a share of it to leave room for raw commands.
+  std::chrono::milliseconds tick = monitorTick_;
+  std::chrono::milliseconds busy = std::min(stats.last, tick);
+  std::chrono::milliseconds idle =
+      std::chrono::milliseconds(kSweepInterval) * (tick - busy).count() /
+      tick.count();
+  return std::max<size_t>(1, idle / kProbeTimeout / kSweepIdleShare);
+}
 
-  // Probe for the address only if we already dont know it.
-  if (!isDeviceKnown(*nextDeviceToProbe_)) {
-    probe(*nextDeviceToProbe_);
-    lastScanTime_ = std::time(0);
+void Rackmon::sweep(Modbus& interface, ScanState& state) {
+  size_t budget = sweepBudget(interface);
+  for (size_t i = 0; i < budget && !allPossibleDevAddrs_.empty(); i++) {
+    auto now = std::chrono::steady_clock::now();
+    if (state.next == 0)
+      state.sweepStart = now;
+    uint8_t addr = allPossibleDevAddrs_[state.next];
+    // Probe for the address only if we already dont know it.
+    if (!isDeviceKnown(addr) && probe(interface, addr))
+      state.found = true;
+    if (++state.next == allPossibleDevAddrs_.size()) {
+      state.next = 0;
+      // Nothing new showed up, look less often.
+      state.backoff =
+          state.found ? 1 : std::min(state.backoff * 2, kMaxSweepBackoff);
+      state.found = false;
+      std::unique_lock lock(scanStatsMutex_);
+      scanStats_[&interface].sweep =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - state.sweepStart);
+    }
   }
+  lastScanTime_ = std::time(0);
+  std::unique_lock lock(scanStatsMutex_);
+  scanStats_[&interface].probesPerStep = budget;
+  scanStats_[&interface].backoff = state.backoff;
+}
 
-  // Try and recover dormant devices
-  recoverDormant();
-  if (++nextDeviceToProbe_ == allPossibleDevAddrs_.end())
-    nextDeviceToProbe_ = allPossibleDevAddrs_.begin();
+void Rackmon::scan(Modbus& interface) {
+  ScanState& state = scanState_.at(&interface);
+  uint32_t requests = fullScanRequests_.load();
+  if (state.fullScans != requests) {
+    fullScan(interface);
+    state.fullScans = requests;
+    state.next = 0;
+    state.backoff = 1;
+    state.skipped = 0;
+    return;
+  }
+  // A device went dormant, it may be getting replaced. Sweep at
+  // full speed again.
+  size_t dormant = dormantDevices(interface);
+  if (dormant > state.dormant) {
+    state.backoff = 1;
+    state.skipped = 0;
+  }
+  state.dormant = dormant;
+  if (++state.skipped < state.backoff)
+    return;
+  state.skipped = 0;
+  sweep(interface, state);
 }
 
 void Rackmon::start(PollThreadTime interval) {
-  auto start_thread = [this](auto func, auto intr) {
+  auto start_thread = [this](std::function<void(Rackmon*)> func, auto intr) {
     threads_.emplace_back(
         std::make_unique<PollThread<Rackmon>>(func, this, intr));
     threads_.back()->start();
   };
   if (threads_.size() != 0)
     throw std::runtime_error("Already running");
-  start_thread(&Rackmon::scan, interval);
-  start_thread(&Rackmon::monitor, interval);
+  // Try and recover dormant devices
+  start_thread(&Rackmon::recoverDormant, interval);
+
+  // Registers may ask to be read more often than the interval.
+  // Wake up often enough to honor the shortest such period,
+  // ModbusDevice::monitor() only reads registers which are due.
+  monitorInterval_ = interval;
+  PollThreadTime tick = interval;
+  for (const auto& rmap : registerMapDB_.regmaps) {
+    for (const auto& [reg, desc] : rmap->registerDescriptors) {
+      if (desc.period > 0)
+        tick = std::min(tick, PollThreadTime(desc.period));
+    }
+  }
+  monitorTick_ = tick;
+  // One monitor and one scan thread per interface. Interfaces do
+  // not share anything, so there is no reason for a slow bus to
+  // hold up monitoring or discovery of devices on another.
+  for (auto& iface : interfaces_)
+    scanState_[iface.get()];
+  for (auto& iface : interfaces_) {
+    Modbus* ifacePtr = iface.get();
+    start_thread(
+        [ifacePtr](Rackmon* self) { self->scan(*ifacePtr); }, kSweepInterval);
+    start_thread(
+        [ifacePtr](Rackmon* self) { self->monitor(*ifacePtr); }, tick);
+  }
 }
 
 void Rackmon::stop() {
@@ -274,8 +386,62 @@ void Rackmon::getValueData(std::vector<ModbusDeviceValueData>& data) {
       });
 }
 
+void Rackmon::encodeRawData(CborEncoder& e) {
+  std::shared_lock lock(devicesMutex_);
+  e.array(devices_.size());
+  for (auto& [addr, dev] : devices_)
+    dev->encodeRawData(e);
+}
+
+void Rackmon::encodeValueData(CborEncoder& e) {
+  std::shared_lock lock(devicesMutex_);
+  e.array(devices_.size());
+  for (auto& [addr, dev] : devices_)
+    dev->encodeValueData(e);
+}
+
+void Rackmon::getChangedValueData(
+    std::map<uint8_t, uint64_t>& since,
+    std::vector<ModbusDeviceValueData>& data) {
+  data.clear();
+  std::shared_lock lock(devicesMutex_);
+  for (auto& [addr, dev] : devices_) {
+    ModbusDeviceValueData changes = dev->getChangedValueData(since[addr]);
+    if (!changes.registerList.empty())
+      data.push_back(std::move(changes));
+  }
+}
+
+RegisterStoreValue Rackmon::getHistory(
+    uint8_t deviceAddress,
+    uint16_t regAddr,
+    uint32_t start,
+    uint32_t end,
+    uint32_t interval) {
+  if (!history_)
+    throw std::logic_error("History is not enabled");
+  // Devices need not be present, their register map is enough.
+  const RegisterMap& rmap = registerMapDB_.at(deviceAddress);
+  const RegisterDescriptor& desc = rmap.registerDescriptors.at(regAddr);
+  return history_->query(deviceAddress, desc, start, end, interval);
+}
+
 std::string Rackmon::getProfileData() {
   std::stringstream ss;
   profileStore_.swap(ss);
+  std::unique_lock lock(monitorStatsMutex_);
+  for (const auto& [iface, stats] : monitorStats_) {
+    ss << "MONITOR " << iface->name() << " : " << stats.last.count()
+       << " ms (max: " << stats.max.count() << " ms, cycles: " << stats.cycles
+       << ")\n";
+  }
+  lock.unlock();
+  std::unique_lock scanLock(scanStatsMutex_);
+  for (const auto& [iface, stats] : scanStats_) {
+    ss << "SCAN " << iface->name() << " : " << stats.fullScan.count()
+       << " ms (sweep: " << stats.sweep.count()
+       << " ms, probes/step: " << stats.probesPerStep
+       << ", backoff: " << stats.backoff << ")\n";
+  }
   return ss.str();
 }
@@ -2,23 +2,65 @@
 #include <atomic>
 #include <shared_mutex>
 #include <thread>
+#include "history.hpp"
 #include "modbus.hpp"
 #include "modbus_device.hpp"
 #include "pollthread.hpp"
 
+// Statistics of the monitor cycles of a single interface.
+struct MonitorCycleStats {
+  uint32_t cycles = 0;
+  std::chrono::milliseconds last{0};
+  std::chrono::milliseconds max{0};
+  // Set while a monitor cycle is running on the interface.
+  bool inProgress = false;
+};
+
+// Statistics of device discovery on a single interface.
+struct ScanStats {
+  // Time taken by the last full scan of all possible addresses.
+  std::chrono::milliseconds fullScan{0};
+  // Time taken by the last complete background sweep.
+  std::chrono::milliseconds sweep{0};
+  // Number of addresses probed by the last sweep step.
+  size_t probesPerStep = 0;
+  // Sweep steps are currently taken every this many intervals.
+  uint32_t backoff = 1;
+};
+
 class Rackmon {
   static constexpr time_t kDormantMinInactiveTime = 300;
   static constexpr ModbusTime kProbeTimeout = std::chrono::milliseconds(50);
+  // Interval of background sweep steps. Each step uses at most
+  // 1/kSweepIdleShare of the time the bus is idle for probes.
+  static constexpr PollThreadTime kSweepInterval = std::chrono::seconds(1);
+  static constexpr int kSweepIdleShare = 2;
+  // Every sweep which finds nothing new doubles the interval of its
+  // steps, up to kSweepInterval * kMaxSweepBackoff.
+  static constexpr uint32_t kMaxSweepBackoff = 32;
+  // Default number of records (16 bytes each) in the history store.
+  static constexpr size_t kDefaultHistoryRecords = 256 * 1024;
   std::vector<std::unique_ptr<PollThread<Rackmon>>> threads_{};
   // Has to be before defining active or dormant devices
   // to ensure users get destroyed before the interface.
   std::vector<std::unique_ptr<Modbus>> interfaces_{};
+  // Optional persistent history of monitored registers. Same as
+  // above, devices record into it.
+  std::unique_ptr<HistoryStore> history_{};
   RegisterMapDatabase registerMapDB_{};
 
   mutable std::shared_mutex devicesMutex_{};
 
   std::stringstream profileStore_{};
 
+  // Monitor cycle times of each interface.
+  std::mutex monitorStatsMutex_{};
+  std::map<const Modbus*, MonitorCycleStats> monitorStats_{};
+
+  // Discovery times of each interface.
+  std::mutex scanStatsMutex_{};
+  std::map<const Modbus*, ScanStats> scanStats_{};
+
   // These devices discovered on actively monitored busses
   std::map<uint8_t, std::unique_ptr<ModbusDevice>> devices_{};
 
@@ -26,21 +68,46 @@ class Rackmon {
   // loaded register maps. A majority of these are not expected
   // to exist, but are candidates for a scan.
   std::vector<uint8_t> allPossibleDevAddrs_{};
-  std::vector<uint8_t>::iterator nextDeviceToProbe_{};
 
-  // As an optimization, devices are normally scanned one by one
-  // This allows someone to initiate a forced full scan.
-  // This mimicks a restart of rackmond.
-  std::atomic<bool> reqForceScan_ = true;
+  // Discovery progress of an interface. Only touched by the scan
+  // thread of the interface.
+  struct ScanState {
+    // Full scans requested which have been handled.
+    uint32_t fullScans = 0;
+    // Index into allPossibleDevAddrs_ of the next address to sweep.
+    size_t next = 0;
+    std::chrono::steady_clock::time_point sweepStart{};
+    // Whether the sweep in progress found a device.
+    bool found = false;
+    // Steps are taken every backoff intervals, counted by skipped.
+    uint32_t backoff = 1;
+    uint32_t skipped = 0;
+    // Number of dormant devices on the interface at the last step.
+    size_t dormant = 0;
+  };
+  std::map<const Modbus*, ScanState> scanState_{};
+
+  // As an optimization, devices are normally scanned a few at a
+  // time in the background. This allows someone to initiate a
+  // forced full scan. This mimicks a restart of rackmond.
+  // Starts at 1 to scan everything on start up.
+  std::atomic<uint32_t> fullScanRequests_ = 1;
 
   // Timestamps of last scan
-  time_t lastScanTime_;
-  time_t lastMonitorTime_;
+  std::atomic<time_t> lastScanTime_ = 0;
+  std::atomic<time_t> lastMonitorTime_ = 0;
+
+  // Registers which do not define their own period are read
+  // at this interval.
+  PollThreadTime monitorInterval_{};
+  // Interval the monitor threads wake up at.
+  PollThreadTime monitorTick_{};
+
+  // Called at the end of every monitor pass.
+  std::function<void()> monitorCallback_{};
 
   // Probe an interface for the presence of the address.
   bool probe(Modbus& interface, uint8_t addr);
-  // Probe all interfaces for the presence of the address.
-  bool probe(uint8_t addr);
 
   // --------- Private Methods --------
 
@@ -51,14 +118,28 @@ class Rackmon {
 
   bool isDeviceKnown(uint8_t);
 
-  // Monitor loop. Blocks forever as long as req_stop is true.
-  void monitor();
+  // Number of dormant devices on an interface.
+  size_t dormantDevices(const Modbus& interface);
 
-  // Scan all possible devices. Skips active/dormant devices.
-  void fullScan();
+  // Monitor all devices on an interface. Each interface has its
+  // own monitor thread, so devices on different busses are
+  // monitored in parallel.
+  void monitor(Modbus& interface);
 
-  // Scan loop. Blocks forever as long as req_stop is true.
-  void scan();
+  // Scan all possible devices on an interface. Skips
+  // active/dormant devices.
+  void fullScan(Modbus& interface);
+
+  // Number of addresses which can be probed in this sweep step
+  // without getting in the way of monitoring.
+  size_t sweepBudget(const Modbus& interface);
+
+  // Probe the next few addresses on an interface.
+  void sweep(Modbus& interface, ScanState& state);
+
+  // Scan loop of an interface. Each interface has its own scan
+  // thread, so all busses are scanned in parallel.
+  void scan(Modbus& interface);
 
  protected:
   virtual std::unique_ptr<Modbus> makeInterface() {
@@ -81,7 +162,7 @@ class Rackmon {
 
   // Force rackmond to do a full scan on the next scan loop.
   void forceScan() {
-    reqForceScan_ = true;
+    fullScanRequests_++;
   }
 
   // Executes the Raw command. Throws an exception on error.
@@ -126,6 +207,36 @@ class Rackmon {
   // Get value data
   void getValueData(std::vector<ModbusDeviceValueData>& data);
 
+  // Encode raw/value data (As an array of devices) straight into
+  // a CBOR stream without making copies of the register stores.
+  void encodeRawData(CborEncoder& e);
+  void encodeValueData(CborEncoder& e);
+
+  // Get value data of registers which changed since the last call.
+  // since holds the last monitor pass seen for each device address,
+  // and is updated. Devices without changes are not returned.
+  void getChangedValueData(
+      std::map<uint8_t, uint64_t>& since,
+      std::vector<ModbusDeviceValueData>& data);
+
+  // Invoke callback at the end of every monitor pass. This is
+  // called from the monitor threads, so it is expected to be quick.
+  // Needs to be set before start().
+  void setMonitorCallback(std::function<void()> callback) {
+    monitorCallback_ = callback;
+  }
+
+  // Get readings of a register kept in the persistent history with
+  // start <= timestamp <= end. With a non-zero interval (In seconds),
+  // readings are downsampled to one per interval. Throws
+  // std::logic_error if the history is not enabled.
+  RegisterStoreValue getHistory(
+      uint8_t deviceAddress,
+      uint16_t regAddr,
+      uint32_t start,
+      uint32_t end,
+      uint32_t interval = 0);
+
   // Get profile data
   std::string getProfileData();
 };
@@ -112,7 +112,7 @@ static void print_text(const std::string& req_s, json& j) {
   j.at("status").get_to(status);
   if (status == "SUCCESS") {
     if (req_s == "raw_data" || req_s == "print_data" || req_s == "value_data" ||
-        req_s == "profile")
+        req_s == "profile" || req_s == "subscribe" || req_s == "history")
       print_nested(j["data"]);
     else if (req_s == "list")
       print_table(j["data"]);
@@ -147,19 +147,69 @@ do_raw_cmd(const std::string& req_s, int timeout, int resp_len, bool json_fmt) {
     print_text("raw", resp_j);
 }
 
-static void do_cmd(const std::string& type, bool json_fmt) {
+static void
+do_cmd(const std::string& type, bool json_fmt, bool cbor_fmt = false) {
   json req;
   req["type"] = type;
+  if (cbor_fmt)
+    req["format"] = "cbor";
   std::string req_s = req.dump();
   std::vector<char> resp;
   send_recv(req_s.c_str(), req_s.length(), resp);
-  json resp_j = json::parse(resp);
+  json resp_j = cbor_fmt ? json::from_cbor(resp) : json::parse(resp);
   if (json_fmt)
     print_json(resp_j);
   else
     print_text(type, resp_j);
 }
 
+static void do_history(
+    int addr,
+    int reg,
+    uint32_t start,
+    uint32_t end,
+    uint32_t interval,
+    bool json_fmt) {
+  json req;
+  req["type"] = "history";
+  req["addr"] = addr;
+  req["regAddress"] = reg;
+  req["start"] = start;
+  if (end != 0)
+    req["end"] = end;
+  req["interval"] = interval;
+  std::string req_s = req.dump();
+  std::vector<char> resp;
+  send_recv(req_s.c_str(), req_s.length(), resp);
+  json resp_j = json::parse(resp);
+  if (json_fmt)
+    print_json(resp_j);
+  else
+    print_text("history", resp_j);
+}
+
+static void do_subscribe(bool json_fmt) {
+  json req;
+  req["type"] = "subscribe";
+  std::string req_s = req.dump();
+  RackmonClient cli;
+  cli.send(req_s.c_str(), req_s.length());
+  // The first response is a snapshot of all the monitored values,
+  // every response after that contains only the registers which
+  // changed. Keep printing until rackmond goes away.
+  while (true) {
+    std::vector<char> resp;
+    cli.recv(resp);
+    if (resp.empty())
+      break;
+    json resp_j = json::parse(resp);
+    if (json_fmt)
+      print_json(resp_j);
+    else
+      print_text("subscribe", resp_j);
+  }
+}
+
 int main(int argc, char* argv[]) {
   CLI::App app("Rackmon CLI interface");
   app.failure_message(CLI::FailureMessage::help);
@@ -193,10 +243,36 @@ int main(int argc, char* argv[]) {
 
   // Data command (Get monitored data)
   std::string format = "raw";
+  bool cbor_fmt = false;
   auto data = app.add_subcommand("data", "Return detailed monitoring data");
-  data->callback([&]() { do_cmd(format + "_data", json_fmt); });
+  data->callback([&]() {
+    // print_data is pre-formatted text, there is nothing to gain.
+    do_cmd(format + "_data", json_fmt, cbor_fmt && format != "print");
+  });
   data->add_set(
       "-f,--format", format, {"raw", "print", "value"}, "Format the data");
+  data->add_flag(
+      "-b,--binary", cbor_fmt, "Use the compact binary (CBOR) transfer format");
+
+  // Subscribe to changes in monitored data
+  app.add_subcommand("subscribe", "Print monitored data as it changes")
+      ->callback([&]() { do_subscribe(json_fmt); });
+
+  // Persistent history of a register
+  int hist_addr = 0, hist_reg = 0;
+  uint32_t hist_start = 0, hist_end = 0, hist_interval = 0;
+  auto history = app.add_subcommand(
+      "history", "Return the recorded history of a register");
+  history->add_option("-a,--addr", hist_addr, "Device address")->required();
+  history->add_option("-r,--reg", hist_reg, "Register address")->required();
+  history->add_option("-s,--start", hist_start, "Start time (epoch)");
+  history->add_option("-e,--end", hist_end, "End time (epoch, default: now)");
+  history->add_option(
+      "-i,--interval", hist_interval, "Downsample to one reading per interval");
+  history->callback([&]() {
+    do_history(
+        hist_addr, hist_reg, hist_start, hist_end, hist_interval, json_fmt);
+  });
 
   // Profile
   app.add_subcommand("profile", "Print profiling data collected from last read")
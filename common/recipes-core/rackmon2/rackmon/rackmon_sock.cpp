@@ -49,45 +49,67 @@ RackmonSock::~RackmonSock() {
     close(sock_);
 }
 
-void RackmonSock::sendChunk(const char* buf, uint16_t bufLen) {
-  if (::send(sock_, &bufLen, sizeof(bufLen), 0) < 0) {
-    throw std::system_error(
-        std::error_code(errno, std::generic_category()), "send header");
+void RackmonSock::encodeChunks(
+    const char* buf,
+    size_t len,
+    std::vector<char>& out) {
+  const size_t kMaxChunkSize = 0xffff;
+  // Each chunk is its length (uint16_t) followed by its bytes. A
+  // chunk shorter than kMaxChunkSize is the last one. off == len is
+  // a special condition where we send a dummy empty chunk to end a
+  // message which is a multiple of kMaxChunkSize. Hence the
+  // condition of off <= len
+  for (size_t off = 0; off <= len; off += kMaxChunkSize) {
+    size_t rem = len - off;
+    uint16_t csize = rem > kMaxChunkSize ? kMaxChunkSize : rem;
+    const char* hdr = (const char*)&csize;
+    out.insert(out.end(), hdr, hdr + sizeof(csize));
+    out.insert(out.end(), buf + off, buf + off + csize);
   }
-  if (bufLen == 0)
-    return;
-  uint16_t sentSize = 0;
-  while (sentSize < bufLen) {
-    int chunkSize = ::send(sock_, buf, bufLen - sentSize, 0);
-    if (chunkSize < 0) {
-      throw std::system_error(
-          std::error_code(errno, std::generic_category()), "send body");
+}
+
+bool RackmonSock::decodeChunks(std::vector<char>& in, std::vector<char>& msg) {
+  msg.clear();
+  size_t off = 0;
+  while (off + sizeof(uint16_t) <= in.size()) {
+    uint16_t csize;
+    std::memcpy(&csize, in.data() + off, sizeof(csize));
+    if (off + sizeof(csize) + csize > in.size())
+      break;
+    off += sizeof(csize);
+    msg.insert(msg.end(), in.begin() + off, in.begin() + off + csize);
+    off += csize;
+    if (csize < 0xffff) {
+      in.erase(in.begin(), in.begin() + off);
+      return true;
     }
-    sentSize += (uint16_t)chunkSize;
-    buf += chunkSize;
   }
+  return false;
 }
 
 void RackmonSock::send(const char* buf, size_t len) {
-  const size_t kMaxChunkSize = 0xffff;
-  // off == len is a special condition where we send a dummy
-  // buf. This special condition of buf_len = 0 is handled
-  // in sendChunk. Hence the condition of off <= len
-  for (size_t off = 0; off <= len; off += kMaxChunkSize) {
-    size_t rem = len - off;
-    size_t csize = rem > kMaxChunkSize ? kMaxChunkSize : rem;
-    sendChunk(buf + off, csize);
+  std::vector<char> out;
+  encodeChunks(buf, len, out);
+  size_t sent = 0;
+  while (sent < out.size()) {
+    int ret = ::send(sock_, out.data() + sent, out.size() - sent, 0);
+    if (ret < 0) {
+      throw std::system_error(
+          std::error_code(errno, std::generic_category()), "send");
+    }
+    sent += (size_t)ret;
   }
 }
 
 bool RackmonSock::recvChunk(std::vector<char>& resp) {
-  uint16_t recvLen;
-  if (::recv(sock_, &recvLen, sizeof(recvLen), 0) < 0) {
+  uint16_t recvLen = 0;
+  int ret = ::recv(sock_, &recvLen, sizeof(recvLen), 0);
+  if (ret < 0) {
     throw std::system_error(
         std::error_code(errno, std::generic_category()), "recv header");
   }
-  // Received dummy, that was our last chunk!
-  if (recvLen == 0)
+  // Received dummy, that was our last chunk! (Or the peer went away).
+  if (ret == 0 || recvLen == 0)
     return false;
   size_t off = resp.size();
   resp.resize(off + recvLen);
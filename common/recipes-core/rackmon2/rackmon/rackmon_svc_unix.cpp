@@ -1,9 +1,15 @@
 #include "rackmon_svc_unix.hpp"
 #include <nlohmann/json.hpp>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
+#include <condition_variable>
 #include <csignal>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
 #include "log.hpp"
 #include "rackmon.hpp"
 
@@ -23,21 +29,109 @@ class RackmonUNIXSocketService {
   int& backChannelRequestor_ = backChannelFDs_[1];
   // The socket we want to receive connections from.
   std::unique_ptr<RackmonService> sock_ = nullptr;
+  // Signalled by the monitor threads at the end of every pass.
+  int monitorEventFD_ = -1;
+  // The epoll instance driving doLoop.
+  int epollFD_ = -1;
+
+  // Signalled by the workers when a response is ready.
+  int doneEventFD_ = -1;
+
+  // Largest request we are willing to buffer for a client.
+  static constexpr size_t kMaxRequestSize = 64 * 1024;
+  // Largest backlog of notifications we keep for a subscriber
+  // before giving up on it.
+  static constexpr size_t kMaxSubscriberBacklog = 1024 * 1024;
+  // Requests can block on the bus for a while, so they are handled
+  // by a fixed set of workers rather than on the loop.
+  static constexpr size_t kNumWorkers = 4;
+
+  // A connection accepted by the loop. Sockets are non-blocking,
+  // the loop only ever moves bytes from and to the buffers.
+  struct Client {
+    std::unique_ptr<RackmonSock> sock;
+    // Bytes received which do not yet make up a whole request.
+    std::vector<char> in{};
+    // Framed bytes still to be sent and how many of them were sent.
+    std::vector<char> out{};
+    size_t outOff = 0;
+    // Events we are currently waiting on.
+    uint32_t events = EPOLLIN;
+    // A worker is handling the request of this client.
+    bool busy = false;
+    // The client went away while busy. The socket is kept open till
+    // the worker is done so its fd is not reused under it.
+    bool gone = false;
+    // The client requested to be notified of register changes.
+    bool subscribed = false;
+    // A monitor pass ended while the subscriber was busy, it is
+    // notified again once the worker is done.
+    bool notifyPending = false;
+    // Last monitor pass seen by a subscriber for each device.
+    std::map<uint8_t, uint64_t> since{};
+  };
+  std::map<int, Client> clients_{};
+
+  // Work for the workers, keyed by the client fd. Collecting the
+  // changes for a subscriber takes the device locks, which are held
+  // for whole bus transactions, so it is not done on the loop either.
+  struct Job {
+    int fd = -1;
+    // The request on the way in, framed output on the way out.
+    std::vector<char> buf{};
+    // Notification of a subscriber rather than a request.
+    bool notify = false;
+    // Send the notification even if nothing changed.
+    bool force = false;
+    // Copy of the subscriber's since, updated by the worker.
+    std::map<uint8_t, uint64_t> since{};
+  };
+
+  // Jobs waiting for a worker and the ones done waiting to be sent
+  // by the loop.
+  std::mutex jobsMutex_{};
+  std::condition_variable jobsCond_{};
+  std::deque<Job> jobs_{};
+  std::deque<Job> done_{};
+  bool stopWorkers_ = false;
+  std::vector<std::thread> workers_{};
 
   void registerExitHandler();
 
   // Handle commands with the JSON format.
   void handleJSONCommand(const json& req, json& resp);
-  void handleJSONCommand(const json& req, RackmonSock& cli);
+  // Stream the response of data requests in the binary (CBOR)
+  // format. Returns false for requests which cannot be streamed.
+  bool handleCBORCommand(const std::string& cmd, std::vector<uint8_t>& resp);
+  void handleJSONCommand(const json& req, std::vector<char>& resp_buf);
   // Handle commands with the legacy byte format.
   void handleLegacyCommand(
       std::vector<char>& req_buf,
       std::vector<char>& resp_buf);
-  void handleLegacyCommand(std::vector<char>& req_buf, RackmonSock& cli);
-  // Handle a connection from a client. Currently
-  // we can deal with one client at a time, but we
-  // could easily extend this to multiple with threading.
-  void handleConnection(std::unique_ptr<RackmonSock> sock);
+  // Handle a request received from a client and return the
+  // response. Requests can block on the bus, this is run by
+  // the workers.
+  std::vector<char> handleConnection(std::vector<char>& buf);
+  void workerLoop();
+  // Hand the responses completed by the workers to their clients.
+  void handleDone();
+  // Read what a client has sent. Once a whole request is in,
+  // subscriptions are handled right away and others are queued
+  // for the workers.
+  void handleInput(int fd, Client& cli);
+  // Send as much of the pending output of a client as the socket
+  // takes. Returns false if the client was removed.
+  bool flushOutput(int fd, Client& cli);
+  void watchClient(int fd, Client& cli, uint32_t events);
+  // Has a worker collect the register changes for a subscriber.
+  // Nothing is sent when nothing changed unless forced. Returns false
+  // if the subscriber was removed.
+  bool notifySubscriber(int fd, Client& cli, bool force = false);
+  // Collect the register changes for a subscriber. Run by the workers.
+  void collectChanges(Job& job);
+  // Push register changes to all subscribers.
+  void notifySubscribers();
+  void removeClient(int fd);
 
  public:
   RackmonUNIXSocketService() {}
@@ -95,19 +189,46 @@ void RackmonUNIXSocketService::handleJSONCommand(const json& req, json& resp) {
     resp["data"] = ret;
   } else if (cmd == "profile") {
     resp["data"] = rackmond_.getProfileData();
+  } else if (cmd == "history") {
+    resp["data"] = rackmond_.getHistory(
+        req.at("addr"),
+        req.at("regAddress"),
+        req.value("start", 0),
+        req.value("end", uint32_t(std::time(0))),
+        req.value("interval", 0));
   } else {
     throw std::logic_error("UNKNOWN_CMD: " + cmd);
   }
   resp["status"] = "SUCCESS";
 }
 
+bool RackmonUNIXSocketService::handleCBORCommand(
+    const std::string& cmd,
+    std::vector<uint8_t>& resp) {
+  CborEncoder e(resp);
+  if (cmd == "raw_data") {
+    e.map(2) << "status" << "SUCCESS" << "data";
+    rackmond_.encodeRawData(e);
+  } else if (cmd == "value_data") {
+    e.map(2) << "status" << "SUCCESS" << "data";
+    rackmond_.encodeValueData(e);
+  } else {
+    return false;
+  }
+  return true;
+}
+
 void RackmonUNIXSocketService::handleJSONCommand(
     const json& req,
-    RackmonSock& cli) {
+    std::vector<char>& resp_buf) {
   auto print_msg = [&req](std::exception& e) {
     logError << "ERROR Executing: " << req["type"] << e.what() << std::endl;
   };
   json resp;
+  // Clients may ask for responses in the binary (CBOR) format
+  // rather than JSON text.
+  std::string format = req.value("format", "json");
+  std::vector<uint8_t> resp_b;
 
   // Handle the JSON command and this is where all the
   // exceptions we have been ignoring all the way from
@@ -115,7 +236,12 @@ void RackmonUNIXSocketService::handleJSONCommand(
   // each exception to an error code.
   // TODO: Work with rest-api to correctly define these.
   try {
-    handleJSONCommand(req, resp);
+    if (format != "json" && format != "cbor") {
+      format = "json";
+      throw std::logic_error("Unsupported format");
+    }
+    if (format != "cbor" || !handleCBORCommand(req.at("type"), resp_b))
+      handleJSONCommand(req, resp);
   } catch (CRCError& e) {
     resp["status"] = "CRC_ERROR";
     print_msg(e);
@@ -139,11 +265,15 @@ void RackmonUNIXSocketService::handleJSONCommand(
     print_msg(e);
   }
 
-  std::string resp_s = resp.dump();
-  try {
-    cli.send(resp_s.c_str(), resp_s.length());
-  } catch (std::exception& e) {
-    logError << "Unable to send response: " << e.what() << std::endl;
+  if (format == "cbor") {
+    // resp is only filled if the command was not streamed or if
+    // streaming it failed midway.
+    if (!resp.is_null())
+      resp_b = json::to_cbor(resp);
+    resp_buf.assign(resp_b.begin(), resp_b.end());
+  } else {
+    std::string resp_s = resp.dump();
+    resp_buf.assign(resp_s.begin(), resp_s.end());
   }
 }
 
@@ -188,23 +318,6 @@ void RackmonUNIXSocketService::handleLegacyCommand(
       resp_buf.begin() + 2);
 }
 
-void RackmonUNIXSocketService::handleLegacyCommand(
-    std::vector<char>& req_buf,
-    RackmonSock& cli) {
-  std::vector<char> resp_buf;
-  try {
-    handleLegacyCommand(req_buf, resp_buf);
-  } catch (std::exception& e) {
-    resp_buf = {0, 0, 1, 0};
-    logError << "Unable to handle legacy command: " << e.what() << std::endl;
-  }
-  try {
-    cli.send(resp_buf.data(), resp_buf.size());
-  } catch (std::exception& e) {
-    logError << "Unable to send response: " << e.what() << std::endl;
-  }
-}
-
 void RackmonUNIXSocketService::requestExit() {
   char c = 'c';
   if (write(backChannelRequestor_, &c, 1) != 1) {
@@ -247,17 +360,57 @@ void RackmonUNIXSocketService::initialize(
     char** /* unused */) {
   logInfo << "Loading configuration" << std::endl;
   rackmond_.load(kRackmonConfigurationPath, kRackmonRegmapDirPath);
+  monitorEventFD_ = eventfd(0, EFD_NONBLOCK);
+  if (monitorEventFD_ < 0) {
+    throw std::system_error(
+        std::error_code(errno, std::generic_category()), "Monitor eventfd");
+  }
+  rackmond_.setMonitorCallback([this]() {
+    uint64_t one = 1;
+    if (write(monitorEventFD_, &one, sizeof(one)) != sizeof(one)) {
+      logError << "Could not signal end of monitor pass" << std::endl;
+    }
+  });
+  doneEventFD_ = eventfd(0, EFD_NONBLOCK);
+  if (doneEventFD_ < 0) {
+    throw std::system_error(
+        std::error_code(errno, std::generic_category()), "Worker eventfd");
+  }
   logInfo << "Starting rackmon threads" << std::endl;
   rackmond_.start();
+  for (size_t i = 0; i < kNumWorkers; i++)
+    workers_.emplace_back(&RackmonUNIXSocketService::workerLoop, this);
   registerExitHandler();
   logInfo << "Creating Rackmon UNIX service" << std::endl;
   sock_ = std::make_unique<RackmonService>();
 }
 
 void RackmonUNIXSocketService::deinitialize() {
-  logInfo << "Deinitializing... stopping rackmond" << std::endl;
+  logInfo << "Deinitializing... stopping workers" << std::endl;
+  {
+    std::unique_lock lk(jobsMutex_);
+    stopWorkers_ = true;
+  }
+  jobsCond_.notify_all();
+  for (auto& worker : workers_)
+    worker.join();
+  workers_.clear();
+  logInfo << "Stopping rackmond" << std::endl;
   rackmond_.stop();
+  clients_.clear();
   sock_ = nullptr;
+  if (doneEventFD_ != -1) {
+    close(doneEventFD_);
+    doneEventFD_ = -1;
+  }
+  if (epollFD_ != -1) {
+    close(epollFD_);
+    epollFD_ = -1;
+  }
+  if (monitorEventFD_ != -1) {
+    close(monitorEventFD_);
+    monitorEventFD_ = -1;
+  }
   if (backChannelRequestor_ != -1) {
     close(backChannelRequestor_);
     backChannelRequestor_ = -1;
@@ -268,16 +421,9 @@ void RackmonUNIXSocketService::deinitialize() {
   }
 }
 
-void RackmonUNIXSocketService::handleConnection(
-    std::unique_ptr<RackmonSock> sock) {
-  std::vector<char> buf;
-
-  try {
-    sock->recv(buf);
-  } catch (...) {
-    logError << "Failed to receive message" << std::endl;
-    return;
-  }
+std::vector<char> RackmonUNIXSocketService::handleConnection(
+    std::vector<char>& buf) {
+  std::vector<char> resp_buf;
   bool is_json = true;
   json req;
   try {
@@ -286,24 +432,273 @@ void RackmonUNIXSocketService::handleConnection(
     is_json = false;
   }
 
-  if (is_json)
-    handleJSONCommand(req, *sock);
+  if (is_json) {
+    handleJSONCommand(req, resp_buf);
+    return resp_buf;
+  }
+  try {
+    handleLegacyCommand(buf, resp_buf);
+  } catch (std::exception& e) {
+    resp_buf = {0, 0, 1, 0};
+    logError << "Unable to handle legacy command: " << e.what() << std::endl;
+  }
+  return resp_buf;
+}
+
+void RackmonUNIXSocketService::collectChanges(Job& job) {
+  std::vector<ModbusDeviceValueData> changes;
+  rackmond_.getChangedValueData(job.since, changes);
+  job.buf.clear();
+  if (changes.empty() && !job.force)
+    return;
+  json resp;
+  resp["status"] = "SUCCESS";
+  resp["data"] = changes;
+  std::string resp_s = resp.dump();
+  RackmonSock::encodeChunks(resp_s.c_str(), resp_s.length(), job.buf);
+}
+
+void RackmonUNIXSocketService::workerLoop() {
+  while (1) {
+    Job job;
+    {
+      std::unique_lock lk(jobsMutex_);
+      jobsCond_.wait(lk, [this]() { return stopWorkers_ || !jobs_.empty(); });
+      if (stopWorkers_)
+        return;
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    if (job.notify) {
+      collectChanges(job);
+    } else {
+      std::vector<char> resp_buf = handleConnection(job.buf);
+      job.buf.clear();
+      RackmonSock::encodeChunks(resp_buf.data(), resp_buf.size(), job.buf);
+    }
+    {
+      std::unique_lock lk(jobsMutex_);
+      done_.push_back(std::move(job));
+    }
+    uint64_t one = 1;
+    if (write(doneEventFD_, &one, sizeof(one)) != sizeof(one)) {
+      logError << "Could not signal completed request" << std::endl;
+    }
+  }
+}
+
+void RackmonUNIXSocketService::handleDone() {
+  std::deque<Job> done;
+  {
+    std::unique_lock lk(jobsMutex_);
+    done.swap(done_);
+  }
+  for (auto& job : done) {
+    int fd = job.fd;
+    auto it = clients_.find(fd);
+    if (it == clients_.end())
+      continue;
+    Client& cli = it->second;
+    cli.busy = false;
+    if (cli.gone) {
+      clients_.erase(it);
+      continue;
+    }
+    if (!job.notify) {
+      cli.out = std::move(job.buf);
+      cli.outOff = 0;
+      flushOutput(fd, cli);
+      continue;
+    }
+    cli.since = std::move(job.since);
+    cli.out.insert(cli.out.end(), job.buf.begin(), job.buf.end());
+    if (!flushOutput(fd, cli))
+      continue;
+    if (cli.notifyPending) {
+      cli.notifyPending = false;
+      notifySubscriber(fd, cli);
+    }
+  }
+}
+
+void RackmonUNIXSocketService::watchClient(
+    int fd,
+    Client& cli,
+    uint32_t events) {
+  if (cli.events == events)
+    return;
+  struct epoll_event ev {};
+  ev.events = events;
+  ev.data.fd = fd;
+  if (epoll_ctl(epollFD_, EPOLL_CTL_MOD, fd, &ev) != 0) {
+    logError << "Failed to watch client" << std::endl;
+    return;
+  }
+  cli.events = events;
+}
+
+void RackmonUNIXSocketService::removeClient(int fd) {
+  auto it = clients_.find(fd);
+  if (it == clients_.end())
+    return;
+  epoll_ctl(epollFD_, EPOLL_CTL_DEL, fd, nullptr);
+  if (it->second.busy)
+    it->second.gone = true;
   else
-    handleLegacyCommand(buf, *sock);
+    clients_.erase(it);
+}
+
+bool RackmonUNIXSocketService::flushOutput(int fd, Client& cli) {
+  while (cli.outOff < cli.out.size()) {
+    ssize_t ret = ::send(
+        fd,
+        cli.out.data() + cli.outOff,
+        cli.out.size() - cli.outOff,
+        MSG_NOSIGNAL);
+    if (ret >= 0) {
+      cli.outOff += ret;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      uint32_t events = cli.subscribed ? EPOLLIN | EPOLLOUT : EPOLLOUT;
+      watchClient(fd, cli, events);
+      return true;
+    } else if (errno != EINTR) {
+      logInfo << "Dropping client: send failed " << errno << std::endl;
+      removeClient(fd);
+      return false;
+    }
+  }
+  cli.out.clear();
+  cli.outOff = 0;
+  if (!cli.subscribed) {
+    // Requests are one per connection, we are done with it.
+    removeClient(fd);
+    return false;
+  }
+  watchClient(fd, cli, EPOLLIN);
+  return true;
+}
+
+bool RackmonUNIXSocketService::notifySubscriber(
+    int fd,
+    Client& cli,
+    bool force) {
+  if (cli.out.size() - cli.outOff > kMaxSubscriberBacklog) {
+    logInfo << "Dropping subscriber: not keeping up" << std::endl;
+    removeClient(fd);
+    return false;
+  }
+  cli.busy = true;
+  Job job{fd};
+  job.notify = true;
+  job.force = force;
+  job.since = cli.since;
+  {
+    std::unique_lock lk(jobsMutex_);
+    jobs_.push_back(std::move(job));
+  }
+  jobsCond_.notify_one();
+  return true;
+}
+
+void RackmonUNIXSocketService::notifySubscribers() {
+  std::vector<int> subscribers;
+  for (auto& [fd, cli] : clients_) {
+    if (!cli.subscribed || cli.gone)
+      continue;
+    if (cli.busy)
+      cli.notifyPending = true;
+    else
+      subscribers.push_back(fd);
+  }
+  for (int fd : subscribers)
+    notifySubscriber(fd, clients_.at(fd));
+}
+
+void RackmonUNIXSocketService::handleInput(int fd, Client& cli) {
+  std::array<char, 4096> buf;
+  bool eof = false;
+  while (1) {
+    ssize_t ret = ::recv(fd, buf.data(), buf.size(), 0);
+    if (ret > 0) {
+      // Clients are not expected to send anything else once they
+      // made their request, drop whatever comes after.
+      if (!cli.subscribed)
+        cli.in.insert(cli.in.end(), buf.begin(), buf.begin() + ret);
+    } else if (ret == 0) {
+      eof = true;
+      break;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    } else if (errno != EINTR) {
+      logError << "Failed to receive message" << std::endl;
+      removeClient(fd);
+      return;
+    }
+  }
+  if (cli.subscribed) {
+    if (eof)
+      removeClient(fd);
+    return;
+  }
+
+  // A client may shut down its end once its request is out, it
+  // still gets the response.
+  std::vector<char> req_buf;
+  if (!RackmonSock::decodeChunks(cli.in, req_buf)) {
+    if (cli.in.size() > kMaxRequestSize) {
+      logError << "Dropping client: request too large" << std::endl;
+      removeClient(fd);
+    } else if (eof) {
+      removeClient(fd);
+    }
+    return;
+  }
+  cli.in.clear();
+
+  json req = json::parse(req_buf, nullptr, false);
+  if (!req.is_discarded() && req.is_object() &&
+      req.value("type", "") == "subscribe") {
+    // Start off with a snapshot of the latest value of every
+    // register. Only changes are pushed from there on.
+    cli.subscribed = true;
+    notifySubscriber(fd, cli, true);
+    return;
+  }
+  // Nothing more to read till the response is out. Hang ups are
+  // still reported.
+  watchClient(fd, cli, 0);
+  cli.busy = true;
+  Job job{fd};
+  job.buf = std::move(req_buf);
+  {
+    std::unique_lock lk(jobsMutex_);
+    jobs_.push_back(std::move(job));
+  }
+  jobsCond_.notify_one();
 }
 
 void RackmonUNIXSocketService::doLoop() {
   struct sockaddr_un client;
-  struct pollfd pfd[2] = {
-      {sock_->getSock(), POLLIN, 0},
-      {backChannelHandler_, POLLIN, 0},
-  };
+  struct epoll_event ev {};
 
-  while (1) {
-    int ret;
-    socklen_t clisocklen = sizeof(struct sockaddr_un);
+  epollFD_ = epoll_create1(0);
+  if (epollFD_ < 0) {
+    throw std::system_error(
+        std::error_code(errno, std::generic_category()), "epoll_create");
+  }
+  for (int fd :
+       {sock_->getSock(), backChannelHandler_, monitorEventFD_, doneEventFD_}) {
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollFD_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      throw std::system_error(
+          std::error_code(errno, std::generic_category()), "epoll_ctl");
+    }
+  }
 
-    ret = poll(pfd, 2, -1);
+  while (1) {
+    std::array<struct epoll_event, 16> events;
+    int ret = epoll_wait(epollFD_, events.data(), events.size(), -1);
     if (ret <= 0) {
       // This should be the common case. The entire thing
       // with the pipe is to handle the race condition when
@@ -312,30 +707,56 @@ void RackmonUNIXSocketService::doLoop() {
       logInfo << "Handling termination signal" << std::endl;
       break;
     }
-    if (pfd[1].revents & POLLIN) {
-      char c;
-      if (read(pfd[1].fd, &c, 1) != 1) {
-        logError << "Got something but no data!" << std::endl;
-      } else if (c == 'c') {
-        logInfo << "Handling termination request" << std::endl;
-        break;
+    for (int i = 0; i < ret; i++) {
+      int fd = events[i].data.fd;
+      if (fd == backChannelHandler_) {
+        char c;
+        if (read(fd, &c, 1) != 1) {
+          logError << "Got something but no data!" << std::endl;
+        } else if (c == 'c') {
+          logInfo << "Handling termination request" << std::endl;
+          return;
+        } else {
+          logError << "Got unknown command: " << c << std::endl;
+        }
+      } else if (fd == monitorEventFD_) {
+        uint64_t count;
+        if (read(fd, &count, sizeof(count)) == sizeof(count))
+          notifySubscribers();
+      } else if (fd == doneEventFD_) {
+        uint64_t count;
+        if (read(fd, &count, sizeof(count)) == sizeof(count))
+          handleDone();
+      } else if (fd == sock_->getSock()) {
+        socklen_t clisocklen = sizeof(struct sockaddr_un);
+        int clifd = accept4(
+            fd, (struct sockaddr*)&client, &clisocklen, SOCK_NONBLOCK);
+        if (clifd < 0) {
+          logError << "Failed to accept new connection" << std::endl;
+          continue;
+        }
+        auto clisock = std::make_unique<RackmonSock>(clifd);
+        ev.events = EPOLLIN;
+        ev.data.fd = clifd;
+        if (epoll_ctl(epollFD_, EPOLL_CTL_ADD, clifd, &ev) != 0) {
+          logError << "Failed to watch new connection" << std::endl;
+          continue;
+        }
+        clients_.emplace(clifd, Client{std::move(clisock)});
       } else {
-        logError << "Got unknown command: " << c << std::endl;
-      }
-    }
-    if (pfd[0].revents & POLLIN) {
-      int clifd =
-          accept(sock_->getSock(), (struct sockaddr*)&client, &clisocklen);
-      if (clifd < 0) {
-        logError << "Failed to accept new connection" << std::endl;
-        continue;
+        auto it = clients_.find(fd);
+        if (it == clients_.end())
+          continue;
+        Client& cli = it->second;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+          removeClient(fd);
+        } else if (
+            (events[i].events & EPOLLOUT) && !flushOutput(fd, cli)) {
+          continue;
+        } else if (events[i].events & EPOLLIN) {
+          handleInput(fd, cli);
+        }
       }
-      auto clisock = std::make_unique<RackmonSock>(clifd);
-      auto tid = std::thread(
-          &RackmonUNIXSocketService::handleConnection,
-          this,
-          std::move(clisock));
-      tid.detach();
     }
   }
 }
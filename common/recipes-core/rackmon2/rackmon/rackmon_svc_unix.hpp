@@ -17,10 +17,15 @@ class RackmonSock {
   int createService();
   int createClient();
 
-  void sendChunk(const char* buf, uint16_t bufLen);
   bool recvChunk(std::vector<char>& resp);
 
  public:
+  // Frames a message of len bytes as send() does, appended to out.
+  static void encodeChunks(const char* buf, size_t len, std::vector<char>& out);
+  // Takes a complete message framed as by send() off the front of
+  // in. Returns false (msg is undefined) if more bytes are needed.
+  static bool decodeChunks(std::vector<char>& in, std::vector<char>& msg);
+
   explicit RackmonSock(int fd) : sock_(fd) {}
   int getSock() const {
     return sock_;
@@ -1,4 +1,5 @@
 #include "regmap.hpp"
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -16,6 +17,23 @@ namespace filesystem = experimental::filesystem;
 
 using nlohmann::json;
 
+// Keep in sync with the JSON serialization of RegisterValueType.
+static const char* typeName(RegisterValueType type) {
+  switch (type) {
+    case RegisterValueType::HEX:
+      return "hex";
+    case RegisterValueType::STRING:
+      return "string";
+    case RegisterValueType::INTEGER:
+      return "integer";
+    case RegisterValueType::FLOAT:
+      return "float";
+    case RegisterValueType::FLAGS:
+      return "flags";
+  }
+  return nullptr;
+}
+
 static void streamHex(std::ostream& os, size_t num, size_t ndigits) {
   os << std::hex << std::setfill('0') << std::setw(ndigits) << std::right
      << num;
@@ -51,9 +69,17 @@ void from_json(const json& j, RegisterDescriptor& i) {
   i.format = j.value("format", RegisterValueType::HEX);
   if (i.format == RegisterValueType::FLOAT) {
     j.at("precision").get_to(i.precision);
+  }
+  if (i.format == RegisterValueType::INTEGER ||
+      i.format == RegisterValueType::FLOAT) {
+    i.sign = j.value("sign", false);
   } else if (i.format == RegisterValueType::FLAGS) {
     j.at("flags").get_to(i.flags);
   }
+  i.period = j.value("period", 0);
+  if (i.period < -1)
+    throw std::out_of_range("Bad period: " + std::to_string(i.period));
+  i.priority = j.value("priority", 0);
 }
 void to_json(json& j, const RegisterDescriptor& i) {
   j["begin"] = i.begin;
@@ -64,182 +90,129 @@ void to_json(json& j, const RegisterDescriptor& i) {
   j["format"] = i.format;
   if (i.format == RegisterValueType::FLOAT) {
     j["precision"] = i.precision;
+  }
+  if (i.format == RegisterValueType::INTEGER ||
+      i.format == RegisterValueType::FLOAT) {
+    j["sign"] = i.sign;
   } else if (i.format == RegisterValueType::FLAGS) {
     j["flags"] = i.flags;
   }
-}
-
-void RegisterValue::makeString(const std::vector<uint16_t>& reg) {
-  // Manual construction of string (non-trivial member of union)
-  new (&value.strValue)(std::string);
-  // String is stored normally H L H L, so we
-  // need reswap the bytes in each nibble.
-  for (const auto& r : reg) {
-    char ch = r >> 8;
-    char cl = r & 0xff;
-    if (ch == '\0')
-      break;
-    value.strValue += ch;
-    if (cl == '\0')
-      break;
-    value.strValue += cl;
+  j["period"] = i.period;
+  j["priority"] = i.priority;
+}
+
+// Strings are stored normally H L H L and are terminated by the
+// first NUL (If any). Returns the length of the string.
+static size_t stringLength(const uint16_t* reg, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if ((reg[i] >> 8) == 0)
+      return i * 2;
+    if ((reg[i] & 0xff) == 0)
+      return i * 2 + 1;
   }
+  return len * 2;
 }
 
-void RegisterValue::makeHex(const std::vector<uint16_t>& reg) {
-  // Manual construction of vector (non-trivial member of union)
-  new (&value.hexValue)(std::vector<uint8_t>);
-  for (uint16_t v : reg) {
-    value.hexValue.push_back(v >> 8);
-    value.hexValue.push_back(v & 0xff);
+static void copyString(const uint16_t* reg, size_t strLen, char* out) {
+  for (size_t i = 0; i < strLen; i++) {
+    out[i] = i % 2 == 0 ? reg[i / 2] >> 8 : reg[i / 2] & 0xff;
   }
 }
 
-void RegisterValue::makeInteger(const std::vector<uint16_t>& reg) {
+static int32_t toInteger(const uint16_t* reg, size_t len, bool sign = false) {
   // TODO We currently do not need more than 32bit values as per
   // our current/planned regmaps. If such a value should show up in the
   // future, then we might need to return std::variant<int32_t,int64_t>.
-  if (reg.size() > 2)
+  if (len > 2)
     throw std::out_of_range("Register does not fit as an integer");
   // Everything in modbus is Big-endian. So when we have a list
   // of registers forming a larger value; For example,
   // a 32bit value would be 2 16bit regs.
   // Then the first register would be the upper nibble of the
   // resulting 32bit value.
-  value.intValue =
-      std::accumulate(reg.begin(), reg.end(), 0, [](int32_t ac, uint16_t v) {
-        return (ac << 16) + v;
-      });
+  if (len == 1 && sign)
+    return int16_t(reg[0]);
+  return std::accumulate(reg, reg + len, 0, [](int32_t ac, uint16_t v) {
+    return (ac << 16) + v;
+  });
+}
+
+static float toFloat(
+    const uint16_t* reg,
+    size_t len,
+    uint16_t precision,
+    bool sign) {
+  // Y = X / 2^N
+  return float(toInteger(reg, len, sign)) / float(1 << precision);
 }
 
-void RegisterValue::makeFloat(
-    const std::vector<uint16_t>& reg,
-    uint16_t precision) {
-  makeInteger(reg);
-  // Y = X / 2^N
-  value.floatValue = float(value.intValue) / float(1 << precision);
-}
-
-void RegisterValue::makeFlags(
-    const std::vector<uint16_t>& reg,
-    const RegisterDescriptor::FlagsDescType& flagsDesc) {
-  makeInteger(reg);
-  uint32_t bitField = static_cast<uint32_t>(value.intValue);
-  new (&value.flagsValue)(FlagsType);
-  for (const auto& [pos, name] : flagsDesc) {
-    bool bitVal = (bitField & (1 << pos)) != 0;
-    value.flagsValue.push_back(std::make_tuple(bitVal, name));
-  }
+static bool flagValue(int32_t bitField, uint8_t pos) {
+  return (static_cast<uint32_t>(bitField) & (1 << pos)) != 0;
 }
 
 RegisterValue::RegisterValue(
-    const std::vector<uint16_t>& reg,
+    const uint16_t* reg,
+    size_t len,
     const RegisterDescriptor& desc,
     uint32_t tstamp)
     : type(desc.format), timestamp(tstamp) {
   switch (desc.format) {
-    case RegisterValueType::STRING:
-      makeString(reg);
-      break;
-    case RegisterValueType::INTEGER:
-      makeInteger(reg);
-      break;
-    case RegisterValueType::FLOAT:
-      makeFloat(reg, desc.precision);
-      break;
-    case RegisterValueType::FLAGS:
-      makeFlags(reg, desc.flags);
-      break;
-    case RegisterValueType::HEX:
-      makeHex(reg);
-  }
-}
-
-RegisterValue::RegisterValue(const std::vector<uint16_t>& reg)
-    : type(RegisterValueType::HEX) {
-  makeHex(reg);
-}
-
-RegisterValue::RegisterValue(const RegisterValue& other)
-    : type(other.type), timestamp(other.timestamp) {
-  switch (type) {
-    case RegisterValueType::HEX:
-      new (&value.hexValue) auto(other.value.hexValue);
-      break;
-    case RegisterValueType::INTEGER:
-      value.intValue = other.value.intValue;
-      break;
-    case RegisterValueType::FLOAT:
-      value.floatValue = other.value.floatValue;
-      break;
-    case RegisterValueType::STRING:
-      new (&value.strValue) auto(other.value.strValue);
-      break;
-    case RegisterValueType::FLAGS:
-      new (&value.flagsValue) auto(other.value.flagsValue);
-      break;
-  }
-}
-
-RegisterValue::RegisterValue(RegisterValue&& other)
-    : type(other.type), timestamp(other.timestamp) {
-  switch (type) {
-    case RegisterValueType::HEX:
-      new (&value.hexValue) auto(std::move(other.value.hexValue));
+    case RegisterValueType::STRING: {
+      std::string str(stringLength(reg, len), '\0');
+      copyString(reg, str.size(), str.data());
+      value = std::move(str);
       break;
+    }
     case RegisterValueType::INTEGER:
-      value.intValue = other.value.intValue;
+      value = toInteger(reg, len, desc.sign);
       break;
     case RegisterValueType::FLOAT:
-      value.floatValue = other.value.floatValue;
+      value = toFloat(reg, len, desc.precision, desc.sign);
       break;
-    case RegisterValueType::STRING:
-      new (&value.strValue) auto(std::move(other.value.strValue));
+    case RegisterValueType::FLAGS: {
+      int32_t bitField = toInteger(reg, len);
+      FlagsType flags;
+      flags.reserve(desc.flags.size());
+      for (const auto& [pos, name] : desc.flags) {
+        flags.emplace_back(flagValue(bitField, pos), name);
+      }
+      value = std::move(flags);
       break;
-    case RegisterValueType::FLAGS:
-      new (&value.flagsValue) auto(std::move(other.value.flagsValue));
+    }
+    case RegisterValueType::HEX: {
+      std::vector<uint8_t> bytes;
+      bytes.reserve(len * 2);
+      for (size_t i = 0; i < len; i++) {
+        bytes.push_back(reg[i] >> 8);
+        bytes.push_back(reg[i] & 0xff);
+      }
+      value = std::move(bytes);
       break;
+    }
   }
 }
 
-RegisterValue::~RegisterValue() {
-  switch (type) {
-    case RegisterValueType::HEX:
-      value.hexValue.~vector<uint8_t>();
-      break;
-    case RegisterValueType::STRING:
-      value.strValue.~basic_string();
-      break;
-    case RegisterValueType::FLAGS:
-      value.flagsValue.~FlagsType();
-      break;
-    case RegisterValueType::INTEGER:
-      [[fallthrough]];
-    case RegisterValueType::FLOAT:
-      // Do nothing
-      break;
-  }
-}
+RegisterValue::RegisterValue(const std::vector<uint16_t>& reg)
+    : RegisterValue(reg.data(), reg.size(), RegisterDescriptor(), 0) {}
 
-RegisterValue::operator std::string() {
-  std::string ret = "";
+RegisterValue::operator std::string() const {
   std::stringstream os;
   switch (type) {
     case RegisterValueType::STRING:
-      os << value.strValue;
+      os << std::get<std::string>(value);
       break;
     case RegisterValueType::INTEGER:
-      os << value.intValue;
+      os << std::get<int32_t>(value);
       break;
     case RegisterValueType::FLOAT:
-      os << std::fixed << std::setprecision(2) << value.floatValue;
+      os << std::fixed << std::setprecision(2) << std::get<float>(value);
       break;
     case RegisterValueType::FLAGS:
       // We could technically be clever and pack this as a
       // JSON object. But considering this is designed for
       // human consumption only, we can make it pretty
       // (and backwards compatible with V1's output).
-      for (auto& [bitval, name] : value.flagsValue) {
+      for (auto& [bitval, name] : std::get<FlagsType>(value)) {
         if (bitval)
           os << "\n*[1] ";
         else
@@ -248,7 +221,7 @@ RegisterValue::operator std::string() {
       }
       break;
     case RegisterValueType::HEX:
-      for (uint8_t byte : value.hexValue) {
+      for (uint8_t byte : std::get<std::vector<uint8_t>>(value)) {
         os << std::hex << std::setw(2) << std::setfill('0') << int(byte);
       }
       break;
@@ -263,37 +236,118 @@ void to_json(json& j, const RegisterValue& m) {
   j["time"] = m.timestamp;
   switch (m.type) {
     case RegisterValueType::HEX:
-      j["value"] = m.value.hexValue;
+      j["value"] = std::get<std::vector<uint8_t>>(m.value);
       break;
     case RegisterValueType::STRING:
-      j["value"] = m.value.strValue;
+      j["value"] = std::get<std::string>(m.value);
       break;
     case RegisterValueType::INTEGER:
-      j["value"] = m.value.intValue;
+      j["value"] = std::get<int32_t>(m.value);
       break;
     case RegisterValueType::FLOAT:
-      j["value"] = m.value.floatValue;
+      j["value"] = std::get<float>(m.value);
       break;
-    case RegisterValueType::FLAGS:
-      j["value"] = m.value.flagsValue;
+    case RegisterValueType::FLAGS: {
+      const auto& flags = std::get<RegisterValue::FlagsType>(m.value);
+      j["value"] = json::array();
+      for (const auto& [bitVal, name] : flags)
+        j["value"].push_back({bitVal, std::string(name)});
+      break;
+    }
+  }
+}
+
+void to_cbor(CborEncoder& e, const RegisterValue& m) {
+  e.map(3) << "type" << typeName(m.type) << "time" << m.timestamp << "value";
+  switch (m.type) {
+    case RegisterValueType::HEX: {
+      const auto& bytes = std::get<std::vector<uint8_t>>(m.value);
+      e.array(bytes.size());
+      for (uint8_t byte : bytes)
+        e << byte;
+      break;
+    }
+    case RegisterValueType::STRING:
+      e << std::get<std::string>(m.value);
+      break;
+    case RegisterValueType::INTEGER:
+      e << std::get<int32_t>(m.value);
+      break;
+    case RegisterValueType::FLOAT:
+      e << std::get<float>(m.value);
+      break;
+    case RegisterValueType::FLAGS: {
+      const auto& flags = std::get<RegisterValue::FlagsType>(m.value);
+      e.array(flags.size());
+      for (const auto& [bitVal, name] : flags)
+        e.array(2) << bitVal << name;
       break;
+    }
+  }
+}
+
+// Same as to_cbor(e, RegisterValue(reg)), but interprets the
+// register contents as it goes rather than building the value.
+static void encodeValue(CborEncoder& e, const Register& reg) {
+  const RegisterDescriptor& desc = reg.desc;
+  e.map(3) << "type" << typeName(desc.format) << "time" << reg.timestamp;
+  e << "value";
+  switch (desc.format) {
+    case RegisterValueType::HEX:
+      e.array(desc.length * 2);
+      for (size_t i = 0; i < desc.length; i++)
+        e << uint8_t(reg.value[i] >> 8) << uint8_t(reg.value[i] & 0xff);
+      break;
+    case RegisterValueType::STRING: {
+      size_t strLen = stringLength(reg.value, desc.length);
+      copyString(reg.value, strLen, e.text(strLen));
+      break;
+    }
+    case RegisterValueType::INTEGER:
+      e << toInteger(reg.value, desc.length, desc.sign);
+      break;
+    case RegisterValueType::FLOAT:
+      e << toFloat(reg.value, desc.length, desc.precision, desc.sign);
+      break;
+    case RegisterValueType::FLAGS: {
+      int32_t bitField = toInteger(reg.value, desc.length);
+      e.array(desc.flags.size());
+      for (const auto& [pos, name] : desc.flags)
+        e.array(2) << flagValue(bitField, pos) << name;
+      break;
+    }
   }
 }
 
 Register::operator std::string() const {
-  return RegisterValue(value, desc, timestamp);
+  return RegisterValue(value, desc.length, desc, timestamp);
 }
 
 Register::operator RegisterValue() const {
-  return RegisterValue(value, desc, timestamp);
+  return RegisterValue(value, desc.length, desc, timestamp);
+}
+
+// Same as the string conversion of a HEX RegisterValue.
+static void formatHex(const Register& reg, char* out) {
+  static const char digits[] = "0123456789abcdef";
+  for (size_t i = 0; i < reg.desc.length; i++) {
+    for (int shift = 12; shift >= 0; shift -= 4)
+      *out++ = digits[(reg.value[i] >> shift) & 0xf];
+  }
 }
 
 void to_json(json& j, const Register& m) {
   j["time"] = m.timestamp;
-  std::string data = RegisterValue(m.value);
+  std::string data(m.desc.length * 4, '\0');
+  formatHex(m, data.data());
   j["data"] = data;
 }
 
+void to_cbor(CborEncoder& e, const Register& m) {
+  e.map(2) << "time" << m.timestamp << "data";
+  formatHex(m, e.text(m.desc.length * 4));
+}
+
 RegisterStore::operator std::string() const {
   std::stringstream ss;
 
@@ -303,7 +357,8 @@ RegisterStore::operator std::string() const {
   streamHex(ss, desc_.begin, 4);
   ss << "> " << std::setfill(' ') << std::setw(32) << std::left << desc_.name
      << " :";
-  for (const auto& v : history_) {
+  for (size_t slot = 0; slot < timestamps_.size(); slot++) {
+    Register v = at(slot);
     if (v) {
       if (desc_.format != RegisterValueType::FLAGS)
         ss << ' ';
@@ -316,23 +371,53 @@ RegisterStore::operator std::string() const {
 }
 
 RegisterStore::operator RegisterStoreValue() const {
-  RegisterStoreValue ret(regAddr_, desc_.name);
-  for (const auto& reg : history_) {
+  RegisterStoreValue ret(desc_);
+  ret.history.reserve(std::count_if(
+      timestamps_.begin(), timestamps_.end(), [](uint32_t t) {
+        return t != 0;
+      }));
+  for (size_t slot = 0; slot < timestamps_.size(); slot++) {
+    Register reg = at(slot);
     if (reg)
-      ret.history.emplace_back(reg);
+      ret.history.push_back(reg);
   }
   return ret;
 }
 
 void to_json(json& j, const RegisterStoreValue& m) {
   j["regAddress"] = m.regAddr;
-  j["name"] = m.name;
-  j["readings"] = m.history;
+  j["name"] = std::string(m.name);
+  j["readings"] = json::array();
+  for (size_t i = 0; i < m.history.size(); i++)
+    j["readings"].push_back(m.history[i]);
 }
 
 void to_json(json& j, const RegisterStore& m) {
   j["begin"] = m.regAddr_;
-  j["readings"] = m.history_;
+  j["readings"] = json::array();
+  for (size_t slot = 0; slot < m.timestamps_.size(); slot++)
+    j["readings"].push_back(m.at(slot));
+}
+
+void RegisterStore::encodeValue(CborEncoder& e) const {
+  size_t valid = std::count_if(
+      timestamps_.begin(), timestamps_.end(), [](uint32_t t) {
+        return t != 0;
+      });
+  e.map(3) << "regAddress" << regAddr_ << "name" << desc_.name << "readings";
+  e.array(valid);
+  for (size_t slot = 0; slot < timestamps_.size(); slot++) {
+    Register reg = at(slot);
+    if (reg)
+      ::encodeValue(e, reg);
+  }
+}
+
+void to_cbor(CborEncoder& e, const RegisterStore& m) {
+  e.map(2) << "begin" << m.regAddr_ << "readings";
+  e.array(m.timestamps_.size());
+  for (size_t slot = 0; slot < m.timestamps_.size(); slot++)
+    to_cbor(e, m.at(slot));
 }
 
 void from_json(const json& j, WriteActionInfo& action) {
@@ -365,6 +450,7 @@ void from_json(const json& j, RegisterMap& m) {
   j.at("name").get_to(m.name);
   j.at("preferred_baudrate").get_to(m.preferredBaudrate);
   j.at("default_baudrate").get_to(m.defaultBaudrate);
+  m.maxReadGap = j.value("max_read_gap", RegisterMap::kDefaultMaxReadGap);
   std::vector<RegisterDescriptor> tmp;
   j.at("registers").get_to(tmp);
   for (auto& i : tmp) {
@@ -380,6 +466,7 @@ void to_json(json& j, const RegisterMap& m) {
   j["name"] = m.name;
   j["preferred_baudrate"] = m.preferredBaudrate;
   j["default_baudrate"] = m.preferredBaudrate;
+  j["max_read_gap"] = m.maxReadGap;
   j["registers"] = {};
   std::transform(
       m.registerDescriptors.begin(),
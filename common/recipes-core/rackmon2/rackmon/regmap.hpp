@@ -1,9 +1,17 @@
 #pragma once
 
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string_view>
 #include <utility>
+#include <variant>
 #include <vector>
+#include "cbor.hpp"
 
 // Describes how we intend on interpreting the value stored
 // in a register.
@@ -40,74 +48,76 @@ struct RegisterDescriptor {
   // the precision.
   uint16_t precision = 0;
 
+  // Whether a single word INTEGER or FLOAT register is signed.
+  // Two word registers are always signed 32bit values.
+  bool sign = false;
+
   // If the register stores flags, this provides the desc.
   FlagsDescType flags{};
+
+  // How often (in seconds) the register should be read. 0 reads
+  // the register every monitor cycle, -1 reads it only once after
+  // the device is discovered (Useful for static information like
+  // serial numbers).
+  int32_t period = 0;
+
+  // Registers with a higher priority are read first in a cycle.
+  uint8_t priority = 0;
 };
 
 struct RegisterValue {
-  using FlagType = std::tuple<bool, std::string>;
+  // Flag names refer to the register descriptor.
+  using FlagType = std::tuple<bool, std::string_view>;
   using FlagsType = std::vector<FlagType>;
-  // Dictates which if the members of value is valid
+  using ValueType = std::
+      variant<std::vector<uint8_t>, std::string, int32_t, float, FlagsType>;
+  // Dictates which if the alternatives of value is valid
   RegisterValueType type = RegisterValueType::HEX;
 
   // The timestamp of when the value was read
   uint32_t timestamp = 0;
 
-  union Value {
-    std::vector<uint8_t> hexValue;
-    std::string strValue;
-    int32_t intValue;
-    float floatValue;
-    FlagsType flagsValue;
-    Value() {}
-    ~Value() {}
-  } value;
+  ValueType value{};
 
   explicit RegisterValue(
-      const std::vector<uint16_t>& reg,
+      const uint16_t* reg,
+      size_t len,
       const RegisterDescriptor& desc,
       uint32_t tstamp);
-  RegisterValue(const std::vector<uint16_t>& reg);
-  RegisterValue(const RegisterValue& other);
-  RegisterValue(RegisterValue&& other);
-
-  // Constructing a union with non-trivial members is
-  // is painful enough. Lets not support assignments.
-  void operator=(const RegisterValue& other) = delete;
-  void operator=(const RegisterValue&& other) = delete;
-  ~RegisterValue();
-  operator std::string();
-
- private:
-  void makeString(const std::vector<uint16_t>& reg);
-  void makeHex(const std::vector<uint16_t>& reg);
-  void makeInteger(const std::vector<uint16_t>& reg);
-  void makeFloat(const std::vector<uint16_t>& reg, uint16_t precision);
-  void makeFlags(
+  explicit RegisterValue(
       const std::vector<uint16_t>& reg,
-      const RegisterDescriptor::FlagsDescType& flagsDesc);
+      const RegisterDescriptor& desc,
+      uint32_t tstamp)
+      : RegisterValue(reg.data(), reg.size(), desc, tstamp) {}
+  RegisterValue(const std::vector<uint16_t>& reg);
+  operator std::string() const;
 };
 void to_json(nlohmann::json& j, const RegisterValue& m);
+void to_cbor(CborEncoder& e, const RegisterValue& m);
 
-// Container of a instance of a register at a given point in time.
+// A reading of a register at a given point in time. This is a view
+// into the storage of a RegisterStore (Or RegisterHistory) and is
+// only valid as long as the storage is not modified.
 struct Register {
   // Reference to the register descriptor.
   const RegisterDescriptor& desc;
   // Timestamp when the register was read.
   uint32_t timestamp = 0;
-  // Actual value of the register/register-range
-  std::vector<uint16_t> value;
+  // Actual value of the register/register-range (desc.length words)
+  const uint16_t* value = nullptr;
 
-  explicit Register(const RegisterDescriptor& d) : desc(d), value(d.length) {}
+  Register(const RegisterDescriptor& d, uint32_t tstamp, const uint16_t* v)
+      : desc(d), timestamp(tstamp), value(v) {}
 
   // equals operator works only on valid register reads. Register
   // with a zero timestamp is considered as invalid.
   bool operator==(const Register& other) const {
-    return timestamp != 0 && other.timestamp != 0 && value == other.value;
+    return timestamp != 0 && other.timestamp != 0 &&
+        std::equal(value, value + desc.length, other.value);
   }
   // Same but opposite of the equals operator.
   bool operator!=(const Register& other) const {
-    return timestamp == 0 || other.timestamp == 0 || value != other.value;
+    return !(*this == other);
   }
   // Returns true if the register contents is valid.
   operator bool() const {
@@ -120,14 +130,52 @@ struct Register {
   operator RegisterValue() const;
 };
 void to_json(nlohmann::json& j, const Register& m);
+void to_cbor(CborEncoder& e, const Register& m);
+
+// Historical record of a register. The readings are kept as they
+// were read in one contiguous buffer and are only interpreted into
+// a RegisterValue when accessed.
+class RegisterHistory {
+  const RegisterDescriptor* desc_;
+  std::vector<uint16_t> values_{};
+  std::vector<uint32_t> timestamps_{};
+
+ public:
+  explicit RegisterHistory(const RegisterDescriptor& desc) : desc_(&desc) {}
+
+  void reserve(size_t size) {
+    values_.reserve(size * desc_->length);
+    timestamps_.reserve(size);
+  }
+  void push_back(const Register& reg) {
+    values_.insert(values_.end(), reg.value, reg.value + desc_->length);
+    timestamps_.push_back(reg.timestamp);
+  }
+  size_t size() const {
+    return timestamps_.size();
+  }
+  bool empty() const {
+    return timestamps_.empty();
+  }
+  // Raw reading at index.
+  Register raw(size_t idx) const {
+    return Register(
+        *desc_, timestamps_[idx], values_.data() + idx * desc_->length);
+  }
+  // Interpreted reading at index.
+  RegisterValue operator[](size_t idx) const {
+    return raw(idx);
+  }
+};
 
 // Container describing the register and its historical record.
 struct RegisterStoreValue {
   uint16_t regAddr = 0;
-  std::string name{};
-  std::vector<RegisterValue> history{};
-  RegisterStoreValue(uint16_t reg, const std::string& n)
-      : regAddr(reg), name(n) {}
+  // Refers to the name in the register descriptor.
+  std::string_view name{};
+  RegisterHistory history;
+  explicit RegisterStoreValue(const RegisterDescriptor& desc)
+      : regAddr(desc.begin), name(desc.name), history(desc) {}
 };
 void to_json(nlohmann::json& j, const RegisterStoreValue& m);
 
@@ -142,27 +190,47 @@ struct RegisterStore {
   uint16_t regAddr_;
   // History of the register contents to keep. This is utilized as
   // a circular buffer with idx pointing to the current slot to
-  // write.
-  std::vector<Register> history_;
+  // write. The slots (desc.length words each) are kept in a single
+  // buffer.
+  std::vector<uint16_t> values_;
+  std::vector<uint32_t> timestamps_;
   int32_t idx_ = 0;
 
+  Register at(size_t slot) const {
+    return Register(
+        desc_, timestamps_[slot], values_.data() + slot * desc_.length);
+  }
+
  public:
   explicit RegisterStore(const RegisterDescriptor& desc)
       : desc_(desc),
         regAddr_(desc.begin),
-        history_(desc.keep, Register(desc)) {}
+        values_(size_t(desc.keep) * desc.length),
+        timestamps_(desc.keep) {}
 
-  // Returns a reference to the last written value (Back of the list)
-  Register& back() {
-    return idx_ == 0 ? history_.back() : history_[idx_ - 1];
+  // Returns the last written value (Back of the list)
+  Register back() const {
+    return at(idx_ == 0 ? timestamps_.size() - 1 : idx_ - 1);
+  }
+  // Returns the front (Next to write)
+  Register front() const {
+    return at(idx_);
+  }
+  // Writes a reading (length() words) to the front. Does not
+  // advance the front.
+  void setFront(const uint16_t* value, uint32_t timestamp) {
+    std::copy(
+        value, value + desc_.length, values_.begin() + idx_ * desc_.length);
+    timestamps_[idx_] = timestamp;
   }
-  // Returns the front (Next to write) reference
-  Register& front() {
-    return history_[idx_];
+  void setFront(const std::vector<uint16_t>& value, uint32_t timestamp) {
+    if (value.size() != desc_.length)
+      throw std::out_of_range("Value does not match register length");
+    setFront(value.data(), timestamp);
   }
   // Advances the front.
   void operator++() {
-    idx_ = (idx_ + 1) % history_.size();
+    idx_ = (idx_ + 1) % timestamps_.size();
   }
 
   // register address accessor
@@ -170,6 +238,26 @@ struct RegisterStore {
     return regAddr_;
   }
 
+  // Length of the register (in 16bit words).
+  uint16_t length() const {
+    return desc_.length;
+  }
+
+  // Poll period of the register (See RegisterDescriptor::period).
+  int32_t period() const {
+    return desc_.period;
+  }
+
+  // Read priority of the register.
+  uint8_t priority() const {
+    return desc_.priority;
+  }
+
+  // Only keep readings which differ from the previous one.
+  bool storeChangesOnly() const {
+    return desc_.storeChangesOnly;
+  }
+
   const std::string& name() const {
     return desc_.name;
   }
@@ -180,10 +268,16 @@ struct RegisterStore {
   // Returns the historical record of the values
   operator RegisterStoreValue() const;
 
-  // Add the JSON conversion methods as friends.
+  // Encodes the historical record of the values. Same as
+  // RegisterStoreValue, without making a copy of the store.
+  void encodeValue(CborEncoder& e) const;
+
+  // Add the JSON/CBOR conversion methods as friends.
   friend void to_json(nlohmann::json& j, const RegisterStore& m);
+  friend void to_cbor(CborEncoder& e, const RegisterStore& m);
 };
 void to_json(nlohmann::json& j, const RegisterStore& m);
+void to_cbor(CborEncoder& e, const RegisterStore& m);
 
 struct WriteActionInfo {
   std::optional<std::string> shell{};
@@ -216,17 +310,46 @@ struct AddrRange {
   bool contains(uint8_t) const;
 };
 
+// Knowledge learned at runtime about how devices of a register
+// map respond to coalesced reads. Some devices reject (or never
+// respond to) a read which spans a hole in their address space.
+// A read never spans from a register before a split recorded here
+// to the register of the split. This is shared by all devices
+// using the same register map.
+class RegisterReadHints {
+  mutable std::mutex mutex_{};
+  std::set<uint16_t> splits_{};
+
+ public:
+  // Returns true if a read must end before this register.
+  bool splitBefore(uint16_t reg) const {
+    std::unique_lock lk(mutex_);
+    return splits_.find(reg) != splits_.end();
+  }
+  // Do not coalesce reads of this register with the ones before it.
+  void split(uint16_t reg) {
+    std::unique_lock lk(mutex_);
+    splits_.insert(reg);
+  }
+};
+
 // Container of an entire register map. This is the memory
 // representation of each JSON register map descriptors
 // at /etc/rackmon.d.
 struct RegisterMap {
+  // Default number of unmonitored registers we are willing to
+  // read (and throw away) to merge two reads into one.
+  static constexpr uint16_t kDefaultMaxReadGap = 8;
   AddrRange applicableAddresses;
   std::string name;
   uint8_t probeRegister;
   uint32_t defaultBaudrate;
   uint32_t preferredBaudrate;
+  uint16_t maxReadGap = kDefaultMaxReadGap;
   std::vector<SpecialHandlerInfo> specialHandlers;
   std::map<uint16_t, RegisterDescriptor> registerDescriptors;
+  std::shared_ptr<RegisterReadHints> readHints =
+      std::make_shared<RegisterReadHints>();
   const RegisterDescriptor& at(uint16_t reg) const {
     return registerDescriptors.at(reg);
   }
@@ -0,0 +1,82 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "cbor.hpp"
+#include "regmap.hpp"
+
+using namespace std;
+using namespace testing;
+using nlohmann::json;
+
+TEST(CborEncoderTest, Primitives) {
+  std::vector<uint8_t> buf;
+  CborEncoder e(buf);
+  e.array(12) << 0 << 23 << 24 << 0x1234 << 0x12345678 << uint64_t(1) << 40;
+  e << int32_t(-1) << int64_t(-1000) << true << false << 1.5f;
+  EXPECT_EQ(
+      buf,
+      std::vector<uint8_t>({0x8c, 0x00, 0x17, 0x18, 0x18, 0x19, 0x12,
+                            0x34, 0x1a, 0x12, 0x34, 0x56, 0x78, 0x01,
+                            0x18, 0x28, 0x20, 0x39, 0x03, 0xe7, 0xf5,
+                            0xf4, 0xfa, 0x3f, 0xc0, 0x00, 0x00}));
+  json j = json::from_cbor(buf);
+  EXPECT_EQ(
+      j,
+      json::parse(
+          "[0, 23, 24, 4660, 305419896, 1, 40, -1, -1000, true, false, 1.5]"));
+}
+
+TEST(CborEncoderTest, Containers) {
+  std::vector<uint8_t> buf;
+  CborEncoder e(buf);
+  std::string longStr(300, 'a');
+  e.map(3) << "hello" << "world" << "long" << longStr << "list";
+  e.array(2) << 1;
+  e.map(0);
+  json exp = {
+      {"hello", "world"}, {"long", longStr}, {"list", {1, json::object()}}};
+  EXPECT_EQ(json::from_cbor(buf), exp);
+}
+
+TEST(CborEncoderTest, RegisterValue) {
+  RegisterDescriptor d;
+  d.length = 2;
+  d.format = RegisterValueType::FLAGS;
+  d.flags = {{0, "HELLO"}, {1, "WORLD"}};
+  for (auto fmt :
+       {RegisterValueType::HEX,
+        RegisterValueType::STRING,
+        RegisterValueType::INTEGER,
+        RegisterValueType::FLOAT,
+        RegisterValueType::FLAGS}) {
+    d.format = fmt;
+    d.precision = 3;
+    RegisterValue val({0x3730, 0x3031}, d, 0x12345678);
+    std::vector<uint8_t> buf;
+    CborEncoder e(buf);
+    to_cbor(e, val);
+    EXPECT_EQ(json::from_cbor(buf), json(val));
+  }
+}
+
+TEST(CborEncoderTest, RegisterStore) {
+  RegisterDescriptor desc{
+      0x10, 2, "HELLO", 3, false, RegisterValueType::INTEGER, 0};
+  RegisterStore reg(desc);
+  // Leave one slot of the history invalid.
+  for (uint16_t i = 0; i < 2; i++) {
+    reg.setFront({0xabcd, i}, i + 1);
+    ++reg;
+  }
+  std::vector<uint8_t> buf;
+  CborEncoder e(buf);
+  to_cbor(e, reg);
+  EXPECT_EQ(json::from_cbor(buf), json(reg));
+  json j = json::from_cbor(buf);
+  EXPECT_EQ(j["readings"][1]["data"], "abcd0001");
+
+  buf.clear();
+  reg.encodeValue(e);
+  RegisterStoreValue val = reg;
+  EXPECT_EQ(json::from_cbor(buf), json(val));
+  EXPECT_EQ(json::from_cbor(buf)["readings"].size(), 2);
+}
@@ -0,0 +1,179 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include "history.hpp"
+
+using namespace std;
+using namespace testing;
+using nlohmann::json;
+
+class HistoryStoreTest : public ::testing::Test {
+ public:
+  const std::string path = "./test_history.bin";
+  void SetUp() override {
+    remove(path.c_str());
+  }
+  void TearDown() override {
+    remove(path.c_str());
+  }
+};
+
+TEST_F(HistoryStoreTest, AppendQuery) {
+  HistoryStore store(path, 16);
+  EXPECT_EQ(store.size(), 0);
+  EXPECT_EQ(store.capacity(), 16);
+  for (uint16_t i = 0; i < 4; i++) {
+    std::vector<uint16_t> val{i, uint16_t(i + 1)};
+    EXPECT_TRUE(store.append(0xa0, 0x10, 100 + i, val.data(), val.size()));
+    EXPECT_TRUE(store.append(0xa1, 0x10, 100 + i, val.data(), val.size()));
+  }
+  // Does not fit in a record.
+  std::vector<uint16_t> big(8);
+  EXPECT_FALSE(store.append(0xa0, 0x20, 104, big.data(), big.size()));
+  EXPECT_EQ(store.size(), 8);
+
+  auto recs = store.query(0xa0, 0x10, 101, 102);
+  ASSERT_EQ(recs.size(), 2);
+  EXPECT_EQ(recs[0].timestamp, 101);
+  EXPECT_EQ(recs[0].deviceAddress, 0xa0);
+  EXPECT_EQ(recs[0].length, 2);
+  EXPECT_EQ(recs[0].value[0], 1);
+  EXPECT_EQ(recs[0].value[1], 2);
+  EXPECT_EQ(recs[1].timestamp, 102);
+  EXPECT_EQ(store.query(0xa1, 0x10, 0, 1000).size(), 4);
+  EXPECT_EQ(store.query(0xa0, 0x11, 0, 1000).size(), 0);
+  EXPECT_EQ(store.query(0xa0, 0x10, 200, 300).size(), 0);
+}
+
+TEST_F(HistoryStoreTest, Rollover) {
+  HistoryStore store(path, 4);
+  for (uint16_t i = 0; i < 10; i++)
+    store.append(0xa0, 0x10, 100 + i, &i, 1);
+  EXPECT_EQ(store.size(), 4);
+  // Only the latest 4 are around.
+  auto recs = store.query(0xa0, 0x10, 0, 1000);
+  ASSERT_EQ(recs.size(), 4);
+  for (size_t i = 0; i < recs.size(); i++) {
+    EXPECT_EQ(recs[i].timestamp, 106 + i);
+    EXPECT_EQ(recs[i].value[0], 6 + i);
+  }
+}
+
+TEST_F(HistoryStoreTest, Persistence) {
+  {
+    HistoryStore store(path, 8);
+    for (uint16_t i = 0; i < 3; i++)
+      store.append(0xa0, 0x10, 100 + i, &i, 1);
+  }
+  {
+    HistoryStore store(path, 8);
+    EXPECT_EQ(store.size(), 3);
+    uint16_t val = 3;
+    store.append(0xa0, 0x10, 103, &val, 1);
+    EXPECT_EQ(store.query(0xa0, 0x10, 0, 1000).size(), 4);
+  }
+  // A different capacity starts over.
+  HistoryStore store(path, 4);
+  EXPECT_EQ(store.size(), 0);
+}
+
+TEST_F(HistoryStoreTest, Downsample) {
+  RegisterDescriptor desc;
+  desc.begin = 0x10;
+  desc.length = 1;
+  desc.name = "POWER";
+  desc.format = RegisterValueType::INTEGER;
+  HistoryStore store(path, 32);
+  // 100, 110, 120 ... 190
+  for (uint16_t i = 0; i < 10; i++) {
+    uint16_t val = 100 + i * 10;
+    store.append(0xa0, 0x10, 1000 + i, &val, 1);
+  }
+  RegisterStoreValue all = store.query(0xa0, desc, 0, 2000);
+  EXPECT_EQ(all.name, "POWER");
+  EXPECT_EQ(all.regAddr, 0x10);
+  EXPECT_EQ(all.history.size(), 10);
+
+  RegisterStoreValue avg = store.query(0xa0, desc, 1000, 2000, 4);
+  ASSERT_EQ(avg.history.size(), 3);
+  EXPECT_EQ(avg.history[0].timestamp, 1000);
+  EXPECT_EQ(std::get<int32_t>(avg.history[0].value), 115);
+  EXPECT_EQ(avg.history[1].timestamp, 1004);
+  EXPECT_EQ(std::get<int32_t>(avg.history[1].value), 155);
+  EXPECT_EQ(avg.history[2].timestamp, 1008);
+  EXPECT_EQ(std::get<int32_t>(avg.history[2].value), 185);
+
+  // Values which cannot be averaged take the last reading.
+  desc.format = RegisterValueType::HEX;
+  RegisterStoreValue last = store.query(0xa0, desc, 1000, 2000, 4);
+  ASSERT_EQ(last.history.size(), 3);
+  EXPECT_EQ(
+      std::get<std::vector<uint8_t>>(last.history[0].value),
+      std::vector<uint8_t>({0x00, 130}));
+  json j = last;
+  EXPECT_EQ(j["readings"].size(), 3);
+
+  // Records of a different length are from an older register map.
+  desc.length = 2;
+  EXPECT_EQ(store.query(0xa0, desc, 0, 2000).history.size(), 0);
+}
+
+TEST_F(HistoryStoreTest, DownsampleSigned) {
+  RegisterDescriptor desc;
+  desc.begin = 0x10;
+  desc.length = 1;
+  desc.name = "CURRENT";
+  desc.format = RegisterValueType::INTEGER;
+  desc.sign = true;
+  HistoryStore store(path, 32);
+  // -2, -4, 2, 0
+  for (int16_t val : {-2, -4, 2, 0}) {
+    uint16_t word = uint16_t(val);
+    store.append(0xa0, 0x10, 1000, &word, 1);
+  }
+  RegisterStoreValue avg = store.query(0xa0, desc, 1000, 2000, 4);
+  ASSERT_EQ(avg.history.size(), 1);
+  EXPECT_EQ(std::get<int32_t>(avg.history[0].value), -1);
+
+  // Unsigned, the same words average to a large positive value.
+  desc.sign = false;
+  avg = store.query(0xa0, desc, 1000, 2000, 4);
+  ASSERT_EQ(avg.history.size(), 1);
+  EXPECT_EQ(std::get<int32_t>(avg.history[0].value), (0xfffe + 0xfffc + 2) / 4);
+}
+
+TEST_F(HistoryStoreTest, ClockSetBack) {
+  HistoryStore store(path, 64);
+  for (uint16_t i = 0; i < 10; i++)
+    store.append(0xa0, 0x10, 5000 + i * 10, &i, 1);
+  // The clock goes back in time, readings from before are still found.
+  for (uint16_t i = 10; i < 20; i++)
+    store.append(0xa0, 0x10, 1000 + i * 10, &i, 1);
+  auto recs = store.query(0xa0, 0x10, 0, 10000);
+  ASSERT_EQ(recs.size(), 20);
+  for (size_t i = 0; i < recs.size(); i++)
+    EXPECT_EQ(recs[i].value[0], i);
+  recs = store.query(0xa0, 0x10, 5000, 5090);
+  ASSERT_EQ(recs.size(), 10);
+  EXPECT_EQ(recs[0].value[0], 0);
+  recs = store.query(0xa0, 0x10, 1100, 1190);
+  ASSERT_EQ(recs.size(), 10);
+  EXPECT_EQ(recs[0].value[0], 10);
+
+  // Downsampling goes by time, not by the order of appends.
+  RegisterDescriptor desc;
+  desc.begin = 0x10;
+  desc.length = 1;
+  desc.format = RegisterValueType::INTEGER;
+  RegisterStoreValue avg = store.query(0xa0, desc, 1000, 10000, 1000);
+  ASSERT_EQ(avg.history.size(), 2);
+  EXPECT_EQ(avg.history[0].timestamp, 1000);
+  EXPECT_EQ(std::get<int32_t>(avg.history[0].value), 14);
+  EXPECT_EQ(avg.history[1].timestamp, 5000);
+  EXPECT_EQ(std::get<int32_t>(avg.history[1].value), 4);
+
+  // Once rolled over, the store is searched by time again.
+  for (uint16_t i = 20; i < 84; i++)
+    store.append(0xa0, 0x10, 1000 + i * 10, &i, 1);
+  EXPECT_EQ(store.query(0xa0, 0x10, 1200, 1290).size(), 10);
+}
@@ -324,7 +324,8 @@ TEST_F(ModbusDeviceTest, MonitorDataValue) {
   EXPECT_EQ(data.registerList[0].history.size(), 1);
   EXPECT_NEAR(data.registerList[0].history[0].timestamp, std::time(0), 10);
   EXPECT_EQ(data.registerList[0].history[0].type, RegisterValueType::STRING);
-  EXPECT_EQ(data.registerList[0].history[0].value.strValue, "abcd");
+  EXPECT_EQ(
+      std::get<std::string>(data.registerList[0].history[0].value), "abcd");
 
   dev.monitor();
   ModbusDeviceValueData data2 = dev.getValueData();
@@ -341,9 +342,11 @@ TEST_F(ModbusDeviceTest, MonitorDataValue) {
   EXPECT_EQ(data2.registerList[0].name, "MFG_MODEL");
   EXPECT_EQ(data2.registerList[0].history.size(), 2);
   EXPECT_EQ(data2.registerList[0].history[0].type, RegisterValueType::STRING);
-  EXPECT_EQ(data2.registerList[0].history[0].value.strValue, "abcd");
+  EXPECT_EQ(
+      std::get<std::string>(data2.registerList[0].history[0].value), "abcd");
   EXPECT_EQ(data2.registerList[0].history[1].type, RegisterValueType::STRING);
-  EXPECT_EQ(data2.registerList[0].history[1].value.strValue, "bcde");
+  EXPECT_EQ(
+      std::get<std::string>(data2.registerList[0].history[1].value), "bcde");
   EXPECT_NEAR(data2.registerList[0].history[0].timestamp, std::time(0), 10);
   EXPECT_NEAR(data2.registerList[0].history[1].timestamp, std::time(0), 10);
   EXPECT_GE(
@@ -355,8 +358,10 @@ TEST_F(ModbusDeviceTest, MonitorDataValue) {
   EXPECT_EQ(data3.registerList[0].history.size(), 2);
   // TODO We probably need a circular iterator on the history.
   // Till then, we will probably get out of order stuff.
-  EXPECT_EQ(data3.registerList[0].history[1].value.strValue, "bcde");
-  EXPECT_EQ(data3.registerList[0].history[0].value.strValue, "cdef");
+  EXPECT_EQ(
+      std::get<std::string>(data3.registerList[0].history[1].value), "bcde");
+  EXPECT_EQ(
+      std::get<std::string>(data3.registerList[0].history[0].value), "cdef");
   nlohmann::json j = data3;
   EXPECT_EQ(j["deviceAddress"], 0x32);
   EXPECT_EQ(j["crcErrors"], 0);
@@ -494,6 +499,416 @@ TEST_F(ModbusDeviceTest, MonitorFmtData) {
   EXPECT_EQ(actual, exp1_out);
 }
 
+class ModbusDeviceBulkReadTest : public ModbusDeviceTest {
+ protected:
+  void SetUp() override {
+    regmap = R"({
+      "name": "orv3_psu",
+      "address_range": [110, 140],
+      "probe_register": 104,
+      "default_baudrate": 19200,
+      "preferred_baudrate": 19200,
+      "registers": [
+        {
+          "begin": 0,
+          "length": 2,
+          "format": "string",
+          "name": "MFG_MODEL"
+        },
+        {
+          "begin": 2,
+          "length": 1,
+          "format": "integer",
+          "name": "FAN_RPM"
+        },
+        {
+          "begin": 10,
+          "length": 1,
+          "format": "integer",
+          "name": "TEMP"
+        },
+        {
+          "begin": 100,
+          "length": 1,
+          "format": "integer",
+          "name": "STATUS"
+        }
+      ]
+    })"_json;
+  }
+};
+
+TEST_F(ModbusDeviceBulkReadTest, PlanReads) {
+  ModbusDevice dev(get_modbus(), 0x32, get_regmap());
+  std::vector<RegisterSpan> spans = dev.planReads();
+  ASSERT_EQ(spans.size(), 2);
+  EXPECT_EQ(spans[0].begin, 0);
+  EXPECT_EQ(spans[0].length, 11);
+  EXPECT_EQ(spans[0].stores, std::vector<size_t>({0, 1, 2}));
+  EXPECT_EQ(spans[1].begin, 100);
+  EXPECT_EQ(spans[1].length, 1);
+  EXPECT_EQ(spans[1].stores, std::vector<size_t>({3}));
+
+  // No gaps allowed, only adjacent registers get merged.
+  get_regmap().maxReadGap = 0;
+  spans = dev.planReads();
+  ASSERT_EQ(spans.size(), 3);
+  EXPECT_EQ(spans[0].begin, 0);
+  EXPECT_EQ(spans[0].length, 3);
+  EXPECT_EQ(spans[0].stores.size(), 2);
+  EXPECT_EQ(spans[1].begin, 10);
+  EXPECT_EQ(spans[2].begin, 100);
+}
+
+TEST_F(ModbusDeviceBulkReadTest, PlanReadsMaxLength) {
+  RegisterMap& rmap = get_regmap();
+  RegisterDescriptor big = rmap.at(100);
+  big.begin = 101;
+  big.length = RegisterSpan::kMaxRegisters;
+  big.name = "BLACKBOX";
+  rmap.registerDescriptors[big.begin] = big;
+  ModbusDevice dev(get_modbus(), 0x32, rmap);
+  std::vector<RegisterSpan> spans = dev.planReads();
+  // 100 and 101 are adjacent, but together they do not fit
+  // in a single response.
+  ASSERT_EQ(spans.size(), 3);
+  EXPECT_EQ(spans[1].begin, 100);
+  EXPECT_EQ(spans[1].length, 1);
+  EXPECT_EQ(spans[2].begin, 101);
+  EXPECT_EQ(spans[2].length, RegisterSpan::kMaxRegisters);
+}
+
+TEST_F(ModbusDeviceBulkReadTest, MonitorCoalesced) {
+  // encodeMsgContentEqual encodes its argument, so make sure
+  // each request is matched against only one expectation.
+  InSequence seq;
+  EXPECT_CALL(
+      get_modbus(),
+      command(
+          // addr(1) = 0x32,
+          // func(1) = 0x03,
+          // reg_off(2) = 0x0000,
+          // reg_cnt(2) = 0x000b
+          encodeMsgContentEqual(0x32030000000b_EM),
+          _,
+          19200,
+          ModbusTime::zero(),
+          ModbusTime::zero()))
+      .Times(1)
+      // addr(1) = 0x32,
+      // func(1) = 0x03,
+      // bytes(1) = 0x16,
+      // data(22) = 6162 6364 0010 0000*7 0020
+      .WillOnce(SetMsgDecode<1>(
+          0x32031661626364001000000000000000000000000000000020_EM));
+  EXPECT_CALL(
+      get_modbus(),
+      command(
+          encodeMsgContentEqual(0x320300640001_EM),
+          _,
+          19200,
+          ModbusTime::zero(),
+          ModbusTime::zero()))
+      .Times(1)
+      .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+
+  ModbusDevice dev(get_modbus(), 0x32, get_regmap());
+  dev.monitor();
+  ModbusDeviceValueData data = dev.getValueData();
+  ASSERT_EQ(data.registerList.size(), 4);
+  EXPECT_EQ(
+      std::get<std::string>(data.registerList[0].history[0].value), "abcd");
+  EXPECT_EQ(std::get<int32_t>(data.registerList[1].history[0].value), 0x10);
+  EXPECT_EQ(std::get<int32_t>(data.registerList[2].history[0].value), 0x20);
+  EXPECT_EQ(std::get<int32_t>(data.registerList[3].history[0].value), 0x30);
+}
+
+TEST_F(ModbusDeviceBulkReadTest, MonitorLearnsHoles) {
+  {
+    InSequence seq;
+    // The device has a hole between FAN_RPM and TEMP.
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x32030000000b_EM), _, _, _, _))
+        .WillOnce(Throw(ModbusError(ModbusError::kIllegalDataAddress)));
+    // Read in halves till the reads are accepted.
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300000002_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x32030461626364_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300020009_EM), _, _, _, _))
+        .WillOnce(Throw(ModbusError(ModbusError::kIllegalDataAddress)));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300020001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020010_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x3203000a0001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020020_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+  }
+
+  ModbusDevice dev(get_modbus(), 0x32, get_regmap());
+  dev.monitor();
+  ModbusDeviceValueData data = dev.getValueData();
+  EXPECT_EQ(
+      std::get<std::string>(data.registerList[0].history[0].value), "abcd");
+  EXPECT_EQ(std::get<int32_t>(data.registerList[1].history[0].value), 0x10);
+  EXPECT_EQ(std::get<int32_t>(data.registerList[2].history[0].value), 0x20);
+  EXPECT_EQ(std::get<int32_t>(data.registerList[3].history[0].value), 0x30);
+
+  // Only the read across the hole is split. Learned hints are
+  // shared with other devices of the same type.
+  ModbusDevice dev2(get_modbus(), 0x33, get_regmap());
+  std::vector<RegisterSpan> spans = dev2.planReads();
+  ASSERT_EQ(spans.size(), 3);
+  EXPECT_EQ(spans[0].begin, 0);
+  EXPECT_EQ(spans[0].length, 3);
+  EXPECT_EQ(spans[0].stores, std::vector<size_t>({0, 1}));
+  EXPECT_EQ(spans[1].begin, 10);
+  EXPECT_EQ(spans[1].length, 1);
+  EXPECT_EQ(spans[2].begin, 100);
+}
+
+TEST_F(ModbusDeviceBulkReadTest, MonitorIgnoresTimeouts) {
+  ModbusDevice dev(get_modbus(), 0x32, get_regmap());
+  // The device does not answer the coalesced read, which could
+  // as well be line noise. Fall back to reading each register by
+  // itself without learning anything from it, however often.
+  for (int i = 0; i < 4; i++) {
+    {
+      InSequence seq;
+      EXPECT_CALL(
+          get_modbus(),
+          command(encodeMsgContentEqual(0x32030000000b_EM), _, _, _, _))
+          .WillOnce(Throw(TimeoutException()));
+      EXPECT_CALL(
+          get_modbus(),
+          command(encodeMsgContentEqual(0x320300000002_EM), _, _, _, _))
+          .WillOnce(SetMsgDecode<1>(0x32030461626364_EM));
+      EXPECT_CALL(
+          get_modbus(),
+          command(encodeMsgContentEqual(0x320300020001_EM), _, _, _, _))
+          .WillOnce(SetMsgDecode<1>(0x3203020010_EM));
+      EXPECT_CALL(
+          get_modbus(),
+          command(encodeMsgContentEqual(0x3203000a0001_EM), _, _, _, _))
+          .WillOnce(SetMsgDecode<1>(0x3203020020_EM));
+      EXPECT_CALL(
+          get_modbus(),
+          command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+          .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+    }
+    dev.monitor();
+    Mock::VerifyAndClearExpectations(&get_modbus());
+    EXPECT_EQ(dev.planReads().size(), 2);
+  }
+  // Nor from the halves of a refused read timing out.
+  {
+    InSequence seq;
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x32030000000b_EM), _, _, _, _))
+        .WillOnce(Throw(ModbusError(ModbusError::kIllegalDataAddress)));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300000002_EM), _, _, _, _))
+        .WillOnce(Throw(TimeoutException()));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300020009_EM), _, _, _, _))
+        .WillOnce(Throw(TimeoutException()));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300020001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020010_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x3203000a0001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020020_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+  }
+  dev.monitor();
+  std::vector<RegisterSpan> spans = dev.planReads();
+  ASSERT_EQ(spans.size(), 2);
+  EXPECT_EQ(spans[0].stores, std::vector<size_t>({0, 1, 2}));
+}
+
+TEST_F(ModbusDeviceBulkReadTest, MonitorSchedule) {
+  RegisterMap& rmap = get_regmap();
+  // Static, read once.
+  rmap.registerDescriptors.at(0).period = -1;
+  // Slow changing.
+  rmap.registerDescriptors.at(10).period = 1000;
+  // Read before everything else.
+  rmap.registerDescriptors.at(100).priority = 1;
+  {
+    InSequence seq;
+    // First pass, everything is due. Highest priority first.
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x32030000000b_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(
+            0x32031661626364001000000000000000000000000000000020_EM));
+    // Third pass, only the registers without a period are due.
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020031_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300020001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020011_EM));
+  }
+
+  ModbusDevice dev(get_modbus(), 0x32, rmap);
+  dev.monitor(100);
+  // Nothing is due yet.
+  dev.monitor(100);
+  dev.monitor();
+  ModbusDeviceValueData data = dev.getValueData();
+  EXPECT_EQ(
+      std::get<std::string>(data.registerList[0].history[0].value), "abcd");
+  EXPECT_EQ(std::get<int32_t>(data.registerList[1].history[0].value), 0x11);
+  EXPECT_EQ(std::get<int32_t>(data.registerList[2].history[0].value), 0x20);
+  EXPECT_EQ(std::get<int32_t>(data.registerList[3].history[0].value), 0x31);
+}
+
+TEST_F(ModbusDeviceBulkReadTest, ChangedValueData) {
+  RegisterMap& rmap = get_regmap();
+  rmap.registerDescriptors.at(0).period = -1;
+  {
+    InSequence seq;
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x32030000000b_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(
+            0x32031661626364001000000000000000000000000000000020_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+    // Only register 0x2 changes.
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300020009_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(
+            0x320312001100000000000000000000000000000020_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+  }
+
+  ModbusDevice dev(get_modbus(), 0x32, rmap);
+  uint64_t since = 0;
+  // Nothing monitored yet.
+  EXPECT_EQ(dev.getChangedValueData(since).registerList.size(), 0);
+  dev.monitor();
+  ModbusDeviceValueData data = dev.getChangedValueData(since);
+  EXPECT_EQ(data.deviceAddress, 0x32);
+  EXPECT_EQ(data.registerList.size(), 4);
+  // Nothing changed since the last call.
+  EXPECT_EQ(dev.getChangedValueData(since).registerList.size(), 0);
+  dev.monitor();
+  data = dev.getChangedValueData(since);
+  ASSERT_EQ(data.registerList.size(), 1);
+  EXPECT_EQ(data.registerList[0].regAddr, 2);
+  ASSERT_EQ(data.registerList[0].history.size(), 1);
+  EXPECT_EQ(std::get<int32_t>(data.registerList[0].history[0].value), 0x11);
+}
+
+TEST_F(ModbusDeviceBulkReadTest, ReactivateRereadsStatic) {
+  RegisterMap& rmap = get_regmap();
+  rmap.registerDescriptors.at(0).period = -1;
+  {
+    InSequence seq;
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x32030000000b_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(
+            0x32031661626364001000000000000000000000000000000020_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+    // Unit pulled out.
+    EXPECT_CALL(get_modbus(), command(_, _, _, _, _))
+        .Times(10)
+        .WillRepeatedly(Throw(TimeoutException()));
+    // A different unit in its place, the static model is read again.
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x32030000000b_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(
+            0x32031665666768001000000000000000000000000000000020_EM));
+    EXPECT_CALL(
+        get_modbus(),
+        command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+        .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+  }
+
+  ModbusDevice dev(get_modbus(), 0x32, rmap);
+  dev.monitor();
+  for (int i = 0; i < 10; i++) {
+    Msg req, resp;
+    EXPECT_THROW(dev.command(req, resp), TimeoutException);
+  }
+  EXPECT_FALSE(dev.isActive());
+  dev.setActive();
+  EXPECT_TRUE(dev.isActive());
+  dev.monitor();
+  ModbusDeviceValueData data = dev.getValueData();
+  EXPECT_EQ(
+      std::get<std::string>(data.registerList[0].history[0].value), "efgh");
+}
+
+TEST_F(ModbusDeviceBulkReadTest, EncodeData) {
+  InSequence seq;
+  EXPECT_CALL(
+      get_modbus(),
+      command(encodeMsgContentEqual(0x32030000000b_EM), _, _, _, _))
+      .WillOnce(SetMsgDecode<1>(
+          0x32031661626364001000000000000000000000000000000020_EM));
+  EXPECT_CALL(
+      get_modbus(),
+      command(encodeMsgContentEqual(0x320300640001_EM), _, _, _, _))
+      .WillOnce(SetMsgDecode<1>(0x3203020030_EM));
+  ModbusDevice dev(get_modbus(), 0x32, get_regmap());
+  dev.monitor();
+
+  std::vector<uint8_t> buf;
+  CborEncoder e(buf);
+  dev.encodeRawData(e);
+  nlohmann::json enc = nlohmann::json::from_cbor(buf);
+  nlohmann::json exp = dev.getRawData();
+  // Could be a second apart.
+  enc.erase("now");
+  exp.erase("now");
+  EXPECT_EQ(enc, exp);
+
+  buf.clear();
+  dev.encodeValueData(e);
+  enc = nlohmann::json::from_cbor(buf);
+  exp = dev.getValueData();
+  enc.erase("now");
+  exp.erase("now");
+  EXPECT_EQ(enc, exp);
+}
+
 class MockModbusDevice : public ModbusDevice {
  public:
   MockModbusDevice(Modbus& m, uint8_t addr, const RegisterMap& rmap)
@@ -170,3 +170,39 @@ TEST_F(ModbusTest, CommandBadResp) {
       bus.command(req, resp, 115200, ModbusTime::zero(), ModbusTime::zero()),
       CRCError);
 }
+
+TEST_F(ModbusTest, CommandExceptionResp) {
+  nlohmann::json conf;
+  conf["device_path"] = "/dev/ttyUSB0";
+  conf["baudrate"] = 19200;
+
+  // Read 2 registers at 0 from 0x32, the device answers with an
+  // illegal data address exception response and its CRC, then
+  // nothing more.
+  uint8_t resp_buf[] = {0x32, 0x83, 0x02, 0x30, 0xfe};
+  std::unique_ptr<MockUARTDevice> dev =
+      std::make_unique<MockUARTDevice>("/dev/ttyUSB0", 19200);
+  EXPECT_CALL(*dev, open()).Times(1);
+  EXPECT_CALL(*dev, write(_, 8)).Times(1);
+  EXPECT_CALL(*dev, read(_, 9, _))
+      .Times(1)
+      .WillOnce(DoAll(
+          SetBufArgNPointeeTo<0>(resp_buf, sizeof(resp_buf)),
+          Throw(TimeoutException())));
+  std::unique_ptr<UARTDevice> dev2 = std::move(dev);
+  std::stringstream ss;
+  MockModbus bus(ss);
+  EXPECT_CALL(bus, makeDevice("default", "/dev/ttyUSB0", 19200))
+      .Times(1)
+      .WillOnce(Return(ByMove(std::move(dev2))));
+  bus.initialize(conf);
+  Msg req = 0x320300000002_M;
+  Msg resp;
+  resp.len = 9;
+  try {
+    bus.command(req, resp, 19200, ModbusTime::zero(), ModbusTime::zero());
+    FAIL() << "Expected ModbusError";
+  } catch (ModbusError& e) {
+    EXPECT_EQ(e.code, ModbusError::kIllegalDataAddress);
+  }
+}
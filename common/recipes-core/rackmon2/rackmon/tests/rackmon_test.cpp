@@ -14,6 +14,9 @@ class FakeModbus : public Modbus {
   uint32_t baud;
   bool probed = false;
   Encoder encoder{};
+  // Like the real interface, serialize commands. Scan and monitor
+  // threads share the interface.
+  std::mutex commandMutex{};
 
  public:
   FakeModbus(uint8_t e, uint8_t mina, uint8_t maxa, uint32_t b)
@@ -28,6 +31,7 @@ class FakeModbus : public Modbus {
       uint32_t b,
       ModbusTime /* unused */,
       ModbusTime /* unused */) {
+    std::unique_lock lock(commandMutex);
     encoder.encode(req);
     EXPECT_GE(req.addr, min_addr);
     EXPECT_LE(req.addr, max_addr);
@@ -253,6 +257,50 @@ TEST_F(RackmonTest, BasicScanFoundOneMon) {
   EXPECT_EQ(data[0].registerList[0].history.size(), 1);
   EXPECT_EQ(data[0].registerList[0].history[0].type, RegisterValueType::STRING);
   EXPECT_EQ(
-      data[0].registerList[0].history[0].value.strValue, "abcdefghijklmnop");
+      std::get<std::string>(data[0].registerList[0].history[0].value),
+      "abcdefghijklmnop");
   EXPECT_NEAR(data[0].registerList[0].history[0].timestamp, std::time(0), 10);
+  // Each interface reports its monitor cycle time.
+  std::string profile = mon.getProfileData();
+  EXPECT_NE(profile.find("MONITOR "), std::string::npos);
+  EXPECT_NE(profile.find("cycles: "), std::string::npos);
+}
+
+TEST_F(RackmonTest, ParallelScanInterfaces) {
+  std::string rconf_s = R"({
+    "interfaces": [
+      {
+        "device_path": "/tmp/blah",
+        "baudrate": 19200
+      },
+      {
+        "device_path": "/tmp/blah",
+        "baudrate": 19200
+      }
+    ]
+  })";
+  std::ofstream ofs(r_conf);
+  ofs << rconf_s;
+  ofs.close();
+  MockRackmon mon;
+  // Each interface has one device. Both are expected to be found
+  // by the scan of their own interface. An address found on one
+  // interface may or may not be skipped by the scan of the other.
+  EXPECT_CALL(mon, makeInterface())
+      .Times(2)
+      .WillOnce(Return(ByMove(make_modbus(160, 2))))
+      .WillOnce(Return(ByMove(make_modbus(162, 2))));
+  mon.load(r_conf, r_test_dir);
+  mon.start();
+  std::this_thread::sleep_for(1s);
+  std::vector<ModbusDeviceInfo> devs = mon.listDevices();
+  mon.stop();
+  ASSERT_EQ(devs.size(), 2);
+  EXPECT_EQ(devs[0].deviceAddress, 160);
+  EXPECT_EQ(devs[1].deviceAddress, 162);
+  // Each interface reports its scan time.
+  std::string profile = mon.getProfileData();
+  EXPECT_NE(profile.find("SCAN "), std::string::npos);
+  EXPECT_NE(profile.find("probes/step: "), std::string::npos);
+  EXPECT_NE(profile.find("backoff: "), std::string::npos);
 }
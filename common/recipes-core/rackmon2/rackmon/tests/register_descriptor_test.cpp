@@ -22,6 +22,28 @@ TEST(RegisterDescriptorTest, JSONConversionDefaults) {
   EXPECT_EQ(d.keep, 1);
   EXPECT_EQ(d.storeChangesOnly, false);
   EXPECT_EQ(d.format, RegisterValueType::HEX);
+  EXPECT_EQ(d.period, 0);
+  EXPECT_EQ(d.priority, 0);
+}
+
+TEST(RegisterDescriptorTest, JSONConversionSchedule) {
+  nlohmann::json desc = nlohmann::json::parse(R"({
+    "begin": 0,
+    "length": 8,
+    "name": "MFG_MODEL",
+    "period": 10,
+    "priority": 2
+  })");
+  RegisterDescriptor d = desc;
+  EXPECT_EQ(d.period, 10);
+  EXPECT_EQ(d.priority, 2);
+
+  desc["period"] = -1;
+  d = desc;
+  EXPECT_EQ(d.period, -1);
+
+  desc["period"] = -2;
+  EXPECT_THROW(d = desc, std::out_of_range);
 }
 
 TEST(RegisterDescriptorTest, JSONConversionEnforceMandatory) {
@@ -95,6 +117,21 @@ TEST(RegisterDescriptorTest, JSONConversionFixed) {
   EXPECT_EQ(d.storeChangesOnly, false);
   EXPECT_EQ(d.format, RegisterValueType::FLOAT);
   EXPECT_EQ(d.precision, 6);
+  EXPECT_EQ(d.sign, false);
+}
+
+TEST(RegisterDescriptorTest, JSONConversionSigned) {
+  nlohmann::json desc = nlohmann::json::parse(R"({
+    "begin": 127,
+    "length": 1,
+    "format": "float",
+    "precision": 6,
+    "sign": true,
+    "name": "Battery Current"
+  })");
+  RegisterDescriptor d = desc;
+  EXPECT_EQ(d.format, RegisterValueType::FLOAT);
+  EXPECT_EQ(d.sign, true);
 }
 
 TEST(RegisterDescriptorTest, JSONConversionFixedMissingPrec) {
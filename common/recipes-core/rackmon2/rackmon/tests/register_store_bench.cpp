@@ -0,0 +1,210 @@
+// Measures the cost of ModbusDevice::getValueData() on a device with
+// a full register history: The number of heap allocations and the
+// latency of each call.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include "modbus_device.hpp"
+
+using nlohmann::json;
+
+constexpr int kIterations = 1000;
+
+static std::atomic<size_t> numAllocations{0};
+
+// Every allocation and deallocation function of the program is replaced,
+// so that all the news and deletes match. They go through these two, kept
+// out of line so the compiler does not pair a free() with a new.
+__attribute__((noinline)) static void* countedAlloc(
+    size_t size,
+    size_t align = alignof(std::max_align_t)) {
+  numAllocations++;
+  size = std::max<size_t>(size, 1);
+  void* ptr = align <= alignof(std::max_align_t)
+      ? std::malloc(size)
+      : std::aligned_alloc(align, (size + align - 1) / align * align);
+  return ptr;
+}
+
+__attribute__((noinline)) static void countedFree(void* ptr) {
+  std::free(ptr);
+}
+
+void* operator new(size_t size) {
+  if (void* ptr = countedAlloc(size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+  if (void* ptr = countedAlloc(size, size_t(align)))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+  return operator new(size, align);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return countedAlloc(size);
+}
+
+void* operator new(
+    size_t size,
+    std::align_val_t align,
+    const std::nothrow_t&) noexcept {
+  return countedAlloc(size, size_t(align));
+}
+
+void* operator new[](
+    size_t size,
+    std::align_val_t align,
+    const std::nothrow_t&) noexcept {
+  return countedAlloc(size, size_t(align));
+}
+
+void operator delete(void* ptr) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete(
+    void* ptr,
+    std::align_val_t,
+    const std::nothrow_t&) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](
+    void* ptr,
+    std::align_val_t,
+    const std::nothrow_t&) noexcept {
+  countedFree(ptr);
+}
+
+// Answers every read with a pattern which changes on every read.
+class FakeModbus : public Modbus {
+  uint16_t seq_ = 0;
+
+ public:
+  FakeModbus() : Modbus(std::cerr) {}
+  void command(Msg& req, Msg& resp, uint32_t, ModbusTime, ModbusTime)
+      override {
+    Encoder::encode(req);
+    uint16_t count = (uint16_t(req.raw[4]) << 8) | req.raw[5];
+    Msg msg;
+    msg << req.addr << uint8_t(0x03) << uint8_t(count * 2);
+    for (uint16_t i = 0; i < count; i++)
+      msg << uint16_t(0x4142 + seq_ + i);
+    seq_++;
+    Encoder::finalize(msg);
+    resp = msg;
+    Encoder::decode(resp);
+  }
+};
+
+static RegisterMap makeRegmap() {
+  // Roughly the shape of an ORv2 PSU register map.
+  json j = R"({
+    "name": "bench",
+    "address_range": [160, 191],
+    "probe_register": 0,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": [
+      {"begin": 0, "length": 8, "format": "string", "name": "MFG_MODEL"},
+      {"begin": 16, "length": 8, "format": "string", "name": "MFG_DATE"},
+      {"begin": 104, "length": 1, "keep": 10, "name": "PSU_Status",
+       "format": "flags",
+       "flags": [[0, "Fail"], [1, "Over Voltage Fault"],
+                 [2, "Over Current Fault"], [3, "Over Temperature Fault"]]},
+      {"begin": 128, "length": 1, "keep": 10, "format": "float",
+       "precision": 6, "name": "Input_VAC"},
+      {"begin": 130, "length": 1, "keep": 10, "format": "float",
+       "precision": 6, "name": "Input_Current_AC"},
+      {"begin": 138, "length": 2, "keep": 10, "format": "integer",
+       "name": "Fan_Speed"},
+      {"begin": 140, "length": 1, "keep": 10, "format": "float",
+       "precision": 6, "name": "Output_Voltage"},
+      {"begin": 150, "length": 2, "keep": 10, "name": "Energy_Counter"}
+    ]
+  })"_json;
+  return j;
+}
+
+int main() {
+  FakeModbus modbus;
+  RegisterMap rmap = makeRegmap();
+  ModbusDevice dev(modbus, 0xa0, rmap);
+  // Fill up the history.
+  for (int i = 0; i < 10; i++)
+    dev.monitor();
+
+  size_t readings = 0;
+  ModbusDeviceValueData data = dev.getValueData();
+  for (const auto& reg : data.registerList)
+    readings += reg.history.size();
+
+  numAllocations = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; i++)
+    data = dev.getValueData();
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start);
+
+  std::cout << "getValueData(): " << data.registerList.size()
+            << " registers, " << readings << " readings" << std::endl;
+  std::cout << "  allocations/call: " << numAllocations / kIterations
+            << std::endl;
+  std::cout << "  latency/call: " << elapsed.count() / kIterations / 1000.0
+            << " us" << std::endl;
+  return 0;
+}
@@ -5,16 +5,20 @@
 using namespace std;
 using namespace testing;
 
+static std::vector<uint16_t> words(const Register& reg) {
+  return std::vector<uint16_t>(reg.value, reg.value + reg.desc.length);
+}
+
 TEST(RegisterTest, BasicCreationCompare) {
   RegisterDescriptor desc{
       0, 2, "HELLO", 1, false, RegisterValueType::STRING, 0};
-  Register reg(desc);
+  // Set to some known value.
+  std::vector<uint16_t> value{0x3730, 0x302d};
+  Register reg(desc, 0, value.data());
 
   EXPECT_EQ(reg.timestamp, 0);
   EXPECT_EQ(false, reg);
-  EXPECT_EQ(reg.value.size(), 2);
-  // Set to some known value.
-  reg.value = {0x3730, 0x302d};
+  EXPECT_EQ(words(reg).size(), 2);
   reg.timestamp = 0x12345678;
   // bool test should now succeed.
   EXPECT_EQ(true, reg);
@@ -22,14 +26,14 @@ TEST(RegisterTest, BasicCreationCompare) {
   // Conversion to RegisterValue
   RegisterValue sval = reg;
   EXPECT_EQ(sval.type, RegisterValueType::STRING);
-  EXPECT_EQ(sval.value.strValue, "700-");
+  EXPECT_EQ(std::get<std::string>(sval.value), "700-");
 
   // Conversion to string.
   std::string strval = reg;
   EXPECT_EQ(strval, "700-");
 
-  Register reg2(desc);
-  reg2.value = {0x3730, 0x302d};
+  std::vector<uint16_t> value2{0x3730, 0x302d};
+  Register reg2(desc, 0, value2.data());
   // Even though the regs have same value, since one is not valid,
   // equality should not succeed.
   EXPECT_NE(reg, reg2);
@@ -39,7 +43,7 @@ TEST(RegisterTest, BasicCreationCompare) {
   EXPECT_EQ(reg, reg2);
 
   // Inequality tests.
-  reg2.value[1] = 0x3030;
+  value2[1] = 0x3030;
   EXPECT_NE(reg, reg2);
   EXPECT_EQ(reg != reg2, true);
   EXPECT_EQ(reg == reg2, false);
@@ -48,14 +52,9 @@ TEST(RegisterTest, BasicCreationCompare) {
 TEST(RegisterTest, JSONTest) {
   RegisterDescriptor desc{
       0, 2, "HELLO", 1, false, RegisterValueType::STRING, 0};
-  Register reg(desc);
-
-  EXPECT_EQ(reg.timestamp, 0);
-  EXPECT_EQ(false, reg);
-  EXPECT_EQ(reg.value.size(), 2);
   // Set to some known value.
-  reg.value = {0x3730, 0x302d};
-  reg.timestamp = 0x12345678;
+  std::vector<uint16_t> value{0x3730, 0x302d};
+  Register reg(desc, 0x12345678, value.data());
   nlohmann::json j = reg;
   EXPECT_EQ(j.is_object(), true);
   EXPECT_EQ(j.size(), 2);
@@ -69,19 +68,20 @@ TEST(RegisterStoreTest, BasicOperation) {
   RegisterStore reg(desc);
   for (uint16_t i = 0; i < 5; i++) {
     EXPECT_EQ(reg.front(), false);
-    reg.front().value = {0x0001, i};
-    reg.front().timestamp = i + 1;
+    reg.setFront({0x0001, i}, i + 1);
     ++reg;
   }
   for (uint16_t i = 0; i < 5; i++) {
     EXPECT_EQ(reg.front(), true);
-    EXPECT_EQ(reg.front().value, std::vector<uint16_t>({0x0001, i}));
+    EXPECT_EQ(words(reg.front()), std::vector<uint16_t>({0x0001, i}));
     EXPECT_EQ(reg.front().timestamp, i + 1);
     ++reg;
     EXPECT_EQ(reg.back(), true);
-    EXPECT_EQ(reg.back().value, std::vector<uint16_t>({0x0001, i}));
+    EXPECT_EQ(words(reg.back()), std::vector<uint16_t>({0x0001, i}));
     EXPECT_EQ(reg.back().timestamp, i + 1);
   }
+  // Writes need to match the register length.
+  EXPECT_THROW(reg.setFront({0x0001}, 1), std::out_of_range);
 }
 
 TEST(RegisterStoreTest, DataRetrievalConversions) {
@@ -96,8 +96,7 @@ TEST(RegisterStoreTest, DataRetrievalConversions) {
   EXPECT_EQ(val.name, "HELLO");
   EXPECT_EQ(val.history.size(), 0);
 
-  reg.front().value = std::vector<uint16_t>({0x3031, 0x3233}); // "0123"
-  reg.front().timestamp = 0x1234;
+  reg.setFront({0x3031, 0x3233}, 0x1234); // "0123"
   ++reg;
   str = reg;
   val = reg;
@@ -106,10 +105,9 @@ TEST(RegisterStoreTest, DataRetrievalConversions) {
   EXPECT_EQ(val.name, "HELLO");
   EXPECT_EQ(val.history.size(), 1);
   EXPECT_EQ(val.history[0].type, RegisterValueType::STRING);
-  EXPECT_EQ(val.history[0].value.strValue, "0123");
+  EXPECT_EQ(std::get<std::string>(val.history[0].value), "0123");
 
-  reg.front().value = std::vector<uint16_t>({0x3132, 0x3334}); // "1234"
-  reg.front().timestamp = 0x1234;
+  reg.setFront({0x3132, 0x3334}, 0x1234); // "1234"
   ++reg;
   str = reg;
   val = reg;
@@ -118,9 +116,9 @@ TEST(RegisterStoreTest, DataRetrievalConversions) {
   EXPECT_EQ(val.name, "HELLO");
   EXPECT_EQ(val.history.size(), 2);
   EXPECT_EQ(val.history[0].type, RegisterValueType::STRING);
-  EXPECT_EQ(val.history[0].value.strValue, "0123");
+  EXPECT_EQ(std::get<std::string>(val.history[0].value), "0123");
   EXPECT_EQ(val.history[1].type, RegisterValueType::STRING);
-  EXPECT_EQ(val.history[1].value.strValue, "1234");
+  EXPECT_EQ(std::get<std::string>(val.history[1].value), "1234");
 
   nlohmann::json j = val;
   EXPECT_TRUE(j.contains("regAddress") && j["regAddress"].is_number_integer());
@@ -9,7 +9,7 @@ TEST(RegisterValueTest, Hex) {
   RegisterValue val({1, 2});
   std::vector<uint8_t> exp{0x00, 0x01, 0x00, 0x02};
   EXPECT_EQ(val.type, RegisterValueType::HEX);
-  EXPECT_EQ(val.value.hexValue, exp);
+  EXPECT_EQ(std::get<std::vector<uint8_t>>(val.value), exp);
   std::string strval = "00010002";
   std::string actual = val;
   EXPECT_EQ(actual, strval);
@@ -33,7 +33,7 @@ TEST(RegisterValueTest, STRING) {
       d,
       0x12345678);
   EXPECT_EQ(val.type, RegisterValueType::STRING);
-  EXPECT_EQ(val.value.strValue, "700-014671-0000 ");
+  EXPECT_EQ(std::get<std::string>(val.value), "700-014671-0000 ");
   std::string actual = val;
   EXPECT_EQ(actual, "700-014671-0000 ");
   EXPECT_EQ(val.timestamp, 0x12345678);
@@ -53,7 +53,7 @@ TEST(RegisterValueTest, INTEGER) {
   d.format = RegisterValueType::INTEGER;
   RegisterValue val({0x1234, 0x5678}, d, 0x12345678);
   EXPECT_EQ(val.type, RegisterValueType::INTEGER);
-  EXPECT_EQ(val.value.intValue, 0x12345678);
+  EXPECT_EQ(std::get<int32_t>(val.value), 0x12345678);
   std::string actual = val;
   EXPECT_EQ(actual, "305419896");
 
@@ -68,13 +68,29 @@ TEST(RegisterValueTest, INTEGER) {
   EXPECT_EQ(j["value"], 305419896);
 }
 
+TEST(RegisterValueTest, SignedINTEGER) {
+  RegisterDescriptor d;
+  d.format = RegisterValueType::INTEGER;
+  RegisterValue uval({0xfffe}, d, 0);
+  EXPECT_EQ(std::get<int32_t>(uval.value), 0xfffe);
+  d.sign = true;
+  RegisterValue sval({0xfffe}, d, 0);
+  EXPECT_EQ(std::get<int32_t>(sval.value), -2);
+  std::string str = sval;
+  EXPECT_EQ(str, "-2");
+  d.format = RegisterValueType::FLOAT;
+  d.precision = 1;
+  RegisterValue fval({0xfffd}, d, 0);
+  EXPECT_NEAR(std::get<float>(fval.value), -1.5, 0.001);
+}
+
 TEST(RegisterValueTest, FLOAT) {
   RegisterDescriptor d;
   d.format = RegisterValueType::FLOAT;
   d.precision = 11;
   RegisterValue val({0x64fc}, d, 0x12345678);
   EXPECT_EQ(val.type, RegisterValueType::FLOAT);
-  EXPECT_NEAR(val.value.floatValue, 12.623, 0.001);
+  EXPECT_NEAR(std::get<float>(val.value), 12.623, 0.001);
   std::string str = val;
   EXPECT_EQ(str, "12.62");
 
@@ -98,7 +114,7 @@ TEST(RegisterValueTest, FLAGS) {
   std::string actstr1 = val1;
   EXPECT_EQ(expstr1, actstr1);
   RegisterValue::FlagsType exp1 = {{true, "HELLO"}, {true, "WORLD"}};
-  EXPECT_EQ(val1.value.flagsValue, exp1);
+  EXPECT_EQ(std::get<RegisterValue::FlagsType>(val1.value), exp1);
 
   RegisterValue val2({0x0000}, d, 0x12345678);
   EXPECT_EQ(val1.type, RegisterValueType::FLAGS);
@@ -106,7 +122,7 @@ TEST(RegisterValueTest, FLAGS) {
   std::string actstr2 = val2;
   EXPECT_EQ(expstr2, actstr2);
   RegisterValue::FlagsType exp2 = {{false, "HELLO"}, {false, "WORLD"}};
-  EXPECT_EQ(val2.value.flagsValue, exp2);
+  EXPECT_EQ(std::get<RegisterValue::FlagsType>(val2.value), exp2);
 
   RegisterValue val3({0x0002}, d, 0x12345678);
   EXPECT_EQ(val3.type, RegisterValueType::FLAGS);
@@ -114,7 +130,7 @@ TEST(RegisterValueTest, FLAGS) {
   std::string actstr3 = val3;
   EXPECT_EQ(expstr3, actstr3);
   RegisterValue::FlagsType exp3 = {{false, "HELLO"}, {true, "WORLD"}};
-  EXPECT_EQ(val3.value.flagsValue, exp3);
+  EXPECT_EQ(std::get<RegisterValue::FlagsType>(val3.value), exp3);
 
   nlohmann::json j = val3;
   EXPECT_TRUE(j.is_object());
@@ -147,13 +163,15 @@ TEST(RegisterValueTest, CopyMoveTest) {
       0x12345678);
   RegisterValue val2(val);
   EXPECT_EQ(val2.type, RegisterValueType::STRING);
-  EXPECT_EQ(val2.value.strValue, val.value.strValue);
+  EXPECT_EQ(
+      std::get<std::string>(val2.value), std::get<std::string>(val.value));
   RegisterValue val3(std::move(val2));
   EXPECT_EQ(val3.type, RegisterValueType::STRING);
-  EXPECT_EQ(val3.value.strValue, val.value.strValue);
+  EXPECT_EQ(
+      std::get<std::string>(val3.value), std::get<std::string>(val.value));
   // Ensure we are moving from 2 and not just copying.
   // XXX move symantics technically allows only destructor and a copy from a
   // moved object, but it supposedly leaves it in a semi-valid state, so
   // checking length for 0 seems a decent option.
-  EXPECT_EQ(val2.value.strValue.length(), 0);
+  EXPECT_EQ(std::get<std::string>(val2.value).length(), 0);
 }
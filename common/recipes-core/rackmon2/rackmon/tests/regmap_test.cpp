@@ -59,6 +59,7 @@ TEST(RegisterMapTest, JSONCoversion) {
   EXPECT_EQ(rmap.probeRegister, 104);
   EXPECT_EQ(rmap.defaultBaudrate, 19200);
   EXPECT_EQ(rmap.preferredBaudrate, 19200);
+  EXPECT_EQ(rmap.maxReadGap, RegisterMap::kDefaultMaxReadGap);
   EXPECT_EQ(rmap.name, "orv2_psu");
   EXPECT_EQ(rmap.registerDescriptors.size(), 2);
   EXPECT_EQ(rmap.specialHandlers.size(), 0);
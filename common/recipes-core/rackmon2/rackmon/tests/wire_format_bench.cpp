@@ -0,0 +1,119 @@
+// Compares the JSON text and CBOR wire formats used for raw_data
+// and value_data responses. Reports bytes on the wire and the CPU
+// time taken to build a response for a fully populated rack.
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include "cbor.hpp"
+#include "regmap.hpp"
+
+using nlohmann::json;
+
+constexpr int kNumDevices = 128;
+constexpr int kIterations = 20;
+
+static RegisterMap makeRegmap() {
+  // Roughly the shape of an ORv2 PSU register map.
+  json j = R"({
+    "name": "bench",
+    "address_range": [160, 191],
+    "probe_register": 0,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": [
+      {"begin": 0, "length": 8, "format": "string", "name": "MFG_MODEL"},
+      {"begin": 16, "length": 8, "format": "string", "name": "MFG_DATE"},
+      {"begin": 104, "length": 1, "keep": 10, "name": "PSU_Status",
+       "format": "flags",
+       "flags": [[0, "Fail"], [1, "OV"], [2, "OC"], [3, "OT"]]},
+      {"begin": 128, "length": 1, "keep": 10, "format": "float",
+       "precision": 6, "name": "Input_VAC"},
+      {"begin": 130, "length": 1, "keep": 10, "format": "float",
+       "precision": 6, "name": "Input_Current_AC"},
+      {"begin": 138, "length": 2, "keep": 10, "format": "integer",
+       "name": "Fan_Speed"},
+      {"begin": 140, "length": 1, "keep": 10, "format": "float",
+       "precision": 6, "name": "Output_Voltage"},
+      {"begin": 150, "length": 2, "keep": 10, "name": "Energy"}
+    ]
+  })"_json;
+  return j;
+}
+
+static std::vector<RegisterStore> makeStores(const RegisterMap& rmap) {
+  std::vector<RegisterStore> stores;
+  for (const auto& [addr, desc] : rmap.registerDescriptors) {
+    RegisterStore store(desc);
+    std::vector<uint16_t> value(desc.length);
+    for (uint16_t i = 0; i < desc.keep; i++) {
+      for (size_t w = 0; w < value.size(); w++)
+        value[w] = 0x4142 + i + w;
+      store.setFront(value, 0x60000000 + i);
+      ++store;
+    }
+    stores.push_back(store);
+  }
+  return stores;
+}
+
+template <typename Func>
+static void run(const char* name, Func&& fn) {
+  size_t bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; i++)
+    bytes = fn();
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  std::cout << std::left << std::setw(16) << name << std::right
+            << std::setw(10) << bytes << " bytes" << std::setw(10)
+            << elapsed.count() / kIterations << " us" << std::endl;
+}
+
+int main() {
+  RegisterMap rmap = makeRegmap();
+  std::vector<RegisterStore> stores = makeStores(rmap);
+
+  std::cout << kNumDevices << " devices, " << stores.size()
+            << " registers each" << std::endl;
+  run("raw json", [&]() {
+    json j = json::array();
+    for (int i = 0; i < kNumDevices; i++)
+      j.push_back({{"addr", i}, {"ranges", stores}});
+    return j.dump().size();
+  });
+  run("raw cbor", [&]() {
+    std::vector<uint8_t> buf;
+    CborEncoder e(buf);
+    e.array(kNumDevices);
+    for (int i = 0; i < kNumDevices; i++) {
+      e.map(2) << "addr" << i << "ranges";
+      e.array(stores.size());
+      for (const auto& store : stores)
+        to_cbor(e, store);
+    }
+    return buf.size();
+  });
+  run("value json", [&]() {
+    json j = json::array();
+    for (int i = 0; i < kNumDevices; i++) {
+      std::vector<RegisterStoreValue> values;
+      for (const auto& store : stores)
+        values.emplace_back(store);
+      j.push_back({{"deviceAddress", i}, {"registers", values}});
+    }
+    return j.dump().size();
+  });
+  run("value cbor", [&]() {
+    std::vector<uint8_t> buf;
+    CborEncoder e(buf);
+    e.array(kNumDevices);
+    for (int i = 0; i < kNumDevices; i++) {
+      e.map(2) << "deviceAddress" << i << "registers";
+      e.array(stores.size());
+      for (const auto& store : stores)
+        store.encodeValue(e);
+    }
+    return buf.size();
+  });
+  return 0;
+}
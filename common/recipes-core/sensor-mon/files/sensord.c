@@ -28,6 +28,7 @@
 #include <math.h>
 #include <string.h>
 #include <pthread.h>
+#include <time.h>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <openbmc/ipmi.h>
@@ -41,6 +42,8 @@
 #define STOP_PERIOD 10
 #define MAX_SENSOR_CHECK_RETRY 3
 #define MAX_ASSERT_CHECK_RETRY 1
+#define MAX_PATH_READS 8
+#define PAUSE_RETRY_MS 500
 #ifdef CONFIG_FBY3_CWC
 #define MAX_SENSORD_FRU MAX_NUM_FRUS+MAX_NUM_EXPS
 #define IDX_TO_NB(f) (f-MAX_NUM_FRUS+FRU_EXP_BASE)
@@ -52,6 +55,49 @@
 static thresh_sensor_t g_snr[MAX_SENSORD_FRU][MAX_SENSOR_NUM + 1] = {0};
 static thresh_sensor_t g_aggregate_snr[MAX_SENSOR_NUM + 1] = {0};
 
+/*
+ * The sensors are grouped by their access path, see
+ * pal_get_sensor_access_path(). Each path has its own reader threads,
+ * which read the sensor due the earliest, at most max_reads of them at
+ * a time. A read due at some time has to be done by the time the next
+ * one is due, the sensors missing that deadline are logged.
+ */
+typedef struct {
+  uint8_t fru;
+  uint8_t snr_num;
+  bool discrete;
+  bool busy;
+  uint8_t read_fail;
+  uint32_t missed;
+  int64_t due;
+  int64_t deadline;
+} sched_snr_t;
+
+typedef struct sched_path {
+  uint32_t path;
+  uint8_t max_reads;
+  int reading;
+  int cnt;
+  sched_snr_t **snrs;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  struct sched_path *next;
+} sched_path_t;
+
+/* snr_monitor() pauses the reads of its FRU to update its thresholds */
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t idle;
+  int reading;
+  bool paused;
+} sched_fru_t;
+
+static sched_snr_t g_sched_snr[MAX_SENSORD_FRU][MAX_SENSOR_NUM + 1];
+static sched_fru_t g_sched_fru[MAX_SENSORD_FRU];
+static sched_path_t *g_sched_paths = NULL;
+static pthread_mutex_t g_sched_paths_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_condattr_t g_sched_condattr;
+
 static void
 print_usage() {
     printf("Usage: sensord <options>\n");
@@ -131,14 +177,18 @@ init_fru_snr_thresh(uint8_t fru) {
     return ret;
   }
 
-  for (i = 0; i < sensor_cnt; i++) {
-    snr_num = sensor_list[i];
-
-    ret = sdr_get_snr_thresh(fruNb, snr_num, &snr[snr_num]);
-    if (ret < 0) {
+  // The SDR of the FRU is loaded once for all its sensors.
+  ret = sdr_get_fru_thresholds(fruNb, snr);
+  if (ret < 0) {
 #ifdef DEBUG
-      syslog(LOG_WARNING, "init_fru_snr_thresh: sdr_get_snr_thresh for FRU: %d", fru);
+    syslog(LOG_WARNING, "init_fru_snr_thresh: sdr_get_fru_thresholds for FRU: %d", fru);
 #endif /* DEBUG */
+  }
+
+  for (i = 0; i < sensor_cnt && ret >= 0; i++) {
+    snr_num = sensor_list[i];
+
+    if (!(snr[snr_num].flag & GETMASK(SENSOR_VALID))) {
       continue;
     }
     pal_alter_sensor_poll_interval(fruNb, snr_num, &(snr[snr_num].poll_interval));
@@ -440,6 +490,286 @@ check_thresh_assert(uint8_t fru, uint8_t snr_num, uint8_t thresh,
   return 0;
 }
 
+static int64_t
+now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int64_t
+snr_interval_ms(thresh_sensor_t *snr) {
+  uint32_t interval = snr->poll_interval;
+
+  if (interval < MIN_POLL_INTERVAL)
+    interval = MIN_POLL_INTERVAL;
+  return (int64_t)interval * 1000;
+}
+
+static void
+sched_wait(sched_path_t *p, int64_t until) {
+  struct timespec ts;
+
+  ts.tv_sec = until / 1000;
+  ts.tv_nsec = (until % 1000) * 1000000;
+  pthread_cond_timedwait(&p->cond, &p->lock, &ts);
+}
+
+/* Stops the reads of the FRU, once the ones in flight are done */
+static void
+sched_pause_fru(uint8_t fru) {
+  sched_fru_t *f = &g_sched_fru[fru-1];
+
+  pthread_mutex_lock(&f->lock);
+  f->paused = true;
+  while (f->reading > 0)
+    pthread_cond_wait(&f->idle, &f->lock);
+  pthread_mutex_unlock(&f->lock);
+}
+
+static void
+sched_resume_fru(uint8_t fru) {
+  sched_fru_t *f = &g_sched_fru[fru-1];
+
+  pthread_mutex_lock(&f->lock);
+  f->paused = false;
+  pthread_mutex_unlock(&f->lock);
+}
+
+/*
+ * Reads a sensor and checks its thresholds, or its state for discrete
+ * sensors. Returns false if it was not read, because it is disabled or
+ * its FRU is paused.
+ */
+static bool
+sched_read_snr(sched_snr_t *s, bool *paused) {
+  uint8_t fru = s->fru;
+  uint8_t snr_num = s->snr_num;
+  sched_fru_t *f = &g_sched_fru[fru-1];
+  thresh_sensor_t *snr = get_struct_thresh_sensor(fru);
+  float curr_val = 0;
+#ifdef CONFIG_FBY3_CWC
+  uint8_t fruNb = fru >= MAX_NUM_FRUS ? IDX_TO_NB(fru) : fru;
+#else
+  uint8_t fruNb = fru;
+#endif
+
+  pthread_mutex_lock(&f->lock);
+  *paused = f->paused;
+  if (!f->paused)
+    f->reading++;
+  pthread_mutex_unlock(&f->lock);
+  if (*paused)
+    return false;
+
+  if (s->discrete) {
+    if (!sensor_raw_read_helper(fruNb, snr_num, &curr_val) &&
+        (snr[snr_num].curr_state != (int) curr_val)) {
+      pal_sensor_discrete_check(fru, snr_num, snr[snr_num].name,
+          snr[snr_num].curr_state, (int) curr_val);
+      snr[snr_num].curr_state = (int) curr_val;
+    }
+  } else if (snr[snr_num].flag) {
+    if (!sensor_raw_read_helper(fruNb, snr_num, &curr_val)) {
+      sensor_fail_assert_clear(&s->read_fail, fru, snr_num, snr[snr_num].name);
+      check_thresh_assert(fru, snr_num, UNC_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, UCR_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, UNR_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, LNC_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, LCR_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, LNR_THRESH, &curr_val);
+
+      check_thresh_deassert(fru, snr_num, UNR_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, UCR_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, UNC_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, LNR_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, LCR_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, LNC_THRESH, &curr_val);
+    } else {
+      sensor_fail_assert_check(&s->read_fail, fru, snr_num, snr[snr_num].name);
+    } /* pal_sensor_read return check */
+  }
+
+  pthread_mutex_lock(&f->lock);
+  if (--f->reading == 0)
+    pthread_cond_signal(&f->idle);
+  pthread_mutex_unlock(&f->lock);
+  return s->discrete || snr[snr_num].flag != 0;
+}
+
+/* Sets when the sensor is read next, and logs the missed deadlines */
+static void
+sched_next(sched_snr_t *s, bool read, bool paused) {
+  thresh_sensor_t *snr = get_struct_thresh_sensor(s->fru);
+  int64_t interval = snr_interval_ms(&snr[s->snr_num]);
+  int64_t now = now_ms();
+
+  if (paused) {
+    // The time the FRU is paused does not count
+    s->due = now + PAUSE_RETRY_MS;
+    s->deadline = s->due + interval;
+    return;
+  }
+
+  if (read && now > s->deadline) {
+    if (s->missed++ == 0) {
+      syslog(LOG_WARNING, "FRU: %d, num: 0x%X, snr:%-16s, read missed its deadline by %lldms",
+          s->fru, s->snr_num, snr[s->snr_num].name, (long long)(now - s->deadline));
+    }
+  } else if (read && s->missed) {
+    syslog(LOG_INFO, "FRU: %d, num: 0x%X, snr:%-16s, read back on schedule after %u missed deadlines",
+        s->fru, s->snr_num, snr[s->snr_num].name, s->missed);
+    s->missed = 0;
+  }
+
+  // Reads late are not caught up on, and a sensor is never read again
+  // within MIN_POLL_INTERVAL, as with the sleep of the FRU loop. A path
+  // slower than its intervals does not read back to back.
+  s->due = now + MIN_POLL_INTERVAL * 1000;
+  if (s->deadline > s->due)
+    s->due = s->deadline;
+  s->deadline = s->due + interval;
+}
+
+/* Reads the sensors of a path, the one due the earliest first */
+static void *
+snr_path_reader(void *arg) {
+  sched_path_t *p = (sched_path_t *)arg;
+  sched_snr_t *s;
+  bool read, paused;
+  int64_t now;
+  int i;
+
+  pthread_mutex_lock(&p->lock);
+  while (1) {
+    s = NULL;
+    if (p->reading < p->max_reads) {
+      for (i = 0; i < p->cnt; i++) {
+        if (!p->snrs[i]->busy && (s == NULL || p->snrs[i]->due < s->due))
+          s = p->snrs[i];
+      }
+    }
+    now = now_ms();
+    if (s == NULL || s->due > now) {
+      sched_wait(p, s ? s->due : now + STOP_PERIOD * 1000);
+      continue;
+    }
+
+    s->busy = true;
+    p->reading++;
+    pthread_mutex_unlock(&p->lock);
+    read = sched_read_snr(s, &paused);
+    pthread_mutex_lock(&p->lock);
+    p->reading--;
+    s->busy = false;
+    sched_next(s, read, paused);
+    pthread_cond_broadcast(&p->cond);
+  }
+  return NULL;
+}
+
+/* Finds the path, or adds it with its reader threads */
+static sched_path_t *
+sched_get_path(uint32_t path, uint8_t max_reads) {
+  sched_path_t *p;
+  pthread_t tid;
+  int i;
+
+  if (max_reads < 1)
+    max_reads = 1;
+  if (max_reads > MAX_PATH_READS)
+    max_reads = MAX_PATH_READS;
+
+  pthread_mutex_lock(&g_sched_paths_lock);
+  for (p = g_sched_paths; p != NULL; p = p->next) {
+    if (p->path == path)
+      break;
+  }
+  if (p != NULL) {
+    // Read no more at a time than any of its sensors allows
+    pthread_mutex_lock(&p->lock);
+    if (max_reads < p->max_reads)
+      p->max_reads = max_reads;
+    pthread_mutex_unlock(&p->lock);
+    pthread_mutex_unlock(&g_sched_paths_lock);
+    return p;
+  }
+
+  p = calloc(1, sizeof(*p));
+  if (p == NULL) {
+    pthread_mutex_unlock(&g_sched_paths_lock);
+    return NULL;
+  }
+  p->path = path;
+  p->max_reads = max_reads;
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->cond, &g_sched_condattr);
+  for (i = 0; i < max_reads; i++) {
+    if (pthread_create(&tid, NULL, snr_path_reader, p) != 0) {
+      syslog(LOG_WARNING, "pthread_create for sensor path 0x%X failed\n", path);
+      if (i == 0) {
+        free(p);
+        pthread_mutex_unlock(&g_sched_paths_lock);
+        return NULL;
+      }
+      p->max_reads = i;
+      break;
+    }
+    pthread_detach(tid);
+  }
+  p->next = g_sched_paths;
+  g_sched_paths = p;
+  pthread_mutex_unlock(&g_sched_paths_lock);
+  return p;
+}
+
+/* Hands the sensors of the FRU to the readers of their paths */
+static int
+sched_add_snrs(uint8_t fru, uint8_t *sensor_list, int sensor_cnt, bool discrete) {
+  sched_snr_t *s, **snrs;
+  sched_path_t *p;
+  uint32_t path;
+  uint8_t max_reads;
+  int i;
+#ifdef CONFIG_FBY3_CWC
+  uint8_t fruNb = fru >= MAX_NUM_FRUS ? IDX_TO_NB(fru) : fru;
+#else
+  uint8_t fruNb = fru;
+#endif
+
+  for (i = 0; i < sensor_cnt; i++) {
+    s = &g_sched_snr[fru-1][sensor_list[i]];
+    if (s->fru != 0)
+      continue;
+    s->fru = fru;
+    s->snr_num = sensor_list[i];
+    s->discrete = discrete;
+    s->due = now_ms();
+    s->deadline = s->due + snr_interval_ms(&get_struct_thresh_sensor(fru)[s->snr_num]);
+
+    if (pal_get_sensor_access_path(fruNb, s->snr_num, &path, &max_reads) != 0) {
+      path = SENSOR_PATH(SENSOR_PATH_FRU, fru);
+      max_reads = 1;
+    }
+    p = sched_get_path(path, max_reads);
+    if (p == NULL)
+      return -1;
+
+    pthread_mutex_lock(&p->lock);
+    snrs = realloc(p->snrs, (p->cnt + 1) * sizeof(*snrs));
+    if (snrs == NULL) {
+      pthread_mutex_unlock(&p->lock);
+      return -1;
+    }
+    snrs[p->cnt++] = s;
+    p->snrs = snrs;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+  }
+  return 0;
+}
+
 static int
 reinit_snr_threshold(uint8_t fru, int mode) {
   int ret = 0;
@@ -456,7 +786,9 @@ reinit_snr_threshold(uint8_t fru, int mode) {
     syslog(LOG_WARNING, "%s: get_struct_thresh_sensor failed",__func__);
 #endif /* DEBUG */
   }
+  sched_pause_fru(fru);
   ret = pal_get_all_thresh_from_file(fruNb, snr, mode);
+  sched_resume_fru(fru);
   if (0 != ret) {
     syslog(LOG_WARNING, "%s: Fail to get threshold from file for slot%d", __func__, fru);
     return -1;
@@ -503,18 +835,16 @@ thresh_reinit_chk(uint8_t fru) {
 
 /*
  * Starts monitoring all the sensors on a fru for all the threshold/discrete values.
- * Each pthread runs this monitoring for a different fru.
+ * Each pthread runs this monitoring for a different fru, the sensors are read by
+ * the readers of their paths.
  */
 static void *
 snr_monitor(void *arg) {
 
   uint8_t fru = (uint8_t)(uintptr_t)arg;
   int i, ret, snr_num, sensor_cnt, discrete_cnt;
-  float curr_val;
   uint8_t *sensor_list, *discrete_list;
   thresh_sensor_t *snr;
-  uint32_t snr_poll_interval[MAX_SENSOR_NUM + 1] = {0};
-  uint8_t snr_read_fail[MAX_SENSOR_NUM + 1] = {0};
 #ifdef CONFIG_FBY3_CWC
   uint8_t fruNb = fru >= MAX_NUM_FRUS ? IDX_TO_NB(fru) : fru;
   uint8_t slot = fru >= MAX_NUM_FRUS ? FRU_SLOT1 : fru;
@@ -551,16 +881,25 @@ snr_monitor(void *arg) {
     pal_get_sensor_name(fruNb, snr_num, snr[snr_num].name);
   }
 
+  if (sched_add_snrs(fru, sensor_list, sensor_cnt, false) < 0 ||
+      sched_add_snrs(fru, discrete_list, discrete_cnt, true) < 0) {
+    syslog(LOG_WARNING, "snr_monitor: scheduling the sensors of FRU %d failed", fru);
+    exit(-1);
+  }
+
   // set flag to notice BMC sensord snr_monitor  is ready
   kv_set("flag_sensord_monitor", "1", 0, 0);
 
   while(1) {
+    // The sensors are not read until resumed
     if (pal_is_fw_update_ongoing(slot)) {
+      sched_pause_fru(fru);
       sleep(STOP_PERIOD);
       continue;
     }
 
     if (pal_get_sdr_update_flag(fru)) {
+      sched_pause_fru(fru);
       if (init_fru_snr_thresh(fru) < 0 || pal_update_sensor_reading_sdr(fru) < 0) {
         syslog(LOG_DEBUG, "%s : slot%u SDR update fail", __func__, fru);
         sleep(STOP_PERIOD);
@@ -570,56 +909,18 @@ snr_monitor(void *arg) {
         pal_set_sdr_update_flag(fru,0);
       }
     }
+    sched_resume_fru(fru);
 
     ret = thresh_reinit_chk(fru);
     if (ret < 0)
       syslog(LOG_ERR, "%s: Fail to reinit sensor threshold for fru%d",__func__,fru);
 
-    for (i = 0; i < sensor_cnt; i++) {
-      snr_num = sensor_list[i];
-      curr_val = 0;
-      if (snr[snr_num].flag) {
-        // granular the sensor via assigning the poll_interval
-        if (snr_poll_interval[snr_num] > MIN_POLL_INTERVAL) {
-          snr_poll_interval[snr_num] -= MIN_POLL_INTERVAL;
-          continue;
-        }
-        snr_poll_interval[snr_num] = snr[snr_num].poll_interval;
-        if (!(ret = sensor_raw_read_helper(fruNb, snr_num, &curr_val))) {
-          sensor_fail_assert_clear(&snr_read_fail[snr_num], fru, snr_num, snr[snr_num].name);
-          check_thresh_assert(fru, snr_num, UNC_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, UCR_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, UNR_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, LNC_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, LCR_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, LNR_THRESH, &curr_val);
-
-          check_thresh_deassert(fru, snr_num, UNR_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, UCR_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, UNC_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, LNR_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, LCR_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, LNC_THRESH, &curr_val);
-        } else {
-          sensor_fail_assert_check(&snr_read_fail[snr_num], fru, snr_num, snr[snr_num].name);
-        } /* pal_sensor_read return check */
-      } /* flag check */
-    } /* loop for all sensors */
-
-    for (i = 0; i < discrete_cnt; i++) {
-      snr_num = discrete_list[i];
-      ret = sensor_raw_read_helper(fruNb, snr_num, &curr_val);
-      if (!ret && (snr[snr_num].curr_state != (int) curr_val)) {
-        pal_sensor_discrete_check(fru, snr_num, snr[snr_num].name,
-            snr[snr_num].curr_state, (int) curr_val);
-        snr[snr_num].curr_state = (int) curr_val;
-      }
-    }
-
 #ifdef DYN_THRESH_FRU1
     // Handle dynamic threshold changes for FRU1
     if (fru == 1) {
+      sched_pause_fru(fru);
       init_fru_snr_thresh(1);
+      sched_resume_fru(fru);
     }
 #endif
 
@@ -835,6 +1136,15 @@ run_sensord(int argc, char **argv) {
     arg++;
   }
 
+  pthread_condattr_init(&g_sched_condattr);
+  pthread_condattr_setclock(&g_sched_condattr, CLOCK_MONOTONIC);
+  for (fru = 1; fru <= MAX_SENSORD_FRU; fru++) {
+    pthread_mutex_init(&g_sched_fru[fru-1].lock, NULL);
+    pthread_cond_init(&g_sched_fru[fru-1].idle, NULL);
+    // Until snr_monitor() is done with its first update
+    g_sched_fru[fru-1].paused = true;
+  }
+
   ret = pal_sensor_monitor_initial();
   for (fru = 1; fru <= MAX_SENSORD_FRU; fru++) {
 
@@ -54,6 +54,8 @@ static const char* xml =
 "  </interface>"
 "</node>";
 
+DBusAsyncRead DBusSensorInterface::asyncRead_;
+
 DBusSensorInterface::DBusSensorInterface() {
   info_ = g_dbus_node_info_new_for_xml(xml, nullptr);
   if (info_ == nullptr) {
@@ -83,11 +85,32 @@ void DBusSensorInterface::sensorRawRead(GDBusMethodInvocation* invocation,
                                         gpointer               arg) {
   Sensor* obj = static_cast<Sensor*>(arg);
   LOG(INFO) << "sensorRawRead of " << obj->getName();
-  obj->sensorRawRead();
-  g_dbus_method_invocation_return_value(invocation,
-                                        g_variant_new("(id)",
-                                        obj->getLastReadStatus(),
-                                        obj->getValue()));
+  asyncRead_.read(obj, invocation, rawRead(obj));
+}
+
+DBusAsyncRead::Fetch DBusSensorInterface::rawRead(Sensor* sensor) {
+  // Read the sensor on a worker and store the value back on the event
+  // loop. Concurrent reads of the sensor share the read.
+  return [sensor]() -> DBusAsyncRead::Complete {
+    float value = 0;
+    ReadResult readResult = sensor->fetchRawValue(&value);
+    return [sensor, readResult, value]() -> GVariant* {
+      sensor->storeRawValue(readResult, value);
+      return g_variant_new("(id)",
+                           sensor->getLastReadStatus(),
+                           sensor->getValue());
+    };
+  };
+}
+
+void DBusSensorInterface::readSensor(Sensor*              sensor,
+                                     DBusAsyncRead::Reply reply) {
+  LOG(INFO) << "readSensor of " << sensor->getName();
+  asyncRead_.read(sensor, reply, rawRead(sensor));
+}
+
+void DBusSensorInterface::cancelReads() {
+  asyncRead_.cancel();
 }
 
 void DBusSensorInterface::getSensorObject(GDBusMethodInvocation* invocation,
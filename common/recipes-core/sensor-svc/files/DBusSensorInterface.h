@@ -20,11 +20,14 @@
  */
 
 #pragma once
+#include <dbus-utils/DBusAsyncRead.h>
 #include <dbus-utils/DBusInterfaceBase.h>
 
 namespace openbmc {
 namespace qin {
 
+class Sensor;
+
 class DBusSensorInterface: public DBusInterfaceBase {
   public:
     /**
@@ -54,7 +57,30 @@ class DBusSensorInterface: public DBusInterfaceBase {
                                GDBusMethodInvocation* invocation,
                                gpointer               arg);
 
+    /**
+     * Raw reads sensor off the event loop, as sensorRawRead does, and
+     * calls reply with its read status and value once stored.
+     *
+     * @param sensor to be read
+     * @param reply called on the event loop
+     */
+    static void readSensor(Sensor* sensor, DBusAsyncRead::Reply reply);
+
+    /**
+     * Fails the sensorRawRead calls waiting and waits for the reads
+     * running. Call it on the event loop before deleting sensors.
+     */
+    static void cancelReads();
+
   private:
+    // runs sensorRawRead off the event loop
+    static DBusAsyncRead asyncRead_;
+
+    /**
+     * Returns the fetch for asyncRead_ which raw reads sensor
+     */
+    static DBusAsyncRead::Fetch rawRead(Sensor* sensor);
+
     /**
      * Callback for sensorRead method
      * Return last read value of sensor and read status
@@ -71,7 +97,8 @@ class DBusSensorInterface: public DBusInterfaceBase {
 
     /**
      * Callback for sensorRawRead method
-     * Invokes rawRead on sensor and returns value and read status
+     * Invokes rawRead on sensor on a worker and returns value and read
+     * status once it is done
     */
     static void sensorRawRead(GDBusMethodInvocation* invocation,
                               gpointer               arg);
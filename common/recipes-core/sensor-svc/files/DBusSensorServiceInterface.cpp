@@ -22,6 +22,7 @@
 #include <glog/logging.h>
 #include <gio/gio.h>
 #include <nlohmann/json.hpp>
+#include "DBusSensorInterface.h"
 #include "DBusSensorServiceInterface.h"
 #include "SensorJsonParser.h"
 
@@ -166,6 +167,9 @@ void DBusSensorServiceInterface::resetTree(GDBusMethodInvocation* invocation,
                                            const char*            objectPath) {
   LOG(INFO) << "resetTree at " << objectPath;
 
+  // Reads in flight may use the sensors deleted
+  DBusSensorInterface::cancelReads();
+
   Object* obj = sensorTree->getObject(objectPath);
   Object::ChildMap childMap = obj->getChildMap();
   for (auto it = childMap.cbegin(); it != childMap.cend();) {
@@ -187,6 +191,8 @@ void DBusSensorServiceInterface::removeFRU(GDBusMethodInvocation* invocation,
 
   Object* obj = sensorTree->getObject(fruPath);
   if ((dynamic_cast<FRU*>(obj)) != nullptr) {
+    // Reads in flight may use the sensors deleted
+    DBusSensorInterface::cancelReads();
     deleteSubtree(sensorTree, obj);
   }
   else {
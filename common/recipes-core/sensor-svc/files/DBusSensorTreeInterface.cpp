@@ -18,10 +18,12 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <glog/logging.h>
 #include <gio/gio.h>
+#include "DBusSensorInterface.h"
 #include "DBusSensorTreeInterface.h"
 #include "FRU.h"
 #include "Sensor.h"
@@ -57,6 +59,11 @@ static const char* xml =
   "    <method name='getSensorObjects'>"
   "      <arg type='a(syids)' name='sensorlist' direction='out'/>"
   "    </method>"
+  "    <method name='getFruSensorValues'>"
+  "      <arg type='s' name='fru' direction='in'/>"
+  "      <arg type='u' name='flags' direction='in'/>"
+  "      <arg type='a(syids)' name='sensorlist' direction='out'/>"
+  "    </method>"
   "  </interface>"
   "</node>";
 
@@ -361,6 +368,105 @@ void DBusSensorTreeInterface::getSensorObjects(
   g_variant_builder_unref(builder);
 }
 
+/*
+* Helper function, locates FRU with fruName under subtree
+*/
+static Object* getFruByNameRec(Object* obj, const std::string &fruName) {
+  for (auto &it : obj->getChildMap()) {
+    if (dynamic_cast<FRU*>(it.second) != nullptr) {
+      if (fruName.compare(it.first) == 0) {
+        return it.second;
+      }
+      Object* fru = getFruByNameRec(it.second, fruName);
+      if (fru != nullptr) {
+        return fru;
+      }
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Recursively collects the sensors under Object obj, in the order of
+ * addSensorObjects
+ */
+static void getSensorsRec(Object* obj, std::vector<Sensor*> &sensors) {
+  for (auto &it : obj->getChildMap()) {
+    Sensor* sensor;
+    if ((sensor = dynamic_cast<Sensor*>(it.second)) != nullptr) {
+      sensors.push_back(sensor);
+    }
+  }
+
+  for (auto &it : obj->getChildMap()) {
+    if (dynamic_cast<FRU*>(it.second) != nullptr) {
+      getSensorsRec(it.second, sensors);
+    }
+  }
+}
+
+/**
+ * Helper function, replies with all sensor objects under Object obj
+ */
+static void returnSensorObjects(GDBusMethodInvocation* invocation,
+                                Object*                obj) {
+  GVariantBuilder* builder = g_variant_builder_new(G_VARIANT_TYPE("a(syids)"));
+
+  addSensorObjects(builder, obj);
+
+  g_dbus_method_invocation_return_value(invocation,
+                                        g_variant_new("(a(syids))", builder));
+  g_variant_builder_unref(builder);
+}
+
+void DBusSensorTreeInterface::getFruSensorValues(
+                                           GDBusMethodInvocation* invocation,
+                                           GVariant*              parameters,
+                                           gpointer               arg) {
+  Object* obj = static_cast<Object*>(arg);
+  const gchar* fruName;
+  guint32 flags;
+  g_variant_get(parameters, "(&su)", &fruName, &flags);
+
+  LOG(INFO) << "getFruSensorValues of " << fruName << " from "
+            << obj->getName() << " flags " << flags;
+
+  Object* fru = obj;
+  if (fruName[0] != '\0' && g_strcmp0(fruName, "all") != 0) {
+    fru = getFruByNameRec(obj, fruName);
+    if (fru == nullptr) {
+      g_dbus_method_invocation_return_error(invocation,
+                                            G_IO_ERROR,
+                                            G_IO_ERROR_NOT_FOUND,
+                                            "FRU not found");
+      return;
+    }
+  }
+
+  std::vector<Sensor*> sensors;
+  if (flags & FRU_SENSOR_VALUES_RAW_READ) {
+    getSensorsRec(fru, sensors);
+  }
+  if (sensors.empty()) {
+    // cached snapshot, as last read by the sensorRawRead callers
+    returnSensorObjects(invocation, fru);
+    return;
+  }
+
+  // Raw read all the sensors at once and reply when the last is stored.
+  // A failed read is reported through the read status of its sensor.
+  std::shared_ptr<size_t> pending(new size_t(sensors.size()));
+  for (auto sensor : sensors) {
+    DBusSensorInterface::readSensor(sensor,
+        [invocation, fru, pending](GVariant*          value,
+                                   const std::string &error) {
+      if (--*pending == 0) {
+        returnSensorObjects(invocation, fru);
+      }
+    });
+  }
+}
+
 void DBusSensorTreeInterface::methodCallBack(
                           GDBusConnection*       connection,
                           const char*            sender,
@@ -391,6 +497,9 @@ void DBusSensorTreeInterface::methodCallBack(
   else if (g_strcmp0(methodName, "getSensorObjects") == 0) {
     getSensorObjects(invocation, arg);
   }
+  else if (g_strcmp0(methodName, "getFruSensorValues") == 0) {
+    getFruSensorValues(invocation, parameters, arg);
+  }
 }
 
 } // namespace qin
@@ -21,6 +21,7 @@
 
 #pragma once
 #include <dbus-utils/DBusInterfaceBase.h>
+#include <openbmc/sensor-svc-client.h>
 
 namespace openbmc {
 namespace qin {
@@ -107,6 +108,17 @@ class DBusSensorTreeInterface: public DBusInterfaceBase {
      */
     static void getSensorObjects(GDBusMethodInvocation* invocation,
                                  gpointer               arg);
+
+    /**
+     * Callback for getFruSensorValues method
+     * Returns all sensor objects under the FRU with input name, or
+     * under subtree for "all", in one call. The values are the ones
+     * last read unless FRU_SENSOR_VALUES_RAW_READ is set in flags,
+     * then the sensors are raw read first.
+     */
+    static void getFruSensorValues(GDBusMethodInvocation* invocation,
+                                   GVariant*              parameters,
+                                   gpointer               arg);
 };
 
 } // namespace qin
@@ -19,6 +19,7 @@
  */
 
 #pragma once
+#include <atomic>
 #include <string>
 #include <object-tree/Object.h>
 
@@ -28,7 +29,8 @@ namespace qin {
 class FRU : public Object {
   private:
     uint8_t fruId_ = 0xFF;      // id of FRU, default 0xFF
-    uint8_t poweronFlag_ = 0;   // keeps track of time in seconds
+    std::atomic<uint8_t> poweronFlag_{0};
+                                // keeps track of time in seconds
                                 // elapsed after FRU power on
                                 // todo: rework on poweronFlag_
 
@@ -61,17 +61,25 @@ std::string Sensor::getUnit() {
 }
 
 ReadResult Sensor::getLastReadStatus() {
-  return sensorAccess_->getLastReadResult();
+  return readResult_;
 }
 
 ReadResult Sensor::sensorRawRead(){
   float val;
-  ReadResult readResult = sensorAccess_->sensorRawRead(this, &val);
+  ReadResult readResult = fetchRawValue(&val);
+  storeRawValue(readResult, val);
+  return readResult;
+}
+
+ReadResult Sensor::fetchRawValue(float *value) {
+  return sensorAccess_->sensorRawRead(this, value);
+}
+
+void Sensor::storeRawValue(ReadResult readResult, float value) {
+  readResult_ = readResult;
   if (readResult == READING_SUCCESS){
-    value_ = val;
+    value_ = value;
   }
-
-  return readResult;
 }
 
 } // namespace qin
@@ -34,6 +34,7 @@ class Sensor : public Object{
   private:
     uint8_t id_ = 0xFF;                           // Sensor Id
     float value_;                                 // Last Read Sensor Value
+    ReadResult readResult_ = READING_NA;          // Last Read Status
     std::string unit_;                            // Unit of Sensor
     std::unique_ptr<SensorAccessMechanism> sensorAccess_;
                                                   // sensorAccess mechanism
@@ -84,6 +85,18 @@ class Sensor : public Object{
      * sensorRaw
      */
     ReadResult sensorRawRead();
+
+    /*
+     * Reads the sensor through sensorAccess_ without storing the value,
+     * so that it can run off the event loop. Only one read of a sensor
+     * may run at a time.
+     */
+    ReadResult fetchRawValue(float *value);
+
+    /*
+     * Stores the result of fetchRawValue as the last read
+     */
+    void storeRawValue(ReadResult readResult, float value);
 };
 
 } // namespace qin
@@ -26,7 +26,10 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <syslog.h>
+#include <atomic>
 #include <chrono>
+#include <map>
+#include <mutex>
 #include <thread>
 #include <cstring>
 #include <linux/i2c.h>
@@ -55,6 +58,18 @@ class SensorAccessVR : public SensorAccessMechanism {
     uint8_t reg_;
     uint8_t slaveAddr_;
 
+    /*
+     * A read is a page select followed by a register read. Sensors of
+     * a VR may be read at once from different workers, so the accesses
+     * to a VR are serialized on a lock per (bus, slave address).
+     */
+    static std::mutex& vrLock(uint8_t busId, uint8_t slaveAddr) {
+      static std::mutex locksMutex;
+      static std::map<uint16_t, std::mutex> locks;
+      std::lock_guard<std::mutex> lock(locksMutex);
+      return locks[(busId << 8) | slaveAddr];
+    }
+
   public:
     SensorAccessVR(uint8_t busId,
                    uint8_t loop,
@@ -79,7 +94,7 @@ class SensorAccessVR : public SensorAccessMechanism {
 
       readResult_ = READING_NA;
 
-      static uint16_t vrUpdateInProgressCount = 0;
+      static std::atomic<uint16_t> vrUpdateInProgressCount{0};
       if ( access(VR_UPDATE_IN_PROGRESS, F_OK) == 0 )
       {
         //Avoid sensord unmonitoring vr sensors
@@ -92,7 +107,7 @@ class SensorAccessVR : public SensorAccessMechanism {
 
         syslog(LOG_WARNING,
                "[%d]Stop Monitor VR Volt due to VR update is in progress\n",
-               vrUpdateInProgressCount++);
+               vrUpdateInProgressCount.fetch_add(1));
         LOG(INFO) << "VR update in progress ";
         return;
       }
@@ -100,6 +115,8 @@ class SensorAccessVR : public SensorAccessMechanism {
         vrUpdateInProgressCount = 0;
       }
 
+      std::lock_guard<std::mutex> lock(vrLock(busId_, slaveAddr_));
+
       snprintf(fn, sizeof(fn), "/dev/i2c-%d", busId_);
       while (retry) {
         fd = open(fn, O_RDWR);
@@ -23,13 +23,13 @@
 #include <string>
 #include <gio/gio.h>
 #include <iomanip>
+#include <openbmc/sensor-svc-client.h>
 
 using namespace std;
 
-#define SENSOR_SVC_DBUS_NAME "org.openbmc.SensorService"
-#define SENSOR_SVC_BASE_PATH "/org/openbmc/SensorService"
-#define SENSOR_SVC_SENSOR_TREE_INTERFACE "org.openbmc.SensorTree"
-#define SENSOR_SVC_SENSOR_OBJECT_INTERFACE "org.openbmc.SensorObject"
+// Raw reading every sensor of every FRU may take longer than the
+// default D-Bus timeout of 25 seconds
+#define RAW_READ_TIMEOUT_MS (120 * 1000)
 
 #define MIN_SENSOR_NUM 1
 #define MAX_SENSOR_NUM 255
@@ -114,9 +114,10 @@ static string getAvailableFruNames() {
 static void printUsageAndExit(string error, int errNo) {
   string frulist = getAvailableFruNames();
 
-  cout << "Usage: sensor-util-v2 [fru] <sensor-num>" << endl;
+  cout << "Usage: sensor-util-v2 [fru] <sensor-num> <--force>" << endl;
   cout << "       [fru]: " << frulist << endl;
   cout << "       <sensor num>: 0xXX (Omit [sensor num] means all sensors." << endl;
+  cout << "       <--force>: read the sensors instead of the cached values" << endl;
 
   if (!error.empty()) {
     cout << "Error: " << error << endl;
@@ -176,162 +177,80 @@ static void printSensorObject(GVariant* sensorObject) {
   }
 }
 
-/*
- * Print Sensor Object at sensorPath
- */
-static void printSensor(const gchar* sensorPath) {
-  GVariant* response;
-  const gchar* name;
-  gchar id;
-  gint ret;
-  gdouble sensorValue;
-  const gchar* unit;
-
-  GError* error = nullptr;
-
-  // Get proxy to sensor
-  GDBusProxy* proxy = getDBusProxy(sensorPath,
-                                   SENSOR_SVC_SENSOR_OBJECT_INTERFACE);
-
-  // Get sensor object
-  response = g_dbus_proxy_call_sync(
-      proxy,
-      "getSensorObject",
-      nullptr,
-      G_DBUS_CALL_FLAGS_NONE,
-      -1,
-      nullptr,
-      &error);
-
-  checkDBusErrorAndExit(error);
-
-  printSensorObject(response);
-  g_variant_unref(response);
-}
-
-/*
- * Locate fru object with name 'fruName' under sensor service
- * and return path to fru object
- */
-static char* getFruObjectPath(const char* fruName) {
-  GVariant* response;
-  char* fruPath;
-  GError* error = nullptr;
-
-  // Get proxy to Sensor Service
-  GDBusProxy* proxy = getDBusProxy(SENSOR_SVC_BASE_PATH,
-                                   SENSOR_SVC_SENSOR_TREE_INTERFACE);
-
-  // Get fru path
-  response = g_dbus_proxy_call_sync(
-      proxy,
-      "getFruPathByName",
-      g_variant_new ("(&s)", fruName),
-      G_DBUS_CALL_FLAGS_NONE,
-      -1,
-      nullptr,
-      &error);
-
-  checkDBusErrorAndExit(error);
-
-  // extract sensorpath from response
-  g_variant_get(response, "(s)", &fruPath);
-  g_variant_unref(response);
-
-  return fruPath;
-}
-
 int main(int argc, char const* argv[]) {
   GError* error = nullptr;
-
   int sensorNum = -1;
+  guint32 flags = 0;
+  const char* args[2];
+  int nargs = 0;
 
   // Argument validation
-  if (argc < 2 || argc > 3)
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--force") == 0) {
+      flags |= FRU_SENSOR_VALUES_RAW_READ;
+    }
+    else if (nargs < 2) {
+      args[nargs++] = argv[i];
+    }
+    else {
+      printUsageAndExit("", -1);
+    }
+  }
+  if (nargs < 1)
   {
     printUsageAndExit("", -1);
     return 1;
   }
 
   // Parse sensorNumber
-  if (argc == 3){
-    sensorNum = parseSensorNumber(argv[2]);
+  if (nargs == 2){
+    sensorNum = parseSensorNumber(args[1]);
   }
 
-  //calculate dbuspath for fru object
-  char* fruPath = SENSOR_SVC_BASE_PATH;
-  if (strcmp(argv[1], "all") != 0) {
-    // if user specified fru name, get fru object path
-    fruPath = getFruObjectPath(argv[1]);
+  // Get proxy to sensor service
+  GDBusProxy* proxy = getDBusProxy(SENSOR_SVC_BASE_PATH,
+                                   SENSOR_SVC_SENSOR_TREE_INTERFACE);
 
-    if (fruPath[0] == '\0') {
-      //fru argv[1] not found
-      printUsageAndExit("Invalid FRU", -1);
-    }
+  // Get all sensor objects under the fru in one call
+  GVariant* response = g_dbus_proxy_call_sync(
+      proxy,
+      "getFruSensorValues",
+      g_variant_new("(su)", args[0], flags),
+      G_DBUS_CALL_FLAGS_NONE,
+      (flags & FRU_SENSOR_VALUES_RAW_READ) ? RAW_READ_TIMEOUT_MS : -1,
+      nullptr,
+      &error);
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+    //fru args[0] not found
+    g_error_free(error);
+    printUsageAndExit("Invalid FRU", -1);
   }
-
-  // Get proxy to fru object
-  GDBusProxy* proxy = getDBusProxy(fruPath, SENSOR_SVC_SENSOR_TREE_INTERFACE);
-
   checkDBusErrorAndExit(error);
 
-  if (sensorNum == -1){
-    // Sensor number not given by user, print all sensors under fru
-    // Get all sensor objects under given fru
-    GVariant* response;
-    const gchar* sensorPath;
-    GVariantIter* iter = nullptr;
-
-    // Get all sensor objects from FRU
-    response = g_dbus_proxy_call_sync(
-        proxy,
-        "getSensorObjects",
-        nullptr,
-        G_DBUS_CALL_FLAGS_NONE,
-        -1,
-        nullptr,
-        &error);
-    checkDBusErrorAndExit(error);
-
-    g_variant_get(response, "(a(syids))", &iter);
-    if (iter != nullptr) {
-      GVariant* sensorObject;
-      while ((sensorObject = g_variant_iter_next_value (iter))) {
+  GVariantIter* iter = nullptr;
+  bool found = false;
+  g_variant_get(response, "(a(syids))", &iter);
+  if (iter != nullptr) {
+    GVariant* sensorObject;
+    while ((sensorObject = g_variant_iter_next_value (iter))) {
+      guchar id;
+      g_variant_get_child(sensorObject, 1, "y", &id);
+      // Sensor number not given by user, print all sensors under fru
+      if (sensorNum == -1 || sensorNum == id) {
         printSensorObject(sensorObject);
+        found = true;
       }
-
-      g_variant_iter_free (iter);
+      g_variant_unref(sensorObject);
     }
-    g_variant_unref(response);
+
+    g_variant_iter_free (iter);
   }
-  else {
-    // Get sensor path based on sensorNum
-    GVariant* response;
-    GVariant* param = g_variant_new("(y)", sensorNum);
-    const gchar* sensorPath;
-
-    // Get sensorpath from FRU object
-    response = g_dbus_proxy_call_sync(
-        proxy,
-        "getSensorPathById",
-        param,
-        G_DBUS_CALL_FLAGS_NONE,
-        -1,
-        nullptr,
-        &error);
-    checkDBusErrorAndExit(error);
-
-    // extract sensorpath from response
-    g_variant_get(response, "(&s)", &sensorPath);
-
-    //Check if sensor is located under FRU object
-    if (sensorPath[0] == '\0') {
-      printErrorExit("Sensor " + string(argv[2]) +
-                     " not found under FRU " + string(argv[1]), -1);
-    }
+  g_variant_unref(response);
 
-    printSensor(sensorPath);
-    g_variant_unref(response);
+  //Check if sensor is located under FRU object
+  if (sensorNum != -1 && !found) {
+    printErrorExit("Sensor " + string(args[1]) +
+                   " not found under FRU " + string(args[0]), -1);
   }
 
   return 0;
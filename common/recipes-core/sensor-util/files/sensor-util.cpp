@@ -27,11 +27,20 @@
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <stdarg.h>
 #include <getopt.h>
 #include <time.h>
-#include <pthread.h>
-#include <signal.h>
 #include <jansson.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include <openbmc/pal.h>
 #include <openbmc/sdr.h>
 #include <openbmc/pal_sensors.h>
@@ -58,10 +67,32 @@
   static const char * pal_fru_list_sensor_history_t =  pal_fru_list;
 #endif /* CUSTOM_FRU_LIST */
 
-static pthread_mutex_t timer = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
-static pthread_condattr_t done_attr;
-static bool done_flag = false;
+// FRUs read at once, over all access paths
+#define MAX_WORKERS 8
+
+// A FRU, with its expansion FRUs, read by a worker. Its output is kept
+// until the main thread prints the FRUs in order.
+struct fru_job {
+  uint8_t fru;
+  bool allow_absent;
+  bool force;
+  // Access paths of the sensors of the FRU and its expansion FRUs, with
+  // their max_reads. A FRU is read once every one of its paths has room.
+  std::map<uint32_t, uint8_t> paths;
+
+  std::mutex lock;
+  std::condition_variable cv;
+  std::string out;
+  json_t *json = nullptr;
+  int ret = 0;
+  bool done = false;
+  // Timed out, the worker drops what it reads after.
+  bool abandoned = false;
+  // Reading sensors, under their own timeout.
+  bool timed = false;
+  std::chrono::steady_clock::time_point deadline;
+  char timed_fru[32] = {0};
+};
 
 // This is for get_sensor_reading
 typedef struct {
@@ -74,7 +105,7 @@ typedef struct {
   bool filter;
   char ** filter_list;
   int filter_len;
-  json_t *fru_sensor_obj;
+  fru_job *job;
   uint8_t *sensor_list;
 } get_sensor_reading_struct;
 
@@ -190,6 +221,83 @@ get_fru_name(uint8_t fru, char *name)
   return ret;
 }
 
+static void
+job_printf(fru_job *job, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void
+job_printf(fru_job *job, const char *fmt, ...) {
+  char buf[512];
+  va_list ap;
+  int len;
+
+  va_start(ap, fmt);
+  len = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (len <= 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lk(job->lock);
+    job->out.append(buf, std::min<size_t>(len, sizeof(buf) - 1));
+  }
+  job->cv.notify_all();
+}
+
+// Adds a sensor to the JSON output, sensors with the same name are
+// put in an array to match the RESTAPI format.
+static void
+json_add_sensor(json_t *fru_sensor_obj, const char *name, json_t *sensor_obj) {
+  json_t *search = json_object_get(fru_sensor_obj, name);
+
+  if (search != NULL) {
+    if (json_is_object(search)) {
+      json_t *value_array = json_array();
+      json_array_append(value_array, search);
+      /*
+      Note : if we use append_new here,
+      the following "json_object_set_new(fru_sensor_obj, name, value_array)"
+      will free the json_object "search"
+      */
+      json_array_append_new(value_array, sensor_obj);
+      json_object_set_new(fru_sensor_obj, name, value_array);
+    } else if (json_is_array(search)) {
+      json_array_append_new(search, sensor_obj);
+    } else {
+      syslog(LOG_ERR, "[%s]get error type of the JSON obj", __func__);
+      json_decref(sensor_obj);
+    }
+  } else {
+    json_object_set_new(fru_sensor_obj, name, sensor_obj);
+  }
+}
+
+static void
+job_add_sensor(fru_job *job, const char *name, json_t *sensor_obj) {
+  std::lock_guard<std::mutex> lk(job->lock);
+  json_add_sensor(job->json, name, sensor_obj);
+}
+
+// Starts the timeout of the sensor reads of a FRU
+static void
+job_start_timer(fru_job *job, uint8_t fru) {
+  {
+    std::lock_guard<std::mutex> lk(job->lock);
+    job->timed = true;
+    job->deadline = std::chrono::steady_clock::now() +
+      std::chrono::seconds(pal_get_sensor_util_timeout(fru));
+    if (get_fru_name(fru, job->timed_fru)) {
+      snprintf(job->timed_fru, sizeof(job->timed_fru), "fru%d", fru);
+    }
+  }
+  job->cv.notify_all();
+}
+
+static void
+job_stop_timer(fru_job *job) {
+  std::lock_guard<std::mutex> lk(job->lock);
+  job->timed = false;
+}
+
 static int
 is_pldm_sensor(uint8_t snr_num, uint8_t fru)
 {
@@ -270,22 +378,24 @@ get_thresh_json_obj(thresh_sensor_t *thresh) {
 
 static void
 print_sensor_reading(float fvalue, uint16_t snr_num, thresh_sensor_t *thresh,
-       get_sensor_reading_struct *sensor_info, char *status, json_t *fru_sensor_obj, char * filter_sensor_name) {
+       get_sensor_reading_struct *sensor_info, char *status, char * filter_sensor_name) {
 
+  fru_job *job = sensor_info->job;
   bool threshold = sensor_info->threshold;
   bool json = sensor_info->json;
   bool filter = sensor_info->filter;
 
   if (json) {
     json_t *sensor_obj = json_object();
-    json_t *search, *thresh_obj;
+    json_t *thresh_obj;
     char svalue[20];
 
     if (is_pldm_state_sensor(snr_num, sensor_info->fru)) {
       json_object_set_new(sensor_obj, "value",
           json_string(numeric_state_to_name((int)fvalue, sensor_state_str,
           sizeof(sensor_state_str)/sizeof(sensor_state_str[0]),UNKNOWN_STATE)));
-      json_object_set_new(fru_sensor_obj, thresh->name, sensor_obj);
+      std::lock_guard<std::mutex> lk(job->lock);
+      json_object_set_new(job->json, thresh->name, sensor_obj);
       return;
     }
 
@@ -295,77 +405,56 @@ print_sensor_reading(float fvalue, uint16_t snr_num, thresh_sensor_t *thresh,
     snprintf(svalue, sizeof(svalue), "%.2f", fvalue);
     json_object_set_new(sensor_obj, "value", json_string(svalue));
 
-    search = json_object_get(fru_sensor_obj, thresh->name);
-    if (search != NULL) {
-      /* in order to match the RESTAPI format */
-      if (json_is_object(search)) {
-        json_t *value_array = json_array();
-        json_array_append(value_array, search);
-        /*
-        Note : if we use append_new here,
-        the following "json_object_set_new(fru_sensor_obj, thresh->name, value_array)"
-        will free the json_object "search"
-        */
-        json_array_append_new(value_array, sensor_obj);
-        json_object_set_new(fru_sensor_obj, thresh->name, value_array);
-      } else if (json_is_array(search)) {
-        json_array_append_new(search, sensor_obj);
-      } else {
-        syslog(LOG_ERR, "[%s]get error type of the JSON obj", __func__);
-        json_decref(sensor_obj);
-      }
-    } else {
-      json_object_set_new(fru_sensor_obj, thresh->name, sensor_obj);
-    }
+    job_add_sensor(job, thresh->name, sensor_obj);
 
     return;
   }
 
   if (filter) {
-    printf("%-28s",filter_sensor_name);
+    job_printf(job, "%-28s",filter_sensor_name);
   } else {
-    printf("%-28s",thresh->name);
+    job_printf(job, "%-28s",thresh->name);
   }
 
   if (is_pldm_state_sensor(snr_num, sensor_info->fru)) {
-    printf(" (0x%X) : %10s    | (%s)",
+    job_printf(job, " (0x%X) : %10s    | (%s)",
         snr_num,
         numeric_state_to_name((int)fvalue, sensor_state_str,
              sizeof(sensor_state_str)/sizeof(sensor_state_str[0]),UNKNOWN_STATE),
              numeric_state_to_name((int)fvalue, sensor_status,
              sizeof(sensor_status)/sizeof(sensor_status[0]),STATUS_NS));
   } else {
-    printf(" (0x%X) : %7.2f %-5s | (%s)",
+    job_printf(job, " (0x%X) : %7.2f %-5s | (%s)",
         snr_num, fvalue, thresh->units, status);
   }
   if (threshold) {
-    printf(" | UCR: ");
+    job_printf(job, " | UCR: ");
     thresh->flag & GETMASK(UCR_THRESH) ?
-      printf("%.2f", thresh->ucr_thresh) : printf("NA");
+      job_printf(job, "%.2f", thresh->ucr_thresh) : job_printf(job, "NA");
 
-    printf(" | UNC: ");
+    job_printf(job, " | UNC: ");
     thresh->flag & GETMASK(UNC_THRESH) ?
-      printf("%.2f", thresh->unc_thresh) : printf("NA");
+      job_printf(job, "%.2f", thresh->unc_thresh) : job_printf(job, "NA");
 
-    printf(" | UNR: ");
+    job_printf(job, " | UNR: ");
     thresh->flag & GETMASK(UNR_THRESH) ?
-      printf("%.2f", thresh->unr_thresh) : printf("NA");
+      job_printf(job, "%.2f", thresh->unr_thresh) : job_printf(job, "NA");
 
-    printf(" | LCR: ");
+    job_printf(job, " | LCR: ");
     thresh->flag & GETMASK(LCR_THRESH) ?
-      printf("%.2f", thresh->lcr_thresh) : printf("NA");
+      job_printf(job, "%.2f", thresh->lcr_thresh) : job_printf(job, "NA");
 
-    printf(" | LNC: ");
+    job_printf(job, " | LNC: ");
     thresh->flag & GETMASK(LNC_THRESH) ?
-      printf("%.2f", thresh->lnc_thresh) : printf("NA");
+      job_printf(job, "%.2f", thresh->lnc_thresh) : job_printf(job, "NA");
 
-    printf(" | LNR: ");
+    job_printf(job, " | LNR: ");
     thresh->flag & GETMASK(LNR_THRESH) ?
-      printf("%.2f", thresh->lnr_thresh) : printf("NA");
+      job_printf(job, "%.2f", thresh->lnr_thresh) : job_printf(job, "NA");
 
   }
 
-  printf("\n");
+  job_printf(job, "\n");
 }
 
 static void
@@ -400,10 +489,10 @@ alter_to_fsc_style_sensor_name (char * str) {
   }
 }
 
-static void*
-get_sensor_reading(void *sensor_data) {
+static void
+get_sensor_reading(get_sensor_reading_struct *sensor_info) {
 
-  get_sensor_reading_struct *sensor_info = (get_sensor_reading_struct *)sensor_data;
+  fru_job *job = sensor_info->job;
   int i = 0,j = 0;
   uint8_t snr_num;
   float fvalue;
@@ -414,15 +503,6 @@ get_sensor_reading(void *sensor_data) {
   bool json = sensor_info->json;
   bool filter = sensor_info->filter;
   char filter_sensor_name[64] = {0};
-  json_t *fru_sensor_obj = sensor_info->fru_sensor_obj;
-
-  pthread_detach(pthread_self());
-  //Allow this thread to be killed at any time
-  pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
-
-  for (i=0; i< sensor_info->filter_len; i++) {
-    alter_to_fsc_style_sensor_name(sensor_info->filter_list[i]);
-  }
 
   for (i = 0; i < sensor_info->sensor_cnt; i++) {
     snr_num = sensor_info->sensor_list[i];
@@ -441,15 +521,8 @@ get_sensor_reading(void *sensor_data) {
       pal_alter_sensor_thresh_flag(sensor_info->fru, snr_num, &(thresh.flag));
       if (ret == ERR_SENSOR_NA) {
         get_fru_name(sensor_info->fru, fruname);
-        printf("%s SDR is missing!\n", fruname);
-
-        //modify the flag to true if we get the sensor reading
-        done_flag = true;
-
-        //Tell caller it's done
-        pthread_cond_signal(&done);
-
-        return NULL;
+        job_printf(job, "%s SDR is missing!\n", fruname);
+        return;
       }
       else if (ret < 0) {
         syslog(LOG_ERR, "sdr_get_snr_thresh failed for FRU %d num: 0x%X", sensor_info->fru, snr_num);
@@ -474,7 +547,6 @@ get_sensor_reading(void *sensor_data) {
     }
 
     if ((false == pal_sensor_is_cached(sensor_info->fru, snr_num)) || (true == sensor_info->force)) {
-      usleep(50);
       ret = sensor_raw_read(sensor_info->fru, snr_num, &fvalue);
     } else {
       ret = sensor_cache_read(sensor_info->fru, snr_num, &fvalue);
@@ -485,64 +557,28 @@ get_sensor_reading(void *sensor_data) {
       if (!is_pldm_sensor(snr_num, sensor_info->fru)) {
         if (json) {
           json_t *sensor_obj = json_object();
-          json_t *search = json_object_get(fru_sensor_obj, thresh.name);
 
           json_object_set_new(sensor_obj, "value", json_string("NA"));
-          if (search != NULL) {
-            /* in order to match the RESTAPI format */
-            if (json_is_object(search)) {
-              json_t *value_array = json_array();
-              json_array_append(value_array, search);
-              /*
-              Note : if we use append_new here,
-              the following "json_object_set_new(fru_sensor_obj, thresh->name, value_array)"
-              will free the json_object "search"
-              */
-              json_array_append_new(value_array, sensor_obj);
-              json_object_set_new(fru_sensor_obj, thresh.name, value_array);
-            } else if (json_is_array(search)) {
-              json_array_append_new(search, sensor_obj);
-            } else {
-              syslog(LOG_ERR, "[%s]get error type of the JSON obj", __func__);
-              json_decref(sensor_obj);
-            }
-          } else {
-            json_object_set_new(fru_sensor_obj, thresh.name, sensor_obj);
-          }
+          job_add_sensor(job, thresh.name, sensor_obj);
         } else if (filter) {
-          printf("%-28s (0x%X) : NA | (na)\n", filter_sensor_name, sensor_info->sensor_list[i]);
+          job_printf(job, "%-28s (0x%X) : NA | (na)\n", filter_sensor_name, sensor_info->sensor_list[i]);
         } else if (is_supported_sensor(snr_num, sensor_info->fru)) {
-          printf("%-28s (0x%X) : 0/NA | (na)\n", thresh.name, sensor_info->sensor_list[i]);
+          job_printf(job, "%-28s (0x%X) : 0/NA | (na)\n", thresh.name, sensor_info->sensor_list[i]);
         } else {
-          printf("%-28s (0x%X) : NA | (na)\n", thresh.name, sensor_info->sensor_list[i]);
+          job_printf(job, "%-28s (0x%X) : NA | (na)\n", thresh.name, sensor_info->sensor_list[i]);
         }
       }
       continue;
     }
     else {
       get_sensor_status(fvalue, &thresh, status);
-      print_sensor_reading(fvalue, (uint16_t)snr_num, &thresh, sensor_info, status, fru_sensor_obj, filter_sensor_name);
+      print_sensor_reading(fvalue, (uint16_t)snr_num, &thresh, sensor_info, status, filter_sensor_name);
     }
   }
-
-  //if the mutex is already locked, the calling thread shall block until the mutex becomes available
-  //wait for the mutex is released and then get the sensor reading
-  pthread_mutex_lock(&timer);
-
-  //modify the flag to true if we get the sensor reading
-  done_flag = true;
-
-  //Tell caller it's done
-  pthread_cond_signal(&done);
-
-  //release the mutex
-  pthread_mutex_unlock(&timer);
-
-  pthread_exit(0);
 }
 
 static void
-get_sensor_history(uint8_t fru, uint8_t *sensor_list, int sensor_cnt, int num, int period) {
+get_sensor_history(uint8_t fru, uint8_t *sensor_list, int sensor_cnt, int num, int period, fru_job *job) {
 
   int start_time, i;
   uint8_t snr_num;
@@ -568,7 +604,7 @@ get_sensor_history(uint8_t fru, uint8_t *sensor_list, int sensor_cnt, int num, i
       ret = sdr_get_snr_thresh(fru, snr_num, &thresh);
       if (ret == ERR_SENSOR_NA) {
         get_fru_name(fru, fruname);
-        printf("%s SDR is missing!\n", fruname);
+        job_printf(job, "%s SDR is missing!\n", fruname);
         return;
       }
       else if (ret < 0) {
@@ -579,16 +615,16 @@ get_sensor_history(uint8_t fru, uint8_t *sensor_list, int sensor_cnt, int num, i
 
     if (sensor_read_history(fru, snr_num, &min, &average, &max, start_time) < 0) {
       if (!is_pldm_sensor(snr_num, fru)) {
-        printf("%-18s (0x%X) min = NA, average = NA, max = NA\n", thresh.name, snr_num);
+        job_printf(job, "%-18s (0x%X) min = NA, average = NA, max = NA\n", thresh.name, snr_num);
       }
       continue;
     }
 
-    printf("%-18s (0x%X) min = %.2f, average = %.2f, max = %.2f\n", thresh.name, snr_num, min, average, max);
+    job_printf(job, "%-18s (0x%X) min = %.2f, average = %.2f, max = %.2f\n", thresh.name, snr_num, min, average, max);
   }
 }
 
-static void clear_sensor_history(uint8_t fru, uint8_t *sensor_list, int sensor_cnt, int num) {
+static void clear_sensor_history(uint8_t fru, uint8_t *sensor_list, int sensor_cnt, int num, fru_job *job) {
   int i;
   uint8_t snr_num;
 
@@ -598,107 +634,23 @@ static void clear_sensor_history(uint8_t fru, uint8_t *sensor_list, int sensor_c
       continue;
     }
     if (sensor_clear_history(fru, snr_num)) {
-      printf("Clearing fru:%u sensor[%u] failed!\n", fru, snr_num);
+      job_printf(job, "Clearing fru:%u sensor[%u] failed!\n", fru, snr_num);
     }
   }
 }
 
-void get_sensor_reading_timer(struct timespec *timeout, get_sensor_reading_struct *sensor_data)
-{
-  struct timespec abs_time;
-  pthread_t tid_get_sensor_reading;
-  int err = 0;
-  int thread_alive = 0;
-  char fruname[32] = {0};
-
-  err = pthread_condattr_init(&done_attr);
-  if ( err != 0 )
-  {
-    syslog(LOG_WARNING, "[%s]init condattr fails. errno:%d", __func__, err);
-    return;
-  }
-
-  err = pthread_condattr_setclock(&done_attr, CLOCK_MONOTONIC);
-  if ( err != 0 )
-  {
-    syslog(LOG_WARNING, "[%s]set condattr clock fails. errno:%d", __func__, err);
-    return;
-  }
-
-  err = pthread_cond_init(&done, &done_attr);
-  if ( err != 0 )
-  {
-    syslog(LOG_WARNING, "[%s]init cond fails. errno:%d", __func__, err);
-    return;
-  }
-
-  pthread_mutex_lock(&timer);
-
-  //Assign the timeout time to abs_time
-  clock_gettime(CLOCK_MONOTONIC, &abs_time);
-  abs_time.tv_sec += timeout->tv_sec;
-  abs_time.tv_nsec += timeout->tv_nsec;
-
-  get_fru_name(sensor_data->fru, fruname);
-
-  //Make get_sensor_reading a thread
-  if (pthread_create(&tid_get_sensor_reading, NULL, get_sensor_reading, (void *) sensor_data) < 0) {
-    syslog(LOG_WARNING, "sensor-util FRU:%s, pthread_create failed\n", fruname);
-    pthread_mutex_unlock(&timer);
-    return;
-  }
-
-  //Check if thread is alive, if pthread_kill (thread_id, sig = 0) returns 0, means thread is alive
-  thread_alive = pthread_kill(tid_get_sensor_reading, 0);
-
-  if (thread_alive == 0)
-  {
-    while ( false == done_flag )
-    {
-      //Timer thread, continue only when get_sensor_reading send the done signal or abs_time timed out
-      err = pthread_cond_timedwait(&done, &timer, &abs_time);
-      if (err == ETIMEDOUT) {
-        break;
-      }
-    }
-
-    //Double Check if thread is still alive
-    thread_alive = pthread_kill(tid_get_sensor_reading, 0);
-
-    //Timeout actions
-    //If Timed out, and Thread is still alive, it means the thread is really timed out, cancel the thread
-    //If Timed out, and Thread is dead, it means the timed out is fake, do nothing
-    if ( (err == ETIMEDOUT) && (thread_alive == 0) ) {
-      printf("FRU:%s timed out...\n", fruname);
-      pthread_cancel(tid_get_sensor_reading);
-    }
-  }
-
-  //re-init for the next fru
-  done_flag = false;
-
-  pthread_mutex_unlock(&timer);
-
-  return;
-}
-
 static int
-print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool threshold, bool force, bool json, bool history_clear, bool filter, char** filter_list, int filter_len,long period, json_t *fru_sensor_obj) {
+print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool threshold, bool force, bool json, bool history_clear, bool filter, char** filter_list, int filter_len,long period, fru_job *job) {
   int ret;
   uint8_t status;
   int sensor_cnt;
   uint8_t *sensor_list;
   char fruname[16] = {0};
-  struct timespec timeout;
   get_sensor_reading_struct data;
   char fru_list[256] = {0};
   uint8_t expList[MAX_NUM_FRUS] = {0}, len = 0, i = 0, root = 0;
   unsigned int caps = 0;
 
-  //Setup timeout for each fru get_sensor_reading
-  memset(&timeout, 0, sizeof(timeout));
-  timeout.tv_sec = pal_get_sensor_util_timeout(fru);
-
   if (fru == AGGREGATE_SENSOR_FRU_ID) {
     size_t cnt, i;
     if (aggregate_sensor_init(NULL)) {
@@ -737,7 +689,7 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
     ret = pal_is_fru_prsnt(fru, &status);
     if (ret < 0) {
       if (json == 0)
-        printf("pal_is_fru_prsnt failed for fru: %s\n", fruname);
+        job_printf(job, "pal_is_fru_prsnt failed for fru: %s\n", fruname);
       return ret;
     }
     // FRU is not present
@@ -747,21 +699,21 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
       if (allow_absent == true)
         return 0;
       if (json == 0)
-        printf("%s is not present!\n\n", fruname);
+        job_printf(job, "%s is not present!\n\n", fruname);
       return -1;
     }
 
     ret = pal_is_fru_ready(fru, &status);
     if ((ret < 0) || (status == 0)) {
       if (json == 0)
-        printf("%s is unavailable!\n\n", fruname);
+        job_printf(job, "%s is unavailable!\n\n", fruname);
       return ret;
     }
 
     ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
     if (ret < 0) {
       if (json == 0)
-        printf("%s get sensor list failed!\n", fruname);
+        job_printf(job, "%s get sensor list failed!\n", fruname);
       return ret;
     }
   }
@@ -778,15 +730,15 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
 
   if (history_clear) {
     if ((caps & FRU_CAPABILITY_SENSOR_SLAVE) && root > 0) {
-      clear_sensor_history(root, sensor_list, sensor_cnt, sensor_num);
+      clear_sensor_history(root, sensor_list, sensor_cnt, sensor_num, job);
     } else {
-      clear_sensor_history(fru, sensor_list, sensor_cnt, sensor_num);
+      clear_sensor_history(fru, sensor_list, sensor_cnt, sensor_num, job);
     }
   } else if (history) {
     if ((caps & FRU_CAPABILITY_SENSOR_SLAVE) && root > 0) {
-      get_sensor_history(root, sensor_list, sensor_cnt, sensor_num, period);
+      get_sensor_history(root, sensor_list, sensor_cnt, sensor_num, period, job);
     } else {
-      get_sensor_history(fru, sensor_list, sensor_cnt, sensor_num, period);
+      get_sensor_history(fru, sensor_list, sensor_cnt, sensor_num, period, job);
     }
   } else {
     if ((caps & FRU_CAPABILITY_SENSOR_SLAVE) && root > 0) {
@@ -802,17 +754,18 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
     data.filter = filter;
     data.filter_list = filter_list;
     data.filter_len = filter_len;
-    data.fru_sensor_obj = fru_sensor_obj;
+    data.job = job;
     data.sensor_list = sensor_list;
-    // memcpy(data.sensor_list, sensor_list, sizeof(uint8_t)*sensor_cnt);
-    get_sensor_reading_timer(&timeout, &data);
+    job_start_timer(job, data.fru);
+    get_sensor_reading(&data);
+    job_stop_timer(job);
   }
 
   //Print Empty Line to separate frus,
   //only when sensor_cnt greater than 0, not history-clear, and sensor_num is not specified
   if ( (sensor_cnt > 0) && (!history_clear) && (sensor_num == SENSOR_ALL) ){
     if (json == 0)
-      printf("\n");
+      job_printf(job, "\n");
   }
 
   ret = 0;
@@ -825,9 +778,9 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
       }
       if (pal_get_root_fru(expList[i], &root) == PAL_EOK && root == fru) {
         if (pal_get_exp_arg_name(expList[i], name) == PAL_EOK) {
-          printf("%s:\n", name);
+          job_printf(job, "%s:\n", name);
         }
-        ret |= print_sensor(expList[i], sensor_num, allow_absent, history, threshold, force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
+        ret |= print_sensor(expList[i], sensor_num, allow_absent, history, threshold, force, json, history_clear, filter, filter_list, filter_len, period, job);
       }
     }
   }
@@ -835,6 +788,252 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
   return ret;
 }
 
+// State shared by the workers, which may outlive run_fru_jobs() when a
+// FRU timed out.
+struct fru_sched {
+  std::mutex lock;
+  std::condition_variable cv;
+  std::vector<std::shared_ptr<fru_job>> jobs;
+  std::vector<bool> started;
+  std::map<uint32_t, int> active;
+  std::function<int(fru_job *)> run;
+};
+
+static void
+fru_worker(std::shared_ptr<fru_sched> sched) {
+  for (;;) {
+    std::shared_ptr<fru_job> job;
+    {
+      std::unique_lock<std::mutex> lk(sched->lock);
+      for (;;) {
+        bool pending = false;
+        for (size_t i = 0; i < sched->jobs.size(); i++) {
+          if (sched->started[i]) {
+            continue;
+          }
+          pending = true;
+          auto &j = sched->jobs[i];
+          bool room = true;
+          for (auto &p : j->paths) {
+            if (sched->active[p.first] >= p.second) {
+              room = false;
+              break;
+            }
+          }
+          if (room) {
+            sched->started[i] = true;
+            for (auto &p : j->paths) {
+              sched->active[p.first]++;
+            }
+            job = j;
+            break;
+          }
+        }
+        if (job || !pending) {
+          break;
+        }
+        sched->cv.wait(lk);
+      }
+    }
+    if (!job) {
+      return;
+    }
+
+    int ret = sched->run(job.get());
+    {
+      std::lock_guard<std::mutex> lk(sched->lock);
+      for (auto &p : job->paths) {
+        sched->active[p.first]--;
+      }
+    }
+    sched->cv.notify_all();
+    {
+      std::lock_guard<std::mutex> lk(job->lock);
+      job->done = true;
+      if (!job->abandoned) {
+        job->ret = ret;
+      } else {
+        json_decref(job->json);
+        job->json = nullptr;
+      }
+    }
+    job->cv.notify_all();
+  }
+}
+
+// Reads the FRUs with one worker per access path, up to MAX_WORKERS at
+// once, and prints them in order as they complete. A FRU whose reads
+// time out, or which does not get to them in as long, is left to its
+// worker, or never started, and whatever it printed so far is kept. Returns true if a FRU was left behind, its worker may still be
+// in the PAL.
+static bool
+run_fru_jobs(std::vector<std::shared_ptr<fru_job>> &jobs, json_t *fru_sensor_obj,
+             const std::function<int(fru_job *)> &run) {
+  auto sched = std::make_shared<fru_sched>();
+  std::vector<std::thread> workers;
+  std::map<uint32_t, int> paths;
+  bool abandoned = false;
+
+  sched->jobs = jobs;
+  sched->started.assign(jobs.size(), false);
+  sched->run = run;
+  for (auto &job : jobs) {
+    job->json = json_object();
+    for (auto &p : job->paths) {
+      paths[p.first] = std::max<int>(paths[p.first], p.second);
+    }
+  }
+  size_t nworkers = 0;
+  for (auto &p : paths) {
+    nworkers += p.second;
+  }
+  nworkers = std::min<size_t>(std::min<size_t>(nworkers, jobs.size()), MAX_WORKERS);
+  for (size_t i = 0; i < nworkers; i++) {
+    workers.emplace_back(fru_worker, sched);
+  }
+
+  for (size_t idx = 0; idx < jobs.size(); idx++) {
+    auto &job = jobs[idx];
+    std::unique_lock<std::mutex> lk(job->lock);
+    bool timed_out = false;
+    bool was_timed = false;
+    bool started = true;
+    // Outside of its sensor reads, a FRU gets as long to get to them,
+    // e.g. when it is queued behind a FRU left behind on its path.
+    auto idle_deadline = std::chrono::steady_clock::now() +
+      std::chrono::seconds(pal_get_sensor_util_timeout(job->fru));
+    for (;;) {
+      fputs(job->out.c_str(), stdout);
+      job->out.clear();
+      if (job->done) {
+        break;
+      }
+      if (was_timed && !job->timed) {
+        idle_deadline = std::chrono::steady_clock::now() +
+          std::chrono::seconds(pal_get_sensor_util_timeout(job->fru));
+      }
+      was_timed = job->timed;
+      auto deadline = job->timed ? job->deadline : idle_deadline;
+      if (job->cv.wait_until(lk, deadline) == std::cv_status::timeout &&
+          !job->done && job->timed == was_timed &&
+          std::chrono::steady_clock::now() >= deadline) {
+        timed_out = true;
+        break;
+      }
+    }
+    if (timed_out) {
+      std::lock_guard<std::mutex> slk(sched->lock);
+      started = sched->started[idx];
+      // Still queued, it never runs now.
+      sched->started[idx] = true;
+    }
+    if (timed_out && !started) {
+      sched->cv.notify_all();
+    }
+    fflush(stdout);
+
+    json_t *value;
+    const char *key;
+    json_object_foreach(job->json, key, value) {
+      if (json_is_array(value)) {
+        size_t i;
+        json_t *elem;
+        json_array_foreach(value, i, elem) {
+          json_add_sensor(fru_sensor_obj, key, json_deep_copy(elem));
+        }
+      } else {
+        json_add_sensor(fru_sensor_obj, key, json_deep_copy(value));
+      }
+    }
+
+    if (timed_out) {
+      printf("FRU:%s timed out...\n", job->timed_fru);
+      abandoned = true;
+    }
+    if (timed_out && started) {
+      job->abandoned = true;
+    } else {
+      json_decref(job->json);
+      job->json = nullptr;
+    }
+  }
+
+  for (auto &w : workers) {
+    if (abandoned) {
+      w.detach();
+    } else {
+      w.join();
+    }
+  }
+  return abandoned;
+}
+
+// Adds the access paths of the sensors of a FRU, and of the expansion
+// FRUs print_sensor() reads along with it. A sensor the PAL does not
+// give a bus for (the default is one path per FRU) goes on a single
+// shared path, so such FRUs are still read one at a time.
+static void
+job_add_paths(fru_job *job, uint8_t fru) {
+  uint8_t *sensor_list;
+  int sensor_cnt = 0;
+  uint8_t expList[MAX_NUM_FRUS] = {0}, len = 0, root = 0;
+  unsigned int caps = 0;
+
+  if (pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt) == 0) {
+    for (int i = 0; i < sensor_cnt; i++) {
+      uint32_t path;
+      uint8_t max_reads = 1;
+      if (pal_get_sensor_access_path(fru, sensor_list[i], &path, &max_reads) != 0 ||
+          SENSOR_PATH_TYPE(path) == SENSOR_PATH_FRU) {
+        path = SENSOR_PATH(SENSOR_PATH_FRU, 0);
+        max_reads = 1;
+      }
+      max_reads = std::max<uint8_t>(max_reads, 1);
+      auto it = job->paths.find(path);
+      if (it == job->paths.end()) {
+        job->paths[path] = max_reads;
+      } else {
+        it->second = std::min(it->second, max_reads);
+      }
+    }
+  }
+
+  if (pal_is_exp() == PAL_EOK && pal_get_exp_fru_list(expList, &len) == PAL_EOK) {
+    for (uint8_t i = 0; i < len; ++i) {
+      if (expList[i] == fru ||
+          (pal_get_fru_capability(expList[i], &caps) == PAL_EOK &&
+           (caps & FRU_CAPABILITY_SENSOR_SLAVE))) {
+        continue;
+      }
+      if (pal_get_root_fru(expList[i], &root) == PAL_EOK && root == fru) {
+        job_add_paths(job, expList[i]);
+      }
+    }
+  }
+}
+
+static std::shared_ptr<fru_job>
+make_fru_job(uint8_t fru, bool allow_absent, bool force) {
+  auto job = std::make_shared<fru_job>();
+
+  job->fru = fru;
+  job->allow_absent = allow_absent;
+  job->force = force;
+  if (get_fru_name(fru, job->timed_fru)) {
+    snprintf(job->timed_fru, sizeof(job->timed_fru), "fru%d", fru);
+  }
+  if (fru == AGGREGATE_SENSOR_FRU_ID) {
+    // Aggregate sensors are computed from the cache, no bus is involved
+    job->paths[SENSOR_PATH(SENSOR_PATH_FRU, fru)] = 1;
+  } else {
+    job_add_paths(job.get(), fru);
+  }
+  if (job->paths.empty()) {
+    job->paths[SENSOR_PATH(SENSOR_PATH_FRU, 0)] = 1;
+  }
+  return job;
+}
+
 int parse_args(int argc, char *argv[], char *fruname,
     bool *history_clear, bool *history, bool *threshold, bool *force, bool *json, bool *filter, long *period, int *snr)
 {
@@ -973,16 +1172,37 @@ main(int argc, char **argv) {
     }
   }
 
-  if (fru == 0) {
+  if (filter) {
+    for (int i = 0; i < filter_len; i++) {
+      alter_to_fsc_style_sensor_name(filter_list[i]);
+    }
+  }
+
+  std::vector<std::shared_ptr<fru_job>> jobs;
+  bool all = fru == 0;
+  if (all) {
     for (fru = 1; fru <= MAX_NUM_FRUS; fru++) {
-      ret |= print_sensor(fru, num, true, history, threshold, force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
+      jobs.push_back(make_fru_job(fru, true, force));
     }
-    ret |= print_sensor(AGGREGATE_SENSOR_FRU_ID, num, true, history, threshold, false, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
+    jobs.push_back(make_fru_job(AGGREGATE_SENSOR_FRU_ID, true, false));
   } else if (pal_get_pair_fru(fru, &pair_fru)) {
-    ret = print_sensor(fru, num, false, history, threshold, fru == AGGREGATE_SENSOR_FRU_ID ? false : force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
-    ret = print_sensor(pair_fru, num, false, history, threshold, pair_fru == AGGREGATE_SENSOR_FRU_ID ? false : force, json, history_clear, filter, filter_list, filter_len ,period, fru_sensor_obj);
+    jobs.push_back(make_fru_job(fru, false, fru == AGGREGATE_SENSOR_FRU_ID ? false : force));
+    jobs.push_back(make_fru_job(pair_fru, false, pair_fru == AGGREGATE_SENSOR_FRU_ID ? false : force));
   } else {
-    ret = print_sensor(fru, num, false, history, threshold, fru == AGGREGATE_SENSOR_FRU_ID ? false : force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
+    jobs.push_back(make_fru_job(fru, false, fru == AGGREGATE_SENSOR_FRU_ID ? false : force));
+  }
+
+  bool abandoned = run_fru_jobs(jobs, fru_sensor_obj, [&](fru_job *job) {
+    return print_sensor(job->fru, num, job->allow_absent, history, threshold, job->force, json,
+        history_clear, filter, filter_list, filter_len, period, job);
+  });
+
+  if (all) {
+    for (auto &job : jobs) {
+      ret |= job->ret;
+    }
+  } else {
+    ret = jobs.back()->ret;
   }
 
   if (json) {
@@ -991,5 +1211,11 @@ main(int argc, char **argv) {
   }
   json_decref(fru_sensor_obj);
 
+  if (abandoned) {
+    // Workers left behind are still in the PAL, do not let exit() run
+    // static destructors and atexit handlers under them.
+    fflush(stdout);
+    _exit(ret);
+  }
   return ret;
 }
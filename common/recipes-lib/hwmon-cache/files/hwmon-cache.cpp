@@ -0,0 +1,267 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <linux/netlink.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <exception>
+
+#include "hwmon-cache.h"
+#include "hwmon-cache.hpp"
+
+namespace hwmon
+{
+
+// The kernel uevents, as received by udev.
+constexpr uint32_t uevent_group = 1;
+
+static int open_uevent_socket() {
+  int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                  NETLINK_KOBJECT_UEVENT);
+  if (fd < 0) {
+    return -1;
+  }
+  struct sockaddr_nl addr = {};
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = uevent_group;
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))) {
+    // Only the failed reads invalidate the cache then.
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// A uevent starts with ACTION@DEVPATH. A driver rebind removes and adds
+// the hwmon/iio device again, which may get another number.
+bool uevent_invalidates(const char* msg, size_t len) {
+  static const char* actions[] = {"add@", "remove@", "bind@", "unbind@",
+                                  "move@"};
+  for (auto action : actions) {
+    size_t n = strlen(action);
+    if (len >= n && memcmp(msg, action, n) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Cache::File::~File() {
+  close(fd);
+}
+
+Cache::Cache(int fd) : uevent_fd(fd) {}
+
+Cache::~Cache() {
+  if (uevent_fd >= 0) {
+    close(uevent_fd);
+  }
+}
+
+Cache& Cache::instance() {
+  static Cache cache(open_uevent_socket());
+  return cache;
+}
+
+void Cache::check_uevents() {
+  if (uevent_fd < 0) {
+    return;
+  }
+  char buf[4096];
+  bool changed = false;
+  while (true) {
+    ssize_t n = recv(uevent_fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // Events were dropped, any of them may be a rebind.
+      if (errno == ENOBUFS) {
+        changed = true;
+        continue;
+      }
+      break;
+    }
+    changed |= uevent_invalidates(buf, n);
+  }
+  if (changed) {
+    dirs.clear();
+    files.clear();
+  }
+}
+
+int Cache::resolve_locked(const std::string& device, std::string& path) {
+  auto it = dirs.find(device);
+  if (it != dirs.end()) {
+    path = it->second;
+    return 0;
+  }
+  glob_t g;
+  int rc = glob(device.c_str(), 0, nullptr, &g);
+  if (rc != 0) {
+    globfree(&g);
+    return rc == GLOB_NOMATCH ? ENOENT : (rc == GLOB_NOSPACE ? ENOMEM : EIO);
+  }
+  path = g.gl_pathv[0];
+  globfree(&g);
+  dirs[device] = path;
+  return 0;
+}
+
+int Cache::resolve(const std::string& device, std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex);
+  check_uevents();
+  return resolve_locked(device, path);
+}
+
+int Cache::open(const std::string& device, const std::string& attr,
+                std::shared_ptr<File>& file) {
+  std::string key = device + '/' + attr;
+  auto it = files.find(key);
+  if (it != files.end()) {
+    file = it->second;
+    return 0;
+  }
+  std::string dir;
+  if (int err = resolve_locked(device, dir)) {
+    return err;
+  }
+  int fd = ::open((dir + '/' + attr).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return errno;
+  }
+  file = std::make_shared<File>(fd);
+  if (files.size() < max_files) {
+    files.emplace(key, file);
+  }
+  return 0;
+}
+
+void Cache::forget(const std::string& device, const std::string& attr) {
+  dirs.erase(device);
+  files.erase(device + '/' + attr);
+}
+
+int Cache::read(const std::string& device, const std::string& attr,
+                std::string& value) {
+  for (int attempt = 0;; attempt++) {
+    std::shared_ptr<File> file;
+    int err;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      check_uevents();
+      err = open(device, attr, file);
+    }
+    // Read without the lock, hwmon drivers may take a while.
+    if (err == 0) {
+      char buf[128];
+      ssize_t n = pread(file->fd, buf, sizeof(buf), 0);
+      if (n >= 0) {
+        value.assign(buf, n);
+        return 0;
+      }
+      err = errno;
+    }
+    if (attempt > 0) {
+      return err;
+    }
+    // Read a device gone or rebound since it was expanded.
+    std::lock_guard<std::mutex> lock(mutex);
+    forget(device, attr);
+  }
+}
+
+void Cache::invalidate() {
+  std::lock_guard<std::mutex> lock(mutex);
+  dirs.clear();
+  files.clear();
+}
+
+} // namespace hwmon
+
+static int read_attr(const char* device, const char* attr, std::string& value) {
+  if (device == nullptr || attr == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+  try {
+    if (int err = hwmon::Cache::instance().read(device, attr, value)) {
+      errno = err;
+      return -1;
+    }
+  } catch (std::exception& e) {
+    errno = ENOMEM;
+    return -1;
+  }
+  return 0;
+}
+
+int hwmon_resolve(const char* device, char* path, size_t size) {
+  if (device == nullptr || path == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+  try {
+    std::string dir;
+    if (int err = hwmon::Cache::instance().resolve(device, dir)) {
+      errno = err;
+      return -1;
+    }
+    if (dir.size() >= size) {
+      errno = ENAMETOOLONG;
+      return -1;
+    }
+    memcpy(path, dir.c_str(), dir.size() + 1);
+  } catch (std::exception& e) {
+    errno = ENOMEM;
+    return -1;
+  }
+  return 0;
+}
+
+int hwmon_read_int(const char* device, const char* attr, int* value) {
+  std::string buf;
+  if (value == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (read_attr(device, attr, buf)) {
+    return -1;
+  }
+  char* end;
+  long v = strtol(buf.c_str(), &end, 0);
+  if (end == buf.c_str()) {
+    errno = EINVAL;
+    return -1;
+  }
+  *value = static_cast<int>(v);
+  return 0;
+}
+
+int hwmon_read_float(const char* device, const char* attr, float* value) {
+  std::string buf;
+  if (value == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (read_attr(device, attr, buf)) {
+    return -1;
+  }
+  char* end;
+  float v = strtof(buf.c_str(), &end);
+  if (end == buf.c_str()) {
+    errno = EINVAL;
+    return -1;
+  }
+  *value = v;
+  return 0;
+}
+
+void hwmon_cache_invalidate(void) {
+  hwmon::Cache::instance().invalidate();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Attributes of hwmon and iio devices.
+ *
+ * A device is a directory, which may be a glob for the part picked by
+ * the kernel, e.g. /sys/bus/i2c/drivers/lm75/3-0048/hwmon/hwmon* or
+ * /sys/bus/iio/devices/iio:device*. It is expanded once, and the files
+ * of the attributes read are kept open, so a reading is a single
+ * pread(). The cache is dropped when a driver is bound, unbound or a
+ * device is added or removed (as told by the kernel uevents), or when
+ * reading a file fails, in which case the device is expanded again and
+ * the read retried once.
+ *
+ * All the functions are thread safe, and return 0, or -1 with errno set
+ * on failure. */
+
+/* Expand the glob in device into path, the first match in order. */
+int hwmon_resolve(const char *device, char *path, size_t size);
+
+/* Read the integer in device/attr, of any base as with scanf("%i").
+ * Callers pass the hwmon* glob of the device as is, there is no need to
+ * resolve it first. */
+int hwmon_read_int(const char *device, const char *attr, int *value);
+
+/* Read the number in device/attr as a float. */
+int hwmon_read_float(const char *device, const char *attr, float *value);
+
+/* Forget the expanded devices and close the files. */
+void hwmon_cache_invalidate(void);
+
+#ifdef __cplusplus
+}
+#endif
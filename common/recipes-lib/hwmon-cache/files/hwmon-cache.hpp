@@ -0,0 +1,66 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace hwmon
+{
+
+/* The expanded devices and open attribute files of a process, see
+ * hwmon-cache.h. */
+class Cache
+{
+  public:
+    // Files kept open at most, the others are opened for each read.
+    static constexpr size_t max_files = 256;
+
+    // The cache of this process, invalidated by the kernel uevents.
+    static Cache& instance();
+
+    // Invalidated by the uevents read from uevent_fd, a datagram socket,
+    // if not -1. Takes ownership of uevent_fd.
+    explicit Cache(int uevent_fd);
+    ~Cache();
+
+    // Return 0 or an errno value.
+    int resolve(const std::string& device, std::string& path);
+    int read(const std::string& device, const std::string& attr,
+             std::string& value);
+    void invalidate();
+
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+
+  private:
+    // Closed once the last reader is done with it.
+    struct File {
+      int fd;
+      explicit File(int f) : fd(f) {}
+      ~File();
+    };
+
+    // mutex is held.
+    void check_uevents();
+    int resolve_locked(const std::string& device, std::string& path);
+    int open(const std::string& device, const std::string& attr,
+             std::shared_ptr<File>& file);
+    void forget(const std::string& device, const std::string& attr);
+
+    std::mutex mutex;
+    int uevent_fd;
+    // Devices as given and expanded.
+    std::unordered_map<std::string, std::string> dirs;
+    // By device and attribute as given.
+    std::unordered_map<std::string, std::shared_ptr<File>> files;
+};
+
+// Whether a uevent changes the devices, and so the expanded globs.
+bool uevent_invalidates(const char* msg, size_t len);
+
+} // namespace hwmon
@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hwmon-cache.h"
+#include "hwmon-cache.hpp"
+
+/* A device tree as found under /sys. */
+static const std::string root = "./test";
+static const std::string device = root + "/3-0048/hwmon/hwmon*";
+
+static void write_file(const std::string& path, const std::string& value)
+{
+  FILE* fp = fopen(path.c_str(), "w");
+  assert(fp != nullptr);
+  fputs(value.c_str(), fp);
+  fclose(fp);
+}
+
+/* The driver probed again, the device gets the number n. */
+static void rebind(int n, const std::string& temp)
+{
+  assert(system(("rm -rf " + root + "/3-0048/hwmon").c_str()) == 0);
+  std::string dir = root + "/3-0048/hwmon/hwmon" + std::to_string(n);
+  assert(system(("mkdir -p " + dir).c_str()) == 0);
+  write_file(dir + "/temp1_input", temp);
+  write_file(dir + "/name", "lm75\n");
+}
+
+/* The fields of a uevent are separated by NULs. */
+template <size_t N>
+static void send_uevent(int fd, const char (&msg)[N])
+{
+  assert(send(fd, msg, N - 1, 0) == ssize_t(N - 1));
+}
+
+static void test_cache()
+{
+  int sv[2];
+  assert(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sv) == 0);
+  hwmon::Cache cache(sv[0]);
+  std::string path, value;
+
+  rebind(3, "42000\n");
+  assert(cache.resolve(device, path) == 0);
+  assert(path == root + "/3-0048/hwmon/hwmon3");
+  assert(cache.read(device, "temp1_input", value) == 0 && value == "42000\n");
+  printf("SUCCESS: globs are expanded\n");
+
+  // Like sysfs, the open file is read again from the start.
+  write_file(path + "/temp1_input", "43500\n");
+  assert(cache.read(device, "temp1_input", value) == 0 && value == "43500\n");
+  printf("SUCCESS: open files are read again\n");
+
+  assert(cache.read(device, "temp2_input", value) == ENOENT);
+  assert(cache.read(root + "/4-0049/hwmon/hwmon*", "temp1_input", value) ==
+         ENOENT);
+  printf("SUCCESS: missing devices and attributes\n");
+
+  // Only the files of a device removed fail in sysfs, not the ones
+  // removed here, so only the uevent tells the cache.
+  rebind(5, "30000\n");
+  send_uevent(sv[1], "change@/devices/3-0048\0ACTION=change");
+  assert(cache.read(device, "temp1_input", value) == 0 && value == "43500\n");
+  send_uevent(sv[1], "unbind@/devices/3-0048\0ACTION=unbind");
+  send_uevent(sv[1], "bind@/devices/3-0048\0ACTION=bind");
+  assert(cache.read(device, "temp1_input", value) == 0 && value == "30000\n");
+  assert(cache.resolve(device, path) == 0);
+  assert(path == root + "/3-0048/hwmon/hwmon5");
+  printf("SUCCESS: rebinds invalidate the cache\n");
+
+  // A file not open yet fails to open in the old directory.
+  rebind(6, "31000\n");
+  assert(cache.read(device, "name", value) == 0 && value == "lm75\n");
+  assert(cache.resolve(device, path) == 0);
+  assert(path == root + "/3-0048/hwmon/hwmon6");
+  printf("SUCCESS: failed reads expand the device again\n");
+
+  close(sv[1]);
+}
+
+static void test_uevents()
+{
+  assert(hwmon::uevent_invalidates("add@/devices/x", 14));
+  assert(hwmon::uevent_invalidates("remove@/devices/x", 17));
+  assert(!hwmon::uevent_invalidates("change@/devices/x", 17));
+  assert(!hwmon::uevent_invalidates("add", 3));
+  printf("SUCCESS: uevent actions\n");
+}
+
+static void test_c_api()
+{
+  char path[64];
+  int value;
+  float fvalue;
+
+  rebind(7, "0x1f\n");
+  assert(hwmon_resolve(device.c_str(), path, sizeof(path)) == 0);
+  assert(std::string(path) == root + "/3-0048/hwmon/hwmon7");
+  assert(hwmon_resolve(device.c_str(), path, 8) == -1 && errno == ENAMETOOLONG);
+  assert(hwmon_read_int(device.c_str(), "temp1_input", &value) == 0);
+  assert(value == 0x1f);
+  write_file(std::string(path) + "/temp1_input", "-1250\n");
+  assert(hwmon_read_int(device.c_str(), "temp1_input", &value) == 0);
+  assert(value == -1250);
+  write_file(std::string(path) + "/temp1_input", "12.5\n");
+  assert(hwmon_read_float(device.c_str(), "temp1_input", &fvalue) == 0);
+  assert(fvalue == 12.5f);
+  assert(hwmon_read_int(device.c_str(), "name", &value) == -1 &&
+         errno == EINVAL);
+  assert(hwmon_read_int(device.c_str(), "fan1_input", &value) == -1 &&
+         errno == ENOENT);
+  printf("SUCCESS: C API\n");
+
+  rebind(8, "100\n");
+  hwmon_cache_invalidate();
+  assert(hwmon_resolve(device.c_str(), path, sizeof(path)) == 0);
+  assert(std::string(path) == root + "/3-0048/hwmon/hwmon8");
+  printf("SUCCESS: explicit invalidation\n");
+}
+
+/* Compare with expanding the glob with a shell for each reading, as
+ * the PALs did. */
+static void benchmark()
+{
+  constexpr int reads = 200;
+  auto run = [](const char* what, auto&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++) {
+      fn();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("%-16s %10.1f us/read\n", what, elapsed.count() * 1e6 / reads);
+  };
+
+  rebind(3, "42000\n");
+  run("popen+fopen", []() {
+    char dir[256], path[300];
+    std::string cmd = "cd " + device + ";pwd";
+    FILE* fp = popen(cmd.c_str(), "r");
+    assert(fp != nullptr && fgets(dir, sizeof(dir), fp) != nullptr);
+    pclose(fp);
+    dir[strlen(dir) - 1] = '\0';
+    snprintf(path, sizeof(path), "%s/temp1_input", dir);
+    int value;
+    fp = fopen(path, "r");
+    assert(fp != nullptr && fscanf(fp, "%i", &value) == 1);
+    fclose(fp);
+  });
+  run("hwmon_read_int", []() {
+    int value;
+    assert(hwmon_read_int(device.c_str(), "temp1_input", &value) == 0);
+  });
+}
+
+int main(int argc, char* argv[])
+{
+  assert(system(("rm -rf " + root).c_str()) == 0);
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    benchmark();
+  } else {
+    test_uevents();
+    test_cache();
+    test_c_api();
+  }
+  assert(system(("rm -rf " + root).c_str()) == 0);
+  return 0;
+}
@@ -4,8 +4,13 @@
 #include <iostream>
 #include <limits>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <regex>
+#include <set>
 #include <dirent.h>
+#include <cstring>
+#include <syslog.h>
 
 #include "fileops.hpp"
 #include "kv.hpp"
@@ -129,6 +134,109 @@ void FileHandle::write(std::string value) {
   }
 }
 
+bool FileHandle::exists(const std::string& key, region r)
+{
+  FileHandle::path p = r == region::persist ? kv_store : cache_store;
+  return fs::exists(p / key);
+}
+
+static std::error_code last_error() {
+  return std::error_code(errno, std::system_category());
+}
+
+/* Closes a file descriptor, releasing its flock. */
+class FdGuard
+{
+  public:
+    explicit FdGuard(int f) : fd(f) {}
+    ~FdGuard() { if (fd >= 0) close(fd); }
+    FdGuard(const FdGuard&) = delete;
+    FdGuard& operator=(const FdGuard&) = delete;
+    const int fd;
+};
+
+FileHandle::path FileHandle::region_path(region r) {
+  return r == region::persist ? kv_store : cache_store;
+}
+
+std::optional<std::string> FileHandle::read_key(const std::string& key,
+                                                region r) {
+  auto fpath = region_path(r) / key;
+  FdGuard f(open(fpath.c_str(), O_RDONLY | O_CLOEXEC));
+  if (f.fd < 0) {
+    if (errno == ENOENT || errno == ENOTDIR) {
+      return std::nullopt;
+    }
+    throw fs::filesystem_error("kv: error opening file", fpath, last_error());
+  }
+  if (flock(f.fd, LOCK_EX) != 0) {
+    throw fs::filesystem_error("kv: error calling flock", fpath, last_error());
+  }
+  std::array<char, max_len> data{};
+  auto bytes = ::read(f.fd, data.data(), max_len);
+  if (bytes < 0) {
+    throw fs::filesystem_error(
+        "kv: error reading from file", fpath, last_error());
+  }
+  return std::string{std::begin(data), std::begin(data) + bytes};
+}
+
+static void write_file(const FileHandle::path& fpath, const std::string& value,
+                       bool skip_same) {
+  FdGuard f(open(fpath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666));
+  if (f.fd < 0) {
+    throw fs::filesystem_error("kv: error opening file", fpath, last_error());
+  }
+  if (flock(f.fd, LOCK_EX) != 0) {
+    throw fs::filesystem_error("kv: error calling flock", fpath, last_error());
+  }
+  if (skip_same) {
+    std::array<char, max_len> data{};
+    auto bytes = pread(f.fd, data.data(), max_len, 0);
+    if (bytes >= 0 && size_t(bytes) == value.size() &&
+        memcmp(data.data(), value.data(), bytes) == 0) {
+      return;
+    }
+  }
+  if (ftruncate(f.fd, 0) < 0) {
+    throw fs::filesystem_error(
+        "kv: error calling ftruncate", fpath, last_error());
+  }
+  auto bytes = pwrite(f.fd, value.data(), value.size(), 0);
+  if (bytes < 0) {
+    throw fs::filesystem_error(
+        "kv: error writing to file", fpath, last_error());
+  }
+  if (size_t(bytes) != value.size()) {
+    throw fs::filesystem_error(
+        "kv: error writing full contents to file", fpath,
+        std::error_code(ENOSPC, std::system_category()));
+  }
+}
+
+static void apply_batch(const key_values& entries, region r, bool skip_same) {
+  auto base = FileHandle::region_path(r);
+  // Most keys of a batch share a handful of directories.
+  std::set<FileHandle::path> dirs;
+  for (const auto& [key, value] : entries) {
+    auto fpath = base / key;
+    if (dirs.insert(fpath.parent_path()).second) {
+      create_dir(fpath.parent_path());
+    }
+    write_file(fpath, value, skip_same);
+  }
+}
+
+void FileHandle::write_batch(const key_values& entries, region r) {
+  for (const auto& [key, value] : entries) {
+    if (key.empty() || value.size() > max_len) {
+      throw std::invalid_argument("kv: invalid batch entry " + key);
+    }
+  }
+  // Keys which already hold their value cost no flash writes.
+  apply_batch(entries, r, r == region::persist);
+}
+
 void FileHandle::remove(const std::string& key, region r)
 {
   //If a file is passed as key and it exists, remove it.
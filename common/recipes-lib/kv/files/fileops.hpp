@@ -13,6 +13,7 @@ namespace std
 #else
 #include <filesystem>
 #endif
+#include <optional>
 #include <string>
 #include <sys/file.h>
 
@@ -46,6 +47,16 @@ class FileHandle
     std::string read();
     void write(std::string value);
     static void remove(const std::string& key, region r);
+    static bool exists(const std::string& key, region r);
+
+    // Batched access for kv::get_many/set_many. These open the files
+    // directly instead of through a FileHandle.
+    static std::optional<std::string> read_key(const std::string& key,
+                                               region r);
+    // Writes key by key, persistent keys only when their value changes.
+    static void write_batch(const key_values& entries, region r);
+    // Directory holding the keys of a region.
+    static path region_path(region r);
 
     FileHandle(const FileHandle&) = delete;
     FileHandle(FileHandle&&) = delete;
@@ -0,0 +1,533 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <array>
+#include <cstring>
+#include <regex>
+#include <system_error>
+#include <tuple>
+
+#include "journalops.hpp"
+#include "fileops.hpp"
+#include "log.hpp"
+
+namespace fs = std::filesystem;
+
+namespace kv
+{
+
+struct journal_header {
+  uint32_t magic;
+  uint32_t version;
+};
+constexpr uint32_t journal_magic = 0x4b564a31; // "KVJ1"
+constexpr uint32_t journal_version = 1;
+
+/* Each record is a header followed by the key and the value. */
+struct record_header {
+  uint32_t crc;       // CRC-32 of the rest of the record.
+  uint16_t key_len;
+  uint16_t value_len;
+  uint8_t type;
+  uint8_t flags;
+  uint16_t reserved;
+};
+static_assert(sizeof(record_header) == 12, "record_header must be packed");
+
+enum : uint8_t { record_set = 1, record_del = 2 };
+/* The batch continues with the next record. */
+constexpr uint8_t record_more = 1 << 0;
+
+static std::system_error sys_error(const std::string& what) {
+  return std::system_error(errno, std::generic_category(), what);
+}
+
+static uint32_t crc32(const char* data, size_t len, uint32_t crc = 0) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc = table[(crc ^ uint8_t(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static size_t record_size(const std::string& key, const std::string& value) {
+  return sizeof(record_header) + key.size() + value.size();
+}
+
+static void encode(std::string& buf, uint8_t type, const std::string& key,
+                   const std::string& value, bool more) {
+  if (key.size() > UINT16_MAX || value.size() > max_len) {
+    throw std::invalid_argument("kv: key or value too long: " + key);
+  }
+  record_header hdr{};
+  hdr.key_len = key.size();
+  hdr.value_len = value.size();
+  hdr.type = type;
+  hdr.flags = more ? record_more : 0;
+  auto body = reinterpret_cast<const char*>(&hdr) + sizeof(hdr.crc);
+  hdr.crc = crc32(body, sizeof(hdr) - sizeof(hdr.crc));
+  hdr.crc = crc32(key.data(), key.size(), hdr.crc);
+  hdr.crc = crc32(value.data(), value.size(), hdr.crc);
+  buf.append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+  buf += key;
+  buf += value;
+}
+
+static std::string encode_header() {
+  journal_header hdr{journal_magic, journal_version};
+  return std::string(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+}
+
+/* Durably replace the file at path with data. */
+static void replace_file(const std::string& path, const std::string& data) {
+  auto tmp = path + ".tmp";
+  int f = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (f < 0) {
+    throw sys_error("kv: open " + tmp);
+  }
+  if (write(f, data.data(), data.size()) != ssize_t(data.size()) ||
+      fdatasync(f) != 0) {
+    auto e = sys_error("kv: write " + tmp);
+    close(f);
+    throw e;
+  }
+  close(f);
+  if (rename(tmp.c_str(), path.c_str()) != 0) {
+    throw sys_error("kv: rename " + tmp);
+  }
+  auto dir = fs::path(path).parent_path();
+  int d = open(dir.empty() ? "." : dir.c_str(),
+               O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (d >= 0) {
+    fsync(d);
+    close(d);
+  }
+}
+
+/* Serializes writers of all processes. */
+class Journal::WriteLock
+{
+  public:
+    explicit WriteLock(const std::string& path) {
+      // Opened for each lock: an fd inherited across fork() would
+      // share its lock with the parent.
+      fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+      if (fd < 0) {
+        throw sys_error("kv: open " + path);
+      }
+      if (flock(fd, LOCK_EX) != 0) {
+        auto e = sys_error("kv: flock " + path);
+        close(fd);
+        throw e;
+      }
+    }
+    ~WriteLock() { close(fd); }
+    WriteLock(const WriteLock&) = delete;
+    WriteLock& operator=(const WriteLock&) = delete;
+  private:
+    int fd;
+};
+
+Journal::Journal(const std::string& path)
+    : jpath(path), lpath(path + ".lock") {
+  auto dir = fs::path(jpath).parent_path();
+  if (!dir.empty()) {
+    fs::create_directories(dir);
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  WriteLock wlock(lpath);
+  if (!fs::exists(jpath)) {
+    create();
+  }
+  catch_up(true);
+}
+
+Journal::~Journal() {
+  if (flusher != nullptr && flusher_pid == getpid()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_one();
+    flusher->join();
+    delete flusher;
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  sync_locked(lock);
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+Journal& Journal::instance() {
+  static Journal journal(
+      FileHandle::region_path(region::persist).string() + ".journal");
+  return journal;
+}
+
+void Journal::create() {
+  // Start out with the keys of the file store. The files are left
+  // alone, so the file backend can still be switched back to.
+  key_values entries;
+  auto store = FileHandle::region_path(region::persist);
+  if (fs::is_directory(store)) {
+    for (auto& entry : fs::recursive_directory_iterator(store)) {
+      if (!fs::is_regular_file(entry)) {
+        continue;
+      }
+      auto key = entry.path().string().substr(store.string().length() + 1);
+      if (auto value = FileHandle::read_key(key, region::persist)) {
+        entries.emplace_back(key, *value);
+      }
+    }
+  }
+  auto buf = encode_header();
+  for (size_t i = 0; i < entries.size(); i++) {
+    encode(buf, record_set, entries[i].first, entries[i].second,
+           i + 1 < entries.size());
+  }
+  replace_file(jpath, buf);
+  counters.bytes_written += buf.size();
+  counters.syncs++;
+  if (!entries.empty()) {
+    KV_WARN("kv: imported %zu keys into %s", entries.size(), jpath.c_str());
+  }
+}
+
+void Journal::reopen() {
+  if (fd >= 0) {
+    close(fd);
+  }
+  fd = open(jpath.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+  if (fd < 0) {
+    throw sys_error("kv: open " + jpath);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    throw sys_error("kv: fstat " + jpath);
+  }
+  ino = st.st_ino;
+  offset = 0;
+  index.clear();
+  live_bytes = 0;
+}
+
+void Journal::put(const std::string& key, const std::string& value) {
+  auto it = index.find(key);
+  if (it != index.end()) {
+    live_bytes -= record_size(key, it->second);
+    it->second = value;
+  } else {
+    index.emplace(key, value);
+  }
+  live_bytes += record_size(key, value);
+}
+
+void Journal::erase(const std::string& key) {
+  auto it = index.find(key);
+  if (it != index.end()) {
+    live_bytes -= record_size(key, it->second);
+    index.erase(it);
+  }
+}
+
+void Journal::catch_up(bool writer) {
+  struct stat st;
+  if (stat(jpath.c_str(), &st) != 0) {
+    throw sys_error("kv: stat " + jpath);
+  }
+  if (fd < 0 || st.st_ino != ino || st.st_size < offset) {
+    // The journal was compacted (Or is new to us): start over.
+    reopen();
+    if (fstat(fd, &st) != 0) {
+      throw sys_error("kv: fstat " + jpath);
+    }
+  }
+  if (st.st_size == offset) {
+    return;
+  }
+
+  std::string buf(st.st_size - offset, '\0');
+  auto bytes = pread(fd, buf.data(), buf.size(), offset);
+  if (bytes < 0) {
+    throw sys_error("kv: read " + jpath);
+  }
+  buf.resize(bytes);
+
+  size_t pos = 0;
+  if (offset == 0) {
+    journal_header hdr{};
+    if (buf.size() >= sizeof(hdr)) {
+      memcpy(&hdr, buf.data(), sizeof(hdr));
+    }
+    if (hdr.magic != journal_magic || hdr.version != journal_version) {
+      throw std::runtime_error("kv: unknown journal format " + jpath);
+    }
+    pos = sizeof(hdr);
+  }
+
+  // Records are applied a whole batch at a time.
+  size_t committed = pos;
+  std::vector<std::tuple<uint8_t, std::string, std::string>> batch;
+  while (pos + sizeof(record_header) <= buf.size()) {
+    record_header hdr;
+    memcpy(&hdr, &buf[pos], sizeof(hdr));
+    size_t end = pos + sizeof(hdr) + hdr.key_len + hdr.value_len;
+    if (end > buf.size() ||
+        crc32(&buf[pos + sizeof(hdr.crc)], end - pos - sizeof(hdr.crc)) !=
+            hdr.crc) {
+      break;
+    }
+    auto key = buf.substr(pos + sizeof(hdr), hdr.key_len);
+    auto value = buf.substr(pos + sizeof(hdr) + hdr.key_len, hdr.value_len);
+    batch.emplace_back(hdr.type, std::move(key), std::move(value));
+    pos = end;
+    if (hdr.flags & record_more) {
+      continue;
+    }
+    for (const auto& [type, k, v] : batch) {
+      if (type == record_set) {
+        put(k, v);
+      } else if (type == record_del) {
+        erase(k);
+      }
+    }
+    batch.clear();
+    committed = pos;
+  }
+  offset += committed;
+
+  // Readers may see an append in progress, but with the write lock
+  // held, anything left is the torn tail of an append that failed.
+  if (writer && offset != st.st_size) {
+    KV_WARN("kv: dropping %zu torn bytes from %s",
+            size_t(st.st_size - offset), jpath.c_str());
+    if (ftruncate(fd, offset) != 0) {
+      throw sys_error("kv: ftruncate " + jpath);
+    }
+  }
+}
+
+void Journal::append(const std::string& records) {
+  auto bytes = write(fd, records.data(), records.size());
+  if (bytes != ssize_t(records.size())) {
+    // A partial record is dropped by the next writer.
+    throw sys_error("kv: write " + jpath);
+  }
+  offset += records.size();
+  counters.appends++;
+  counters.bytes_written += records.size();
+
+  pending = true;
+  if (flusher_pid != getpid()) {
+    // The first append of this process. A forked child does not have
+    // the thread of its parent.
+    flusher = new std::thread(&Journal::flush_loop, this);
+    flusher_pid = getpid();
+  }
+  cv.notify_one();
+}
+
+std::optional<std::string> Journal::get(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  catch_up(false);
+  auto it = index.find(key);
+  if (it == index.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+bool Journal::set(const std::string& key, const std::string& value,
+                  bool require_create) {
+  std::lock_guard<std::mutex> lock(mutex);
+  WriteLock wlock(lpath);
+  catch_up(true);
+  auto it = index.find(key);
+  if (it != index.end()) {
+    if (require_create) {
+      return false;
+    }
+    // Same value, nothing to write to flash.
+    if (it->second == value) {
+      return true;
+    }
+  }
+  std::string records;
+  encode(records, record_set, key, value, false);
+  append(records);
+  put(key, value);
+  return true;
+}
+
+void Journal::set_many(const key_values& entries) {
+  std::lock_guard<std::mutex> lock(mutex);
+  WriteLock wlock(lpath);
+  catch_up(true);
+  key_values changed;
+  for (const auto& entry : entries) {
+    auto it = index.find(entry.first);
+    if (it == index.end() || it->second != entry.second) {
+      changed.push_back(entry);
+    }
+  }
+  if (changed.empty()) {
+    return;
+  }
+  std::string records;
+  for (size_t i = 0; i < changed.size(); i++) {
+    encode(records, record_set, changed[i].first, changed[i].second,
+           i + 1 < changed.size());
+  }
+  append(records);
+  for (const auto& [key, value] : changed) {
+    put(key, value);
+  }
+}
+
+size_t Journal::del(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  WriteLock wlock(lpath);
+  catch_up(true);
+  std::vector<std::string> victims;
+  if (index.count(key) != 0) {
+    victims.push_back(key);
+  } else {
+    // As with files, the key could be a regex.
+    try {
+      const std::regex search(key);
+      for (const auto& entry : index) {
+        if (std::regex_match(entry.first, search)) {
+          victims.push_back(entry.first);
+        }
+      }
+    } catch (std::regex_error&) {
+    }
+  }
+  if (victims.empty()) {
+    return 0;
+  }
+  std::string records;
+  for (size_t i = 0; i < victims.size(); i++) {
+    encode(records, record_del, victims[i], "", i + 1 < victims.size());
+  }
+  append(records);
+  for (const auto& victim : victims) {
+    erase(victim);
+  }
+  return victims.size();
+}
+
+std::vector<std::string> Journal::keys(const std::string& prefix) {
+  std::lock_guard<std::mutex> lock(mutex);
+  catch_up(false);
+  std::vector<std::string> found;
+  for (const auto& entry : index) {
+    if (entry.first.compare(0, prefix.size(), prefix) == 0) {
+      found.push_back(entry.first);
+    }
+  }
+  return found;
+}
+
+bool Journal::needs_compaction() const {
+  return size_t(offset) > compact_min_size &&
+         size_t(offset) > 2 * (live_bytes + sizeof(journal_header));
+}
+
+void Journal::compact() {
+  std::lock_guard<std::mutex> lock(mutex);
+  compact_locked();
+}
+
+void Journal::compact_locked() {
+  WriteLock wlock(lpath);
+  catch_up(true);
+  auto buf = encode_header();
+  size_t left = index.size();
+  for (const auto& [key, value] : index) {
+    encode(buf, record_set, key, value, --left > 0);
+  }
+  replace_file(jpath, buf);
+
+  // Other processes notice the new inode and replay it.
+  if (fd >= 0) {
+    close(fd);
+  }
+  fd = open(jpath.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fd = -1;
+    throw sys_error("kv: open " + jpath);
+  }
+  ino = st.st_ino;
+  offset = buf.size();
+  // Anything pending was in the old journal, the new one is synced.
+  pending = false;
+  counters.compactions++;
+  counters.syncs++;
+  counters.bytes_written += buf.size();
+}
+
+void Journal::sync() {
+  std::unique_lock<std::mutex> lock(mutex);
+  sync_locked(lock);
+}
+
+void Journal::sync_locked(std::unique_lock<std::mutex>& lock) {
+  if (!pending || fd < 0) {
+    return;
+  }
+  pending = false;
+  // Readers need not wait for the flash.
+  int f = dup(fd);
+  lock.unlock();
+  if (f < 0 || fdatasync(f) != 0) {
+    KV_WARN("kv: fdatasync %s: %s", jpath.c_str(), strerror(errno));
+  }
+  if (f >= 0) {
+    close(f);
+  }
+  lock.lock();
+  counters.syncs++;
+}
+
+void Journal::flush_loop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    cv.wait(lock, [this] { return pending || stopping; });
+    // Let more appends join this commit.
+    cv.wait_for(lock, commit_window, [this] { return stopping; });
+    sync_locked(lock);
+    if (!stopping && needs_compaction()) {
+      try {
+        compact_locked();
+      } catch (std::exception& e) {
+        KV_WARN("kv: compacting %s: %s", jpath.c_str(), e.what());
+      }
+    }
+  }
+}
+
+Journal::stats Journal::get_stats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return counters;
+}
+
+} // namespace kv
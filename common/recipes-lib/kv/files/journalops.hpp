@@ -0,0 +1,110 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+
+#include <sys/types.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "kv.hpp"
+
+namespace kv
+{
+
+/* Log-structured backend for region::persist.
+ *
+ * Every change is appended to a single journal file instead of
+ * rewriting one file per key. A background thread makes appends
+ * durable with one fdatasync per commit window (group commit), and
+ * compacts the journal by rewriting the live keys once it is mostly
+ * dead records. Each process keeps all keys in memory and catches up
+ * with the appends of other processes on access, so a read costs a
+ * stat() of the journal.
+ *
+ * Writers serialize on a lock file next to the journal. Records carry
+ * a checksum and a batch of records is only applied once its last
+ * record is complete: batches are atomic, and a torn tail left by a
+ * power loss is dropped.
+ */
+class Journal
+{
+  public:
+    static constexpr auto commit_window = std::chrono::milliseconds(200);
+    static constexpr size_t compact_min_size = 64 * 1024;
+
+    struct stats {
+      size_t appends = 0;
+      size_t bytes_written = 0;  // Including compaction.
+      size_t syncs = 0;
+      size_t compactions = 0;
+    };
+
+    // Opens the journal at path. A new journal starts out with the
+    // keys of the file store. Throws std::system_error on failure.
+    explicit Journal(const std::string& path);
+    ~Journal();
+
+    // The journal of the persistent region.
+    static Journal& instance();
+
+    std::optional<std::string> get(const std::string& key);
+    // Returns false if require_create and the key exists.
+    bool set(const std::string& key, const std::string& value,
+             bool require_create);
+    void set_many(const key_values& entries);
+    // Delete a key, or all keys matching a regex. Returns the number
+    // of keys deleted.
+    size_t del(const std::string& key);
+    std::vector<std::string> keys(const std::string& prefix);
+
+    // Commit pending appends without waiting for the commit window.
+    void sync();
+    void compact();
+    stats get_stats();
+    const std::string& path() const { return jpath; }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+  private:
+    class WriteLock;
+
+    std::string jpath;
+    std::string lpath;
+    int fd = -1;
+    ino_t ino = 0;
+    // Replayed up to here.
+    off_t offset = 0;
+    // Size of the records of the keys in index.
+    size_t live_bytes = 0;
+    std::unordered_map<std::string, std::string> index;
+    stats counters;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool pending = false;
+    bool stopping = false;
+    // Only the process which started the thread can join it.
+    std::thread* flusher = nullptr;
+    pid_t flusher_pid = 0;
+
+    void create();
+    void reopen();
+    void catch_up(bool writer);
+    void append(const std::string& records);
+    void put(const std::string& key, const std::string& value);
+    void erase(const std::string& key);
+    bool needs_compaction() const;
+    void compact_locked();
+    void sync_locked(std::unique_lock<std::mutex>& lock);
+    void flush_loop();
+};
+
+} // namespace kv
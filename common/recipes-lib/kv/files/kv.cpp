@@ -5,27 +5,20 @@
 #include <syslog.h>
 #include <limits>
 #include <iostream>
+#include <mutex>
 
 #include "kv.hpp"
 #include "fileops.hpp"
+#include "journalops.hpp"
+#include "shmops.hpp"
+#include "watchops.hpp"
 #include "log.hpp"
 
 using namespace kv;
 
-/*
-*  set key::value
-*  len is the size of value. If 0, it is assumed value is
-*      a string and strlen() is used to determine the length.
-*  flags is bitmask of options.
-*
-*  return 0 on success, negative error code on failure.
-*/
-int kv_set(const char *key, const char *value, size_t len, unsigned int flags) {
-  if (key == nullptr || value == nullptr) {
-    errno = EINVAL;
-    return -1;
-  }
-
+/* Length of the value to set, following the rules of kv_set.
+ * Returns false with errno set if it is too long. */
+static bool value_length(const char *value, size_t& len) {
   /* Length of zero implies we should treat it like a string. */
   if (len == 0) {
     /* The typical buffer allocated is exactly MAX_VALUE_LEN bytes, so we
@@ -38,11 +31,55 @@ int kv_set(const char *key, const char *value, size_t len, unsigned int flags) {
      * Assume it is missing and give E2BIG error. */
     if (len >= MAX_VALUE_LEN) {
       errno = E2BIG;
-      return -1;
+      return false;
     }
   }
   if (len > MAX_VALUE_LEN) {
     errno = E2BIG;
+    return false;
+  }
+  return true;
+}
+
+/* Copy a value out to the caller, following the rules of kv_get. */
+static void copy_value(const char *key, const std::string& result,
+                       char *value, size_t *len) {
+  auto bytes = result.size();
+
+  // result is required to be less than or equal to 'MAX_VALUE_LEN' and
+  // value is required to have enough space to store at least that, so
+  // this copy is always safe.
+  std::copy(std::begin(result), std::end(result), value);
+
+  // Update length variable.
+  if (len != nullptr)
+    *len = bytes;
+  // If no length was given, treat it as a string.  Ensure we have a null
+  // terminator.
+  else if ((bytes + 1) < max_len)
+    value[bytes] = '\0';
+  else if (value[max_len - 1] != '\0') {
+    KV_WARN("kv_get: truncating string-type value for key %s with length %zd",
+        key, bytes);
+    value[max_len - 1] = '\0';
+  }
+}
+
+/*
+*  set key::value
+*  len is the size of value. If 0, it is assumed value is
+*      a string and strlen() is used to determine the length.
+*  flags is bitmask of options.
+*
+*  return 0 on success, negative error code on failure.
+*/
+int kv_set(const char *key, const char *value, size_t len, unsigned int flags) {
+  if (key == nullptr || value == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (!value_length(value, len)) {
     return -1;
   }
 
@@ -84,25 +121,7 @@ int kv_get(const char *key, char *value, size_t *len, unsigned int flags) {
   try {
     auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
     auto result = kv::get(key, r);
-    auto bytes = result.size();
-
-    // result is required to be less than or equal to 'MAX_VALUE_LEN' and
-    // value is required to have enough space to store at least that, so
-    // this copy is always safe.
-    std::copy(std::begin(result), std::end(result), value);
-
-    // Update length variable.
-    if (len != nullptr)
-      *len = bytes;
-    // If no length was given, treat it as a string.  Ensure we have a null
-    // terminator.
-    else if ((bytes + 1) < max_len)
-      value[bytes] = '\0';
-    else if (value[max_len - 1] != '\0') {
-      KV_WARN("kv_get: truncating string-type value for key %s with length %zd",
-          key, bytes);
-      value[max_len - 1] = '\0';
-    }
+    copy_value(key, result, value, len);
   } catch (std::filesystem::filesystem_error& e) {
     // Eat no-such-file errors and just return a -1.
     // Too many callers try to look up kv-entries for entries that haven't
@@ -143,11 +162,210 @@ int kv_del(const char *key, unsigned int flags)
   return 0;
 }
 
+/*
+*  get count keys at once. Missing keys are returned with a length of
+*      KV_BATCH_MISSING.
+*
+*  return the number of keys found, negative error code on failure.
+*/
+int kv_get_batch(const char **keys, char **values, size_t *lens,
+                 size_t count, unsigned int flags) {
+  if (keys == nullptr || values == nullptr || (flags & KV_FCREATE)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  int found = 0;
+  try {
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      if (keys[i] == nullptr || values[i] == nullptr) {
+        errno = EINVAL;
+        return -1;
+      }
+      names.emplace_back(keys[i]);
+    }
+    auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
+    auto results = kv::get_many(names, r);
+    for (size_t i = 0; i < count; i++) {
+      if (!results[i]) {
+        if (lens != nullptr)
+          lens[i] = KV_BATCH_MISSING;
+        else
+          values[i][0] = '\0';
+        continue;
+      }
+      copy_value(keys[i], *results[i], values[i],
+                 lens != nullptr ? &lens[i] : nullptr);
+      found++;
+    }
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_get_batch: %s", e.what());
+    return -1;
+  }
+
+  return found;
+}
+
+/*
+*  set count key::value pairs at once. lens may be NULL if all values
+*      are strings.
+*
+*  return 0 on success, negative error code on failure.
+*/
+int kv_set_batch(const char **keys, const char **values, const size_t *lens,
+                 size_t count, unsigned int flags) {
+  if (keys == nullptr || values == nullptr || (flags & KV_FCREATE)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    kv::key_values entries;
+    entries.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      if (keys[i] == nullptr || values[i] == nullptr) {
+        errno = EINVAL;
+        return -1;
+      }
+      size_t len = lens != nullptr ? lens[i] : 0;
+      if (!value_length(values[i], len)) {
+        return -1;
+      }
+      entries.emplace_back(keys[i], std::string{values[i], values[i] + len});
+    }
+    auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
+    kv::set_many(entries, r);
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_set_batch: %s", e.what());
+    return -1;
+  }
+
+  return 0;
+}
+
+int kv_watch(const char *key, unsigned int flags, kv_watch_cb cb, void *arg)
+{
+  if (key == nullptr || cb == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+  try {
+    auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
+    return kv::watch(key,
+        [cb, arg](const std::string& k, const std::optional<std::string>& v) {
+          if (v) {
+            cb(k.c_str(), v->c_str(), v->size(), arg);
+          } else {
+            cb(k.c_str(), nullptr, 0, arg);
+          }
+        }, r, flags & KV_FPREFIX);
+  } catch (std::invalid_argument& e) {
+    errno = EINVAL;
+    return -1;
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_watch: %s", e.what());
+    return -1;
+  }
+}
+
+int kv_unwatch(int id)
+{
+  try {
+    kv::unwatch(id);
+  } catch (kv::key_does_not_exist& e) {
+    errno = ENOENT;
+    return -1;
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_unwatch: %s", e.what());
+    return -1;
+  }
+  return 0;
+}
+
+int kv_watch_fd(void)
+{
+  try {
+    return kv::watch_fd();
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_watch_fd: %s", e.what());
+    return -1;
+  }
+}
+
+int kv_watch_dispatch(void)
+{
+  try {
+    return kv::watch_dispatch();
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_watch_dispatch: %s", e.what());
+    return -1;
+  }
+}
+
 namespace kv {
 
+/* The journal when it backs the region, else nullptr. */
+static Journal* journal([[maybe_unused]] region r)
+{
+#ifdef KV_PERSIST_JOURNAL
+  if (r == region::persist) {
+    return &Journal::instance();
+  }
+#endif
+  return nullptr;
+}
+
+static std::filesystem::filesystem_error no_key(const std::string& key)
+{
+  return std::filesystem::filesystem_error(
+      "kv: key not found", key,
+      std::error_code(ENOENT, std::system_category()));
+}
+
+/* The shared memory table when it backs the region, else nullptr. */
+static ShmStore* shm_store([[maybe_unused]] region r)
+{
+#ifdef KV_TEMP_SHM
+  if (r == region::temp) {
+    return ShmStore::instance();
+  }
+#endif
+  return nullptr;
+}
+
 void set(const std::string& key, const std::string& value,
          region r, bool require_create)
 {
+  if (auto j = journal(r)) {
+    if (!j->set(key, value, require_create)) {
+      throw key_already_exists("kv_set: key " + key + " already exists");
+    }
+    return;
+  }
+  if (auto shm = shm_store(r)) {
+    // Keys created by scripts straight in the cache directory are
+    // still found there.
+    if (require_create && FileHandle::exists(key, r)) {
+      throw key_already_exists("kv_set: key " + key + " already exists");
+    }
+    switch (shm->set(key, value, require_create)) {
+      case ShmStore::result::ok:
+        return;
+      case ShmStore::result::exists:
+        throw key_already_exists("kv_set: key " + key + " already exists");
+      case ShmStore::result::full:
+        // Does not fit in the table, store it in a file instead.
+        break;
+    }
+  }
 
   FileHandle fp;
   fp.open_and_lock<FileHandle::access::write>(key, r);
@@ -168,6 +386,21 @@ void set(const std::string& key, const std::string& value,
 
 std::string get(const std::string& key, region r)
 {
+  if (auto j = journal(r)) {
+    if (auto value = j->get(key)) {
+      return *value;
+    }
+    throw no_key(key);
+  }
+  if (auto shm = shm_store(r)) {
+    std::string value;
+    if (shm->get(key, value)) {
+      return value;
+    }
+    // Not in the table, it might be a key which did not fit or was
+    // created by a script.
+  }
+
   FileHandle fp;
   fp.open_and_lock<FileHandle::access::read>(key, r);
 
@@ -176,8 +409,100 @@ std::string get(const std::string& key, region r)
 
 void del(const std::string& key, region r)
 {
+  if (auto j = journal(r)) {
+    if (j->del(key) == 0) {
+      throw key_does_not_exist(key);
+    }
+    return;
+  }
+  if (auto shm = shm_store(r)) {
+    if (shm->del(key)) {
+      // Clear out a file of the same name created by a script.
+      if (FileHandle::exists(key, r)) {
+        FileHandle::remove(key, r);
+      }
+      return;
+    }
+    // As with files, the key could be a regex.
+    bool found = false;
+    try {
+      found = shm->del_matching(std::regex(key)) > 0;
+    } catch (std::regex_error&) {
+    }
+    try {
+      FileHandle::remove(key, r);
+    } catch (key_does_not_exist&) {
+      if (!found) {
+        throw;
+      }
+    }
+    return;
+  }
   FileHandle::remove(key, r);
 }
 
+std::vector<std::optional<std::string>> get_many(
+    const std::vector<std::string>& keys, region r)
+{
+  std::vector<std::optional<std::string>> values(keys.size());
+  auto j = journal(r);
+  auto shm = shm_store(r);
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::string value;
+    if (j) {
+      values[i] = j->get(keys[i]);
+    } else if (shm && shm->get(keys[i], value)) {
+      values[i] = std::move(value);
+    } else {
+      values[i] = FileHandle::read_key(keys[i], r);
+    }
+  }
+  return values;
+}
+
+void set_many(const key_values& entries, region r)
+{
+  if (auto j = journal(r)) {
+    // A single append, so the batch is one write to flash.
+    j->set_many(entries);
+    return;
+  }
+  auto shm = shm_store(r);
+  if (!shm) {
+    FileHandle::write_batch(entries, r);
+    return;
+  }
+  // Keys which do not fit in the table go to files.
+  key_values rest;
+  for (const auto& entry : entries) {
+    if (shm->set(entry.first, entry.second, false) != ShmStore::result::ok) {
+      rest.push_back(entry);
+    }
+  }
+  if (!rest.empty()) {
+    FileHandle::write_batch(rest, r);
+  }
+}
+
+int watch(const std::string& key, watch_callback cb, region r, bool prefix)
+{
+  return Watcher::instance().add(key, r, prefix, std::move(cb));
+}
+
+void unwatch(int id)
+{
+  Watcher::instance().remove(id);
+}
+
+int watch_fd()
+{
+  return Watcher::instance().fd();
+}
+
+int watch_dispatch()
+{
+  return Watcher::instance().dispatch();
+}
+
 
 } // namespace kv
@@ -26,10 +26,49 @@ extern "C" {
 /* Will set the key:value only if the key does not already exist */
 #define KV_FCREATE        (1 << 1)
 
+/* Watch all keys starting with the key (See kv_watch) */
+#define KV_FPREFIX        (1 << 2)
+
 int kv_get(const char *key, char *value, size_t *len, unsigned int flags);
 int kv_set(const char *key, const char *value, size_t len, unsigned int flags);
 int kv_del(const char *key, unsigned int flags);
 
+/* Get or set count keys at once. The arrays are indexed alike and lens
+ * follows the rules of kv_get/kv_set for each key (It may be NULL for
+ * strings). Keys which do not exist are returned with a length of
+ * KV_BATCH_MISSING (Or as an empty string if lens is NULL).
+ * KV_FCREATE is not supported.
+ *
+ * With the default file backend, a persistent batch is written key by
+ * key like kv_set, skipping keys which already hold their value.
+ * Readers, and a power loss, may catch it half applied. With the
+ * journal backend (persist_backend=journal), a persistent batch is a
+ * single append: one write to flash, which is stored and seen by
+ * readers all at once or not at all.
+ *
+ * kv_get_batch returns the number of keys found, kv_set_batch returns
+ * 0. Both return -1 with errno set on failure. */
+#define KV_BATCH_MISSING  ((size_t)-1)
+
+int kv_get_batch(const char **keys, char **values, size_t *lens,
+                 size_t count, unsigned int flags);
+int kv_set_batch(const char **keys, const char **values, const size_t *lens,
+                 size_t count, unsigned int flags);
+
+/* Call cb when a key changes, with its new value (NULL once deleted).
+ * Callbacks are run by kv_watch_dispatch(), which does not block and
+ * should be called whenever kv_watch_fd() is readable (e.g. from a
+ * poll() loop). Changes made by any process are seen, including to
+ * keys kept in shared memory. kv_watch returns an id for kv_unwatch,
+ * or -1 with errno set on failure. */
+typedef void (*kv_watch_cb)(const char *key, const char *value, size_t len,
+                            void *arg);
+
+int kv_watch(const char *key, unsigned int flags, kv_watch_cb cb, void *arg);
+int kv_unwatch(int id);
+int kv_watch_fd(void);
+int kv_watch_dispatch(void);
+
 #ifdef __cplusplus
 }
 #endif
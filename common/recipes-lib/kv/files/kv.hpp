@@ -3,8 +3,12 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later
  * Copyright 2020-present Facebook. All Rights Reserved.
  */
+#include <functional>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 #include "kv.h"
 
 namespace kv {
@@ -17,6 +21,32 @@ void set(const std::string& key, const std::string& value,
     region r = region::temp, bool require_create = false);
 void del(const std::string& key, region r = region::temp);
 
+using key_values = std::vector<std::pair<std::string, std::string>>;
+
+// Look up several keys at once. Keys which do not exist are nullopt.
+std::vector<std::optional<std::string>> get_many(
+    const std::vector<std::string>& keys, region r = region::temp);
+// Set several keys at once. A persistent batch is one atomic write
+// with the journal backend, and key by key with the file backend, see
+// kv_set_batch.
+void set_many(const key_values& entries, region r = region::temp);
+
+// Called with a watched key and its new value, nullopt once deleted.
+using watch_callback = std::function<void(
+    const std::string& key, const std::optional<std::string>& value)>;
+
+// Watch a key for changes. With prefix, watch all keys starting with
+// key in its directory ("dir/fan" matches "dir/fan1", not
+// "dir/sub/fan1"). Returns an id for unwatch(). Callbacks are only
+// run by watch_dispatch(), which should be called whenever watch_fd()
+// is readable.
+int watch(const std::string& key, watch_callback cb,
+          region r = region::temp, bool prefix = false);
+void unwatch(int id);
+int watch_fd();
+// Run the callbacks of pending changes. Returns the number run.
+int watch_dispatch();
+
 struct key_already_exists : public std::logic_error {
     using logic_error::logic_error;
 };
@@ -0,0 +1,354 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <climits>
+#include <cstring>
+#include <system_error>
+
+#include "shmops.hpp"
+#include "log.hpp"
+
+namespace kv
+{
+
+/* Name of the shared memory object (/dev/shm/...). */
+#ifndef __TEST__
+constexpr auto shm_name = "/kv_cache";
+#else
+constexpr auto shm_name = "/kv_cache_test";
+#endif
+
+constexpr uint32_t shm_magic = 0x4b564353; // "KVCS"
+constexpr uint32_t shm_version = 2;
+
+/* Readers give up on the seqlock and take the stripe lock after
+ * this many attempts (A writer was preempted mid-write). */
+constexpr int max_read_retries = 100;
+
+struct ShmStore::Table {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t size;
+  std::atomic<uint32_t> generation;
+  // Number of processes blocked in wait(), writers only make the
+  // wake up syscall when there are any.
+  std::atomic<uint32_t> waiters;
+  pthread_mutex_t locks[kStripes];
+  Bucket buckets[kBuckets];
+};
+
+static std::system_error sys_error(const std::string& what) {
+  return std::system_error(errno, std::generic_category(), what);
+}
+
+class StripeLock
+{
+  public:
+    explicit StripeLock(pthread_mutex_t& m) : mutex(m) {}
+    ~StripeLock() { pthread_mutex_unlock(&mutex); }
+    StripeLock(const StripeLock&) = delete;
+    StripeLock& operator=(const StripeLock&) = delete;
+  private:
+    pthread_mutex_t& mutex;
+};
+
+ShmStore::ShmStore(const std::string& name) {
+  fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw sys_error("kv: shm_open " + name);
+  }
+  // Serialize the initialization of the table with other processes.
+  if (flock(fd, LOCK_EX) != 0) {
+    close(fd);
+    throw sys_error("kv: flock " + name);
+  }
+  struct stat st;
+  bool fresh = fstat(fd, &st) == 0 && st.st_size == 0;
+  if (fresh && ftruncate(fd, sizeof(Table)) != 0) {
+    flock(fd, LOCK_UN);
+    close(fd);
+    throw sys_error("kv: ftruncate " + name);
+  }
+  void* addr = mmap(nullptr, sizeof(Table), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    flock(fd, LOCK_UN);
+    close(fd);
+    throw sys_error("kv: mmap " + name);
+  }
+  table = static_cast<Table*>(addr);
+
+  if (fresh) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    for (auto& lock : table->locks) {
+      pthread_mutex_init(&lock, &attr);
+    }
+    pthread_mutexattr_destroy(&attr);
+    table->version = shm_version;
+    table->size = sizeof(Table);
+    table->magic.store(shm_magic, std::memory_order_release);
+  }
+  flock(fd, LOCK_UN);
+
+  if (table->magic.load(std::memory_order_acquire) != shm_magic ||
+      table->version != shm_version || table->size != sizeof(Table)) {
+    munmap(table, sizeof(Table));
+    close(fd);
+    errno = EPROTO;
+    throw sys_error("kv: incompatible table " + name);
+  }
+}
+
+ShmStore::~ShmStore() {
+  munmap(table, sizeof(Table));
+  close(fd);
+}
+
+ShmStore* ShmStore::instance() {
+  static ShmStore* store = []() -> ShmStore* {
+    try {
+      return new ShmStore(shm_name);
+    } catch (std::exception& e) {
+      KV_WARN("kv: falling back to files: %s", e.what());
+      return nullptr;
+    }
+  }();
+  return store;
+}
+
+void ShmStore::unlink(const std::string& name) {
+  shm_unlink(name.c_str());
+}
+
+static long futex(std::atomic<uint32_t>& word, int op, uint32_t val) {
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+  return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), op, val,
+                 nullptr, nullptr, 0);
+}
+
+uint32_t ShmStore::generation() const {
+  return table->generation.load();
+}
+
+void ShmStore::wait(uint32_t seen) {
+  table->waiters.fetch_add(1);
+  // Returns right away if the generation already moved on.
+  futex(table->generation, FUTEX_WAIT, seen);
+  table->waiters.fetch_sub(1);
+}
+
+void ShmStore::wake() {
+  table->generation.fetch_add(1);
+  futex(table->generation, FUTEX_WAKE, INT_MAX);
+}
+
+void ShmStore::changed() {
+  table->generation.fetch_add(1);
+  if (table->waiters.load() != 0) {
+    futex(table->generation, FUTEX_WAKE, INT_MAX);
+  }
+}
+
+ShmStore::Bucket& ShmStore::bucket_of(const std::string& key,
+                                      size_t& stripe) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (unsigned char c : key) {
+    hash = (hash ^ c) * 16777619u;
+  }
+  size_t idx = hash % kBuckets;
+  stripe = idx % kStripes;
+  return table->buckets[idx];
+}
+
+pthread_mutex_t& ShmStore::lock_stripe(size_t stripe) {
+  pthread_mutex_t& mutex = table->locks[stripe];
+  int ret = pthread_mutex_lock(&mutex);
+  if (ret == EOWNERDEAD) {
+    // The owner died holding the lock. Anything it was in the middle
+    // of writing is garbage.
+    repair_stripe(stripe);
+    pthread_mutex_consistent(&mutex);
+  } else if (ret != 0) {
+    errno = ret;
+    throw sys_error("kv: pthread_mutex_lock");
+  }
+  return mutex;
+}
+
+void ShmStore::repair_stripe(size_t stripe) {
+  for (size_t idx = stripe; idx < kBuckets; idx += kStripes) {
+    for (auto& e : table->buckets[idx].entries) {
+      uint32_t seq = e.seq.load(std::memory_order_relaxed);
+      if (seq & 1) {
+        e.key_len.store(0, std::memory_order_relaxed);
+        e.seq.store(seq + 1, std::memory_order_release);
+      }
+    }
+  }
+}
+
+ShmStore::read_result ShmStore::try_read(const Bucket& b,
+                                         const std::string& key,
+                                         std::string& value) {
+  for (const auto& e : b.entries) {
+    uint32_t seq = e.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      return read_result::retry;
+    }
+    if (e.key_len.load(std::memory_order_relaxed) != key.size() ||
+        memcmp(e.key, key.data(), key.size()) != 0) {
+      // A torn key can only cause a false match, which is caught
+      // below. Missing a key being written is the same as having
+      // looked before it was.
+      continue;
+    }
+    size_t len = std::min<size_t>(
+        e.value_len.load(std::memory_order_relaxed), MAX_VALUE_LEN);
+    value.assign(e.value, len);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (e.seq.load(std::memory_order_relaxed) != seq) {
+      return read_result::retry;
+    }
+    return read_result::found;
+  }
+  return read_result::missing;
+}
+
+void ShmStore::write_entry(Entry& e, const std::string& key,
+                           const std::string& value) {
+  uint32_t seq = e.seq.load(std::memory_order_relaxed);
+  e.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(e.key, key.data(), key.size());
+  memcpy(e.value, value.data(), value.size());
+  e.key_len.store(key.size(), std::memory_order_relaxed);
+  e.value_len.store(value.size(), std::memory_order_relaxed);
+  e.seq.store(seq + 2, std::memory_order_release);
+}
+
+void ShmStore::clear_entry(Entry& e) {
+  uint32_t seq = e.seq.load(std::memory_order_relaxed);
+  e.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.key_len.store(0, std::memory_order_relaxed);
+  e.seq.store(seq + 2, std::memory_order_release);
+}
+
+bool ShmStore::get(const std::string& key, std::string& value) {
+  if (key.empty() || key.size() > MAX_KEY_LEN) {
+    return false;
+  }
+  size_t stripe;
+  const Bucket& b = bucket_of(key, stripe);
+  for (int i = 0; i < max_read_retries; i++) {
+    auto ret = try_read(b, key, value);
+    if (ret != read_result::retry) {
+      return ret == read_result::found;
+    }
+  }
+  StripeLock lock(lock_stripe(stripe));
+  return try_read(b, key, value) == read_result::found;
+}
+
+ShmStore::result ShmStore::set(const std::string& key,
+                               const std::string& value,
+                               bool require_create) {
+  if (key.empty() || key.size() > MAX_KEY_LEN ||
+      value.size() > MAX_VALUE_LEN) {
+    return result::full;
+  }
+  size_t stripe;
+  Bucket& b = bucket_of(key, stripe);
+  StripeLock lock(lock_stripe(stripe));
+  Entry* free_entry = nullptr;
+  for (auto& e : b.entries) {
+    size_t len = e.key_len.load(std::memory_order_relaxed);
+    if (len == 0) {
+      if (free_entry == nullptr) {
+        free_entry = &e;
+      }
+    } else if (len == key.size() && memcmp(e.key, key.data(), len) == 0) {
+      if (require_create) {
+        return result::exists;
+      }
+      write_entry(e, key, value);
+      changed();
+      return result::ok;
+    }
+  }
+  if (free_entry == nullptr) {
+    return result::full;
+  }
+  write_entry(*free_entry, key, value);
+  changed();
+  return result::ok;
+}
+
+bool ShmStore::del(const std::string& key) {
+  if (key.empty() || key.size() > MAX_KEY_LEN) {
+    return false;
+  }
+  size_t stripe;
+  Bucket& b = bucket_of(key, stripe);
+  StripeLock lock(lock_stripe(stripe));
+  for (auto& e : b.entries) {
+    size_t len = e.key_len.load(std::memory_order_relaxed);
+    if (len == key.size() && memcmp(e.key, key.data(), len) == 0) {
+      clear_entry(e);
+      changed();
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t ShmStore::del_matching(const std::regex& search) {
+  size_t deleted = 0;
+  for (size_t stripe = 0; stripe < kStripes; stripe++) {
+    StripeLock lock(lock_stripe(stripe));
+    for (size_t idx = stripe; idx < kBuckets; idx += kStripes) {
+      for (auto& e : table->buckets[idx].entries) {
+        size_t len = e.key_len.load(std::memory_order_relaxed);
+        if (len != 0 && std::regex_match(e.key, e.key + len, search)) {
+          clear_entry(e);
+          deleted++;
+        }
+      }
+    }
+  }
+  if (deleted != 0) {
+    changed();
+  }
+  return deleted;
+}
+
+std::vector<std::string> ShmStore::keys(const std::string& prefix) {
+  std::vector<std::string> ret;
+  for (size_t stripe = 0; stripe < kStripes; stripe++) {
+    StripeLock lock(lock_stripe(stripe));
+    for (size_t idx = stripe; idx < kBuckets; idx += kStripes) {
+      for (auto& e : table->buckets[idx].entries) {
+        size_t len = e.key_len.load(std::memory_order_relaxed);
+        if (len != 0 && len >= prefix.size() &&
+            memcmp(e.key, prefix.data(), prefix.size()) == 0) {
+          ret.emplace_back(e.key, len);
+        }
+      }
+    }
+  }
+  return ret;
+}
+
+} // namespace kv
@@ -0,0 +1,101 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+
+#include <pthread.h>
+#include <atomic>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "kv.hpp"
+
+namespace kv
+{
+
+/* Shared memory backend for region::temp.
+ *
+ * All processes map the same table of fixed size entries. Keys hash to
+ * a bucket of kSlots entries and never move out of it. Writers take
+ * the (process shared, robust) lock of the bucket's stripe. Readers do
+ * not lock or make syscalls: each entry carries a sequence count which
+ * is odd while it is being written, and a read is retried if the count
+ * changed while it was copied (seqlock).
+ *
+ * Every change also bumps a table wide generation count, which
+ * watchers wait on (futex) to learn that something changed.
+ */
+class ShmStore
+{
+  public:
+    static constexpr size_t kBuckets = 512;
+    static constexpr size_t kSlots = 8;
+    static constexpr size_t kStripes = 64;
+
+    enum class result { ok, exists, full };
+
+    // Opens the table, creating it if required. Throws
+    // std::system_error on failure.
+    explicit ShmStore(const std::string& name);
+    ~ShmStore();
+
+    // The table shared by every user of libkv. nullptr if shared
+    // memory is not available.
+    static ShmStore* instance();
+    static void unlink(const std::string& name);
+
+    // Returns false if the key is not in the table.
+    bool get(const std::string& key, std::string& value);
+    // result::full if the key is too long or its bucket is full.
+    result set(const std::string& key, const std::string& value,
+               bool require_create);
+    // Returns false if the key was not in the table.
+    bool del(const std::string& key);
+    // Delete all keys matching a regex. Returns the number deleted.
+    size_t del_matching(const std::regex& search);
+    // Keys in the table starting with prefix.
+    std::vector<std::string> keys(const std::string& prefix);
+
+    // Count of changes made to the table.
+    uint32_t generation() const;
+    // Blocks till the generation is no longer seen. May return early.
+    void wait(uint32_t seen);
+    // Wakes up all waiters, as if the table had changed.
+    void wake();
+
+    ShmStore(const ShmStore&) = delete;
+    ShmStore& operator=(const ShmStore&) = delete;
+
+  private:
+    struct Entry {
+      std::atomic<uint32_t> seq;
+      std::atomic<uint16_t> value_len;
+      // Zero if the entry is not used.
+      std::atomic<uint8_t> key_len;
+      char key[MAX_KEY_LEN];
+      char value[MAX_VALUE_LEN];
+    };
+    struct Bucket {
+      Entry entries[kSlots];
+    };
+    struct Table;
+
+    enum class read_result { found, missing, retry };
+
+    Table* table = nullptr;
+    int fd = -1;
+
+    Bucket& bucket_of(const std::string& key, size_t& stripe);
+    pthread_mutex_t& lock_stripe(size_t stripe);
+    void repair_stripe(size_t stripe);
+    void changed();
+    static read_result try_read(const Bucket& b, const std::string& key,
+                                std::string& value);
+    static void write_entry(Entry& e, const std::string& key,
+                            const std::string& value);
+    static void clear_entry(Entry& e);
+};
+
+} // namespace kv
@@ -2,16 +2,455 @@
  * Copyright 2015-present Facebook. All Rights Reserved.
  */
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include "kv.hpp"
+#include "fileops.hpp"
+#include "journalops.hpp"
+#include "shmops.hpp"
+
+/* With the shared memory backend, temp keys are not files. */
+#ifdef KV_TEMP_SHM
+constexpr bool temp_files = false;
+#else
+constexpr bool temp_files = true;
+#endif
+
+/* Nor are persistent keys with the journal. */
+#ifdef KV_PERSIST_JOURNAL
+constexpr bool persist_files = false;
+#else
+constexpr bool persist_files = true;
+#endif
+
+static void test_shm_store()
+{
+  constexpr auto name = "/kv_test_store";
+  kv::ShmStore::unlink(name);
+  kv::ShmStore store(name);
+  std::string value;
+
+  assert(!store.get("shm1", value));
+  assert(store.set("shm1", "val", false) == kv::ShmStore::result::ok);
+  assert(store.get("shm1", value) && value == "val");
+  assert(store.set("shm1", "val2", true) == kv::ShmStore::result::exists);
+  assert(store.set("shm1", "val2", false) == kv::ShmStore::result::ok);
+  assert(store.get("shm1", value) && value == "val2");
+  printf("SUCCESS: shm set/get/create\n");
+
+  {
+    // A second mapping sees the same table.
+    kv::ShmStore other(name);
+    assert(other.get("shm1", value) && value == "val2");
+  }
+  printf("SUCCESS: shm table is shared\n");
+
+  std::string binary{"a\0b", 3};
+  assert(store.set("shm2", binary, false) == kv::ShmStore::result::ok);
+  assert(store.get("shm2", value) && value == binary);
+  printf("SUCCESS: shm binary values\n");
+
+  std::string long_key(MAX_KEY_LEN + 1, 'k');
+  assert(store.set(long_key, "val", false) == kv::ShmStore::result::full);
+  assert(!store.get(long_key, value));
+  printf("SUCCESS: shm rejects long keys\n");
+
+  assert(store.del("shm1"));
+  assert(!store.del("shm1"));
+  assert(!store.get("shm1", value));
+  printf("SUCCESS: shm delete\n");
+
+  assert(store.set("shm_re1", "1", false) == kv::ShmStore::result::ok);
+  assert(store.set("shm_re2", "2", false) == kv::ShmStore::result::ok);
+  assert(store.del_matching(std::regex("shm_re.*")) == 2);
+  assert(!store.get("shm_re1", value) && !store.get("shm_re2", value));
+  printf("SUCCESS: shm regex delete\n");
+
+  // Fill up the table, some buckets run out of slots.
+  size_t stored = 0, full = 0;
+  for (size_t i = 0; i < kv::ShmStore::kBuckets * kv::ShmStore::kSlots; i++) {
+    auto key = "fill" + std::to_string(i);
+    auto ret = store.set(key, key, false);
+    if (ret == kv::ShmStore::result::ok) {
+      assert(store.get(key, value) && value == key);
+      stored++;
+    } else {
+      assert(ret == kv::ShmStore::result::full);
+      full++;
+    }
+  }
+  assert(stored > 0 && full > 0);
+  assert(store.del_matching(std::regex("fill.*")) == stored);
+  printf("SUCCESS: shm full buckets are reported\n");
+
+  // Readers never see a torn value.
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    for (int i = 0; !done; i = (i + 1) % 10) {
+      store.set("shm3", std::string(100 + i, '0' + i), false);
+    }
+  });
+  for (int i = 0; i < 100000; i++) {
+    if (store.get("shm3", value)) {
+      assert(value.size() >= 100 && value.size() < 110);
+      assert(value == std::string(value.size(), '0' + value.size() - 100));
+    }
+  }
+  done = true;
+  writer.join();
+  printf("SUCCESS: shm concurrent reads are consistent\n");
+
+  kv::ShmStore::unlink(name);
+}
+
+/* Compare the file and shared memory backends of region::temp. */
+static void test_batch()
+{
+  kv::key_values entries;
+  for (int i = 0; i < 20; i++) {
+    entries.emplace_back("batch/key" + std::to_string(i), std::to_string(i));
+  }
+  for (auto r : {kv::region::temp, kv::region::persist}) {
+    kv::set_many(entries, r);
+    auto values = kv::get_many({"batch/key3", "batch/missing", "batch/key19"},
+                               r);
+    assert(values.size() == 3);
+    assert(values[0] && *values[0] == "3");
+    assert(!values[1]);
+    assert(values[2] && *values[2] == "19");
+    assert(kv::get("batch/key7", r) == "7");
+  }
+  printf("SUCCESS: get_many/set_many round trip\n");
+
+#ifndef KV_PERSIST_JOURNAL
+  // Unchanged keys are not written again.
+  {
+    struct stat before, after;
+    assert(stat("./test/persist/batch/key1", &before) == 0);
+    usleep(10000);
+    kv::set_many({{"batch/key1", "1"}}, kv::region::persist);
+    assert(stat("./test/persist/batch/key1", &after) == 0);
+    assert(before.st_mtim.tv_nsec == after.st_mtim.tv_nsec &&
+           before.st_mtim.tv_sec == after.st_mtim.tv_sec);
+  }
+  printf("SUCCESS: persistent batch skips unchanged keys\n");
+#endif
+
+  const char* keys[] = {"cbatch1", "cbatch2", "cbatch3"};
+  const char* in[] = {"a", "bb", "ccc"};
+  char out[3][MAX_VALUE_LEN];
+  char* outp[] = {out[0], out[1], out[2]};
+  size_t lens[3];
+  assert(kv_set_batch(keys, in, NULL, 2, KV_FPERSIST) == 0);
+  assert(kv_get_batch(keys, outp, lens, 3, KV_FPERSIST) == 2);
+  assert(lens[0] == 1 && memcmp(out[0], "a", 1) == 0);
+  assert(lens[1] == 2 && memcmp(out[1], "bb", 2) == 0);
+  assert(lens[2] == KV_BATCH_MISSING);
+  assert(kv_get_batch(keys, outp, NULL, 3, KV_FPERSIST) == 2);
+  assert(strcmp(out[1], "bb") == 0 && out[2][0] == '\0');
+  assert(kv_set_batch(keys, in, NULL, 3, KV_FCREATE) != 0 && errno == EINVAL);
+  printf("SUCCESS: kv_get_batch/kv_set_batch\n");
+}
+
+/* Wait for and run pending watch callbacks. */
+static int watch_events()
+{
+  struct pollfd pfd = {kv::watch_fd(), POLLIN, 0};
+  if (poll(&pfd, 1, 1000) <= 0) {
+    return 0;
+  }
+  return kv::watch_dispatch();
+}
+
+static void watch_cb(const char *key, const char *value, size_t len,
+                     void *arg)
+{
+  auto seen = static_cast<std::string*>(arg);
+  *seen = std::string(key) + "=" + (value ? std::string(value, len) : "-");
+}
+
+static void test_watch()
+{
+  auto r = kv::region::persist;
+  std::vector<std::pair<std::string, std::optional<std::string>>> events;
+  auto cb = [&events](const std::string& key,
+                      const std::optional<std::string>& value) {
+    events.emplace_back(key, value);
+  };
+
+  int id = kv::watch("watch1", cb, r);
+  assert(kv::watch_dispatch() == 0);
+  kv::set("watch1", "on", r);
+  assert(watch_events() == 1);
+  assert(events.back().first == "watch1" && events.back().second == "on");
+  kv::set("watch2", "on", r);
+  assert(watch_events() == 0);
+  printf("SUCCESS: watch delivers changes of the key\n");
+
+  kv::set("watch1", "on", r);
+  assert(watch_events() == 0);
+  printf("SUCCESS: watch skips writes of the same value\n");
+
+  kv::del("watch1", r);
+  assert(watch_events() == 1);
+  assert(events.back().first == "watch1" && !events.back().second);
+  printf("SUCCESS: watch delivers deletes\n");
+
+  int pid = kv::watch("wdir/fan", cb, r, true);
+  kv::set_many({{"wdir/fan1", "1"}, {"wdir/fan2", "2"}, {"wdir/psu", "3"}}, r);
+  events.clear();
+  assert(watch_events() == 2);
+  assert(events.size() == 2);
+  assert(events[0].first == "wdir/fan1" && events[0].second == "1");
+  assert(events[1].first == "wdir/fan2" && events[1].second == "2");
+  printf("SUCCESS: prefix watch\n");
+
+  kv::unwatch(id);
+  kv::unwatch(pid);
+  kv::set("watch1", "off", r);
+  kv::set("wdir/fan1", "0", r);
+  assert(watch_events() == 0);
+  printf("SUCCESS: unwatch\n");
+
+  // Temp keys may be in the shared memory table rather than files,
+  // and be changed by another process.
+  auto t = kv::region::temp;
+  id = kv::watch("twatch", cb, t);
+  pid = kv::watch("tdir/fan", cb, t, true);
+  events.clear();
+  kv::set("twatch", "1", t);
+  assert(watch_events() == 1);
+  assert(events.back().first == "twatch" && events.back().second == "1");
+  pid_t child = fork();
+  if (child == 0) {
+    kv::set("tdir/fan1", "2", t);
+    _exit(0);
+  }
+  assert(waitpid(child, nullptr, 0) == child);
+  assert(watch_events() == 1);
+  assert(events.back().first == "tdir/fan1" && events.back().second == "2");
+  kv::del("twatch", t);
+  assert(watch_events() == 1);
+  assert(events.back().first == "twatch" && !events.back().second);
+  kv::unwatch(id);
+  kv::unwatch(pid);
+  printf("SUCCESS: watch of temp keys\n");
+
+  std::string seen;
+  id = kv_watch("watch3", KV_FPERSIST, watch_cb, &seen);
+  assert(id >= 0);
+  assert(kv_set("watch3", "abc", 0, KV_FPERSIST) == 0);
+  assert(watch_events() == 1 && seen == "watch3=abc");
+  assert(kv_del("watch3", KV_FPERSIST) == 0);
+  assert(watch_events() == 1 && seen == "watch3=-");
+  assert(kv_unwatch(id) == 0);
+  assert(kv_unwatch(id) != 0 && errno == ENOENT);
+  printf("SUCCESS: kv_watch/kv_unwatch\n");
+}
+
+static void test_journal()
+{
+  constexpr auto path = "./test/jtest.journal";
+  kv::Journal a(path);
+  kv::Journal b(path);  // As seen by another process.
+
+  assert(a.set("j1", "v1", false));
+  assert(!a.set("j1", "v2", true));
+  assert(b.get("j1") == "v1");
+  a.set_many({{"j2", "v2"}, {"j3", "v3"}});
+  assert(b.get("j3") == "v3");
+  assert(b.del("j[23]") == 2);
+  assert(!a.get("j2") && !a.get("j3"));
+  assert(a.del("j4") == 0);
+  auto appends = a.get_stats().appends;
+  a.set("j1", "v1", false);
+  assert(a.get_stats().appends == appends);
+  printf("SUCCESS: journal set/get/del across instances\n");
+
+  a.sync();
+  auto size = std::filesystem::file_size(path);
+  a.set_many({{"j5", "v5"}, {"j6", "v6"}});
+  // Tear the batch as a power loss would.
+  assert(truncate(path, std::filesystem::file_size(path) - 3) == 0);
+  {
+    kv::Journal c(path);
+    assert(c.get("j1") == "v1" && !c.get("j5") && !c.get("j6"));
+    assert(std::filesystem::file_size(path) == size);
+  }
+  printf("SUCCESS: journal drops torn batches\n");
+
+  kv::Journal d(path);
+  for (int i = 0; i < 5000; i++) {
+    d.set("j7", std::to_string(i), false);
+  }
+  assert(d.get_stats().bytes_written > kv::Journal::compact_min_size);
+  // The flusher may have compacted it already.
+  d.compact();
+  assert(std::filesystem::file_size(path) < 4096);
+  assert(d.get_stats().compactions >= 1);
+  assert(b.get("j7") == "4999" && b.get("j1") == "v1");
+  b.set("j8", "v8", false);
+  assert(d.get("j8") == "v8");
+  printf("SUCCESS: journal compaction\n");
+}
+
+/* Persistent writes of thresholds and states of many sensors, as a
+ * sensor daemon would do, through whichever backend is built. */
+static void persist_workload()
+{
+  constexpr int keys = 100;
+  constexpr int rounds = 50;
+  auto wchar = [] {
+    FILE* fp = fopen("/proc/self/io", "r");
+    unsigned long long val = 0;
+    char line[64];
+    while (fp && fgets(line, sizeof(line), fp)) {
+      if (sscanf(line, "wchar: %llu", &val) == 1) {
+        break;
+      }
+    }
+    if (fp) {
+      fclose(fp);
+    }
+    return val;
+  };
+
+  std::vector<double> latency;
+  auto written = wchar();
+  for (int r = 0; r < rounds; r++) {
+    for (int k = 0; k < keys; k++) {
+      auto start = std::chrono::steady_clock::now();
+      kv::set("sensor/fru1_" + std::to_string(k) + "_thresh",
+              std::to_string(40 + k % 10) + "." + std::to_string(r),
+              kv::region::persist);
+      std::chrono::duration<double, std::micro> elapsed =
+          std::chrono::steady_clock::now() - start;
+      latency.push_back(elapsed.count());
+    }
+  }
+  written = wchar() - written;
+  std::sort(latency.begin(), latency.end());
+  double sum = 0;
+  for (auto l : latency) {
+    sum += l;
+  }
+  printf("%s: %d persistent sets\n",
+         persist_files ? "file backend" : "journal backend", keys * rounds);
+  printf("  latency avg %.1f us, p99 %.1f us, max %.1f us\n",
+         sum / latency.size(), latency[latency.size() * 99 / 100],
+         latency.back());
+#ifdef KV_PERSIST_JOURNAL
+  auto& journal = kv::Journal::instance();
+  journal.sync();
+  auto st = journal.get_stats();
+  printf("  %llu bytes written in %zu appends, %zu syncs, %zu compactions\n",
+         written, st.appends, st.syncs, st.compactions);
+#else
+  printf("  %llu bytes written to %d file rewrites\n", written,
+         keys * rounds);
+#endif
+}
+
+static void benchmark()
+{
+  constexpr int keys = 200;
+  constexpr int rounds = 50;
+  constexpr auto name = "/kv_bench_store";
+  auto run = [](const char* what, auto&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      for (int k = 0; k < keys; k++) {
+        fn("fru1_sensor" + std::to_string(k), std::to_string(r * 1000 + k));
+      }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("%-16s %10.0f ops/sec\n", what, keys * rounds / elapsed.count());
+  };
+
+  run("file set", [](const std::string& key, const std::string& val) {
+    kv::FileHandle fp;
+    fp.open_and_lock<kv::FileHandle::access::write>(key, kv::region::temp);
+    fp.write(val);
+  });
+  run("file get", [](const std::string& key, const std::string&) {
+    kv::FileHandle fp;
+    fp.open_and_lock<kv::FileHandle::access::read>(key, kv::region::temp);
+    fp.read();
+  });
+
+  // The same work as above, a batch of all keys at a time.
+  auto run_batch = [](const char* what, auto&& fn) {
+    std::vector<std::string> names;
+    for (int k = 0; k < keys; k++) {
+      names.push_back("fru1_sensor" + std::to_string(k));
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      kv::key_values entries;
+      for (int k = 0; k < keys; k++) {
+        entries.emplace_back(names[k], std::to_string(r * 1000 + k));
+      }
+      fn(names, entries);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("%-16s %10.0f ops/sec\n", what, keys * rounds / elapsed.count());
+  };
+
+  run_batch("file set_many", [](const std::vector<std::string>&,
+                                const kv::key_values& entries) {
+    kv::FileHandle::write_batch(entries, kv::region::temp);
+  });
+  run_batch("file get_many", [](const std::vector<std::string>& names,
+                                const kv::key_values&) {
+    for (auto& name : names) {
+      kv::FileHandle::read_key(name, kv::region::temp);
+    }
+  });
+  run("persist set", [](const std::string& key, const std::string& val) {
+    kv::FileHandle fp;
+    fp.open_and_lock<kv::FileHandle::access::write>(key, kv::region::persist);
+    fp.write(val);
+  });
+  run_batch("persist set_many", [](const std::vector<std::string>&,
+                                   const kv::key_values& entries) {
+    kv::FileHandle::write_batch(entries, kv::region::persist);
+  });
+
+  kv::ShmStore::unlink(name);
+  kv::ShmStore store(name);
+  run("shm set", [&store](const std::string& key, const std::string& val) {
+    store.set(key, val, false);
+  });
+  run("shm get", [&store](const std::string& key, const std::string&) {
+    std::string val;
+    store.get(key, val);
+  });
+  kv::ShmStore::unlink(name);
+}
 
 int main(int argc, char *argv[])
 {
   char value[MAX_VALUE_LEN*2];
   size_t len;
 
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    benchmark();
+    persist_workload();
+    assert(system("rm -rf ./test") == 0);
+    return 0;
+  }
+  kv::ShmStore::unlink("/kv_cache_test");
+
   assert(kv_get("test1", value, NULL, KV_FPERSIST) != 0);
   printf("SUCCESS: Non-existent file results in error.\n");
   assert(kv_del("test1", KV_FPERSIST) != 0);
@@ -19,7 +458,7 @@ int main(int argc, char *argv[])
 
   assert(kv_set("test1", "val", 0, KV_FPERSIST) == 0);
   printf("SUCCESS: Creating persist key func call\n");
-  assert(access("./test/persist/test1", F_OK) == 0);
+  assert((access("./test/persist/test1", F_OK) == 0) == persist_files);
   printf("SUCCESS: key file created as expected!\n");
   assert(kv_get("test1", value, NULL, KV_FPERSIST) == 0);
   printf("SUCCESS: Read of key succeeded!\n");
@@ -34,7 +473,7 @@ int main(int argc, char *argv[])
 
   assert(kv_set("test1", "val", 0, 0) == 0);
   printf("SUCCESS: Creating non-persist key func call\n");
-  assert(access("./test/tmp/test1", F_OK) == 0);
+  assert((access("./test/tmp/test1", F_OK) == 0) == temp_files);
   printf("SUCCESS: key file created as expected!\n");
   assert(kv_get("test1", value, NULL, 0) == 0);
   printf("SUCCESS: Read of key succeeded!\n");
@@ -43,7 +482,7 @@ int main(int argc, char *argv[])
 
   assert(kv_set("test3/test", "test3-1234", 0, 0) == 0);
   printf("SUCCESS: Creating non-persist key in subdirectory\n");
-  assert(access("./test/tmp/test3/test", F_OK) == 0);
+  assert((access("./test/tmp/test3/test", F_OK) == 0) == temp_files);
   printf("SUCCESS: key file created as expected!\n");
   assert(kv_get("test3/test", value, NULL, 0) == 0);
   printf("SUCCESS: Read of key succeeded!\n");
@@ -122,7 +561,43 @@ int main(int argc, char *argv[])
     printf("SUCCESS: Read and write using C++ interface.\n");
   }
 
+#ifdef KV_TEMP_SHM
+  {
+    // Keys created by scripts are still visible, and can be
+    // replaced or deleted.
+    assert(system("mkdir -p ./test/tmp && echo -n script > ./test/tmp/test6")
+           == 0);
+    assert(kv::get("test6") == "script");
+    assert(kv_set("test6", "val", 0, KV_FCREATE) != 0 && errno == EEXIST);
+    kv::set("test6", "new");
+    assert(kv::get("test6") == "new");
+    assert(kv_del("test6", 0) == 0);
+    assert(kv_get("test6", value, NULL, 0) != 0 && errno == ENOENT);
+    printf("SUCCESS: Keys created as files are found in shm mode\n");
+
+    // Keys which do not fit in the table go to files.
+    std::string long_key(MAX_KEY_LEN + 1, 'k');
+    kv::set(long_key, "long");
+    assert(kv::get(long_key) == "long");
+    assert(access(("./test/tmp/" + long_key).c_str(), F_OK) == 0);
+    printf("SUCCESS: Keys too long for shm are stored as files\n");
+
+    assert(kv_set("test7_1", "1", 0, 0) == 0);
+    assert(kv_set("test7_2", "2", 0, 0) == 0);
+    assert(kv_del("test7_.*", 0) == 0);
+    assert(kv_get("test7_1", value, NULL, 0) != 0);
+    assert(kv_del("test7_.*", 0) != 0 && errno == ENOENT);
+    printf("SUCCESS: Regex delete of shm keys\n");
+  }
+#endif
+
+  test_batch();
+  test_watch();
+  test_journal();
+  test_shm_store();
+
   assert(system("rm -rf ./test") == 0);
+  kv::ShmStore::unlink("/kv_cache_test");
 
   return 0;
 }
@@ -0,0 +1,332 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <set>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+#include "watchops.hpp"
+#include "fileops.hpp"
+#include "journalops.hpp"
+#include "log.hpp"
+
+namespace fs = std::filesystem;
+
+namespace kv
+{
+
+/* kv_set closes the file it wrote, batches and scripts may rename
+ * files into place. */
+constexpr uint32_t watch_mask =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+/* Journals are appended to and replaced when compacted. */
+constexpr uint32_t journal_mask = IN_MODIFY | IN_MOVED_TO;
+
+static Journal* journal([[maybe_unused]] region r) {
+#ifdef KV_PERSIST_JOURNAL
+  if (r == region::persist) {
+    return &Journal::instance();
+  }
+#endif
+  return nullptr;
+}
+
+static ShmStore* shm_store([[maybe_unused]] region r) {
+#ifdef KV_TEMP_SHM
+  if (r == region::temp) {
+    return ShmStore::instance();
+  }
+#endif
+  return nullptr;
+}
+
+static std::optional<std::string> lookup(const std::string& key, region r) {
+  return get_many({key}, r).front();
+}
+
+Watcher::Watcher() {
+  ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (ifd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "kv: inotify_init1");
+  }
+  shm_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  efd = epoll_create1(EPOLL_CLOEXEC);
+  if (shm_fd < 0 || efd < 0) {
+    auto err = std::system_error(errno, std::generic_category(),
+                                 "kv: watch fd");
+    close(ifd);
+    close(shm_fd);
+    close(efd);
+    throw err;
+  }
+  for (int fd : {ifd, shm_fd}) {
+    struct epoll_event ev {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(efd, EPOLL_CTL_ADD, fd, &ev);
+  }
+}
+
+Watcher::~Watcher() {
+  if (shm_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(shm_mutex);
+      shm_stop = true;
+    }
+    shm_cond.notify_one();
+    // The thread may be blocked waiting on the table.
+    shm->wake();
+    shm_thread.join();
+  }
+  close(efd);
+  close(shm_fd);
+  close(ifd);
+}
+
+Watcher& Watcher::instance() {
+  static Watcher watcher;
+  return watcher;
+}
+
+int Watcher::add(const std::string& key, region r, bool prefix,
+                 watch_callback cb) {
+  fs::path kpath(key);
+  auto dir = kpath.parent_path().string();
+  auto name = kpath.filename().string();
+  if (name.empty() && !prefix) {
+    throw std::invalid_argument("kv: cannot watch key " + key);
+  }
+
+  auto j = journal(r);
+  fs::path dpath;
+  uint32_t mask = watch_mask;
+  if (j != nullptr) {
+    dpath = fs::path(j->path()).parent_path();
+    mask = journal_mask;
+  } else {
+    // The directory has to exist to be watched. It would be created by
+    // the first kv_set of the key anyway.
+    dpath = FileHandle::region_path(r) / dir;
+    fs::create_directories(dpath);
+  }
+  // Changes after this are seen by the thread watching the table.
+  auto s = shm_store(r);
+  uint32_t gen = s ? s->generation() : 0;
+  auto initial = prefix ? std::nullopt : lookup(key, r);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  int wd = inotify_add_watch(ifd, dpath.empty() ? "." : dpath.c_str(), mask);
+  if (wd < 0) {
+    throw fs::filesystem_error(
+        "kv: error calling inotify_add_watch", dpath,
+        std::error_code(errno, std::system_category()));
+  }
+  dirs[wd] = j ? fs::path(j->path()).filename().string() : "";
+
+  int id = next_id++;
+  Watch w{r, wd, dir, name, prefix, j != nullptr, s != nullptr,
+          std::move(cb), {}};
+  if (!prefix) {
+    w.last[key] = initial;
+  }
+  watches.emplace(id, std::move(w));
+  if (s != nullptr && !shm_thread.joinable()) {
+    shm = s;
+    arm_shm(gen);
+    shm_thread = std::thread(&Watcher::watch_shm, this);
+  }
+  return id;
+}
+
+void Watcher::arm_shm(uint32_t gen) {
+  {
+    std::lock_guard<std::mutex> lock(shm_mutex);
+    shm_seen = gen;
+    shm_armed = true;
+  }
+  shm_cond.notify_one();
+}
+
+void Watcher::watch_shm() {
+  std::unique_lock<std::mutex> lock(shm_mutex);
+  for (;;) {
+    shm_cond.wait(lock, [this] { return shm_stop || shm_armed; });
+    if (shm_stop) {
+      return;
+    }
+    uint32_t seen = shm_seen;
+    lock.unlock();
+    shm->wait(seen);
+    lock.lock();
+    if (!shm_stop && shm->generation() != seen) {
+      // Nothing more till dispatch() has looked at the keys, however
+      // many changes come in meanwhile.
+      shm_armed = false;
+      uint64_t one = 1;
+      if (write(shm_fd, &one, sizeof(one)) != sizeof(one)) {
+        KV_WARN("kv: watch: cannot signal eventfd");
+      }
+    }
+  }
+}
+
+void Watcher::remove(int id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = watches.find(id);
+  if (it == watches.end()) {
+    throw key_does_not_exist("kv: no watch " + std::to_string(id));
+  }
+  int wd = it->second.wd;
+  watches.erase(it);
+  for (const auto& [_, w] : watches) {
+    if (w.wd == wd) {
+      return;
+    }
+  }
+  inotify_rm_watch(ifd, wd);
+  dirs.erase(wd);
+}
+
+std::vector<std::string> Watcher::store_keys(const Watch& w) {
+  auto full = w.dir.empty() ? w.name : w.dir + "/" + w.name;
+  if (!w.prefix) {
+    return {full};
+  }
+  std::vector<std::string> keys;
+  // Only keys in the directory of the prefix, as with files.
+  auto found = w.journal ? Journal::instance().keys(full) : shm->keys(full);
+  for (auto& key : found) {
+    if (key.find('/', w.dir.empty() ? 0 : w.dir.size() + 1) ==
+        std::string::npos) {
+      keys.push_back(std::move(key));
+    }
+  }
+  // And the ones which were deleted.
+  for (const auto& [key, _] : w.last) {
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+int Watcher::dispatch() {
+  std::vector<std::tuple<watch_callback, std::string,
+                         std::optional<std::string>>> calls;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Several events of a key (e.g. a delete and create) are
+    // collapsed into a single callback with its current value.
+    std::set<std::pair<int, std::string>> changed;
+    alignas(struct inotify_event) char buf[4096];
+    for (;;) {
+      auto bytes = read(ifd, buf, sizeof(buf));
+      if (bytes < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN) {
+          break;
+        }
+        throw std::system_error(errno, std::generic_category(),
+                                "kv: read inotify");
+      }
+      for (char* p = buf; p < buf + bytes;) {
+        auto ev = reinterpret_cast<struct inotify_event*>(p);
+        p += sizeof(struct inotify_event) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW) {
+          // Events were lost, check every key watched.
+          KV_WARN("kv: inotify queue overflow");
+          for (const auto& [id, w] : watches) {
+            for (const auto& [key, _] : w.last) {
+              changed.emplace(id, key);
+            }
+          }
+          continue;
+        }
+        if (ev->mask & IN_IGNORED) {
+          // The directory was removed.
+          dirs.erase(ev->wd);
+          continue;
+        }
+        if (ev->len == 0 || (ev->mask & IN_ISDIR)) {
+          continue;
+        }
+        std::string name(ev->name);
+        auto dir = dirs.find(ev->wd);
+        if (dir != dirs.end() && !dir->second.empty()) {
+          if (name != dir->second) {
+            continue;
+          }
+          for (const auto& [id, w] : watches) {
+            if (w.journal) {
+              for (auto& key : store_keys(w)) {
+                changed.emplace(id, std::move(key));
+              }
+            }
+          }
+          continue;
+        }
+        for (const auto& [id, w] : watches) {
+          if (w.wd != ev->wd) {
+            continue;
+          }
+          if (w.prefix ? name.compare(0, w.name.size(), w.name) == 0
+                       : name == w.name) {
+            changed.emplace(id, w.dir.empty() ? name : w.dir + "/" + name);
+          }
+        }
+      }
+    }
+
+    uint64_t count;
+    if (read(shm_fd, &count, sizeof(count)) == sizeof(count)) {
+      // The generation is taken before looking at the keys, so that
+      // later changes signal again.
+      uint32_t gen = shm->generation();
+      for (const auto& [id, w] : watches) {
+        if (w.shm) {
+          for (auto& key : store_keys(w)) {
+            changed.emplace(id, std::move(key));
+          }
+        }
+      }
+      arm_shm(gen);
+    }
+
+    for (const auto& [id, key] : changed) {
+      auto it = watches.find(id);
+      if (it == watches.end()) {
+        continue;
+      }
+      auto& w = it->second;
+      std::optional<std::string> value;
+      try {
+        value = lookup(key, w.r);
+      } catch (std::exception& e) {
+        KV_WARN("kv: watch: %s", e.what());
+        continue;
+      }
+      auto last = w.last.find(key);
+      if (last != w.last.end() && last->second == value) {
+        continue;
+      }
+      w.last[key] = value;
+      calls.emplace_back(w.cb, key, std::move(value));
+    }
+  }
+
+  // Callbacks are free to add or remove watches.
+  for (const auto& [cb, key, value] : calls) {
+    cb(key, value);
+  }
+  return calls.size();
+}
+
+} // namespace kv
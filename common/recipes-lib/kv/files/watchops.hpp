@@ -0,0 +1,95 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022-present Facebook. All Rights Reserved.
+ */
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kv.hpp"
+#include "shmops.hpp"
+
+namespace kv
+{
+
+/* Change notifications for the file store.
+ *
+ * Watched keys are mapped to inotify watches on the directory holding
+ * them, so a single inotify instance (and fd) serves all the watches
+ * of a process. Events are only read and turned into callbacks by
+ * dispatch(), which never blocks. Keys kept in a journal are watched
+ * through the journal file instead.
+ *
+ * Keys in the shared memory table have no file to watch. A thread
+ * waits for the table to change and signals an eventfd, after which
+ * dispatch() checks every key watched in the table. The fd handed out
+ * is an epoll instance over the inotify fd and the eventfd.
+ */
+class Watcher
+{
+  public:
+    // The watcher of this process. Throws std::system_error if inotify
+    // is not available.
+    static Watcher& instance();
+
+    int add(const std::string& key, region r, bool prefix, watch_callback cb);
+    void remove(int id);
+    int fd() const { return efd; }
+    int dispatch();
+
+    Watcher(const Watcher&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
+  private:
+    struct Watch {
+      region r;
+      int wd;
+      // The key is dir/name, or a prefix dir/name*.
+      std::string dir;
+      std::string name;
+      bool prefix;
+      bool journal;
+      bool shm;
+      watch_callback cb;
+      // Last value delivered per key, to drop events which did not
+      // change the value (e.g. a kv_set of the same value).
+      std::map<std::string, std::optional<std::string>> last;
+    };
+    // Keys of a watch whose journal or shared memory table changed.
+    std::vector<std::string> store_keys(const Watch& w);
+    // Run by shm_thread.
+    void watch_shm();
+    // Have shm_thread signal the next change after generation gen.
+    void arm_shm(uint32_t gen);
+
+    Watcher();
+    ~Watcher();
+
+    std::mutex mutex;
+    int ifd = -1;
+    int efd = -1;
+    // Signalled by shm_thread when the table changed.
+    int shm_fd = -1;
+    int next_id = 1;
+    std::map<int, Watch> watches;
+    // Watched directories. For the directory of a journal, the name of
+    // the journal file.
+    std::map<int, std::string> dirs;
+
+    // Started with the first watch of a key in the table.
+    ShmStore* shm = nullptr;
+    std::thread shm_thread;
+    std::mutex shm_mutex;
+    std::condition_variable shm_cond;
+    // Waiting for the generation to move on from shm_seen.
+    bool shm_armed = false;
+    bool shm_stop = false;
+    uint32_t shm_seen = 0;
+};
+
+} // namespace kv
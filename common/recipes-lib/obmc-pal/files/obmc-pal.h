@@ -158,6 +158,18 @@ enum {
   SENSORD_MODE_NORMAL  = 0x0F,
 };
 
+/* Physical access path of a sensor, see pal_get_sensor_access_path() */
+enum {
+  SENSOR_PATH_FRU = 0,
+  SENSOR_PATH_I2C,
+  SENSOR_PATH_IPMB,
+  SENSOR_PATH_PECI,
+  SENSOR_PATH_HWMON,
+};
+#define SENSOR_PATH(type, id)  (((uint32_t)(type) << 16) | ((id) & 0xFFFF))
+#define SENSOR_PATH_TYPE(path) ((path) >> 16)
+#define SENSOR_PATH_ID(path)   ((path) & 0xFFFF)
+
 enum {
   PAL_EOK = 0,
   PAL_ENOTSUP = -ENOTSUP,
@@ -407,6 +419,7 @@ int pal_get_fru_sensor_list(uint8_t fru, uint8_t **sensor_list, int *cnt);
 int pal_get_sensor_poll_interval(uint8_t fru, uint8_t sensor_num, uint32_t *value);
 int pal_alter_sensor_poll_interval(uint8_t fru, uint8_t sensor_num, uint32_t *value);
 bool pal_sensor_is_source_host(uint8_t fru, uint8_t sensor_num);
+int pal_get_sensor_access_path(uint8_t fru, uint8_t sensor_num, uint32_t *path, uint8_t *max_reads);
 bool pal_is_host_snr_available(uint8_t fru, uint8_t sensor_id);
 int pal_correct_sensor_reading_from_cache(uint8_t fru, uint8_t sensor_id, float *value);
 int pal_get_fru_discrete_list(uint8_t fru, uint8_t **sensor_list, int *cnt);
@@ -533,6 +546,7 @@ int pal_wait_mcu_ready2update(uint8_t bus);
 int pal_set_time_sync(uint8_t *req_data, uint8_t req_len);
 int pal_set_sdr_update_flag(uint8_t slot, uint8_t update);
 int pal_get_sdr_update_flag(uint8_t slot);
+int pal_sensor_sdr_path(uint8_t fru, char *path);
 int pal_parse_mem_mapping_string(uint8_t channel, bool *support_mem_mapping, char *error_log);
 int pal_convert_to_dimm_str(uint8_t cpu, uint8_t channel, uint8_t slot, char *str);
 int pal_fw_update_prepare(uint8_t fru, const char *comp);
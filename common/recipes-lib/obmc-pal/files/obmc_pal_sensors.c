@@ -31,6 +31,8 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <openbmc/kv.h>
 #include "obmc-pal.h"
 #include "obmc_pal_sensors.h"
@@ -49,6 +51,24 @@
 
 #define CACHE_READ_RETRY 5
 
+#define SENSOR_CACHE_SHM   "/sensor_cache_fru%u"
+#define SENSOR_CACHE_MAGIC 0x53434301 /* "SCC", version 1 */
+
+/*
+ * Latest readings of the sensors of a FRU, shared by all processes.
+ * Writers take the robust lock. Readers do not lock, they retry while
+ * seq is odd or changed under them.
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;
+  pthread_mutex_t lock;
+  sensor_cache_entry_t entry[MAX_SENSOR_CACHE_NUM];
+} sensor_cache_shm_t;
+
+/* Mapped tables of this process, by FRU. */
+static sensor_cache_shm_t *sensor_cache_shm[UINT8_MAX + 1];
+
 typedef struct {
   long log_time;
   float value;
@@ -73,6 +93,19 @@ typedef struct {
   sensor_coarse_data_t data[MAX_COARSE_DATA_NUM];
 } sensor_coarse_shm_t;
 
+/*
+ * History rings mapped by this process, by kind, FRU and sensor. Their
+ * layout is shared with sensor-history. Each ring is appended to without
+ * a lock. Concurrent writers of the same sensor, which sensord does not
+ * have, may lose a sample.
+ */
+enum {
+  HISTORY_FINE,
+  HISTORY_COARSE,
+  HISTORY_KINDS,
+};
+static void **history_maps[HISTORY_KINDS][UINT8_MAX + 1];
+
 static int
 sensor_key_get(uint8_t fru, uint8_t sensor_num, char *key)
 {
@@ -99,133 +132,284 @@ sensor_coarse_key_get(uint8_t fru, uint8_t sensor_num, char *key)
   return 0;
 }
 
-static int
-cache_set_coarse_history(char *key, float value) {
+/*
+ * Map the history ring of a sensor, creating it if create is set. The
+ * mapping is kept for the life of the process, so sampling a sensor
+ * does not need a syscall.
+ */
+static void *
+history_map(int kind, uint8_t fru, uint8_t sensor_num, bool create)
+{
+  char key[MAX_KEY_LEN] = {0};
+  int share_size = kind == HISTORY_COARSE ?
+    sizeof(sensor_coarse_shm_t) : sizeof(sensor_shm_t);
   int fd;
-  int share_size = sizeof(sensor_coarse_shm_t);
-  void *ptr;
-  sensor_coarse_shm_t *snr_shm;
-  long current_time;
-  int ret = ERR_FAILURE;
+  struct stat st;
+  void *ptr, *expected = NULL;
+  void **maps;
+
+  maps = __atomic_load_n(&history_maps[kind][fru], __ATOMIC_ACQUIRE);
+  if (maps == NULL) {
+    void **fresh = calloc(UINT8_MAX + 1, sizeof(void *));
+    void **none = NULL;
+    if (fresh == NULL) {
+      return NULL;
+    }
+    if (__atomic_compare_exchange_n(&history_maps[kind][fru], &none, fresh,
+          false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      maps = fresh;
+    } else {
+      free(fresh);
+      maps = none;
+    }
+  }
+  ptr = __atomic_load_n(&maps[sensor_num], __ATOMIC_ACQUIRE);
+  if (ptr != NULL) {
+    return ptr;
+  }
 
-  fd = shm_open(key, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+  if ((kind == HISTORY_COARSE ? sensor_coarse_key_get(fru, sensor_num, key) :
+       sensor_key_get(fru, sensor_num, key)) != 0) {
+    return NULL;
+  }
+  fd = shm_open(key, create ? O_CREAT | O_RDWR : O_RDWR, S_IRUSR | S_IWUSR);
   if (fd < 0) {
     DEBUG_STR("%s: shm_open %s failed, errno = %d", __FUNCTION__, key, errno);
-    return -1;
-  }
-
-  if (flock(fd, LOCK_EX) < 0) {
-    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
+    return NULL;
   }
-
-  if (ftruncate(fd, share_size) != 0) {
-    syslog(LOG_INFO, "%s: truncate %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
+  // Only sizing a new ring needs the lock.
+  if (fstat(fd, &st) != 0 || st.st_size < share_size) {
+    if (!create || flock(fd, LOCK_EX) < 0) {
+      close(fd);
+      return NULL;
+    }
+    if ((fstat(fd, &st) != 0 || st.st_size < share_size) &&
+        ftruncate(fd, share_size) != 0) {
+      syslog(LOG_INFO, "%s: truncate %s failed errno = %d\n", __FUNCTION__, key, errno);
+      flock(fd, LOCK_UN);
+      close(fd);
+      return NULL;
+    }
+    flock(fd, LOCK_UN);
   }
-
   ptr = mmap(NULL, share_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
   if (ptr == MAP_FAILED) {
     syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
+    return NULL;
+  }
+
+  if (!__atomic_compare_exchange_n(&maps[sensor_num], &expected, ptr,
+        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    // Another thread mapped it first.
+    munmap(ptr, share_size);
+    ptr = expected;
+  }
+  return ptr;
+}
+
+static int
+cache_set_coarse_history(uint8_t fru, uint8_t sensor_num, float value) {
+  sensor_coarse_shm_t *snr_shm;
+  sensor_coarse_data_t *s;
+  long current_time;
+  int index;
+
+  snr_shm = history_map(HISTORY_COARSE, fru, sensor_num, true);
+  if (snr_shm == NULL) {
+    return ERR_FAILURE;
   }
 
-  snr_shm = (sensor_coarse_shm_t *)ptr;
   current_time = time(NULL);
-  if (snr_shm->data[snr_shm->index].log_time == 0) {
-    sensor_coarse_data_t *s = &snr_shm->data[snr_shm->index];
-    s->log_time = current_time;
+  index = __atomic_load_n(&snr_shm->index, __ATOMIC_RELAXED);
+  s = &snr_shm->data[index];
+  if (s->log_time == 0) {
     s->avg = s->sum = s->max = s->min = value;
     s->count = 1;
-  } else {
-    sensor_coarse_data_t *s = &snr_shm->data[snr_shm->index];
-    /* If the log was started less than an hour ago, then 
+    __atomic_store_n(&s->log_time, current_time, __ATOMIC_RELEASE);
+  } else if (difftime(current_time, s->log_time) < COARSE_THRESHOLD) {
+    /* If the log was started less than an hour ago, then
      * continue to log to this entry */
-    if (difftime(current_time, s->log_time) < COARSE_THRESHOLD) {
-      s->sum += value;
-      s->count += 1;
-      if (value > s->max)
-        s->max = value;
-      if (value < s->min)
-        s->min = value;
-      s->avg = s->sum / s->count;
-    } else {
-      /* Start logging to the next entry */
-      snr_shm->index = (snr_shm->index + 1) % MAX_COARSE_DATA_NUM;
-      s = &snr_shm->data[snr_shm->index];
-      memset(s, 0, sizeof(*s));
-      s->log_time = current_time;
-      s->avg = s->sum = s->max = s->min = value;
-      s->count = 1;
-    }
+    s->sum += value;
+    s->count += 1;
+    if (value > s->max)
+      s->max = value;
+    if (value < s->min)
+      s->min = value;
+    s->avg = s->sum / s->count;
+  } else {
+    /* Start logging to the next entry, readers see it once it is
+     * filled */
+    index = (index + 1) % MAX_COARSE_DATA_NUM;
+    s = &snr_shm->data[index];
+    __atomic_store_n(&s->log_time, 0, __ATOMIC_RELAXED);
+    s->avg = s->sum = s->max = s->min = value;
+    s->count = 1;
+    __atomic_store_n(&s->log_time, current_time, __ATOMIC_RELEASE);
+    __atomic_store_n(&snr_shm->index, index, __ATOMIC_RELEASE);
   }
+  return 0;
+}
 
-  if (munmap(ptr, share_size) != 0) {
-    syslog(LOG_INFO, "%s: munmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
-  }
-  ret = 0;
+static int
+cache_set_history(uint8_t fru, uint8_t sensor_num, float value) {
+  sensor_shm_t *snr_shm;
+  int index;
 
-unlock_bail:
-  if (flock(fd, LOCK_UN) < 0) {
-    syslog(LOG_INFO, "%s: file-unlock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    ret = -1;
+  snr_shm = history_map(HISTORY_FINE, fru, sensor_num, true);
+  if (snr_shm == NULL) {
+    return ERR_FAILURE;
   }
-close_bail:
-  close(fd);
-  return ret;
-}
 
-static int
-cache_set_history(char *key, float value) {
+  // Fill the next slot, then publish it.
+  index = __atomic_load_n(&snr_shm->index, __ATOMIC_RELAXED);
+  snr_shm->data[index].log_time = time(NULL);
+  snr_shm->data[index].value = value;
+  __atomic_store_n(&snr_shm->index, (index + 1) % MAX_DATA_NUM, __ATOMIC_RELEASE);
+  return 0;
+}
 
+/*
+ * Map the cache table of the FRU, creating it if create is set. Returns
+ * NULL if it does not exist yet or cannot be mapped.
+ */
+static sensor_cache_shm_t *
+sensor_cache_map(uint8_t fru, bool create)
+{
+  char name[32];
   int fd;
-  int share_size = sizeof(sensor_shm_t);
+  struct stat st;
   void *ptr;
-  sensor_shm_t *snr_shm;
-  int ret = ERR_FAILURE;
+  sensor_cache_shm_t *shm, *expected = NULL;
+  pthread_mutexattr_t attr;
 
-  fd = shm_open(key, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
-  if (fd < 0) {
-    DEBUG_STR("%s: shm_open %s failed, errno = %d", __FUNCTION__, key, errno);
-    return -1;
+  shm = __atomic_load_n(&sensor_cache_shm[fru], __ATOMIC_ACQUIRE);
+  if (shm != NULL) {
+    return shm;
   }
 
+  snprintf(name, sizeof(name), SENSOR_CACHE_SHM, fru);
+  fd = shm_open(name, create ? O_CREAT | O_RDWR : O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    return NULL;
+  }
   if (flock(fd, LOCK_EX) < 0) {
-    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
+    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, name, errno);
+    close(fd);
+    return NULL;
+  }
+  if (fstat(fd, &st) != 0 ||
+      (st.st_size < (off_t)sizeof(sensor_cache_shm_t) &&
+       (!create || ftruncate(fd, sizeof(sensor_cache_shm_t)) != 0))) {
+    flock(fd, LOCK_UN);
+    close(fd);
+    return NULL;
+  }
+  ptr = mmap(NULL, sizeof(sensor_cache_shm_t), PROT_READ | PROT_WRITE,
+             MAP_SHARED, fd, 0);
+  if (ptr == MAP_FAILED) {
+    syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, name, errno);
+    flock(fd, LOCK_UN);
+    close(fd);
+    return NULL;
+  }
+  shm = (sensor_cache_shm_t *)ptr;
+  if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != SENSOR_CACHE_MAGIC) {
+    if (!create) {
+      munmap(ptr, sizeof(sensor_cache_shm_t));
+      flock(fd, LOCK_UN);
+      close(fd);
+      return NULL;
+    }
+    memset(shm, 0, sizeof(sensor_cache_shm_t));
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&shm->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    __atomic_store_n(&shm->magic, SENSOR_CACHE_MAGIC, __ATOMIC_RELEASE);
+  }
+  flock(fd, LOCK_UN);
+  close(fd);
+
+  if (!__atomic_compare_exchange_n(&sensor_cache_shm[fru], &expected, shm,
+        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    // Another thread mapped it first.
+    munmap(ptr, sizeof(sensor_cache_shm_t));
+    shm = expected;
   }
+  return shm;
+}
 
-  if (ftruncate(fd, share_size) != 0) {
-    syslog(LOG_INFO, "%s: truncate %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
+/* Copy count entries from first, consistent with each other. */
+static int
+sensor_cache_copy(sensor_cache_shm_t *shm, int first, int count,
+                  sensor_cache_entry_t *entries)
+{
+  uint32_t seq;
+  int retry;
+
+  for (retry = 0; retry < CACHE_READ_RETRY * 20; retry++) {
+    seq = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1) {
+      // Being written.
+      sched_yield();
+      continue;
+    }
+    memcpy(entries, &shm->entry[first], sizeof(sensor_cache_entry_t) * count);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == seq) {
+      return 0;
+    }
   }
+  return ERR_FAILURE;
+}
 
-  ptr = mmap(NULL, share_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-  if (ptr == MAP_FAILED) {
-    syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
+/*
+ * Store a reading. Returns 1 if it differs from the cached one, 0 if
+ * not, or ERR_FAILURE.
+ */
+static int
+sensor_cache_store(sensor_cache_shm_t *shm, uint8_t sensor_num, uint8_t status,
+                   float value)
+{
+  sensor_cache_entry_t *e = &shm->entry[sensor_num];
+  uint32_t seq;
+  int ret = pthread_mutex_lock(&shm->lock);
+
+  if (ret == EOWNERDEAD) {
+    // The writer died, seq is fixed up below.
+    pthread_mutex_consistent(&shm->lock);
+  } else if (ret != 0) {
+    return ERR_FAILURE;
   }
+  ret = e->status != status || (status == SENSOR_CACHE_VALID && e->value != value);
 
-  snr_shm = (sensor_shm_t *)ptr;
-  snr_shm->data[snr_shm->index].log_time = time(NULL);
-  snr_shm->data[snr_shm->index].value = value;
-  snr_shm->index = (snr_shm->index + 1) % MAX_DATA_NUM;
+  seq = __atomic_load_n(&shm->seq, __ATOMIC_RELAXED) | 1;
+  __atomic_store_n(&shm->seq, seq, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  e->value = value;
+  e->status = status;
+  e->log_time = time(NULL);
+  __atomic_store_n(&shm->seq, seq + 1, __ATOMIC_RELEASE);
 
-  if (munmap(ptr, share_size) != 0) {
-    syslog(LOG_INFO, "%s: munmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
-  }
-  ret = 0;
+  pthread_mutex_unlock(&shm->lock);
+  return ret;
+}
 
-unlock_bail:
-  if (flock(fd, LOCK_UN) < 0) {
-    syslog(LOG_INFO, "%s: file-unlock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    ret = -1;
+int
+sensor_cache_read_fru(uint8_t fru, sensor_cache_entry_t *entries)
+{
+#ifndef DBUS_SENSOR_SVC
+  sensor_cache_shm_t *shm = sensor_cache_map(fru, false);
+
+  if (shm == NULL) {
+    return ERR_FAILURE;
   }
-close_bail:
-  close(fd);
-  return ret;
+  return sensor_cache_copy(shm, 0, MAX_SENSOR_CACHE_NUM, entries);
+#else
+  return ERR_FAILURE;
+#endif
 }
 
 int __attribute__((weak))
@@ -236,7 +420,20 @@ sensor_cache_read(uint8_t fru, uint8_t sensor_num, float *value)
   char key[MAX_KEY_LEN];
   char str[MAX_VALUE_LEN];
   int retry = 0;
+  sensor_cache_shm_t *shm = sensor_cache_map(fru, false);
+  sensor_cache_entry_t e;
 
+  if (shm != NULL && sensor_cache_copy(shm, sensor_num, 1, &e) == 0) {
+    if (e.status == SENSOR_CACHE_VALID) {
+      *value = e.value;
+      return 0;
+    }
+    if (e.status == SENSOR_CACHE_NA) {
+      return ERR_SENSOR_NA;
+    }
+  }
+
+  // Not cached by sensor_cache_write(), try the kv mirror.
   if (sensor_key_get(fru, sensor_num, key))
     return ERR_UNKNOWN_FRU;
   for (retry = 0; retry < CACHE_READ_RETRY; retry++) {
@@ -260,32 +457,58 @@ sensor_cache_read(uint8_t fru, uint8_t sensor_num, float *value)
 #endif
 }
 
+/*
+ * Forget the cached reading, readers go back to the kv key. Some PALs
+ * set it to "NA" themselves and return an error.
+ */
+static void
+sensor_cache_clear(uint8_t fru, uint8_t sensor_num)
+{
+  sensor_cache_shm_t *shm = sensor_cache_map(fru, false);
+
+  if (shm != NULL) {
+    sensor_cache_store(shm, sensor_num, SENSOR_CACHE_EMPTY, 0.0);
+  }
+}
+
 int
 sensor_cache_write(uint8_t fru, uint8_t sensor_num, bool available, float value)
 {
   char key[MAX_KEY_LEN];
   char str[MAX_VALUE_LEN];
   int ret;
+  int changed = 1;
+  sensor_cache_shm_t *shm;
 
   if (sensor_key_get(fru, sensor_num, key))
     return ERR_UNKNOWN_FRU;
 
-  if (available)
+  if (available) {
     sprintf(str, "%.2f", value);
-  else
+    // Readers of the kv mirror have always seen two decimals.
+    value = strtof(str, NULL);
+  } else {
     strcpy(str, "NA");
+  }
 
-  ret = kv_set(key, str, 0, 0);
-  if (ret) {
-    DEBUG_STR("sensor_cache_write: cache_set %s failed.\n", key);
-    return ERR_FAILURE;
+  shm = sensor_cache_map(fru, true);
+  if (shm != NULL) {
+    changed = sensor_cache_store(shm, sensor_num,
+        available ? SENSOR_CACHE_VALID : SENSOR_CACHE_NA, value);
   }
-  if (available) {
-    cache_set_history(key, value);
-    if (sensor_coarse_key_get(fru, sensor_num, key) == 0) {
-      cache_set_coarse_history(key, value);
+
+  // The kv mirror only needs to be written when the reading changes.
+  if (changed != 0) {
+    ret = kv_set(key, str, 0, 0);
+    if (ret) {
+      DEBUG_STR("sensor_cache_write: cache_set %s failed.\n", key);
+      return ERR_FAILURE;
     }
   }
+  if (available) {
+    cache_set_history(fru, sensor_num, value);
+    cache_set_coarse_history(fru, sensor_num, value);
+  }
   return 0;
 }
 
@@ -301,6 +524,8 @@ int sensor_raw_read(uint8_t fru, uint8_t sensor_num, float *value)
     sensor_cache_write(fru, sensor_num, true, *value);
   else if (ret == ERR_SENSOR_NA)
     sensor_cache_write(fru, sensor_num, false, 0.0);
+  else if (ret < 0)
+    sensor_cache_clear(fru, sensor_num);
   return ret;
 }
 
@@ -308,39 +533,19 @@ static int
 sensor_read_short_history(uint8_t fru, uint8_t sensor_num, float *min,
     float *average, float *max, int start_time)
 {
-  char key[MAX_KEY_LEN] = {0};
-  int fd;
-  int share_size = sizeof(sensor_shm_t);
-  void *ptr;
   sensor_shm_t *snr_shm;
   int16_t read_index;
   uint16_t count = 0;
   float read_val;
   double total = 0;
-  int ret = ERR_FAILURE;
+  sensor_data_t d;
 
-  if (sensor_key_get(fru, sensor_num, key))
-    return ERR_UNKNOWN_FRU;
-
-  fd = shm_open(key, O_RDONLY, S_IRUSR | S_IWUSR);
-  if (fd < 0) {
-    DEBUG_STR("%s: shm_open %s failed, errno = %d", __FUNCTION__, key, errno);
+  snr_shm = history_map(HISTORY_FINE, fru, sensor_num, false);
+  if (snr_shm == NULL) {
     return ERR_FAILURE;
   }
 
-  if (flock(fd, LOCK_EX) < 0) {
-    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
-  }
-
-  ptr = mmap(NULL, share_size, PROT_READ, MAP_SHARED, fd, 0);
-  if (ptr == MAP_FAILED) {
-    syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
-  }
-
-  snr_shm = (sensor_shm_t *)ptr;
-  read_index = snr_shm->index - 1;
+  read_index = __atomic_load_n(&snr_shm->index, __ATOMIC_ACQUIRE) - 1;
   if (read_index < 0) {
     read_index += MAX_DATA_NUM;
   }
@@ -349,8 +554,12 @@ sensor_read_short_history(uint8_t fru, uint8_t sensor_num, float *min,
   *min = read_val;
   *max = read_val;
 
-  while ((snr_shm->data[read_index].log_time >= start_time) && (count < MAX_DATA_NUM)) {
-    read_val = snr_shm->data[read_index].value;
+  while (count < MAX_DATA_NUM) {
+    d = snr_shm->data[read_index];
+    if (d.log_time < start_time) {
+      break;
+    }
+    read_val = d.value;
     if (read_val > *max)
       *max = read_val;
     if (read_val < *min)
@@ -363,15 +572,10 @@ sensor_read_short_history(uint8_t fru, uint8_t sensor_num, float *min,
     }
   }
 
-  if (munmap(ptr, share_size) != 0) {
-    syslog(LOG_INFO, "%s: munmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
-  }
-
   /* If none found in history, just return the cached value */
   if (!count) {
     float read_value;
-    ret = sensor_cache_read(fru, sensor_num, &read_value);
+    int ret = sensor_cache_read(fru, sensor_num, &read_value);
     if (ret)
       return ret;
     total = *min = *max = read_value;
@@ -379,81 +583,51 @@ sensor_read_short_history(uint8_t fru, uint8_t sensor_num, float *min,
   }
 
   *average = total / count;
-  ret = 0;
-unlock_bail:
-  if (flock(fd, LOCK_UN) < 0) {
-    syslog(LOG_INFO, "%s: file-unlock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    ret = -1;
-  }
-close_bail:
-  close(fd);
-  return ret;
+  return 0;
 }
 
 static int
 sensor_read_long_history(uint8_t fru, uint8_t sensor_num, float *min,
     float *average, float *max, int start_time)
 {
-  char key[MAX_KEY_LEN] = {0};
-  int fd;
-  int share_size = sizeof(sensor_coarse_shm_t);
-  void *ptr;
   sensor_coarse_shm_t *snr_shm;
-  sensor_coarse_data_t *s;
+  sensor_coarse_data_t s;
   int16_t read_index;
   uint16_t count = 0;
   double total = 0;
-  int ret = ERR_FAILURE;
-
-  if (sensor_coarse_key_get(fru, sensor_num, key))
-    return ERR_UNKNOWN_FRU;
 
-  fd = shm_open(key, O_RDONLY, S_IRUSR | S_IWUSR);
-  if (fd < 0) {
-    DEBUG_STR("%s: shm_open %s failed, errno = %d", __FUNCTION__, key, errno);
+  snr_shm = history_map(HISTORY_COARSE, fru, sensor_num, false);
+  if (snr_shm == NULL) {
     return ERR_FAILURE;
   }
 
-  if (flock(fd, LOCK_EX) < 0) {
-    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
-  }
-
-  ptr = mmap(NULL, share_size, PROT_READ, MAP_SHARED, fd, 0);
-  if (ptr == MAP_FAILED) {
-    syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
-  }
-
-  snr_shm = (sensor_coarse_shm_t *)ptr;
-  read_index = snr_shm->index;
+  read_index = __atomic_load_n(&snr_shm->index, __ATOMIC_ACQUIRE);
   total = 0;
   *max = -FLT_MAX;
   *min = FLT_MAX;
   while (count < MAX_COARSE_DATA_NUM) {
-    s = &snr_shm->data[read_index];
-    if (s->log_time < start_time) {
+    s.log_time = __atomic_load_n(&snr_shm->data[read_index].log_time, __ATOMIC_ACQUIRE);
+    if (s.log_time < start_time) {
       break;
     }
-    if (s->max > *max)
-      *max = s->max;
-    if (s->min < *min)
-      *min = s->min;
-    total += s->avg;
+    s.max = snr_shm->data[read_index].max;
+    s.min = snr_shm->data[read_index].min;
+    s.avg = snr_shm->data[read_index].avg;
+    if (s.max > *max)
+      *max = s.max;
+    if (s.min < *min)
+      *min = s.min;
+    total += s.avg;
     count++;
     if ((--read_index) < 0) {
       read_index += MAX_COARSE_DATA_NUM;
     }
   }
-  if (munmap(ptr, share_size) != 0) {
-    syslog(LOG_INFO, "%s: munmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
-  }
 
   /* If none found in history, just return the cached value */
   if (!count) {
     float read_value;
-    ret = sensor_cache_read(fru, sensor_num, &read_value);
+    int ret = sensor_cache_read(fru, sensor_num, &read_value);
     if (ret)
       return ret;
     total = *min = *max = read_value;
@@ -461,15 +635,7 @@ sensor_read_long_history(uint8_t fru, uint8_t sensor_num, float *min,
   }
 
   *average = total / count;
-  ret = 0;
-unlock_bail:
-  if (flock(fd, LOCK_UN) < 0) {
-    syslog(LOG_INFO, "%s: file-unlock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    ret = -1;
-  }
-close_bail:
-  close(fd);
-  return ret;
+  return 0;
 }
 
 int
@@ -561,6 +727,20 @@ pal_sensor_is_source_host(uint8_t fru, uint8_t sensor_id)
   return false;
 }
 
+/*
+ * sensord reads the sensors on different paths in parallel, and at most
+ * max_reads of the sensors sharing a path at a time. The default keeps
+ * all the sensors of a FRU on one path, read one at a time, for the PALs
+ * which are not safe to call from several threads for the same FRU.
+ */
+int __attribute__((weak))
+pal_get_sensor_access_path(uint8_t fru, uint8_t sensor_num, uint32_t *path, uint8_t *max_reads)
+{
+  *path = SENSOR_PATH(SENSOR_PATH_FRU, fru);
+  *max_reads = 1;
+  return PAL_EOK;
+}
+
 bool __attribute__((weak))
 pal_is_host_snr_available(uint8_t fru, uint8_t sensor_id)
 {
@@ -717,6 +897,12 @@ pal_sensor_sdr_init(uint8_t fru, void *sinfo)
   return -1;
 }
 
+int __attribute__((weak))
+pal_sensor_sdr_path(uint8_t fru, char *path)
+{
+  return -1;
+}
+
 int __attribute__((weak))
 pal_get_all_thresh_from_file(uint8_t fru, thresh_sensor_t *sinfo, int mode) {
   int fd;
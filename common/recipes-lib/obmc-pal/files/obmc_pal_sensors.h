@@ -75,11 +75,36 @@ typedef struct {
  * it starts to get accounted in the COARSE grained calculations */
 #define COARSE_THRESHOLD ((double)3600)
 
+/* Number of entries in a FRU's sensor cache table */
+#define MAX_SENSOR_CACHE_NUM (PHYSICAL_SENSOR_END + 1)
+
+/* Status of a sensor_cache_entry_t */
+#define SENSOR_CACHE_EMPTY 0
+#define SENSOR_CACHE_VALID 1
+#define SENSOR_CACHE_NA    2
+
+typedef struct {
+  float value;
+  uint8_t status;
+  uint8_t reserved[3];
+  int64_t log_time;
+} sensor_cache_entry_t;
+
 /* Functions */
 
 /* Read a cached value of the given sensor */
 int sensor_cache_read(uint8_t fru, uint8_t sensor_num, float *value);
 
+/*
+ * Read the cached readings of all the sensors of the FRU at once, indexed
+ * by sensor number, without a syscall once the cache is mapped. entries
+ * has MAX_SENSOR_CACHE_NUM entries. Sensors never written with
+ * sensor_cache_write(), or whose last sensor_raw_read() failed with an
+ * error other than ERR_SENSOR_NA, are SENSOR_CACHE_EMPTY,
+ * sensor_cache_read() falls back to their kv key.
+ */
+int sensor_cache_read_fru(uint8_t fru, sensor_cache_entry_t *entries);
+
 /* Writes the cache explicitly */
 int sensor_cache_write(uint8_t fru, uint8_t sensor_num, bool available, float value);
 
@@ -0,0 +1,152 @@
+/*
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <openbmc/kv.h>
+#include <openbmc/cmock.h>
+#include "obmc-pal.h"
+#include "obmc_pal_sensors.h"
+
+#define TEST_FRU 250
+#define TEST_SNR 1
+
+DEFINE_MOCK_FUNC(int, kv_get, const char *, char *, size_t *, unsigned int);
+DEFINE_MOCK_FUNC(int, kv_set, const char *, const char *, size_t, unsigned int);
+DEFINE_MOCK_FUNC(int, pal_get_fru_name, uint8_t, char *);
+DEFINE_MOCK_FUNC(int, pal_sensor_read_raw, uint8_t, uint8_t, void *);
+
+// A single kv key is enough, the tests only use one sensor.
+static char kv_value[MAX_VALUE_LEN];
+
+static int mocked_kv_get(const char *key, char *value, size_t *len, unsigned int flags)
+{
+  strcpy(value, kv_value);
+  if (len)
+    *len = strlen(kv_value);
+  return 0;
+}
+
+static int unexpected_kv_get(const char *key, char *value, size_t *len, unsigned int flags)
+{
+  ASSERT(0, "Cached readings do not go to kv");
+  return -1;
+}
+
+static int mocked_kv_set(const char *key, const char *value, size_t len, unsigned int flags)
+{
+  ASSERT_EQ_STR(key, "test_sensor1", "Sensor key");
+  snprintf(kv_value, sizeof(kv_value), "%s", value);
+  return 0;
+}
+
+static int mocked_fru_name(uint8_t fru, char *name)
+{
+  strcpy(name, "test");
+  return 0;
+}
+
+static int mocked_read_ok(uint8_t fru, uint8_t snr, void *value)
+{
+  *(float *)value = 42.0;
+  return 0;
+}
+
+static int mocked_read_na(uint8_t fru, uint8_t snr, void *value)
+{
+  return ERR_SENSOR_NA;
+}
+
+// What several PALs do: report NA through kv and fail the read.
+static int mocked_read_kv_na(uint8_t fru, uint8_t snr, void *value)
+{
+  kv_set("test_sensor1", "NA", 0, 0);
+  return -1;
+}
+
+static void setup(void)
+{
+  MOCK(kv_get, mocked_kv_get);
+  MOCK(kv_set, mocked_kv_set);
+  MOCK(pal_get_fru_name, mocked_fru_name);
+}
+
+DEFINE_TEST(test_read_cached)
+{
+  float val = 0;
+
+  setup();
+  MOCK(pal_sensor_read_raw, mocked_read_ok);
+  ASSERT_EQ(sensor_raw_read(TEST_FRU, TEST_SNR, &val), 0, "Raw read succeeds");
+  ASSERT_EQ_FLT(val, 42.0, "Raw read value");
+  ASSERT_EQ_STR(kv_value, "42.00", "kv mirror is written");
+
+  MOCK(kv_get, unexpected_kv_get);
+  val = 0;
+  ASSERT_EQ(sensor_cache_read(TEST_FRU, TEST_SNR, &val), 0, "Cache read succeeds");
+  ASSERT_EQ_FLT(val, 42.0, "Cached value");
+}
+
+DEFINE_TEST(test_read_na)
+{
+  float val = 0;
+
+  setup();
+  MOCK(pal_sensor_read_raw, mocked_read_ok);
+  sensor_raw_read(TEST_FRU, TEST_SNR, &val);
+  MOCK(pal_sensor_read_raw, mocked_read_na);
+  ASSERT_EQ(sensor_raw_read(TEST_FRU, TEST_SNR, &val), ERR_SENSOR_NA, "Raw read is NA");
+  ASSERT_EQ_STR(kv_value, "NA", "kv mirror is NA");
+  ASSERT_EQ(sensor_cache_read(TEST_FRU, TEST_SNR, &val), ERR_SENSOR_NA, "Cache read is NA");
+}
+
+DEFINE_TEST(test_read_failed_kv_na)
+{
+  float val = 0;
+
+  setup();
+  MOCK(pal_sensor_read_raw, mocked_read_ok);
+  sensor_raw_read(TEST_FRU, TEST_SNR, &val);
+  ASSERT_EQ(sensor_cache_read(TEST_FRU, TEST_SNR, &val), 0, "Cache read succeeds");
+
+  MOCK(pal_sensor_read_raw, mocked_read_kv_na);
+  ASSERT_EQ(sensor_raw_read(TEST_FRU, TEST_SNR, &val), -1, "Raw read fails");
+  ASSERT_EQ(sensor_cache_read(TEST_FRU, TEST_SNR, &val), ERR_SENSOR_NA,
+      "Cache read is NA, not the last good reading");
+
+  // The next good reading is cached again.
+  MOCK(pal_sensor_read_raw, mocked_read_ok);
+  sensor_raw_read(TEST_FRU, TEST_SNR, &val);
+  MOCK(kv_get, unexpected_kv_get);
+  ASSERT_EQ(sensor_cache_read(TEST_FRU, TEST_SNR, &val), 0, "Cache read succeeds");
+  ASSERT_EQ_FLT(val, 42.0, "Cached value");
+}
+
+int main(int argc, char *argv[])
+{
+  char name[64];
+
+  snprintf(name, sizeof(name), "/sensor_cache_fru%u", TEST_FRU);
+  shm_unlink(name);
+  CALL_TESTS();
+  shm_unlink(name);
+  return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2019-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Compares reading a whole chip the way libsensors and the PWM sensors
+// used to (open, read and close every attribute) with
+// SensorChip::read_all() over files kept open, on a fake hwmon tree.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "sensorchip.hpp"
+
+using namespace std;
+
+#define NUM_IN 16
+#define NUM_FAN 8
+#define NUM_PWM 8
+
+class BenchChip : public FanSensorChip {
+  public:
+    BenchChip(const sensors_chip_name *_chip) : FanSensorChip(_chip, "bench-isa-0000") {}
+    void add(const sensors_feature *feature, const sensors_subfeature *subfeature) {
+      addsensor(SensorChip::make_sensor(chip, feature, subfeature));
+    }
+    void add_pwm(const string &name) {
+      addsensor(make_sensor(chip, name));
+    }
+};
+
+static double now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void write_attr(const string &path, const char *value)
+{
+  FILE *fp = fopen(path.c_str(), "w");
+  if (fp == NULL) {
+    perror(path.c_str());
+    exit(1);
+  }
+  fputs(value, fp);
+  fclose(fp);
+}
+
+// What sensors_get_value() does for each value.
+static float read_sysfs(const string &path, double scale)
+{
+  double value = NAN;
+  FILE *fp = fopen(path.c_str(), "r");
+  if (fp) {
+    if (fscanf(fp, "%lf", &value) != 1) {
+      value = NAN;
+    }
+    fclose(fp);
+  }
+  return float(value / scale);
+}
+
+// What PWMSensor::read() did.
+static float read_ifstream(const string &path)
+{
+  ifstream file;
+  file.exceptions(~ifstream::goodbit);
+  file.open(path);
+  int val;
+  file >> val;
+  file.close();
+  return ceil(float(val) * 100.0 / 255.0);
+}
+
+int main(int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+  char dir[] = "/tmp/obmc-sensors-bench.XXXXXX";
+  if (mkdtemp(dir) == NULL) {
+    perror("mkdtemp");
+    return -1;
+  }
+  string base(dir);
+
+  vector<string> names, paths, labels;
+  vector<double> scales;
+  vector<sensors_feature> features;
+  vector<sensors_subfeature> subfeatures;
+  features.reserve(NUM_IN + NUM_FAN);
+  subfeatures.reserve(NUM_IN + NUM_FAN);
+  names.reserve(2 * (NUM_IN + NUM_FAN));
+  for (int i = 1; i <= NUM_IN + NUM_FAN; i++) {
+    bool in = i <= NUM_IN;
+    int n = in ? i : i - NUM_IN;
+    names.push_back((in ? "in" : "fan") + to_string(n));
+    names.push_back(names.back() + "_input");
+    features.push_back({const_cast<char *>(names[names.size() - 2].c_str()), i - 1,
+        in ? SENSORS_FEATURE_IN : SENSORS_FEATURE_FAN, i - 1, 0});
+    subfeatures.push_back({const_cast<char *>(names.back().c_str()), i - 1,
+        in ? SENSORS_SUBFEATURE_IN_INPUT : SENSORS_SUBFEATURE_FAN_INPUT, i - 1,
+        SENSORS_MODE_R});
+    paths.push_back(base + "/" + names.back());
+    labels.push_back(names[names.size() - 2]);
+    scales.push_back(in ? 1000.0 : 1.0);
+    write_attr(paths.back(), in ? "1234\n" : "5400\n");
+  }
+  for (int i = 1; i <= NUM_PWM; i++) {
+    labels.push_back("pwm" + to_string(i));
+    paths.push_back(base + "/" + labels.back());
+    write_attr(paths.back(), "128\n");
+  }
+
+  sensors_chip_name name = {const_cast<char *>("bench"), {SENSORS_BUS_TYPE_ISA, 0}, 0, dir};
+  BenchChip chip(&name);
+  for (size_t i = 0; i < features.size(); i++) {
+    chip.add(&features[i], &subfeatures[i]);
+  }
+  for (int i = 1; i <= NUM_PWM; i++) {
+    chip.add_pwm("pwm" + to_string(i));
+  }
+
+  size_t count = labels.size();
+  vector<const char *> clabels;
+  for (auto &l : labels) {
+    clabels.push_back(l.c_str());
+  }
+  vector<float> before(count), after(count);
+
+  double start = now_us();
+  for (int it = 0; it < iterations; it++) {
+    for (size_t i = 0; i < count; i++) {
+      before[i] = i < scales.size() ? read_sysfs(paths[i], scales[i]) : read_ifstream(paths[i]);
+    }
+  }
+  double open_us = (now_us() - start) / iterations;
+
+  start = now_us();
+  for (int it = 0; it < iterations; it++) {
+    if (chip.read_all(clabels.data(), after.data(), count) != count) {
+      printf("read_all failed\n");
+      return -1;
+    }
+  }
+  double batch_us = (now_us() - start) / iterations;
+
+  for (size_t i = 0; i < count; i++) {
+    if (before[i] != after[i]) {
+      printf("%s: %f != %f\n", clabels[i], before[i], after[i]);
+      return -1;
+    }
+    unlink(paths[i].c_str());
+  }
+  rmdir(dir);
+
+  printf("%zu sensors, %d iterations\n", count, iterations);
+  printf("open/read/close: %.1f us per chip\n", open_us);
+  printf("read_all:        %.1f us per chip\n", batch_us);
+  return 0;
+}
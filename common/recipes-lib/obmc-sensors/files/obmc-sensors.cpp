@@ -45,6 +45,27 @@ extern "C" int sensors_read(const char *chip, const char *label, float *value)
   return ret;
 }
 
+extern "C" int sensors_read_chip_batch(const char *chip, const char * const *labels,
+    float *values, size_t count)
+{
+  if (!chip || (count && (!labels || !values))) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  auto it = sensors.find(chip);
+  if (it == sensors.end()) {
+    syslog(LOG_ERR, "ReadBatch(%s): Unknown chip\n", chip);
+    errno = ENODEV;
+    return -1;
+  }
+  size_t nread = it->second->read_all(labels, values, count);
+  if (nread < count) {
+    syslog(LOG_ERR, "ReadBatch(%s): %zu of %zu sensors failed\n", chip, count - nread, count);
+  }
+  return int(nread);
+}
+
 extern "C" int sensors_write(const char *chip, const char *label, float value)
 {
   int ret = -1;
@@ -32,6 +32,8 @@
 #ifndef _OBMC_SENSORS_H_
 #define _OBMC_SENSORS_H_
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +42,12 @@ extern "C" {
 // Read the given chip's sensor value
 int sensors_read(const char *chip, const char *label, float *value);
 
+// Read the sensors with the given labels of a chip in one pass, over
+// sysfs files kept open. Values which could not be read are set to NAN.
+// Returns the number of values read, or -1 if the chip does not exist.
+int sensors_read_chip_batch(const char *chip, const char * const *labels,
+    float *values, size_t count);
+
 // Write sensor value. Not supported on all chips/labels
 int sensors_write(const char *chip, const char *label, float value);
 
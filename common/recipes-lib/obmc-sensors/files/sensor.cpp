@@ -17,11 +17,87 @@
  */
 #include <cmath>
 #include <syslog.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "sensor.hpp"
+#include <cstdlib>
 #include <cstring>
 
 using namespace std;
 
+// Same units as libsensors, which divides the sysfs value by these.
+static double type_scaling(sensors_subfeature_type type)
+{
+  switch (type & 0xFF80) {
+    case SENSORS_SUBFEATURE_IN_INPUT:
+    case SENSORS_SUBFEATURE_TEMP_INPUT:
+    case SENSORS_SUBFEATURE_CURR_INPUT:
+    case SENSORS_SUBFEATURE_HUMIDITY_INPUT:
+      return 1000.0;
+    case SENSORS_SUBFEATURE_FAN_INPUT:
+      return 1.0;
+    case SENSORS_SUBFEATURE_POWER_AVERAGE:
+    case SENSORS_SUBFEATURE_ENERGY_INPUT:
+      return 1000000.0;
+  }
+  switch (type) {
+    case SENSORS_SUBFEATURE_POWER_AVERAGE_INTERVAL:
+    case SENSORS_SUBFEATURE_VID:
+      return 1000.0;
+    default:
+      return 1.0;
+  }
+}
+
+AttrFile::~AttrFile()
+{
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+void AttrFile::open(const std::string &_path)
+{
+  std::lock_guard<std::mutex> lk(fd_lock);
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+  path = _path;
+}
+
+bool AttrFile::read(char *buf, size_t size)
+{
+  std::lock_guard<std::mutex> lk(fd_lock);
+  if (fd < 0) {
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+  }
+  ssize_t len = pread(fd, buf, size - 1, 0);
+  if (len <= 0) {
+    close(fd);
+    fd = -1;
+    return false;
+  }
+  buf[len] = '\0';
+  return true;
+}
+
+long AttrFile::read_long(int base)
+{
+  char buf[32], *end;
+  if (!read(buf, sizeof(buf))) {
+    throw system_error(EIO, std::generic_category(), "Attribute read failure");
+  }
+  long val = strtol(buf, &end, base);
+  if (end == buf) {
+    throw system_error(EINVAL, std::generic_category(), "Attribute parse failure");
+  }
+  return val;
+}
+
 void Sensor::initialize()
 {
   if (feature == nullptr || chip == nullptr || subfeature == nullptr) {
@@ -45,6 +121,10 @@ void Sensor::initialize()
     else
       label.assign(name);
   }
+  if (chip->path != nullptr) {
+    attr.open(string(chip->path) + "/" + subfeature->name);
+  }
+  scale = type_scaling(subfeature->type);
 }
 
 float Sensor::read()
@@ -53,7 +133,21 @@ float Sensor::read()
   if (subfeature == nullptr) {
     throw system_error(ENOTSUP, std::generic_category(), "Sensor feature not supported");
   }
-  if ((sensors_get_value(chip, subfeature->number, &value)) < 0) {
+  int ret;
+  if (computed || chip->path == nullptr) {
+    ret = sensors_get_value(chip, subfeature->number, &value);
+  } else {
+    char buf[32], *end;
+    ret = -1;
+    if (attr.read(buf, sizeof(buf))) {
+      value = strtod(buf, &end);
+      if (end != buf) {
+        value /= scale;
+        ret = 0;
+      }
+    }
+  }
+  if (ret < 0) {
     char cname[128];
     sensors_snprintf_chip_name(cname, sizeof(cname), chip);
     // 0 rpm will let ASPEED tacho driver reading timeout, ignore the error and report 0 rpm directlly.
@@ -80,15 +174,12 @@ void Sensor::write(float value)
 void PWMSensor::initialize()
 {
   path = string(chip->path) + "/" + name;
+  pwm.open(path);
 }
 
 float PWMSensor::read()
 {
-  InFile file;
-  file.open(path);
-  int val;
-  file >> val;
-  file.close();
+  int val = pwm.read_long();
   return ceil(float(val) * 100.0 / 255.0);
 }
 
@@ -103,12 +194,7 @@ void PWMSensor::write(float value)
 
 int LegacyPWMSensor::unit_max()
 {
-  InFile file;
-  file.open(unit_path);
-  int unit;
-  file >> unit;
-  file.close();
-  return unit + 1;
+  return unit.read_long() + 1;
 }
 
 void LegacyPWMSensor::initialize()
@@ -123,22 +209,17 @@ void LegacyPWMSensor::initialize()
   falling_path = base + "/" + name + "_falling";
   rising_path = base + "/" + name + "_rising";
   unit_path = base + "/pwm_type_m_unit";
+  en.open(en_path);
+  falling.open(falling_path);
+  unit.open(unit_path);
 }
 
 float LegacyPWMSensor::read()
 {
-  InFile file;
-  file.open(en_path);
-  int en;
-  file >> en;
-  file.close();
-  if (!en) {
+  if (!en.read_long()) {
     return 0.0;
   }
-  int val;
-  file.open(falling_path);
-  file >> std::hex >> val;
-  file.close();
+  int val = falling.read_long(16);
   if (val == 0)
     return 100.0;
   int max = unit_max();
@@ -19,6 +19,7 @@
 #define _SENSOR_HPP_
 #include <string>
 #include <fstream>
+#include <mutex>
 #include <system_error>
 #include <sensors/sensors.h>
 
@@ -30,12 +31,27 @@ class OutFile : public std::ofstream {
     }
 };
 
-// ifstream which throws by default
-class InFile : public std::ifstream {
+// sysfs attribute kept open across reads. Each read is a pread() from
+// the start of the file, which makes the driver sample it again. The
+// file is reopened on the next read after a failure, e.g. the device
+// was unbound.
+class AttrFile {
+  std::string path;
+  int fd;
+  std::mutex fd_lock;
   public:
-    InFile() : std::ifstream() {
-      exceptions(~std::ifstream::goodbit);
-    }
+    AttrFile() : path(), fd(-1) {}
+    ~AttrFile();
+    AttrFile(const AttrFile&) = delete;
+    AttrFile& operator=(const AttrFile&) = delete;
+
+    void open(const std::string &_path);
+
+    // Reads the attribute into buf. Returns false on failure.
+    bool read(char *buf, size_t size);
+
+    // Reads the attribute as a number, throws on failure.
+    long read_long(int base = 10);
 };
 
 // Sensor capable of reading/writing sensor values.
@@ -47,9 +63,15 @@ class Sensor {
   const sensors_subfeature *subfeature;
   std::string name;
   std::string label;
+  // The raw attribute is only used when no compute statement of the
+  // config applies to it, otherwise libsensors does the conversion.
+  bool computed;
+  double scale;
+  AttrFile attr;
   public:
     Sensor(const sensors_chip_name *_c, const sensors_feature *_feature, const sensors_subfeature *_subfeature)
-      : chip(_c), feature(_feature), subfeature(_subfeature), name(), label("") {}
+      : chip(_c), feature(_feature), subfeature(_subfeature), name(), label(""),
+        computed(false), scale(1.0), attr() {}
     virtual ~Sensor() {}
 
     // Initialize a sensor.
@@ -58,6 +80,9 @@ class Sensor {
     // Get the label
     std::string get_label() {return label;}
 
+    // Have libsensors apply the config to the value.
+    void set_computed(bool c) {computed = c;}
+
     // Reads the current value of the sensor
     virtual float read();
 
@@ -70,9 +95,10 @@ class Sensor {
 class PWMSensor : public Sensor {
   protected:
   std::string path;
+  AttrFile pwm;
   public:
     PWMSensor(const sensors_chip_name *fanchip, const std::string &_name)
-      : Sensor(fanchip, nullptr, nullptr), path() {name = _name; label = _name;}
+      : Sensor(fanchip, nullptr, nullptr), path(), pwm() {name = _name; label = _name;}
     virtual ~PWMSensor() {}
 
     // Initialize a sensor.
@@ -93,11 +119,15 @@ class LegacyPWMSensor : public Sensor {
   std::string falling_path;
   std::string type_path;
   std::string unit_path;
+  AttrFile en;
+  AttrFile falling;
+  AttrFile unit;
   int unit_max();
   public:
     LegacyPWMSensor(const sensors_chip_name *fanchip, const std::string &_name)
       : Sensor(fanchip, nullptr, nullptr), en_path(),
-      rising_path(), falling_path(), type_path(), unit_path() {name = _name;}
+      rising_path(), falling_path(), type_path(), unit_path(),
+      en(), falling(), unit() {name = _name;}
     virtual ~LegacyPWMSensor() {}
 
     // Initialize a sensor.
@@ -17,6 +17,7 @@
  */
 #include <stdio.h> 
 #include <dirent.h>
+#include <cmath>
 #include <regex>
 #include <vector>
 #include "sensorchip.hpp"
@@ -30,7 +31,9 @@ using namespace std;
 
 unique_ptr<Sensor> SensorChip::make_sensor(const sensors_chip_name *chip, const sensors_feature *feature, const sensors_subfeature *subfeature)
 {
-  return unique_ptr<Sensor>(new Sensor(chip, feature, subfeature));
+  unique_ptr<Sensor> snr(new Sensor(chip, feature, subfeature));
+  snr->set_computed(computed.count(feature->name) || computed.count(subfeature->name));
+  return snr;
 }
 
 void SensorChip::addsensor(std::unique_ptr<Sensor> snr)
@@ -79,6 +82,25 @@ void SensorChip::enumerate()
   }
 }
 
+size_t SensorChip::read_all(const char * const labels[], float values[], size_t count)
+{
+  size_t nread = 0;
+  for (size_t i = 0; i < count; i++) {
+    values[i] = NAN;
+    auto it = this->find(labels[i]);
+    if (it == this->end()) {
+      continue;
+    }
+    try {
+      values[i] = it->second->read();
+      nread++;
+    } catch (std::system_error &e) {
+      // Reported as NAN, the others are still read.
+    }
+  }
+  return nread;
+}
+
 unique_ptr<Sensor> FanSensorChip::make_sensor(const sensors_chip_name *chip, const std::string &name)
 {
   return unique_ptr<PWMSensor>(new PWMSensor(chip, name));
@@ -19,15 +19,18 @@
 #define _SENSORCHIP_HPP_
 #include <memory>
 #include <map>
+#include <set>
 #include <string>
 #include "sensor.hpp"
 
 // Collection of sensors grouped in a single "chip". Provides efficient
 // lookup of sensors within a chip.
-class SensorChip : public std::map<std::string, std::unique_ptr<Sensor>> {
+class SensorChip : public std::map<std::string, std::unique_ptr<Sensor>, std::less<>> {
   protected:
   const sensors_chip_name *chip;
   std::string name;
+  // Features with a compute statement in the config.
+  std::set<std::string> computed;
 
     // Makes a sensor for the given chip.
     virtual std::unique_ptr<Sensor> make_sensor(const sensors_chip_name *chip,
@@ -38,11 +41,20 @@ class SensorChip : public std::map<std::string, std::unique_ptr<Sensor>> {
 
   public:
     SensorChip(const sensors_chip_name *_chip, const std::string &n)
-      : chip(_chip), name(n) {}
+      : chip(_chip), name(n), computed() {}
     virtual ~SensorChip() {}
 
+    // Leave the conversion of the feature to libsensors. Has to be
+    // called before enumerate().
+    void add_computed(const std::string &feature) {computed.insert(feature);}
+
     // Enumerate sensors in this chip
     virtual void enumerate();
+
+    // Reads the sensors with the given labels, one pread() each on
+    // files kept open. Values which cannot be read are set to NAN.
+    // Returns the number of values read.
+    size_t read_all(const char * const labels[], float values[], size_t count);
 };
 
 // Collection of sensors in a Fan chip (Works for 4.18 and above kernels).
@@ -19,10 +19,70 @@
 //#include <iostream>
 #include <syslog.h>
 #include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fstream>
+#include <vector>
 #include "sensorlist.hpp"
 
 using namespace std;
 
+// Same files as sensors_init() reads without a config.
+#define DEFAULT_CONFIG_FILE "/etc/sensors3.conf"
+#define ALT_CONFIG_FILE "/etc/sensors.conf"
+#define DEFAULT_CONFIG_DIR "/etc/sensors.d"
+
+// Collects the compute statements of a config file as pairs of chip
+// pattern and feature. Only chip and compute statements matter here.
+static bool parse_computes(const string &file, vector<pair<string, string>> &out)
+{
+  ifstream ifs(file);
+  if (!ifs.is_open()) {
+    return false;
+  }
+  vector<string> chips = {"*"};
+  string stmt;
+  for (string line; getline(ifs, line);) {
+    if (!line.empty() && line.back() == '\\') {
+      line.pop_back();
+      stmt += line + " ";
+      continue;
+    }
+    stmt += line;
+
+    vector<string> tokens;
+    string tok;
+    bool quoted = false;
+    for (char c : stmt) {
+      if (c == '"') {
+        quoted = !quoted;
+      } else if (c == '#' && !quoted) {
+        break;
+      } else if (isspace(c) && !quoted) {
+        if (!tok.empty()) {
+          tokens.push_back(tok);
+          tok.clear();
+        }
+      } else {
+        tok += c;
+      }
+    }
+    if (!tok.empty()) {
+      tokens.push_back(tok);
+    }
+    stmt.clear();
+
+    if (tokens.size() >= 2 && tokens[0] == "chip") {
+      chips.assign(tokens.begin() + 1, tokens.end());
+    } else if (tokens.size() >= 2 && tokens[0] == "compute") {
+      for (auto &chip : chips) {
+        out.emplace_back(chip, tokens[1]);
+      }
+    }
+  }
+  return true;
+}
+
 SensorList::SensorList(const char *conf_file)
 {
   _sensor_list_build(conf_file);
@@ -62,6 +122,12 @@ void SensorList::enumerate()
       continue;
     }
     (*this)[name] = make_chip(chip, name);
+    auto it = computed.find(name);
+    if (it != computed.end()) {
+      for (auto &feature : it->second) {
+        (*this)[name]->add_computed(feature);
+      }
+    }
     (*this)[name]->enumerate();
   }
 }
@@ -70,10 +136,46 @@ void SensorList::re_enumerate(const char *conf_file)
 {
   sensors_cleanup();
   this->clear();
+  computed.clear();
 
   _sensor_list_build(conf_file);
 }
 
+void SensorList::_load_computed(const char* conf_file)
+{
+  vector<pair<string, string>> computes;
+
+  if (conf_file == nullptr || !parse_computes(conf_file, computes)) {
+    if (!parse_computes(DEFAULT_CONFIG_FILE, computes)) {
+      parse_computes(ALT_CONFIG_FILE, computes);
+    }
+    DIR *dir = opendir(DEFAULT_CONFIG_DIR);
+    if (dir) {
+      struct dirent *ent;
+      while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] != '.') {
+          parse_computes(string(DEFAULT_CONFIG_DIR "/") + ent->d_name, computes);
+        }
+      }
+      closedir(dir);
+    }
+  }
+
+  for (auto &compute : computes) {
+    sensors_chip_name match;
+    if (sensors_parse_chip_name(compute.first.c_str(), &match)) {
+      continue;
+    }
+    const sensors_chip_name *chip;
+    for (int nr = 0; (chip = sensors_get_detected_chips(&match, &nr)) != NULL;) {
+      char cname[128];
+      sensors_snprintf_chip_name(cname, sizeof(cname), chip);
+      computed[cname].insert(compute.second);
+    }
+    sensors_free_chip_name(&match);
+  }
+}
+
 void SensorList::_sensor_list_build(const char* conf_file)
 {
   FILE *f = NULL;
@@ -85,6 +187,7 @@ void SensorList::_sensor_list_build(const char* conf_file)
   if (f != NULL) {
     fclose(f);
   }
+  _load_computed(f != NULL ? conf_file : nullptr);
   try {
     enumerate();
   } catch (std::out_of_range &e) {
@@ -20,9 +20,12 @@
 #include "sensorchip.hpp"
 
 // Collection of sensor-chips. Provides efficient look-up of sensor chips.
-class SensorList : public std::map<std::string, std::unique_ptr<SensorChip>> {
+class SensorList : public std::map<std::string, std::unique_ptr<SensorChip>, std::less<>> {
   private:
+    // Features of each chip with a compute statement in the config.
+    std::map<std::string, std::set<std::string>> computed;
     void _sensor_list_build(const char* conf_file = nullptr);
+    void _load_computed(const char* conf_file);
   protected:
     // Allocates a chip object
     virtual std::unique_ptr<SensorChip> make_chip(const sensors_chip_name *chip, const std::string &name);
@@ -29,6 +29,8 @@
 #include <syslog.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include "sdr.h"
 
 #define FIELD_RATE_UNIT(x)  ((x & (0x07 << 3)) >> 3)
@@ -46,6 +48,23 @@
 #endif
 
 #define MAX_NAME_LEN        16
+#define MAX_SDR_FRU         256
+
+/*
+ * Process-wide copy of the SDR of each FRU, so looking up a sensor does
+ * not run pal_sensor_sdr_init() for the whole FRU again. Only the SDR of
+ * FRUs with a file (pal_sensor_sdr_path()) is kept, and the copy is
+ * dropped when the file changes. Nothing is kept while
+ * pal_get_sdr_update_flag() is set.
+ */
+typedef struct {
+  sensor_info_t *sinfo;
+  struct timespec mtime;
+  off_t size;
+} sdr_cache_t;
+
+static sdr_cache_t sdr_cache[MAX_SDR_FRU];
+static pthread_mutex_t sdr_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* Array for BCD Plus definition. */
 const char bcd_plus_array[] = "0123456789 -.XXX";
@@ -169,6 +188,84 @@ const char * sensor_base_units[] = {
   "",						    /* 093 */
 };
 
+/* Stat the SDR file of the FRU, if the platform has one */
+static bool
+sdr_stamp(uint8_t fru, struct stat *st) {
+  char path[128] = {0};
+
+  if (pal_sensor_sdr_path(fru, path) < 0 || stat(path, st) != 0) {
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Copy count entries of the SDR of the FRU from snr_num on. The SDR is
+ * loaded when not cached or stale, retried while not ready if retry is
+ * set. Returns the pal_sensor_sdr_init() error if it cannot be loaded.
+ */
+static int
+sdr_cache_get(uint8_t fru, uint8_t snr_num, int count, sensor_info_t *sinfo,
+    bool retry) {
+
+  int ret;
+  int cnt = 0;
+  struct stat st;
+  bool stamped;
+  sdr_cache_t *cache = &sdr_cache[fru];
+  sensor_info_t *table;
+
+  stamped = sdr_stamp(fru, &st);
+
+  pthread_mutex_lock(&sdr_cache_mutex);
+  if (stamped && cache->sinfo != NULL && cache->size == st.st_size &&
+      cache->mtime.tv_sec == st.st_mtim.tv_sec &&
+      cache->mtime.tv_nsec == st.st_mtim.tv_nsec &&
+      !pal_get_sdr_update_flag(fru)) {
+    memcpy(sinfo, &cache->sinfo[snr_num], sizeof(sensor_info_t) * count);
+    pthread_mutex_unlock(&sdr_cache_mutex);
+    return 0;
+  }
+  pthread_mutex_unlock(&sdr_cache_mutex);
+
+  // Loading may take a while, do not hold up the other FRUs.
+  table = calloc(MAX_SENSOR_NUM + 1, sizeof(sensor_info_t));
+  if (table == NULL) {
+    return -1;
+  }
+  ret = pal_sensor_sdr_init(fru, table);
+  while (retry && ret == ERR_NOT_READY) {
+    if (cnt++ > MAX_RETRIES_SDR_INIT) {
+      break;
+    }
+#ifdef DEBUG
+    syslog(LOG_INFO, "sdr_cache_get: fru: %d, ret: %d cnt: %d", fru, ret, cnt);
+#endif /* DEBUG */
+    msleep(50);
+    ret = pal_sensor_sdr_init(fru, table);
+  }
+  if (ret < 0) {
+    free(table);
+    return ret;
+  }
+  memcpy(sinfo, &table[snr_num], sizeof(sensor_info_t) * count);
+
+  if (!stamped || pal_get_sdr_update_flag(fru)) {
+    // Without a file there is no telling when it changes. Being
+    // updated, the next lookup loads it again.
+    free(table);
+    return 0;
+  }
+  pthread_mutex_lock(&sdr_cache_mutex);
+  free(cache->sinfo);
+  cache->sinfo = table;
+  cache->size = st.st_size;
+  cache->mtime = st.st_mtim;
+  pthread_mutex_unlock(&sdr_cache_mutex);
+
+  return 0;
+}
+
 /* Get the units of the sensor from the SDR */
 static int
 _sdr_get_sensor_units(sdr_full_t *sdr, uint8_t *op, uint8_t *modifier,
@@ -218,13 +315,12 @@ sdr_get_sensor_units(uint8_t fru, uint8_t snr_num, char *units) {
   uint8_t op;
   uint8_t modifier;
   sdr_full_t *sdr;
+  sensor_info_t sinfo;
 
-  sensor_info_t sinfo[MAX_SENSOR_NUM + 1] = {0};
-
-  if (pal_sensor_sdr_init(fru, sinfo) < 0) {
+  if (sdr_cache_get(fru, snr_num, 1, &sinfo, false) < 0) {
     sdr = NULL;
   } else {
-    sdr = &sinfo[snr_num].sdr;
+    sdr = &sinfo.sdr;
   }
 
   if (sdr != NULL) {
@@ -337,13 +433,12 @@ sdr_get_sensor_name(uint8_t fru, uint8_t snr_num, char *name) {
 
   int ret = 0;
   sdr_full_t *sdr;
+  sensor_info_t sinfo;
 
-  sensor_info_t sinfo[MAX_SENSOR_NUM + 1] = {0};
-
-  if (pal_sensor_sdr_init(fru, sinfo) < 0) {
+  if (sdr_cache_get(fru, snr_num, 1, &sinfo, false) < 0) {
     sdr = NULL;
   } else {
-    sdr = &sinfo[snr_num].sdr;
+    sdr = &sinfo.sdr;
   }
 
   if (sdr != NULL) {
@@ -555,67 +650,51 @@ _sdr_get_snr_thresh(uint8_t fru, sdr_full_t *sdr, uint8_t snr_num,
   return 0;
 }
 
-int
-sdr_get_snr_thresh(uint8_t fru, uint8_t snr_num, thresh_sensor_t *snr) {
-
-  int ret = 0;
-  sdr_full_t *sdr;
-#ifdef DEBUG
-  int cnt = 0;
-#endif /* DEBUG */
-  int retry = 0;
+/*
+ * Whether the thresholds of the FRU come from the threshold-util file.
+ * Returns -1 if the FRU name cannot be read.
+ */
+static int
+sdr_thresh_from_file(uint8_t fru) {
   char fpath[64] = {0};
   char initpath[64] = {0};
-  char initflag[64] = {0};
   char fru_name[16];
 
-  sensor_info_t sinfo[MAX_SENSOR_NUM + 1] = {0};
-
-  ret = pal_sensor_sdr_init(fru, sinfo);
-
-  while (ret == ERR_NOT_READY) {
-
-    if (retry++ > MAX_RETRIES_SDR_INIT) {
-      syslog(LOG_INFO, "sdr_get_snr_thresh: failed for fru: %d", fru);
+  if (pal_get_fru_name(fru, fru_name) < 0) {
+    printf("%s: Fail to get fru%d name\n", __func__, fru);
+    return -1;
+  }
 
-      return ERR_NOT_READY;
+  sprintf(initpath, INIT_THRESHOLD_BIN, fru_name);
+  if (0 == access(initpath, F_OK)) { // init done
+    sprintf(fpath, THRESHOLD_BIN, fru_name);
+    if (0 == access(fpath, F_OK)) {
+      return 1;
     }
-#ifdef DEBUG
-    syslog(LOG_INFO, "sdr_get_snr_thresh: fru: %d, ret: %d cnt: %d", fru, ret, cnt++);
-#endif /* DEBUG */
-    msleep(50);
-    ret = pal_sensor_sdr_init(fru, sinfo);
   }
+  return 0;
+}
 
-  if (ret < 0) {
-    sdr = NULL;
-  } else {
-    sdr = &sinfo[snr_num].sdr;
-  }
+/* Fill snr from the SDR, or the PAL if sdr is NULL */
+static int
+sdr_fill_snr_thresh(uint8_t fru, uint8_t snr_num, sdr_full_t *sdr,
+    bool from_file, thresh_sensor_t *snr) {
+
+  int ret = 0;
 
   /* Set all the threshold options set in the flag */
   snr->flag = GETMASK(SENSOR_VALID) | GETMASK(UCR_THRESH) |
     GETMASK(UNC_THRESH) | GETMASK(UNR_THRESH) | GETMASK(LCR_THRESH) |
     GETMASK(LNC_THRESH) | GETMASK(LNR_THRESH);
 
-  ret = pal_get_fru_name(fru, fru_name);
-  if (ret < 0) {
-    printf("%s: Fail to get fru%d name\n", __func__, fru);
-    return -1;
-  }
-  
-  sprintf(initpath, INIT_THRESHOLD_BIN, fru_name);
-  if (0 == access(initpath, F_OK)) { // init done
-    sprintf(fpath, THRESHOLD_BIN, fru_name);
-    if (0 == access(fpath, F_OK)) {
-      ret = pal_get_thresh_from_file(fru, snr_num, snr);
-      if (0 != ret) {
-        syslog(LOG_WARNING, "%s: Fail to get threshold from file for slot%d", __func__, fru);
-        return -1;
-      }
+  if (from_file) {
+    ret = pal_get_thresh_from_file(fru, snr_num, snr);
+    if (0 != ret) {
+      syslog(LOG_WARNING, "%s: Fail to get threshold from file for slot%d", __func__, fru);
+      return -1;
+    }
 
-      return ret;
-    } 
+    return ret;
   }
 
   if (sdr != NULL) {
@@ -627,7 +706,6 @@ sdr_get_snr_thresh(uint8_t fru, uint8_t snr_num, thresh_sensor_t *snr) {
 #endif
     }
   } else {
-
     ret = pal_get_sensor_name(fru, snr_num, snr->name);
     ret = pal_get_sensor_units(fru, snr_num, snr->units);
     ret = pal_get_sensor_poll_interval(fru, snr_num, &(snr->poll_interval));
@@ -664,3 +742,72 @@ sdr_get_snr_thresh(uint8_t fru, uint8_t snr_num, thresh_sensor_t *snr) {
 
   return ret;
 }
+
+int
+sdr_get_snr_thresh(uint8_t fru, uint8_t snr_num, thresh_sensor_t *snr) {
+
+  int ret = 0;
+  int from_file;
+  sensor_info_t sinfo;
+
+  ret = sdr_cache_get(fru, snr_num, 1, &sinfo, true);
+  if (ret == ERR_NOT_READY) {
+    syslog(LOG_INFO, "sdr_get_snr_thresh: failed for fru: %d", fru);
+    return ERR_NOT_READY;
+  }
+
+  from_file = sdr_thresh_from_file(fru);
+  if (from_file < 0) {
+    return -1;
+  }
+
+  return sdr_fill_snr_thresh(fru, snr_num, ret < 0 ? NULL : &sinfo.sdr,
+      from_file, snr);
+}
+
+int
+sdr_get_fru_thresholds(uint8_t fru, thresh_sensor_t *snr) {
+
+  int i;
+  int ret;
+  int from_file;
+  int sensor_cnt;
+  int filled = 0;
+  uint8_t snr_num;
+  uint8_t *sensor_list;
+  sensor_info_t *sinfo;
+
+  ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
+  if (ret < 0) {
+    return ret;
+  }
+
+  from_file = sdr_thresh_from_file(fru);
+  if (from_file < 0) {
+    return -1;
+  }
+
+  sinfo = calloc(MAX_SENSOR_NUM + 1, sizeof(sensor_info_t));
+  if (sinfo == NULL) {
+    return -1;
+  }
+  ret = sdr_cache_get(fru, 0, MAX_SENSOR_NUM + 1, sinfo, true);
+  if (ret == ERR_NOT_READY) {
+    syslog(LOG_INFO, "sdr_get_fru_thresholds: failed for fru: %d", fru);
+    free(sinfo);
+    return ERR_NOT_READY;
+  }
+
+  for (i = 0; i < sensor_cnt; i++) {
+    snr_num = sensor_list[i];
+    if (sdr_fill_snr_thresh(fru, snr_num, ret < 0 ? NULL : &sinfo[snr_num].sdr,
+          from_file, &snr[snr_num]) < 0) {
+      snr[snr_num].flag = CLEARBIT(snr[snr_num].flag, SENSOR_VALID);
+      continue;
+    }
+    filled++;
+  }
+
+  free(sinfo);
+  return filled;
+}
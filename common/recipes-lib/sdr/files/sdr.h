@@ -39,6 +39,13 @@ extern "C" {
 int sdr_get_sensor_name(uint8_t fru, uint8_t snr_num, char *name);
 int sdr_get_sensor_units(uint8_t fru, uint8_t snr_num, char *units);
 int sdr_get_snr_thresh(uint8_t fru, uint8_t snr_num, thresh_sensor_t *snr);
+/*
+ * Fill snr[snr_num] for every sensor of pal_get_fru_sensor_list(), with
+ * the SDR of the FRU loaded once. snr has MAX_SENSOR_NUM + 1 entries.
+ * SENSOR_VALID is cleared in the flag of the sensors which failed.
+ * Returns the number of sensors filled, or a negative error.
+ */
+int sdr_get_fru_thresholds(uint8_t fru, thresh_sensor_t *snr);
 
 #define FORMAT_CONV(X) ((int)(X*100 + 0.5)*0.01)  //take the second decimal place
 
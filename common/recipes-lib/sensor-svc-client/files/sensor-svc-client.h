@@ -32,6 +32,10 @@ extern "C" {
 #define SENSOR_SVC_SENSOR_TREE_INTERFACE "org.openbmc.SensorTree"
 #define SENSOR_SVC_SENSOR_OBJECT_INTERFACE "org.openbmc.SensorObject"
 
+// getFruSensorValues flags
+// Raw read the sensors instead of returning the values last read
+#define FRU_SENSOR_VALUES_RAW_READ (1 << 0)
+
 extern int sensor_svc_raw_read(uint8_t fru, uint8_t sensor_num, float *value);
 extern int sensor_svc_read(uint8_t fru, uint8_t sensor_num, float *value);
 
@@ -229,6 +229,7 @@ void DBus::unregisterObjectInterface(DBusObject              &object,
        << interface.getName() << " at path " << object.getPath();
     throw std::runtime_error("Object unregistration failed");
   }
+  interface.cancelCalls();
 
   std::string path = object.getPath();
   if (id > 0) {
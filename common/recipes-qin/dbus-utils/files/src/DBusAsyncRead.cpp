@@ -0,0 +1,176 @@
+/*
+ * Copyright 2014-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <exception>
+#include <string>
+#include <glog/logging.h>
+#include <gio/gio.h>
+#include "DBusAsyncRead.h"
+
+namespace openbmc {
+namespace qin {
+
+DBusAsyncRead::~DBusAsyncRead() {
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    stop_ = true;
+  }
+  cvQueue_.notify_all();
+  for (auto &t : workers_) {
+    t.join();
+  }
+}
+
+void DBusAsyncRead::read(const void* key, Reply reply, Fetch fetch) {
+  std::lock_guard<std::mutex> lock(m_);
+  auto it = inflight_.find(key);
+  if (it != inflight_.end()) {
+    LOG(INFO) << "Joining the read in flight of " << key;
+    it->second->replies.push_back(reply);
+    return;
+  }
+
+  std::shared_ptr<Job> job(new Job);
+  job->key = key;
+  job->fetch = fetch;
+  job->replies.push_back(reply);
+  job->context = g_main_context_ref_thread_default();
+  job->generation = generation_;
+  job->owner = this;
+  inflight_[key] = job;
+  queue_.push_back(job);
+
+  while (workers_.size() < nWorkers_) {
+    workers_.push_back(std::thread(&DBusAsyncRead::work, this));
+  }
+  cvQueue_.notify_one();
+}
+
+void DBusAsyncRead::read(const void*            key,
+                         GDBusMethodInvocation* invocation,
+                         Fetch                  fetch) {
+  read(key,
+       [invocation](GVariant* value, const std::string &error) {
+         if (value == nullptr) {
+           g_dbus_method_invocation_return_error(invocation,
+                                                 G_IO_ERROR,
+                                                 G_IO_ERROR_FAILED,
+                                                 "%s",
+                                                 error.c_str());
+         } else {
+           g_dbus_method_invocation_return_value(invocation, value);
+         }
+       },
+       fetch);
+}
+
+void DBusAsyncRead::cancel() {
+  std::vector<Reply> replies;
+  {
+    std::unique_lock<std::mutex> lock(m_);
+    generation_++;
+    for (auto &it : inflight_) {
+      for (auto &reply : it.second->replies) {
+        replies.push_back(reply);
+      }
+      it.second->replies.clear();
+    }
+    inflight_.clear();
+    queue_.clear();
+    while (running_ > 0) {
+      cvIdle_.wait(lock);
+    }
+  }
+
+  LOG(INFO) << "Cancelled " << replies.size() << " reads";
+  for (auto &reply : replies) {
+    reply(nullptr, "Read cancelled");
+  }
+}
+
+void DBusAsyncRead::work() {
+  std::unique_lock<std::mutex> lock(m_);
+  while (true) {
+    while (!stop_ && queue_.empty()) {
+      cvQueue_.wait(lock);
+    }
+    if (stop_) {
+      return;
+    }
+    std::shared_ptr<Job> job = queue_.front();
+    queue_.pop_front();
+    running_++;
+    lock.unlock();
+
+    try {
+      job->complete = job->fetch();
+    } catch (const std::exception &e) {
+      job->error = e.what();
+    }
+
+    // Not g_main_context_invoke(), which may call onFetched right here
+    // if the main context is not running.
+    GSource* source = g_idle_source_new();
+    g_source_set_callback(source,
+                          onFetched,
+                          new std::shared_ptr<Job>(job),
+                          [](gpointer arg) {
+                            delete static_cast<std::shared_ptr<Job>*>(arg);
+                          });
+    g_source_attach(source, job->context);
+    g_source_unref(source);
+
+    lock.lock();
+    running_--;
+    cvIdle_.notify_all();
+  }
+}
+
+gboolean DBusAsyncRead::onFetched(gpointer arg) {
+  std::shared_ptr<Job> job = *static_cast<std::shared_ptr<Job>*>(arg);
+  DBusAsyncRead* self = job->owner;
+  std::vector<Reply> replies;
+  {
+    std::lock_guard<std::mutex> lock(self->m_);
+    if (job->generation != self->generation_) {
+      // cancel() answered the calls, and what complete uses may be gone
+      return G_SOURCE_REMOVE;
+    }
+    self->inflight_.erase(job->key);
+    replies.swap(job->replies);
+  }
+
+  GVariant* value = nullptr;
+  if (job->complete) {
+    try {
+      value = g_variant_ref_sink(job->complete());
+    } catch (const std::exception &e) {
+      job->error = e.what();
+    }
+  }
+  for (auto &reply : replies) {
+    reply(value, job->error);
+  }
+  if (value != nullptr) {
+    g_variant_unref(value);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+} // namespace qin
+} // namespace openbmc
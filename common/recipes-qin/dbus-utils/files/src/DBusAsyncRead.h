@@ -0,0 +1,136 @@
+/*
+ * Copyright 2014-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <gio/gio.h>
+
+namespace openbmc {
+namespace qin {
+
+/**
+ * Runs the device reads of DBus method calls on a pool of worker threads,
+ * so that a slow device does not hold up the event loop and every other
+ * client with it.
+ *
+ * A read is done in two steps. The fetch runs on a worker and only talks
+ * to the device. The completion it returns runs on the main context of
+ * the caller, where it can update the objects, and builds the reply.
+ * Calls reading a key while a read of the same key is queued or running
+ * share it and get the same reply.
+ */
+class DBusAsyncRead {
+  public:
+    // Runs on the main context. Returns the reply, which may be floating.
+    typedef std::function<GVariant*()> Complete;
+    // Runs on a worker. Throws std::exception if the read failed.
+    typedef std::function<Complete()> Fetch;
+    // Sends the reply, or the error if value is nullptr.
+    typedef std::function<void(GVariant*          value,
+                               const std::string &error)> Reply;
+
+    /**
+     * Constructor. The workers are started by the first read.
+     *
+     * @param workers number of reads running at once
+     */
+    explicit DBusAsyncRead(unsigned int workers = 4)
+        : nWorkers_(workers) {}
+
+    /**
+     * Stops the workers once their current fetch is done. Calls still
+     * waiting are not answered, so it should outlive the event loop.
+     */
+    ~DBusAsyncRead();
+
+    /**
+     * Reads key, or waits for the read of key in flight. Call it on the
+     * main context which runs the completion and reply.
+     *
+     * @param key of what is read, e.g. the attribute
+     * @param reply sends the reply once the read is done
+     * @param fetch reads the device if no read of key is in flight
+     */
+    void read(const void* key, Reply reply, Fetch fetch);
+
+    /**
+     * Same as above, replying to the DBus method invocation. A failed
+     * read is sent as G_IO_ERROR_FAILED.
+     */
+    void read(const void* key, GDBusMethodInvocation* invocation, Fetch fetch);
+
+    /**
+     * Fails the calls waiting for a read and waits for the fetches
+     * running, so that the objects they use can be deleted. Call it
+     * on the main context.
+     */
+    void cancel();
+
+    DBusAsyncRead(const DBusAsyncRead&) = delete;
+    DBusAsyncRead& operator=(const DBusAsyncRead&) = delete;
+
+  private:
+    struct Job {
+      const void*        key;
+      Fetch              fetch;
+      Complete           complete;
+      std::string        error;
+      std::vector<Reply> replies;
+      GMainContext*      context{nullptr};
+      unsigned int       generation{0};
+      DBusAsyncRead*     owner{nullptr};
+
+      ~Job() {
+        if (context != nullptr) {
+          g_main_context_unref(context);
+        }
+      }
+    };
+
+    std::mutex                                m_;
+    std::condition_variable                   cvQueue_;
+    std::condition_variable                   cvIdle_;
+    std::deque<std::shared_ptr<Job>>          queue_;
+    // reads queued or running by key
+    std::unordered_map<const void*,
+                       std::shared_ptr<Job>>  inflight_;
+    std::vector<std::thread>                  workers_;
+    unsigned int                              nWorkers_;
+    unsigned int                              running_{0};
+    // bumped by cancel(); jobs of an older generation are dropped
+    unsigned int                              generation_{0};
+    bool                                      stop_{false};
+
+    void work();
+
+    /**
+     * Runs on the main context of the job once its fetch is done.
+     */
+    static gboolean onFetched(gpointer arg);
+};
+
+} // namespace qin
+} // namespace openbmc
@@ -57,6 +57,13 @@ class DBusInterfaceBase {
     GDBusInterfaceVTable* getVtable() {
       return &vtable_;
     }
+
+    /**
+     * Called on the main context when an object is unregistered with the
+     * interface, before it is deleted. Calls still running on the
+     * object off the event loop must be stopped here.
+     */
+    virtual void cancelCalls() {}
 };
 
 } // namespace qin
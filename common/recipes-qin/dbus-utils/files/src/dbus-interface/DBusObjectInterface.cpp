@@ -71,6 +71,8 @@ const char* DBusObjectInterface::xml =
   "  </interface>"
   "</node>";
 
+DBusAsyncRead DBusObjectInterface::asyncRead_;
+
 DBusObjectInterface::DBusObjectInterface() {
   info_ = g_dbus_node_info_new_for_xml(xml, nullptr);
   if (info_ == nullptr) {
@@ -86,6 +88,10 @@ DBusObjectInterface::~DBusObjectInterface() {
   g_dbus_node_info_unref(info_);
 }
 
+void DBusObjectInterface::cancelCalls() {
+  asyncRead_.cancel();
+}
+
 void DBusObjectInterface::ping(GDBusMethodInvocation* invocation) {
   std::time_t t = std::time(nullptr);
   char* tchars = std::asctime(std::localtime(&t));
@@ -157,18 +163,39 @@ void DBusObjectInterface::readAttrValue(GDBusMethodInvocation* invocation,
     return;
   }
 
-  std::string value;
-  try {
-    value = obj->readAttrValue(name);
-  } catch (const std::system_error &e) {
-    g_dbus_method_invocation_return_error(invocation,
-                                          G_IO_ERROR,
-                                          G_IO_ERROR_FAILED,
-                                          e.what());
+  if (!obj->isAttrFetchable(name)) {
+    std::string value;
+    try {
+      value = obj->readAttrValue(name);
+    } catch (const std::system_error &e) {
+      g_dbus_method_invocation_return_error(invocation,
+                                            G_IO_ERROR,
+                                            G_IO_ERROR_FAILED,
+                                            e.what());
+      return;
+    }
+
+    g_dbus_method_invocation_return_value(invocation,
+                                          g_variant_new("(s)", value.c_str()));
+    return;
   }
 
-  g_dbus_method_invocation_return_value(invocation,
-                                        g_variant_new("(s)", value.c_str()));
+  // Fetch the value on a worker and store it back on the event loop.
+  // Concurrent reads of the attribute share the fetch. The object is
+  // kept until the read is done or cancelled by cancelCalls(), but the
+  // attribute may be deleted in the meantime, so it is looked up again.
+  std::string attrName = name;
+  asyncRead_.read(attr, invocation,
+                  [obj, attrName]() -> DBusAsyncRead::Complete {
+    std::string value = obj->fetchAttrValue(attrName);
+    return [obj, attrName, value]() -> GVariant* {
+      Attribute* attr = obj->getAttribute(attrName);
+      if (attr != nullptr) {
+        attr->setValue(value);
+      }
+      return g_variant_new("(s)", value.c_str());
+    };
+  });
 }
 
 void DBusObjectInterface::setAttrValue(GDBusMethodInvocation* invocation,
@@ -20,6 +20,7 @@
 #include <string>
 #include <glog/logging.h>
 #include <gio/gio.h>
+#include "../DBusAsyncRead.h"
 #include "../DBusInterfaceBase.h"
 
 namespace openbmc {
@@ -39,6 +40,13 @@ class DBusObjectInterface: public DBusInterfaceBase {
 
     ~DBusObjectInterface();
 
+    /**
+     * Cancels the reads of asyncRead_, failing the calls waiting for them,
+     * so that the object unregistered can be deleted. The reads of the
+     * other objects are failed as well.
+     */
+    void cancelCalls() override;
+
     /**
      * All the subfunctions in the callback handler should comply
      * with what is specified in the xml.
@@ -92,6 +100,8 @@ class DBusObjectInterface: public DBusInterfaceBase {
      * Read the Attribute value through the file system or other APIs if
      * available. Send GIO_ERROR_NOT_FOUND to DBus if the specified attribute
      * does not exist. Send GIO_ERROR_FAILED if the reading failed.
+     * Attributes fetched from a device are read by asyncRead_, and the
+     * reply is sent once the read is done.
      *
      * @param invocation stands for the identity of the message
      * @param gvparam should be a GVariant containing a string of
@@ -175,6 +185,8 @@ class DBusObjectInterface: public DBusInterfaceBase {
                                gpointer               arg);
 
   private:
+    // runs the reads of fetchable attributes off the event loop
+    static DBusAsyncRead asyncRead_;
 
     /**
      * Helper function for sending an error to the DBus when the
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2014-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+#include <gio/gio.h>
+#include "../DBusAsyncRead.h"
+using namespace openbmc::qin;
+
+/**
+ * Runs the reads on a main context of the test thread and records the
+ * replies. The fetches wait until released.
+ */
+class DBusAsyncReadTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+      context_ = g_main_context_new();
+      g_main_context_push_thread_default(context_);
+    }
+
+    virtual void TearDown() {
+      release();
+      g_main_context_pop_thread_default(context_);
+      g_main_context_unref(context_);
+    }
+
+    DBusAsyncRead::Reply reply() {
+      return [this](GVariant* value, const std::string &error) {
+        if (value == nullptr) {
+          errors_.push_back(error);
+        } else {
+          values_.push_back(g_variant_get_int32(value));
+        }
+      };
+    }
+
+    DBusAsyncRead::Fetch fetch(int value) {
+      return [this, value]() -> DBusAsyncRead::Complete {
+        std::unique_lock<std::mutex> lock(m_);
+        fetches_++;
+        cv_.notify_all();
+        while (!released_) {
+          cv_.wait(lock);
+        }
+        if (value < 0) {
+          throw std::system_error(EIO, std::system_category(), "EIO");
+        }
+        return [this, value]() -> GVariant* {
+          completes_++;
+          return g_variant_new_int32(value);
+        };
+      };
+    }
+
+    void waitForFetches(int n) {
+      std::unique_lock<std::mutex> lock(m_);
+      while (fetches_ < n) {
+        cv_.wait(lock);
+      }
+    }
+
+    void release() {
+      std::lock_guard<std::mutex> lock(m_);
+      released_ = true;
+      cv_.notify_all();
+    }
+
+    // Runs the main context until n replies are in.
+    void waitForReplies(size_t n) {
+      while (values_.size() + errors_.size() < n) {
+        g_main_context_iteration(context_, TRUE);
+      }
+    }
+
+    GMainContext*            context_;
+    std::mutex               m_;
+    std::condition_variable  cv_;
+    int                      fetches_{0};
+    bool                     released_{false};
+    std::atomic<int>         completes_{0};
+    std::vector<int>         values_;
+    std::vector<std::string> errors_;
+};
+
+TEST_F(DBusAsyncReadTest, Coalesce) {
+  DBusAsyncRead reader(2);
+  int key;
+  reader.read(&key, reply(), fetch(1));
+  waitForFetches(1);
+  // joins the fetch running
+  reader.read(&key, reply(), fetch(2));
+  reader.read(&key, reply(), fetch(3));
+  release();
+  waitForReplies(3);
+  EXPECT_EQ(fetches_, 1);
+  EXPECT_EQ(completes_, 1);
+  EXPECT_EQ(values_, std::vector<int>({1, 1, 1}));
+
+  // a new read once the reply is sent
+  reader.read(&key, reply(), fetch(4));
+  waitForReplies(4);
+  EXPECT_EQ(fetches_, 2);
+  EXPECT_EQ(values_.back(), 4);
+}
+
+TEST_F(DBusAsyncReadTest, Parallel) {
+  DBusAsyncRead reader(2);
+  int key1, key2;
+  reader.read(&key1, reply(), fetch(1));
+  reader.read(&key2, reply(), fetch(2));
+  // both run while the main context is free
+  waitForFetches(2);
+  release();
+  waitForReplies(2);
+  EXPECT_EQ(values_.size(), 2);
+  EXPECT_EQ(values_[0] + values_[1], 3);
+}
+
+TEST_F(DBusAsyncReadTest, Error) {
+  DBusAsyncRead reader(1);
+  int key;
+  release();
+  reader.read(&key, reply(), fetch(-1));
+  waitForReplies(1);
+  ASSERT_EQ(errors_.size(), 1);
+  EXPECT_NE(errors_[0].find("EIO"), std::string::npos);
+  EXPECT_EQ(completes_, 0);
+}
+
+TEST_F(DBusAsyncReadTest, Cancel) {
+  DBusAsyncRead reader(1);
+  int key1, key2;
+  reader.read(&key1, reply(), fetch(1));
+  waitForFetches(1);
+  reader.read(&key1, reply(), fetch(1));
+  reader.read(&key2, reply(), fetch(2)); // queued
+  std::thread t([this]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    release();
+  });
+  reader.cancel();
+  t.join();
+  EXPECT_EQ(errors_.size(), 3);
+  EXPECT_EQ(fetches_, 1);
+
+  // the cancelled completion is dropped
+  reader.read(&key2, reply(), fetch(5));
+  waitForReplies(4);
+  EXPECT_EQ(values_, std::vector<int>({5}));
+  EXPECT_EQ(completes_, 1);
+}
+
+int main (int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  ::google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
@@ -125,6 +125,33 @@ class Object {
      */
     virtual const std::string& readAttrValue(const std::string &name) const;
 
+    /**
+     * Whether reading the attribute of the given name goes to a device,
+     * e.g. through the file system, instead of the value kept in the
+     * attribute. Such a read may be split in fetchAttrValue(), off the
+     * thread owning the object, and Attribute::setValue() back on it.
+     *
+     * @param name of the attribute
+     * @return false by default
+     */
+    virtual bool isAttrFetchable(const std::string &name) const {
+      return false;
+    }
+
+    /**
+     * Fetch the value of the attribute of the given name from the device
+     * without storing it. It should only use what does not change once
+     * the attribute is set up, as it may run on another thread.
+     *
+     * @param name of the attribute to be fetched
+     * @return value fetched; the value kept in the attribute by default
+     * @throw std::invalid_argument if name not found
+     * @throw std::system_error if the attribute cannot be read
+     */
+    virtual std::string fetchAttrValue(const std::string &name) const {
+      return readAttrValue(name);
+    }
+
     /**
      * Write attribute value of the given name. It is a write function
      * instead of set just to match the modes in Attribute.
@@ -148,7 +175,9 @@ class Object {
     virtual Attribute* addAttribute(const std::string &name);
 
     /**
-     * Delete attribute from the object.
+     * Delete attribute from the object. A fetchAttrValue() of it may be
+     * running on another thread, so a fetchable attribute should only be
+     * deleted once the object is unregistered from the ipc.
      *
      * @param name of attribute
      * @throw std::invalid_argument if attribute not found
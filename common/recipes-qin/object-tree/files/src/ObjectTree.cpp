@@ -86,8 +86,9 @@ void ObjectTree::deleteObjectByPath(const std::string &path) {
     LOG(ERROR) << "Failed to delete the object at \"" << path << "\"";
     throw std::invalid_argument("Error deleting object");
   }
-  objectMap_.erase(it);
+  // Unregistered before it is deleted, which stops the calls running on it
   ipc_.get()->unregisterObject(path);
+  objectMap_.erase(it);
 }
 
 Object* ObjectTree::getParent(const std::string &parentPath,
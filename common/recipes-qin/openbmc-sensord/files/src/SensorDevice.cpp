@@ -46,10 +46,16 @@ const std::string& SensorDevice::readAttrValue(const Object    &object,
     << attr.getName() << "\" value of Object \"" << object.getName() << "\"";
   DCHECK(attr.isReadable()) << "SensorAttribute \"" << attr.getName()
     << "\" is not readable";
-  attr.setValue(sensorApi_.get()->readValue(object, attr));
+  attr.setValue(fetchAttrValue(object, attr));
   return attr.getValue();
 }
 
+const std::string SensorDevice::fetchAttrValue(
+                                   const Object          &object,
+                                   const SensorAttribute &attr) const {
+  return sensorApi_.get()->readValue(object, attr);
+}
+
 const std::string& SensorDevice::readAttrValue(
                                    const std::string &name) const {
   LOG(INFO) << "Reading the value of Attribute \"" << name << "\"";
@@ -58,6 +64,13 @@ const std::string& SensorDevice::readAttrValue(
   return readAttrValue(*this, *attr);
 }
 
+std::string SensorDevice::fetchAttrValue(const std::string &name) const {
+  LOG(INFO) << "Fetching the value of Attribute \"" << name << "\"";
+  SensorAttribute* attr =
+      static_cast<SensorAttribute*>(getReadableAttribute(name));
+  return fetchAttrValue(*this, *attr);
+}
+
 void SensorDevice::writeAttrValue(const Object      &object,
                                   SensorAttribute   &attr,
                                   const std::string &value) {
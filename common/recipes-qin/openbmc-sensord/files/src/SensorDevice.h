@@ -98,6 +98,40 @@ class SensorDevice : public Object {
      */
     const std::string& readAttrValue(const std::string &name) const override;
 
+    /**
+     * Fetch the value of specified SensorAttribute through sensorApi_
+     * without storing it. SensorApi only uses the paths set up with the
+     * device, so it can be called off the event loop.
+     *
+     * @param the object to be associated with the reading
+     * @param the attribute to be read
+     * @return value of the attribute
+     * @throw std::system_error if the attribute cannot be read
+     */
+    const std::string fetchAttrValue(const Object          &object,
+                                     const SensorAttribute &attr) const;
+
+    /**
+     * All the attributes are read through sensorApi_.
+     *
+     * @param name of the attribute
+     * @return true if the attribute exists
+     */
+    bool isAttrFetchable(const std::string &name) const override {
+      return getAttribute(name) != nullptr;
+    }
+
+    /**
+     * Fetch the value of Attribute name through sensorApi_ without
+     * storing it.
+     *
+     * @param name of the attribute to be fetched
+     * @return value of the attribute
+     * @throw std::invalid_argument if name not found
+     * @throw std::system_error EPERM if attr has no read modes
+     */
+    std::string fetchAttrValue(const std::string &name) const override;
+
     /**
      * Write the value of specified SensorAttribute through sensorApi_.
      * It is assumed that the attr can be accessed through sensorApi_.
@@ -47,6 +47,13 @@ const std::string& SensorObject::readAttrValue(const std::string &name)
   return static_cast<SensorDevice*>(parent_)->readAttrValue(*this, *attr);
 }
 
+std::string SensorObject::fetchAttrValue(const std::string &name) const {
+  LOG(INFO) << "Fetching the value of Attribute \"" << name << "\"";
+  SensorAttribute* attr =
+      static_cast<SensorAttribute*>(getReadableAttribute(name));
+  return static_cast<SensorDevice*>(parent_)->fetchAttrValue(*this, *attr);
+}
+
 void SensorObject::writeAttrValue(const std::string &name,
                                   const std::string &value) {
   LOG(INFO) << "Writing the value of Attribute \"" << name << "\"";
@@ -64,6 +64,28 @@ class SensorObject : public Object {
     virtual const std::string& readAttrValue(const std::string &name)
         const override;
 
+    /**
+     * All the attributes are read through sensorApi_.
+     *
+     * @param name of the attribute
+     * @return true if the attribute exists
+     */
+    virtual bool isAttrFetchable(const std::string &name) const override {
+      return getAttribute(name) != nullptr;
+    }
+
+    /**
+     * Fetch the value of Attribute name through sensorApi_ without
+     * storing it. Will call the fetchAttrValue function from SensorDevice.
+     *
+     * @param name of the attribute to be fetched
+     * @return value fetched
+     * @throw std::invalid_argument if name not found
+     * @throw std::system_error EPERM if attr has no read modes
+     */
+    virtual std::string fetchAttrValue(const std::string &name)
+        const override;
+
     /**
      * Write the value of Attribute name with type through sensorApi_.
      * Will call the writeAttrValue function from SensorDevice.
@@ -17,6 +17,8 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <string>
 #include <string.h>
 #include <system_error>
@@ -34,17 +36,23 @@ const std::string SensorSysfsApi::readValue(const Object          &object,
                                             const SensorAttribute &attr)
     const {
   std::string path = fsPath_ + std::string("/") + attr.getAddr();
-  std::fstream fs;
   LOG(INFO) << "Reading value from path " << path;
-  fs.open(path, std::fstream::in);
-  if (!fs.is_open()) {
+  // sysfs attributes are a line, read in one go without an fstream
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
     LOG(ERROR) << "Path " << path << " cannot be opened";
     throw std::system_error(errno, std::system_category(), strerror(errno));
   }
-  std::string str;
-  std::getline(fs, str);
-  fs.close();
-  return str;
+  char buf[256];
+  ssize_t len = read(fd, buf, sizeof(buf));
+  int err = errno;
+  close(fd);
+  if (len < 0) {
+    LOG(ERROR) << "Path " << path << " cannot be read";
+    throw std::system_error(err, std::system_category(), strerror(err));
+  }
+  std::string str(buf, len);
+  return str.substr(0, str.find('\n'));
 }
 
 void SensorSysfsApi::writeValue(const Object          &object,
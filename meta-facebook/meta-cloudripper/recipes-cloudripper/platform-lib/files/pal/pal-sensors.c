@@ -42,6 +42,7 @@
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/misc-utils.h>
 #include <openbmc/log.h>
+#include <openbmc/hwmon-cache.h>
 #include "pal-sensors.h"
 #include "pal.h"
 
@@ -491,47 +492,10 @@ int pal_sensor_discrete_check(uint8_t fru, uint8_t snr_num, char *snr_name,
   return 0;
 }
 
-static int get_current_dir(const char *device, char *dir_name) {
-  char cmd[LARGEST_DEVICE_NAME + 1];
-  FILE *fp;
-  int ret=-1;
-  int size;
-
-  // Get current working directory
-  snprintf(cmd, sizeof(cmd), "cd %s;pwd", device);
-
-  fp = popen(cmd, "r");
-  if (NULL == fp)
-     return -1;
-  if (fgets(dir_name, LARGEST_DEVICE_NAME, fp) == NULL) {
-    pclose(fp);
-    return -1;
-  }
-
-  ret = pclose(fp);
-  if (-1 == ret)
-     OBMC_ERROR(-1, "%s pclose() fail ", __func__);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  dir_name[size-1] = '\0';
-
-  return 0;
-}
-
 static int read_attr(const char *device, const char *attr, float *value) {
-  char full_name[LARGEST_DEVICE_NAME * 2];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
 
-  // Get current working directory
-  if (get_current_dir(device, dir_name)) {
-    return -1;
-  }
-
-  snprintf(full_name, sizeof(full_name), "%s/%s", dir_name, attr);
-
-  if (device_read(full_name, &tmp)) {
+  if (hwmon_read_int(device, attr, &tmp)) {
     return -1;
   }
 
@@ -542,18 +506,9 @@ static int read_attr(const char *device, const char *attr, float *value) {
 
 static int read_hsc_attr(const char *device, const char* attr,
                          float r_sense, float *value) {
-  char full_dir_name[LARGEST_DEVICE_NAME * 2];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
 
-  // Get current working directory
-  if (get_current_dir(device, dir_name))
-  {
-    return -1;
-  }
-  snprintf(full_dir_name, sizeof(full_dir_name), "%s/%s", dir_name, attr);
-
-  if (device_read(full_dir_name, &tmp)) {
+  if (hwmon_read_int(device, attr, &tmp)) {
     return -1;
   }
 
@@ -579,19 +534,11 @@ static int read_hsc_power(const char *device, float r_sense, float *value) {
 }
 
 static int read_fan_rpm_f(const char *device, uint8_t fan, float *value) {
-  char full_name[LARGEST_DEVICE_NAME * 2];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   char device_name[11];
   int tmp;
 
-  /* Get current working directory */
-  if (get_current_dir(device, dir_name)) {
-    return -1;
-  }
-
   snprintf(device_name, sizeof(device_name), "fan%d_input", fan);
-  snprintf(full_name, sizeof(full_name), "%s/%s", dir_name, device_name);
-  if (device_read(full_name, &tmp)) {
+  if (hwmon_read_int(device, device_name, &tmp)) {
     return -1;
   }
 
@@ -601,24 +548,13 @@ static int read_fan_rpm_f(const char *device, uint8_t fan, float *value) {
 }
 
 static int read_fan_rpm(const char *device, uint8_t fan, int *value) {
-  char full_name[LARGEST_DEVICE_NAME * 2];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   char device_name[11];
-  int tmp;
-
-  /* Get current working directory */
-  if (get_current_dir(device, dir_name)) {
-    return -1;
-  }
 
   snprintf(device_name, sizeof(device_name), "fan%d_input", fan);
-  snprintf(full_name, sizeof(full_name), "%s/%s", dir_name, device_name);
-  if (device_read(full_name, &tmp)) {
+  if (hwmon_read_int(device, device_name, value)) {
     return -1;
   }
 
-  *value = tmp;
-
   return 0;
 }
 
@@ -43,6 +43,7 @@
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/misc-utils.h>
 #include <openbmc/log.h>
+#include <openbmc/hwmon-cache.h>
 
 #define RUN_SHELL_CMD(_cmd)                              \
   do {                                                   \
@@ -96,7 +97,6 @@ typedef struct {
 } sensor_path_t;
 
 static sensor_desc_t m_snr_desc[MAX_NUM_FRUS][MAX_SENSOR_NUM + 1] = {0};
-static sensor_path_t snr_path[MAX_NUM_FRUS][MAX_SENSOR_NUM + 1] = {0};
 static uint8_t sdr_fru_update_flag[MAX_NUM_FRUS] = {0};
 static bool init_threshold_done[MAX_NUM_FRUS + 1] = {false};
 
@@ -1204,62 +1204,10 @@ pal_get_fru_sensor_list(uint8_t fru, uint8_t **sensor_list, int *cnt) {
   return 0;
 }
 
-static int
-get_current_dir(const char *device, char *dir_name) {
-  char cmd[LARGEST_DEVICE_NAME + 1];
-  FILE *fp;
-  int size;
-
-  // Get current working directory
-  snprintf(cmd, sizeof(cmd), "cd %s;pwd", device);
-
-  fp = popen(cmd, "r");
-  if (NULL == fp)
-     return -1;
-
-  if (fgets(dir_name, LARGEST_DEVICE_NAME, fp) == NULL) {
-    pclose(fp);
-    return -1;
-  }
-
-  if (pclose(fp) == -1)
-     OBMC_ERROR(errno, "pclose(%s) failed", cmd);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  if (size > 0 && isspace(dir_name[size - 1]))
-    dir_name[size - 1] = '\0';
-
-  return 0;
-}
-
 static int
 check_and_read_sensor_value(uint8_t fru, uint8_t snr_num, const char *device,
                             const char *attr, int *value) {
-  char dir_name[LARGEST_DEVICE_NAME + 1];
-
-  if (snr_path[fru][snr_num].name != NULL) {
-    if (!device_read(snr_path[fru][snr_num].name, value))
-      return 0;
-  }
-
-  if (strstr(device, "hwmon*") != NULL) {
-    /* Get current working directory */
-    if (get_current_dir(device, dir_name)) {
-      return -1;
-    }
-    snprintf(snr_path[fru][snr_num].name, sizeof(snr_path[fru][snr_num].name),
-             "%s/%s", dir_name, attr);
-  } else {
-    snprintf(snr_path[fru][snr_num].name, sizeof(snr_path[fru][snr_num].name),
-             "%s/%s", device, attr);
-  }
-
-  if (device_read(snr_path[fru][snr_num].name, value)) {
-    return -1;
-  }
-
-  return 0;
+  return hwmon_read_int(device, attr, value);
 }
 
 static int
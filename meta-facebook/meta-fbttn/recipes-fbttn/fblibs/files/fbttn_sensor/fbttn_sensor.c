@@ -30,6 +30,7 @@
 #include <syslog.h>
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/kv.h>
+#include <openbmc/hwmon-cache.h>
 #include "fbttn_sensor.h"
 //For Kernel 2.6 -> 4.1
 #define MEZZ_TEMP_DEVICE "/sys/devices/platform/ast-i2c.12/i2c-12/12-001f/hwmon/hwmon*"
@@ -660,28 +661,9 @@ read_device_float(const char *device, float *value) {
 
 static int
 read_temp_attr(const char *device, const char *attr, float *value) {
-  char full_name[LARGEST_DEVICE_NAME + 1];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
-  FILE *fp;
-  int size;
-
-  // Get current working directory
-  snprintf(
-      full_name, LARGEST_DEVICE_NAME, "cd %s;pwd", device);
-
-  fp = popen(full_name, "r");
-  fgets(dir_name, LARGEST_DEVICE_NAME, fp);
-  pclose(fp);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  dir_name[size-1] = '\0';
 
-  snprintf(
-      full_name, LARGEST_DEVICE_NAME, "%s/%s", dir_name, attr);
-
-  if (read_device(full_name, &tmp)) {
+  if (hwmon_read_int(device, attr, &tmp)) {
     return -1;
   }
 
@@ -803,26 +785,9 @@ read_adc_value(const int pin, const char *device, float *value) {
 
 static int
 read_hsc_value(const char* att, const char *device, int r_sense, float *value) {
-  char full_name[LARGEST_DEVICE_NAME];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
-  FILE *fp;
-  int size;
-
-  // Get current working directory
-  snprintf(
-      full_name, LARGEST_DEVICE_NAME, "cd %s;pwd", device);
 
-  fp = popen(full_name, "r");
-  fgets(dir_name, LARGEST_DEVICE_NAME, fp);
-  pclose(fp);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  dir_name[size-1] = '\0';
-
-  snprintf(full_name, LARGEST_DEVICE_NAME, "%s/%s", dir_name, att);
-  if(read_device(full_name, &tmp)) {
+  if (hwmon_read_int(device, att, &tmp)) {
     return -1;
   }
 
@@ -838,31 +803,12 @@ read_hsc_value(const char* att, const char *device, int r_sense, float *value) {
 
 static int
 read_nic_temp(const char *device, float *value) {
-  char full_name[LARGEST_DEVICE_NAME + 1];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
-  FILE *fp;
-  int size;
   int ret = 0, read_retry = 0;
   static unsigned int retry = 0;
 
-  // Get current working directory
-  snprintf(
-      full_name, LARGEST_DEVICE_NAME, "cd %s;pwd", device);
-
-  fp = popen(full_name, "r");
-  fgets(dir_name, LARGEST_DEVICE_NAME, fp);
-  pclose(fp);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  dir_name[size-1] = '\0';
-
-  snprintf(
-      full_name, LARGEST_DEVICE_NAME, "%s/temp2_input", dir_name);
-
   while (read_retry < 5) {
-    if (read_device(full_name, &tmp)) {
+    if (hwmon_read_int(device, "temp2_input", &tmp)) {
       msleep(50);
       read_retry++;
     }
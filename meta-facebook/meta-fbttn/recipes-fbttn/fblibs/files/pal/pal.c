@@ -1456,6 +1456,11 @@ pal_get_fru_sdr_path(uint8_t fru, char *path) {
   return fbttn_sensor_sdr_path(fru, path);
 }
 
+int
+pal_sensor_sdr_path(uint8_t fru, char *path) {
+  return fbttn_sensor_sdr_path(fru, path);
+}
+
 int
 pal_get_fru_sensor_list(uint8_t fru, uint8_t **sensor_list, int *cnt) {
 
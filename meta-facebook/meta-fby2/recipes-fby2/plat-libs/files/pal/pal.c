@@ -3960,6 +3960,39 @@ pal_get_fru_sdr_path(uint8_t fru, char *path) {
   return fby2_sensor_sdr_path(fru, path);
 }
 
+int
+pal_sensor_sdr_path(uint8_t fru, char *path) {
+  return fby2_sensor_sdr_path(fru, path);
+}
+
+int
+pal_get_sensor_access_path(uint8_t fru, uint8_t sensor_num, uint32_t *path, uint8_t *max_reads) {
+  int bus;
+
+  switch(fru) {
+    case FRU_SLOT1:
+    case FRU_SLOT2:
+    case FRU_SLOT3:
+    case FRU_SLOT4:
+      // Each slot is read through its own BIC, one request at a time
+      bus = pal_get_ipmb_bus_id(fru);
+      if (bus < 0)
+        return PAL_ENOTSUP;
+      *path = SENSOR_PATH(SENSOR_PATH_IPMB, bus);
+      break;
+    case FRU_SPB:
+    case FRU_NIC:
+      // Local sensors, pal_sensor_read_raw() keeps POST state for the SPB
+      *path = SENSOR_PATH(SENSOR_PATH_FRU, fru);
+      break;
+    default:
+      return PAL_ENOTSUP;
+  }
+  *max_reads = 1;
+
+  return PAL_EOK;
+}
+
 int
 pal_get_fru_sensor_list(uint8_t fru, uint8_t **sensor_list, int *cnt) {
   int spb_type;
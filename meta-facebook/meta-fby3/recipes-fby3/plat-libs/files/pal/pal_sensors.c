@@ -2898,6 +2898,47 @@ pal_sensor_read_raw(uint8_t fru, uint8_t sensor_num, void *value) {
   return 0;
 }
 
+int
+pal_get_sensor_access_path(uint8_t fru, uint8_t sensor_num, uint32_t *path, uint8_t *max_reads) {
+  int bus;
+
+  // A BIC answers one IPMB request at a time, and the 2U expansion
+  // sensors are read through slot1's BIC, so they share its path.
+  // That also keeps the config_status of slot1 in pal_sensor_read_raw()
+  // to a single reader.
+  switch(fru) {
+    case FRU_SLOT1:
+    case FRU_SLOT2:
+    case FRU_SLOT3:
+    case FRU_SLOT4:
+      bus = fby3_common_get_bus_id(fru);
+      if ( bus < 0 ) {
+        return PAL_ENOTSUP;
+      }
+      *path = SENSOR_PATH(SENSOR_PATH_IPMB, bus);
+      break;
+    case FRU_2U_TOP:
+    case FRU_2U_BOT:
+      bus = fby3_common_get_bus_id(FRU_SLOT1);
+      if ( bus < 0 ) {
+        return PAL_ENOTSUP;
+      }
+      *path = SENSOR_PATH(SENSOR_PATH_IPMB, bus);
+      break;
+    // BMC and NIC sensors are local, keep one path per FRU since the
+    // 2nd source HSC setup in pal_sensor_read_raw() is not reentrant.
+    case FRU_BMC:
+    case FRU_NIC:
+      *path = SENSOR_PATH(SENSOR_PATH_FRU, fru);
+      break;
+    default:
+      return PAL_ENOTSUP;
+  }
+  *max_reads = 1;
+
+  return PAL_EOK;
+}
+
 int
 pal_get_sensor_name(uint8_t fru, uint8_t sensor_num, char *name) {
   switch(fru) {
@@ -15,6 +15,7 @@
 #include <openbmc/ipmb.h>
 #include <openbmc/obmc-sensors.h>
 #include <openbmc/obmc-i2c.h>
+#include <openbmc/hwmon-cache.h>
 #include <facebook/fbgc_gpio.h>
 #include <facebook/bic.h>
 #include "pal.h"
@@ -1129,37 +1130,17 @@ read_current_iocm(uint8_t id, float *value) {
 
 int
 get_current_dir(const char *device, char *dir_name) {
-  char cmd[MAX_PATH_LEN + 1] = {0};
-  FILE *fp = NULL;
-  int size = 0;
-
   if (device == NULL || dir_name == NULL) {
     syslog(LOG_ERR, "%s: Invalid parameter", __func__);
     return -1;
   }
 
-  // Get current working directory
-  snprintf(cmd, sizeof(cmd), "cd %s;pwd", device);
-
-  fp = popen(cmd, "r");
-  if (fp == NULL) {
-     syslog(LOG_ERR, "%s: popen failed, error: %s ", __func__, strerror(errno));
-     return -1;
-  }
-  if (fgets(dir_name, MAX_PATH_LEN, fp) == NULL) {
-     syslog(LOG_ERR, "%s: fget() failed, error: %s ", __func__, strerror(errno));
-     pclose(fp);
-     return -1;
-  }
-
-  if (pclose(fp) == -1) {
-     syslog(LOG_ERR, "%s: pclose() failed, error %s", __func__, strerror(errno));
+  // The glob is expanded once and cached until the device is rebound
+  if (hwmon_resolve(device, dir_name, MAX_PATH_LEN) < 0) {
+    syslog(LOG_ERR, "%s: failed to resolve %s, error: %s", __func__, device, strerror(errno));
+    return -1;
   }
 
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  dir_name[size - 1] = '\0';
-
   return 0;
 }
 
@@ -1221,19 +1202,13 @@ write_device(const char *device, const char *value) {
 static int
 read_ads1015(uint8_t id, float *value) {
   int read_value = 0;
-  char full_dir_name[MAX_PATH_LEN * 2] = {0};
-  char dir_name[MAX_PATH_LEN] = {0};
-
-  if (get_current_dir(IOCM_VOLTAGE_SENSOR_DIR, dir_name) < 0) {
-    syslog(LOG_WARNING, "%s() Failed to get dir: %s\n", __func__, IOCM_VOLTAGE_SENSOR_PATH);
-    return ERR_SENSOR_NA;
-  }
+  char attr[MAX_PATH_LEN] = {0};
 
-  snprintf(full_dir_name, sizeof(full_dir_name), IOCM_VOLTAGE_SENSOR_PATH, dir_name, id);
+  snprintf(attr, sizeof(attr), IOCM_VOLTAGE_SENSOR_ATTR, id);
 
-  if (read_device(full_dir_name, &read_value) < 0) {
+  if (hwmon_read_int(IOCM_VOLTAGE_SENSOR_DIR, attr, &read_value) < 0) {
 #ifdef DEBUG
-     syslog(LOG_WARNING, "%s() Failed to read device: %s\n", __func__, full_dir_name);
+     syslog(LOG_WARNING, "%s() Failed to read device: %s/%s\n", __func__, IOCM_VOLTAGE_SENSOR_DIR, attr);
 #endif
      return ERR_SENSOR_NA;
   }
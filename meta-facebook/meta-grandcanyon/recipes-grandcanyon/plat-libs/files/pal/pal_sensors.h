@@ -38,7 +38,7 @@
 
 // ADS1015 INFO
 #define IOCM_VOLTAGE_SENSOR_DIR      "/sys/bus/i2c/devices/13-0049/iio\\:device*"
-#define IOCM_VOLTAGE_SENSOR_PATH     "%s/in_voltage%d_raw"
+#define IOCM_VOLTAGE_SENSOR_ATTR     "in_voltage%d_raw"
 #define ADS1015_PGA_DEFAULT          (2048)  // unit: mV
 #define ADS1015_DIV_UNIT             (1000)  // mV -> V
 
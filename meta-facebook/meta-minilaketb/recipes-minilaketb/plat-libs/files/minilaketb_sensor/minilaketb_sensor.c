@@ -31,6 +31,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <openbmc/obmc-i2c.h>
+#include <openbmc/hwmon-cache.h>
 #include "minilaketb_sensor.h"
 #include <openbmc/nvme-mi.h>
 
@@ -660,50 +661,11 @@ read_m2_temp_on_gp(char *device, uint8_t sensor_num, float *value) {
   return 0;
 }
 
-static int
-get_current_dir(const char *device, char *dir_name) {
-  char cmd[LARGEST_DEVICE_NAME + 1];
-  FILE *fp;
-  int ret=-1;
-  int size;
-
-  // Get current working directory
-  snprintf(
-      cmd, LARGEST_DEVICE_NAME, "cd %s;pwd", device);
-
-  fp = popen(cmd, "r");
-  if(NULL == fp)
-     return -1;
-  fgets(dir_name, LARGEST_DEVICE_NAME, fp);
-
-  ret = pclose(fp);
-  if(-1 == ret)
-     syslog(LOG_ERR, "$s pclose() fail ", __func__);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  dir_name[size-1] = '\0';
-
-  return 0;
-}
-
-
 static int
 read_temp_attr(const char *device, const char *attr, float *value) {
-  char full_dir_name[LARGEST_DEVICE_NAME + 1];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
 
-  // Get current working directory
-  if (get_current_dir(device, dir_name))
-  {
-    return -1;
-  }
-  snprintf(
-      full_dir_name, LARGEST_DEVICE_NAME, "%s/%s", dir_name, attr);
-
-
-  if (read_device(full_dir_name, &tmp)) {
+  if (hwmon_read_int(device, attr, &tmp)) {
      return -1;
   }
 
@@ -739,19 +701,9 @@ read_adc_value(const int pin, const char *device, float *value) {
 
 static int
 read_hsc_value(const char* attr, const char *device, float r_sense, float *value) {
-  char full_dir_name[LARGEST_DEVICE_NAME];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
 
-  // Get current working directory
-  if (get_current_dir(device, dir_name))
-  {
-    return -1;
-  }
-  snprintf(
-      full_dir_name, LARGEST_DEVICE_NAME, "%s/%s", dir_name, attr);
-
-  if(read_device(full_dir_name, &tmp)) {
+  if (hwmon_read_int(device, attr, &tmp)) {
     return -1;
   }
 
@@ -1861,6 +1861,11 @@ pal_get_fru_sdr_path(uint8_t fru, char *path) {
   return minilaketb_sensor_sdr_path(fru, path);
 }
 
+int
+pal_sensor_sdr_path(uint8_t fru, char *path) {
+  return minilaketb_sensor_sdr_path(fru, path);
+}
+
 int
 pal_get_fru_sensor_list(uint8_t fru, uint8_t **sensor_list, int *cnt) {
 
@@ -49,6 +49,7 @@
 #include <openbmc/sensor-correction.h>
 #include <openbmc/misc-utils.h>
 #include <openbmc/log.h>
+#include <openbmc/hwmon-cache.h>
 
 #define RUN_SHELL_CMD(_cmd)                              \
   do {                                                   \
@@ -81,13 +82,8 @@ typedef struct {
   char name[32];
 } _sensor_thresh_t;
 
-typedef struct {
-  char name[NAME_MAX];
-} sensor_path_t;
-
 static sensor_desc_t m_snr_desc[MAX_NUM_FRUS][MAX_SENSOR_NUM + 1] = {0};
 static struct threadinfo t_dump[MAX_NUM_FRUS] = {0, };
-static sensor_path_t snr_path[MAX_NUM_FRUS][MAX_SENSOR_NUM + 1] = {0};
 
 /* List of BIC Discrete sensors to be monitored */
 const uint8_t bic_discrete_list[] = {
@@ -2337,62 +2333,10 @@ pal_set_server_power(uint8_t slot_id, uint8_t cmd) {
   return 0;
 }
 
-static int
-get_current_dir(const char *device, char *dir_name) {
-  char cmd[LARGEST_DEVICE_NAME + 1];
-  FILE *fp;
-  int size;
-
-  // Get current working directory
-  snprintf(cmd, sizeof(cmd), "cd %s;pwd", device);
-
-  fp = popen(cmd, "r");
-  if(NULL == fp)
-     return -1;
-
-  if (fgets(dir_name, LARGEST_DEVICE_NAME, fp) == NULL) {
-    pclose(fp);
-    return -1;
-  }
-
-  if (pclose(fp) == -1)
-     OBMC_ERROR(errno, "pclose(%s) failed", cmd);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  if (size > 0 && isspace(dir_name[size - 1]))
-    dir_name[size - 1] = '\0';
-
-  return 0;
-}
-
 static int
 check_and_read_sensor_value(uint8_t fru, uint8_t snr_num, const char *device,
                             const char *attr, int *value) {
-  char dir_name[LARGEST_DEVICE_NAME + 1];
-
-  if (snr_path[fru][snr_num].name != NULL) {
-    if (!read_device(snr_path[fru][snr_num].name, value))
-      return 0;
-  }
-
-  if (strstr(device, "hwmon*") != NULL) {
-    /* Get current working directory */
-    if (get_current_dir(device, dir_name)) {
-      return -1;
-    }
-    snprintf(snr_path[fru][snr_num].name, sizeof(snr_path[fru][snr_num].name),
-             "%s/%s", dir_name, attr);
-  } else {
-    snprintf(snr_path[fru][snr_num].name, sizeof(snr_path[fru][snr_num].name),
-             "%s/%s", device, attr);
-  }
-
-  if (read_device(snr_path[fru][snr_num].name, value)) {
-    return -1;
-  }
-
-  return 0;
+  return hwmon_read_int(device, attr, value);
 }
 
 static int
@@ -44,6 +44,7 @@
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/sensor-correction.h>
 #include <openbmc/misc-utils.h>
+#include <openbmc/hwmon-cache.h>
 #include <facebook/bic.h>
 #include <facebook/wedge_eeprom.h>
 #include "pal_sensors.h"
@@ -2076,50 +2077,9 @@ static int check_dir_exist(const char *device) {
   return 0;
 }
 
-static int
-get_current_dir(const char *device, char *dir_name) {
-  char cmd[LARGEST_DEVICE_NAME + 1];
-  FILE *fp;
-  int ret=-1;
-  int size;
-
-  // Get current working directory
-  snprintf(
-      cmd, LARGEST_DEVICE_NAME, "cd %s;pwd", device);
-
-  fp = popen(cmd, "r");
-  if(NULL == fp)
-     return -1;
-  if (fgets(dir_name, LARGEST_DEVICE_NAME, fp) == NULL) {
-    pclose(fp);
-    return -1;
-  }
-
-  ret = pclose(fp);
-  if(-1 == ret)
-     OBMC_ERROR(-1, "%s pclose() fail ", __func__);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  dir_name[size-1] = '\0';
-
-  return 0;
-}
-
 static int
 read_attr_integer(const char *device, const char *attr, int *value) {
-  char full_name[LARGEST_DEVICE_NAME * 2];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
-
-  // Get current working directory
-  if (get_current_dir(device, dir_name)) {
-    return -1;
-  }
-
-  snprintf(
-      full_name, sizeof(full_name), "%s/%s", dir_name, attr);
-
-  if (device_read(full_name, value)) {
+  if (hwmon_read_int(device, attr, value)) {
     return -1;
   }
 
@@ -2128,19 +2088,9 @@ read_attr_integer(const char *device, const char *attr, int *value) {
 
 static int
 read_attr(const char *device, const char *attr, float *value) {
-  char full_name[LARGEST_DEVICE_NAME * 2];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
 
-  // Get current working directory
-  if (get_current_dir(device, dir_name)) {
-    return -1;
-  }
-
-  snprintf(
-      full_name, sizeof(full_name), "%s/%s", dir_name, attr);
-
-  if (device_read(full_name, &tmp)) {
+  if (hwmon_read_int(device, attr, &tmp)) {
     return -1;
   }
 
@@ -2152,19 +2102,9 @@ read_attr(const char *device, const char *attr, float *value) {
 static int
 read_hsc_attr(const char *device,
               const char* attr, float r_sense, float *value) {
-  char full_dir_name[LARGEST_DEVICE_NAME * 2];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
 
-  // Get current working directory
-  if (get_current_dir(device, dir_name))
-  {
-    return -1;
-  }
-  snprintf(
-      full_dir_name, sizeof(full_dir_name), "%s/%s", dir_name, attr);
-
-  if (device_read(full_dir_name, &tmp)) {
+  if (hwmon_read_int(device, attr, &tmp)) {
     return -1;
   }
 
@@ -2185,19 +2125,11 @@ read_hsc_curr(const char *device, float r_sense, float *value) {
 
 static int
 read_fan_rpm_f(const char *device, uint8_t fan, float *value) {
-  char full_name[LARGEST_DEVICE_NAME * 2];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   char device_name[11];
   int tmp;
 
-  /* Get current working directory */
-  if (get_current_dir(device, dir_name)) {
-    return -1;
-  }
-
   snprintf(device_name, 11, "fan%d_input", fan);
-  snprintf(full_name, sizeof(full_name), "%s/%s", dir_name, device_name);
-  if (device_read(full_name, &tmp)) {
+  if (hwmon_read_int(device, device_name, &tmp)) {
     return -1;
   }
 
@@ -2208,24 +2140,13 @@ read_fan_rpm_f(const char *device, uint8_t fan, float *value) {
 
 static int
 read_fan_rpm(const char *device, uint8_t fan, int *value) {
-  char full_name[LARGEST_DEVICE_NAME * 2];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   char device_name[11];
-  int tmp;
-
-  /* Get current working directory */
-  if (get_current_dir(device, dir_name)) {
-    return -1;
-  }
 
   snprintf(device_name, 11, "fan%d_input", fan);
-  snprintf(full_name, sizeof(full_name), "%s/%s", dir_name, device_name);
-  if (device_read(full_name, &tmp)) {
+  if (hwmon_read_int(device, device_name, value)) {
     return -1;
   }
 
-  *value = tmp;
-
   return 0;
 }
 
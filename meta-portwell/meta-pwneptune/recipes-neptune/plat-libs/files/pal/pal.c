@@ -38,6 +38,7 @@
 #include <sys/stat.h>
 #include <openbmc/gpio.h>
 #include <openbmc/kv.h>
+#include <openbmc/hwmon-cache.h>
 #include <openbmc/sensor-correction.h>
 
 #define BIT(value, index) ((value >> index) & 1)
@@ -1154,11 +1155,7 @@ write_device(const char *device, const char *value) {
 
 static int
 read_temp_attr(uint8_t sensor_num, const char *device, const char *attr, float *value) {
-  char full_name[LARGEST_DEVICE_NAME + 1];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
-  FILE *fp;
-  int size;
   static unsigned int retry[4] = {0};
   uint8_t i_retry = -1;
 
@@ -1175,22 +1172,7 @@ read_temp_attr(uint8_t sensor_num, const char *device, const char *attr, float *
       break;
   }
 
-  // Get current working directory
-  snprintf(
-      full_name, LARGEST_DEVICE_NAME, "cd %s;pwd", device);
-
-  fp = popen(full_name, "r");
-  fgets(dir_name, LARGEST_DEVICE_NAME, fp);
-  pclose(fp);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  dir_name[size-1] = '\0';
-
-  snprintf(
-      full_name, LARGEST_DEVICE_NAME, "%s/%s", dir_name, attr);
-
-  if (read_device(full_name, &tmp)) {
+  if (hwmon_read_int(device, attr, &tmp)) {
     return -1;
   }
 
@@ -1214,30 +1196,11 @@ read_temp(uint8_t sensor_num, const char *device, float *value) {
 
 static int
 read_nic_temp(const char *device, float *value) {
-  char full_name[LARGEST_DEVICE_NAME + 1];
-  char dir_name[LARGEST_DEVICE_NAME + 1];
   int tmp;
-  FILE *fp;
-  int size;
   int ret = 0;
   static unsigned int retry = 0;
 
-  // Get current working directory
-  snprintf(
-      full_name, LARGEST_DEVICE_NAME, "cd %s;pwd", device);
-
-  fp = popen(full_name, "r");
-  fgets(dir_name, LARGEST_DEVICE_NAME, fp);
-  pclose(fp);
-
-  // Remove the newline character at the end
-  size = strlen(dir_name);
-  dir_name[size-1] = '\0';
-
-  snprintf(
-      full_name, LARGEST_DEVICE_NAME, "%s/temp2_input", dir_name);
-
-  if (read_device(full_name, &tmp)) {
+  if (hwmon_read_int(device, "temp2_input", &tmp)) {
     ret = READING_NA;
   }
 